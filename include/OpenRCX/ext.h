@@ -75,6 +75,15 @@ class Ext
                        int                pattern,
                        bool               keep_file,
                        int                metal);
+  bool define_rules_solver(int                jobs,
+                           const std::string& command,
+                           int                retries,
+                           const std::string& cache,
+                           int                metal_jobs,
+                           double             max_error);
+  bool solve_deck(const std::string& deck,
+                  const std::string& out,
+                  const std::string& command);
   bool write_rules(const std::string& name,
                    const std::string& dir,
                    const std::string& file,
@@ -177,9 +186,19 @@ class Ext
     bool        lef_rc              = false;
     bool        lef_res             = false;
     bool        rlog                = false;
+    const char* spef_file           = nullptr;
+    bool        release_parasitics  = false;
+    const char* block_cache_dir     = nullptr;
+    const char* index_file          = nullptr;
+    const char* net_cache_file      = nullptr;
+    const char* measure_log_file    = nullptr;
+    int         compact_rules       = 0;
   };
 
   bool extract(ExtractOptions options);
+  bool reevaluate_parasitics(const std::string& log_file,
+                             const std::string& rules_file);
+  bool verify_compact_rules(const std::string& file, int order);
 
   bool define_process_corner(int ext_model_index, const std::string& name);
   bool define_derived_corner(const std::string& name,
@@ -226,10 +245,16 @@ class Ext
     const char* exclude_cells    = nullptr;
     const char* cap_units        = "PF";
     const char* res_units        = "OHM";
+    const char* reuse_file       = nullptr;
   };
   bool write_spef(const SpefOptions& options);
 
   bool independent_spef_corner();
+
+  bool write_parasitics_binary(const std::string& file, bool float64);
+  bool read_parasitics_binary(const std::string& file,
+                              const std::string& nets);
+  bool remove_parasitics();
   
   struct ReadSpefOpts {
     const char* file = nullptr;
@@ -258,6 +283,7 @@ class Ext
     bool               no_cap_num_collapse = false;
     const char* cap_node_map_file = nullptr;
     bool               log = false;
+    int                threads = 1;
   };
 
   bool read_spef(ReadSpefOpts& opt);
@@ -282,6 +308,9 @@ class Ext
        float              upper_guard = -1;
        bool               m_map = false;
        bool               log = false;
+       bool               stream = false;
+       bool               detail = false;
+       int                threads = 1;
   };
 
   bool diff_spef(const DiffOptions& opt);
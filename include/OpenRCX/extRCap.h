@@ -159,6 +159,13 @@ class extGeoThickTable
 };
 
 class extSpef;
+class extSpefNameCache;
+class extBlockContext;
+struct extHierNetPlan;
+class extHash;
+class extSearchIndex;
+class extNetCache;
+class extMeasureLog;
 
 class extDistRC
 {
@@ -192,6 +199,15 @@ class extDistRC
   friend class extMeasure;
   friend class extMain;
 };
+// verify_compact_rules: fit tables against the dense compute tables
+struct extFitStats
+{
+  uint   _tableCnt;
+  uint   _pointCnt;
+  double _maxErr[3];  // relative: coupling, fringe, res
+  double _denseBytes;
+  double _fitBytes;
+};
 class extDistRCTable
 {
  private:
@@ -202,8 +218,15 @@ class extDistRCTable
   Ath__array1D<extDistRC*>* _computeTable;
   uint                      _unit;
 
+  // extract_parasitics -compact_rules: polynomial pieces over the measured
+  // points instead of _computeTable
+  uint    _fitOrder;  // 1: linear, 3: monotone cubic
+  uint    _fitCnt;    // measured points used as knots
+  double* _fitSlope;  // cubic: coupling, fringe, res slope per knot
+
   void makeCapTableOver();
   void makeCapTableUnder();
+  uint getKnotCnt(int& maxDist, AthPool<extDistRC>* rcPool);
 
  public:
   extDistRCTable(uint distCnt);
@@ -216,9 +239,8 @@ class extDistRCTable
   void       makeComputeTable(uint maxDist, uint distUnit);
   extDistRC* getLastRC();
   extDistRC* getRC_index(int n);
-  extDistRC* getComputeRC(double dist);
-  extDistRC* getComputeRC(uint dist);
-  extDistRC* getRC(uint s, bool compute);
+  extDistRC* getComputeRC(uint dist, extDistRC* fitRC = NULL);
+  extDistRC* getRC(uint s, bool compute, extDistRC* fitRC = NULL);
   uint       writeRules(FILE*                     fp,
                         Ath__array1D<extDistRC*>* table,
                         double                    w,
@@ -241,8 +263,12 @@ class extDistRCTable
                        bool                compute,
                        bool                bin,
                        bool                ignore,
-                       double              dbFactor = 1.0);
+                       double              dbFactor = 1.0,
+                       uint                fitOrder = 0);
   uint interpolate(uint distUnit, int maxDist, AthPool<extDistRC>* rcPool);
+  uint makeFitTable(uint distUnit, uint order, AthPool<extDistRC>* rcPool);
+  bool       getFitRC(uint n, extDistRC* rc);
+  void       compareFitTable(extDistRCTable* dense, extFitStats* stats);
   uint mapInterpolate(extDistRC*          rc1,
                       extDistRC*          rc2,
                       uint                distUnit,
@@ -340,29 +366,34 @@ class extDistWidthRCTable
                            uint         widthCnt,
                            bool         bin,
                            bool         ignore,
-                           double       dbFactor = 1.0);
+                           double       dbFactor = 1.0,
+                           uint         fitOrder = 0);
   uint       readRulesUnder(Ath__parser* parser,
                             uint         widthCnt,
                             bool         bin,
                             bool         ignore,
-                            double       dbFactor = 1.0);
+                            double       dbFactor = 1.0,
+                            uint         fitOrder = 0);
   uint       readRulesDiagUnder(Ath__parser* parser,
                                 uint         widthCnt,
                                 uint         diagWidthCnt,
                                 uint         diagDistCnt,
                                 bool         bin,
                                 bool         ignore,
-                                double       dbFactor = 1.0);
+                                double       dbFactor = 1.0,
+                                uint         fitOrder = 0);
   uint       readRulesDiagUnder(Ath__parser* parser,
                                 uint         widthCnt,
                                 bool         bin,
                                 bool         ignore,
-                                double       dbFactor = 1.0);
+                                double       dbFactor = 1.0,
+                                uint         fitOrder = 0);
   uint       readRulesOverUnder(Ath__parser* parser,
                                 uint         widthCnt,
                                 bool         bin,
                                 bool         ignore,
-                                double       dbFactor = 1.0);
+                                double       dbFactor = 1.0,
+                                uint         fitOrder = 0);
   uint       readMetalHeader(Ath__parser* parser,
                              uint&        met,
                              const char*  keyword,
@@ -370,14 +401,20 @@ class extDistWidthRCTable
                              bool         ignore);
 
   // extDistRC* getRC(uint mou, double w, double s);
-  extDistRC* getRC(uint mou, uint w, uint s);
-  extDistRC* getRC(uint mou, uint w, uint dw, uint ds, uint s);
+  extDistRC* getRC(uint mou, uint w, uint s, extDistRC* fitRC = NULL);
+  extDistRC* getRC(uint       mou,
+                   uint       w,
+                   uint       dw,
+                   uint       ds,
+                   uint       s,
+                   extDistRC* fitRC = NULL);
   extDistRC* getFringeRC(uint mou, uint w, int index_dist=-1);
   void       getFringeTable(uint                  mou,
                             uint                  w,
                             Ath__array1D<int>*    sTable,
                             Ath__array1D<double>* rcTable,
                             bool                  map);
+  void       compareFitTables(extDistWidthRCTable* dense, extFitStats* stats);
 
   extDistRC* getLastWidthFringeRC(uint mou);
   extDistRC* getRC_99(uint mou, uint w, uint dw, uint ds);
@@ -436,6 +473,7 @@ class extMetRCTable
   extDistRC* getOverFringeRC(extMeasure* m, int index_dist=-1);
   extDistRC* getOverFringeRC_last(int met, int width);
 	AthPool<extDistRC>* getRCPool();
+  void       compareFitTables(extMetRCTable* dense, extFitStats* stats);
 };
 class extRCTable
 {
@@ -458,6 +496,75 @@ class extMain;
 class extMeasure;
 class extMainOptions;
 
+// one pattern deck queued for the rules_gen solver jobs
+struct extSolverJob
+{
+  std::string _dir;
+  std::string _file;
+  std::string _option;
+  int         _pid;
+  uint        _tryCnt;
+  uint64_t    _cacheKey;  // 0 when define_rules_solver has no -cache
+};
+
+// "Charge on <name> = <cap>" line of a solver output
+struct extSolverCharge
+{
+  const char* _line;  // in the mapped output, for caps.log
+  uint        _lineLen;
+  int         _met;   // M<met>_w<wire>; 0 when the name is no wire
+  int         _wire;  // -1 when the name has no w<wire>
+  double      _cap;   // as written by the solver
+};
+
+// solver output mapped in memory and parsed in place
+class extSolverOutput
+{
+ public:
+  extSolverOutput();
+  ~extSolverOutput();
+
+  bool        read(const char* fileName);
+  void        printCharge(FILE* fp, extSolverCharge* c);
+  static void parseWireName(const char* name, uint len, int& met, int& wire);
+
+  std::string                  _fileName;
+  bool                         _potential;  // has the "*** POTENTIAL" header
+  std::vector<extSolverCharge> _chargeTable;
+
+ private:
+  void parse();
+
+  char*  _buf;
+  size_t _size;
+};
+
+// pattern of a bench_wires -db_only net, kept in its _benchPattern property
+enum extBenchPatternKind
+{
+  BENCH_OVER       = 0,
+  BENCH_UNDER      = 1,
+  BENCH_OVER_UNDER = 2,
+  BENCH_DIAG       = 3
+};
+struct extBenchPattern
+{
+  odb::dbNet* _net;
+  int         _kind;
+  int         _met;
+  int         _overMet;   // metal above the pattern, -1 for none
+  int         _underMet;  // metal below the pattern, -1 for none
+  double      _w;         // width and spacing in nm, as in the net name
+  double      _s;
+
+  // from the parasitics of the net
+  uint   _len;
+  double _totCC;
+  double _totGnd;
+  double _res;
+  double _cntxCC;
+};
+
 class extRCModel
 {
  private:
@@ -507,6 +614,46 @@ class extRCModel
 
   extMain* _extMain;
 
+  // define_rules_solver: decks are queued, run concurrently, then read back
+  uint                       _solverJobCnt;
+  uint                       _solverRetryCnt;
+  std::string                _solverCmd;
+  bool                       _queueSolverJobs;
+  bool                       _readAfterJobs;
+  std::vector<extSolverJob*> _solverJobTable;
+
+  // define_rules_solver -cache: solver outputs keyed by the deck content
+  std::string _solverCacheDir;
+  uint        _solverCacheHitCnt;
+  uint        _solverCacheMissCnt;
+
+  // define_rules_solver -metal_jobs: models of the metals, own the pools of
+  // the tables merged into this model
+  std::vector<extRCModel*> _metalWorkerTable;
+
+  // define_rules_solver: outputs of the queued decks, parsed on threads once
+  // the jobs are done and taken by the pattern reads
+  std::vector<std::string>                _solverOutputNames;
+  std::map<std::string, extSolverOutput*> _solverOutputTable;
+
+  // readRules: pools of the tables of the Metal sections read on threads
+  std::vector<AthPool<extDistRC>*> _rulesPoolTable;
+
+  // getSharedRules: extMain instances holding the model, 0 for a model of
+  // its own
+  uint _sharedRefCnt;
+
+  // extract_parasitics -compact_rules: fit order of the distance tables, 0
+  // for the dense compute tables
+  uint _fitOrder;
+
+  // define_rules_solver -max_error: spacings left to the interpolation of
+  // the rules tables while it stays within the error budget (percent)
+  double _solverMaxError;
+  bool   _deferAddRC;
+  uint   _adaptiveSolveCnt;
+  uint   _adaptiveSkipCnt;
+
  public:
   extMetRCTable* getMetRCTable(uint ii) { return _modelTable[ii]; };
 
@@ -623,6 +770,58 @@ class extRCModel
   bool  solverStep(extMeasure* m);
   void  cleanFiles();
 
+  void setSolverJobs(uint        jobCnt,
+                     const char* cmd,
+                     uint        retryCnt,
+                     const char* cacheDir);
+  void setSolverMaxError(double maxError);
+  void reportAdaptiveSpacing();
+  bool queueSolverJobs();
+  bool runSolverJobs();
+  bool mkSolverCmd(char*       cmd,
+                   uint        cmdSize,
+                   const char* option,
+                   const char* dir,
+                   const char* file);
+  bool startSolverJob(extSolverJob* job);
+  bool solverOutputValid(const char* dir, const char* file);
+  static bool writeStubSolverOutput(const char* deck, const char* out);
+  void runSolverProcesses(uint& doneCnt, uint& failCnt, uint& retryCnt);
+  void runBuiltinSolverJobs(uint& doneCnt, uint& failCnt);
+  static bool runBuiltinSolver(const char* deck, const char* out);
+  uint64_t    solverDeckKey(const char*       dir,
+                            const char*       file,
+                            const char*       option,
+                            std::vector<int>& metals);
+  bool        readSolverCache(const char* dir,
+                              const char* file,
+                              const char* option,
+                              uint64_t&   key);
+  void        saveSolverCache(const char* dir, const char* file, uint64_t key);
+  void        reportSolverCache();
+  void        setMetalOptions(extRCModel* m, const char* topDir, uint met);
+  void        mergeMetalTables(extRCModel* w, uint met);
+
+  void             readSolverOutputs();
+  extSolverOutput* getSolverOutput();
+  void             beginCapLog(extMeasure* m, bool printWires, bool wires3D);
+  void             addBenchCharge(extMeasure* m,
+                                  int         met,
+                                  int         wire,
+                                  double      cap,
+                                  uint&       cnt);
+  void             addDiagCharge(extMeasure* m,
+                                 int         diagMet,
+                                 int         met,
+                                 int         wire,
+                                 double      cap,
+                                 uint&       cnt);
+  void             addBench3DCharge(extMeasure* m,
+                                    int         wire,
+                                    double      cap,
+                                    uint&       cnt);
+  void             sortBench3DCharges(extMeasure* m, uint cnt);
+
   extDistRC* measurePattern(uint   met,
                             int    underMet,
                             int    overMet,
@@ -740,6 +939,35 @@ class extRCModel
                                   bool         diag,
                                   bool         ignore,
                                   double       dbFactor = 1.0);
+  uint readRulesTables(Ath__parser*          parser,
+                       extMetRCTable*        rcTable,
+                       uint                  met,
+                       Ath__array1D<double>* wTable,
+                       const char*           ouKey,
+                       bool                  over,
+                       bool                  under,
+                       bool                  bin,
+                       bool                  diag,
+                       double                dbFactor);
+  static extRCModel* getSharedRules(const char* name,
+                                    const char* fileName,
+                                    uint        cornerCnt,
+                                    uint*       cornerTable,
+                                    double      dbFactor,
+                                    uint        fitOrder = 0);
+  static void        releaseSharedRules(extRCModel* m);
+  bool               isSharedRules() { return _sharedRefCnt > 0; }
+  bool readRulesParallel(const char* name,
+                         bool        bin,
+                         bool        over,
+                         bool        under,
+                         bool        overUnder,
+                         bool        diag,
+                         uint        cornerCnt,
+                         uint*       cornerTable,
+                         double      dbFactor);
+  void setFitOrder(uint order) { _fitOrder = order; };
+  void compareFitTables(extRCModel* dense, extFitStats* stats);
 
   extDistRC* getOverFringeRC(uint met, uint underMet, uint width);
   double     getFringeOver(uint met, uint mUnder, uint w, uint s);
@@ -769,10 +997,11 @@ class extRCModel
 	uint benchDB_WS(extMainOptions* opt, extMeasure* measure);
 	int writeBenchWires_DB(extMeasure* measure);
 	int writeBenchWires_DB_diag(extMeasure* measure);
+	void mkBenchPatternProperty(extMeasure* m);
 	extMetRCTable* initCapTables(uint layerCnt, uint widthCnt);
 
 	extDistRC* getMinRC(int met, int width);
-	extDistRC* getMaxRC(int met, int width, int dist);
+	extDistRC* getMaxRC(int met, int width, int dist, extDistRC* fitRC);
 };
 class extNetStats
 {
@@ -977,6 +1206,7 @@ class extMeasure
 
   void measureRC(int* options);
 	int computeAndStoreRC(odb::dbRSeg *rseg1, odb::dbRSeg *rseg2, int srcCovered);
+  int  storeRC(odb::dbRSeg* rseg1, odb::dbRSeg* rseg2, int totLenCovered);
 	int computeAndStoreRC_720(odb::dbRSeg *rseg1, odb::dbRSeg *rseg2, int srcCovered);
 	void OverSubRC(odb::dbRSeg *rseg1, odb::dbRSeg *rseg2, int ouCovered, int diagCovered, int srcCovered);
 	void OverSubRC_dist(odb::dbRSeg *rseg1, odb::dbRSeg *rseg2, int ouCovered, int diagCovered, int srcCovered);
@@ -1217,6 +1447,7 @@ class extMeasure
 
   extDistRC*           _rc[20];
   extDistRC*           _tmpRC;
+  extDistRC            _fitRC;  // compact rules lookup, until the next one
   bool                 _rcValid;
   extRCTable*          _capTable;
   Ath__array1D<double> _widthTable;
@@ -1316,6 +1547,27 @@ class extMeasure
 
   bool _rotatedGs;
 
+  // extract_parasitics -measure_log record kinds
+  enum MEASURE_LOG_KIND
+  {
+    MLG_EVENT,
+    MLG_OVER,
+    MLG_UNDER,
+    MLG_OVER_UNDER,
+    MLG_DIAG,
+    MLG_DIAG_WIDTH
+  };
+  extMeasureLog* _measureLog;
+  void           logCoverage(uint kind, uint len);
+  void           logDiag(uint kind,
+                         int  rsegId1,
+                         uint rsegId2,
+                         uint len,
+                         uint diagWidth,
+                         uint diagDist,
+                         uint tgtMet);
+  void           logEvent(int totLenCovered);
+
   odb::dbCreateNetUtil _create_net_util;
   int _dbunit;
 };
@@ -1574,6 +1826,58 @@ class extMain
   bool       _eco;
   odb::Rect* _ibox;
 
+  // nets whose spef sections changed since the last indexed write_spef
+  std::vector<uint> _ecoNetIds;
+  bool              _spefReuseOk;
+
+  // escaped spef names, kept across write_spef calls on the block
+  extSpefNameCache* _spefNameCache;
+
+  // extract_parasitics -block_cache: entry to save the block parasitics to
+  std::string _blockCacheFile;
+  // the cache and options of the last extraction with -block_cache, for the
+  // child blocks flatten merges
+  std::string _blockCacheDir;
+  std::string _blockCacheOptions;
+  std::string _blockCacheRules;
+  uint        _blockCacheTracks;
+
+  // extract_parasitics -index_file: wire counts and net bboxes of the sweep
+  const char*     _searchIndexFile;
+  extSearchIndex* _searchIndex;
+  bool            _searchIndexWritten;  // by the running extraction
+
+  // extract_parasitics -net_cache: parasitics of unchanged nets across runs
+  const char*  _netCacheFile;
+  extNetCache* _netCache;
+
+  // define_rules_solver: concurrent solver jobs of rules_gen and bench_wires
+  uint        _solverJobCnt;
+  uint        _solverRetryCnt;
+  std::string _solverCmd;
+  std::string _solverCacheDir;
+  uint        _solverMetalJobCnt;
+  double      _solverMaxError;
+  std::string _processName;  // last readProcess, re-read by the metal jobs
+  std::string _processFile;
+
+  // extract_parasitics -compact_rules: fit order of the rules tables read
+  uint _rulesFitOrder;
+
+  // extract_parasitics -measure_log: model inputs of the sweep, for replay
+  const char*    _measureLogFile;
+  extMeasureLog* _measureLog;
+  std::string    _measureLogPath;  // last log written, for reevaluation
+
+  // extract_parasitics -spef: nets behind the final sweep front are written
+  const char*       _retireSpefFile;
+  bool              _retireRelease;
+  bool              _retiring;
+  std::vector<uint> _retireOrder;  // signal net ids by ascending bbox xMax
+  std::vector<int>  _retireMaxX;   // by net id
+  std::vector<char> _retireState;  // by net id: 0 pending, 1 written, 2 freed
+  uint              _retireNext;
+
   bool _getBandWire;
   bool _printBandInfo;
   bool _reuseMetalFill;
@@ -1606,6 +1910,14 @@ class extMain
   double _gndcFactor;
   bool   _gndcModify;
 
+  // adjust_rc factors not applied to the db values yet; derived corners
+  // whose db values are not copied from their process corner. Both are
+  // applied by the spef writer and materialized before other db access.
+  double _pendingResFactor;
+  double _pendingCcFactor;
+  double _pendingGndcFactor;
+  bool   _lazyScaledCorners;
+
   float _netGndcCalibFactor;
   bool  _netGndcCalibration;
 
@@ -2080,6 +2392,8 @@ class extMain
                     uint        cornerCnt);
 
   extRCModel* getRCmodel(uint n);
+  bool        sharedRCmodel(extRCModel* m, const char* cmd);
+  void        releaseRCmodels();
 
   double getLefResistance(uint level, uint width, uint length, uint model);
   double getResistance(uint level, uint width, uint len, uint model);
@@ -2110,6 +2424,8 @@ class extMain
                     int         min,
                     int         typ,
                     int         max);
+  void setRulesFitOrder(uint order);
+  bool verifyCompactRules(const char* filename, uint order);
 
   void          setDB(odb::dbDatabase* db);
   void          setBlock(odb::dbBlock* block);
@@ -2140,6 +2456,51 @@ class extMain
   void unlinkRSeg(std::vector<odb::dbNet*>& nets);
   void unlinkCapNode(std::vector<odb::dbNet*>& nets);
   void removeExt(std::vector<odb::dbNet*>& nets);
+  void recordEcoNets(std::vector<odb::dbNet*>& nets);
+  void setNetRetirement(const char* spefFile, bool release);
+  bool initNetRetirement();
+  uint retireExtractedNets(int limit);
+  void releaseRetiredNets(std::vector<odb::dbNet*>& nets);
+  uint finishNetRetirement();
+  extSpefNameCache* getSpefNameCache();
+  void              clearSpefNameCache();
+  int               couplingHalo(uint ccTracks);
+  uint64_t          blockParasiticsKey(const char*      optionKey,
+                                       const char*      rulesFile,
+                                       uint             ccTracks,
+                                       extBlockContext* ctx);
+  bool              loadBlockCache(const char*      dir,
+                                   const char*      optionKey,
+                                   const char*      rulesFile,
+                                   uint             ccTracks,
+                                   extBlockContext* ctx);
+  void              setBlockCacheOptions(const char* dir,
+                                         const char* optionKey,
+                                         const char* rulesFile,
+                                         uint        ccTracks);
+  bool              loadChildBlockCache(odb::dbBlock* blk);
+  static extBlockContext* newBlockContext(odb::dbBlock* parent);
+  static void             deleteBlockContext(extBlockContext* ctx);
+  void saveBlockCache();
+  static void     hashSWires(extHash& h, odb::dbNet* net);
+  uint64_t        wireChecksum();
+  uint64_t        searchIndexStamp();
+  void            setSearchIndexStamp(uint64_t stamp);
+  void            clearWireAltered(odb::dbNet* net);
+  void     setSearchIndexFile(const char* file);
+  bool     openSearchIndex();
+  void     closeSearchIndex();
+  bool getIndexedWireCounts(uint& signalCnt, uint& maxWidth);
+  void setIndexedWireCounts(uint signalCnt, uint maxWidth);
+  uint getIndexedNetBbox(odb::dbNet* net, odb::Rect& maxRect);
+  uint64_t netCacheOptionKey(const char* rulesFile);
+  void     setNetCacheFile(const char* file);
+  bool     openNetCache(const char* rulesFile, std::vector<odb::dbNet*>& inets);
+  void     closeNetCache();
+  void     setMeasureLogFile(const char* file);
+  bool     openMeasureLog(extMeasure* m);
+  void     closeMeasureLog();
+  uint     reevaluateParasitics(const char* logFile, const char* rulesFile);
   void removeExt();
   void removeCC(std::vector<odb::dbNet*>& nets);
   void removeRSeg(std::vector<odb::dbNet*>& nets);
@@ -2263,8 +2624,17 @@ class extMain
                 bool                 moreToRead      = false,
                 bool                 diff            = false,
                 bool                 calib           = false,
-                int                  app_ptint_limit = 0);
+                int                  app_ptint_limit = 0,
+                uint                 threadCnt       = 1,
+                bool                 streamDiff      = false,
+                bool                 diffDetail      = true);
   uint readSPEFincr(char* filename);
+  uint writeBinaryParasitics(const char* filename,
+                             bool        float64,
+                             bool        quiet = false);
+  uint readBinaryParasitics(const char* filename,
+                            char*       netNames,
+                            bool        quiet = false);
   uint writeSPEF(bool stop);
   uint writeSPEF(uint        netId,
                  bool        single_pi,
@@ -2294,7 +2664,8 @@ class extMain
                  int         corner,
                  const char* corner_name,
                  bool        flatten,
-                 bool        parallel);
+                 bool        parallel,
+                 const char* reuseFile = NULL);
   uint writeNetSPEF(odb::dbNet* net, double resBound, uint debug);
   uint makeITermCapNode(uint id, odb::dbNet* net);
   uint makeBTermCapNode(uint id, odb::dbNet* net);
@@ -2352,6 +2723,16 @@ class extMain
                          bool        readDb = false,
                          bool        readFiles = false);
   uint        benchWires(extMainOptions* options);
+  void        setRulesSolver(uint        jobCnt,
+                             const char* cmd,
+                             uint        retryCnt,
+                             const char* cacheDir,
+                             uint        metalJobCnt,
+                             double      maxError);
+  void        genRulePatterns(extRCModel* m, int pattern, uint met);
+  void        genMetalRulePatterns(extRCModel* m,
+                                   const char* topDir,
+                                   int         pattern);
   uint        GenExtRules(const char *rulesFileName);
   FILE*       getPtFile() { return _ptFile; };
   static void destroyExtSdb(std::vector<odb::dbNet*>& nets, void* ext);
@@ -2412,7 +2793,17 @@ class extMain
   void        getScaledRC(int sidx, double& res, double& cap);
   void        getScaledGndC(int sidx, double& cap);
   void        getScaledCC(int sidx, double& cap);
-  void        genScaledExt();
+  void        genScaledExt(bool copy = false);
+  void        loadLazyRC();
+  void        saveLazyRC();
+  void        applyPendingAdjust();
+  void        applyLazyRC();
+  void        getPendingAdjust(double& res, double& cc, double& gndc);
+  void        getLazyScale(int     dbIndex,
+                           int&    srcDbIndex,
+                           double& res,
+                           double& cc,
+                           double& gndc);
   // void makeCornerNameMap(char *buff, int cornerCnt, bool spef);
   void makeCornerNameMap();
   void getExtractedCorners();
@@ -2661,11 +3052,11 @@ class extMain
 
   // 021710D BEGIN
   uint addRCtoTop(odb::dbBlock* blk, bool write_spef);
-  uint createCapNodes(odb::dbNet* net,
-                      odb::dbNet* parentNet,
-                      uint*       capNodeMap,
-                      uint        baseNum);
-  uint createRSegs(odb::dbNet* net, odb::dbNet* parentNet, uint* capNodeMap);
+  uint createCapNodes(extHierNetPlan& plan,
+                      uint*           capNodeMap,
+                      uint            baseNum,
+                      uint&           maxInternal);
+  uint createRSegs(extHierNetPlan& plan, uint* capNodeMap);
   // uint createCCsegs(odb::dbNet *net, odb::dbNet *parentNet, uint
   // *capNodeMap);
   uint write_spef_nets(bool flatten, bool parallel);
@@ -2687,11 +3078,11 @@ class extMain
   uint adjustParentNode(odb::dbNet*   net,
                         odb::dbITerm* from_child_iterm,
                         uint          node_num);
-  uint createCCsegs(odb::dbNet* net,
-                    odb::dbNet* parentNet,
-                    odb::dbNet* topDummyNet,
-                    uint*       capNodeMap,
-                    uint        baseNum);
+  uint createCCsegs(extHierNetPlan& plan,
+                    odb::dbNet*     topDummyNet,
+                    uint*           capNodeMap,
+                    uint            baseNum,
+                    uint            maxCap);
   // 022110D END
 
   // 022210D BEGIN
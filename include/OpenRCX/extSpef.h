@@ -46,7 +46,11 @@
 
 //#define AFILE FILE
 
+#include <stdint.h>
+
 #include <map>
+#include <string>
+#include <vector>
 
 namespace OpenRCX {
 
@@ -65,6 +69,101 @@ class extRcTripplet
   friend class extSpef;
 };
 
+// Open addressing table of SPEF internal cap nodes keyed by
+// (netMapId, nodeNumber) packed into 64 bits
+class extNodeIdTable
+{
+ private:
+  uint64_t* _keys;
+  uint*     _capIds;  // 0 marks an empty slot
+  uint      _size;    // power of 2
+  uint      _mask;
+  uint      _cnt;
+
+  uint hashSlot(uint64_t key);
+  void reHash(uint size);
+
+ public:
+  extNodeIdTable(uint size);
+  ~extNodeIdTable();
+
+  static uint64_t mkKey(uint netMapId, uint nodeNum)
+  {
+    return ((uint64_t) netMapId << 32) | nodeNum;
+  }
+  uint get(uint netMapId, uint nodeNum);
+  void set(uint netMapId, uint nodeNum, uint capId);
+  uint getCnt() { return _cnt; }
+};
+
+// One *CAP or *RES line of a *D_NET section, as tokenized by the parallel
+// reader; values are stored in extSpefDNetRecord::_vals
+class extSpefDNetEntry
+{
+ public:
+  std::string _node1;
+  std::string _node2;
+  uint        _valIndex;
+  uint        _valCnt;
+};
+
+// Per-net intermediate record filled by the parallel *D_NET parser workers
+class extSpefDNetRecord
+{
+ public:
+  std::string                   _netWord;
+  std::vector<extSpefDNetEntry> _gndCaps;
+  std::vector<extSpefDNetEntry> _ccCaps;
+  std::vector<extSpefDNetEntry> _res;
+  std::vector<double>           _vals;
+  uint                          _badLines;
+  bool                          _hasCap;
+  bool                          _hasRes;
+  bool                          _ended;
+};
+
+// Per-net totals filled by the streaming diff workers; one value per corner
+class extSpefDNetTotals
+{
+ public:
+  std::string         _netWord;
+  std::vector<double> _totCap;
+  std::vector<double> _gndCap;
+  std::vector<double> _ccCap;
+  std::vector<double> _res;
+  uint                _gndCapCnt;
+  uint                _ccCapCnt;
+  uint                _resCnt;
+  bool                _hasRes;
+  bool                _ended;
+};
+
+// Percent error distribution of one quantity compared by the streaming diff
+class extSpefDiffStats
+{
+ public:
+  enum
+  {
+    HIST_BIN_CNT = 9
+  };
+
+  const char*        _name;
+  std::vector<float> _diffs;
+  uint               _hist[HIST_BIN_CNT];
+  double             _sum;
+  double             _sumSq;
+
+  extSpefDiffStats(const char* name);
+  void   add(double percent);
+  double percentile(double p);
+  void   print();
+};
+
+class extSpefBinWriter;
+class extSpefBinReader;
+class extSpefRetireWriter;
+class extSpefNameCache;
+
 class extSpef
 {
  private:
@@ -82,6 +181,21 @@ class extSpef
   //	AFILE *_outFP;
   FILE* _outFP;
 
+  FILE*                 _netIndexFP;
+  int                   _reuseFd;
+  std::vector<uint64_t> _reuseBegin;  // by net id; end 0: not in old file
+  std::vector<uint64_t> _reuseEnd;
+  std::vector<bool>     _reuseDirty;
+  uint64_t              _runBegin;  // pending run of old file bytes
+  uint64_t              _runEnd;
+  uint64_t              _runOutPos;
+  uint                  _reusedCnt;
+
+  extSpefRetireWriter* _retireWriter;  // owns _outFP while retiring nets
+  uint                 _retiredCnt;
+
+  extSpefNameCache* _nameCache;  // owned by _ext when there is one
+
   Ath__parser* _parser;
 
   Ath__parser* _nodeParser;
@@ -172,9 +286,8 @@ class extSpef
   bool                 _inputNet;
 
   Ath__nameTable* _notFoundInst;
-  Ath__nameTable* _nodeHashTable;
-  // AthHash<uint> *_nodeHashTable;
-  // HashN<uint> _nodeHashTable;
+  Ath__nameTable* _nodeHashTable;  // node words, test parsing only
+  extNodeIdTable* _nodeIdTable;
   uint            _tmpCapId;
   Ath__nameTable* _node2nodeHashTable;
   char            _tmpBuff1[1024];
@@ -242,6 +355,12 @@ class extSpef
   Ath__array1D<uint>*   _levelTable;
   Ath__gridTable*       _search;
   Ath__array1D<uint>*   _idTable;
+  std::vector<uint>     _nodeCoordSlot;   // cap node id -> coord table index
+  std::vector<uint>     _nodeCoordStamp;  // net stamp of _nodeCoordSlot
+  uint                  _nodeCoordNetStamp;
+  uint                  _nodeCoordIndexCnt;
+  std::vector<uint>     _nodeShapeIds;  // per coord table index
+  bool                  _nodeShapeIdsDone;
   double                _lengthUnit;
   double                _nodeCoordFactor;
   bool                  _doSortRSeg;
@@ -275,11 +394,23 @@ class extSpef
   int           _db_ext_corner;
   int           _active_corner_cnt;
   int           _active_corner_number[32];
+  // lazy adjust_rc and derived corner factors by active corner
+  double        _resScale[32];
+  double        _gndScale[32];
+  double        _ccScale[32];
   bool          _writeNameMap;
   bool          _moreToRead;
   bool          _termJxy;
   bool          _independentExtCorners;
   bool          _incrPlusCcNets;
+  uint          _readThreadCnt;
+  bool          _streamDiff;
+  bool          _diffDetail;
+
+  // write_spef -reuse: copy unchanged *D_NET sections of a previous file
+  const char*       _reuseSpefFile;
+  std::vector<uint> _reuseNetIds;
+  bool              _netIndexWritten;
   odb::dbBTerm* _ccbterm1;
   odb::dbBTerm* _ccbterm2;
   odb::dbITerm* _cciterm1;
@@ -315,7 +446,9 @@ class extSpef
   void adjustNodeCoords();
   void checkCCterm();
   int  findNodeIndexFromNodeCoords(uint targetCapNodeId);
+  void indexNodeCoords();
   uint getShapeIdFromNodeCoords(uint targetCapNodeId);
+  uint findNodeShapeIds(uint netId);
   uint getITermShapeId(odb::dbITerm* iterm);
   uint getBTermShapeId(odb::dbBTerm* bterm);
   void initSearchForNets();
@@ -344,6 +477,7 @@ class extSpef
   void setupMappingForWrite(uint btermCnt = 0, uint itermCnt = 0);
   void setupMapping(uint itermCnt = 0);
   void preserveFlag(bool v);
+  bool getPreserveFlag() { return _preserveCapValues; }
   void setCornerCnt(uint n);
 
   void          incr_wRun() { _wRun++; };
@@ -421,11 +555,24 @@ class extSpef
                   bool                     parallel);
 
   int  getWriteCorner(int corner, const char* name);
+  uint writeBinary(const char* filename, bool float64, bool quiet = false);
+  uint readBinary(const char*               filename,
+                  std::vector<odb::dbNet*>& tnets,
+                  bool                      quiet = false);
+  bool startRetireWrite();
+  uint retireNets(std::vector<odb::dbNet*>& nets);
+  uint finishRetireWrite();
+  void        internSpefNames(odb::dbBlock* block);
+  const char* spefNetName(odb::dbNet* net);
+  const char* spefInstName(odb::dbInst* inst);
+  void        releaseSpefNames();
   bool writeITerm(uint node);
   bool writeBTerm(uint node);
   bool writeNode(uint netId, uint node);
   uint writePort(uint node);
-  void writeDnet(uint netId, double* totCap);
+  void writeDnet(uint netId, double* gndCap, double* ccCap);
+  void writeTotCap(double* gndCap, double* ccCap);
+  void setupWriteScales();
   void writeKeyword(const char* keyword);
   uint writePorts();
   uint writeITerms();
@@ -465,6 +612,39 @@ class extSpef
   uint writeInstMap();
 
   uint readDNet(uint debug);
+  bool sortDNetRSegs();
+
+  // parallel *D_NET reader
+  bool     isParallelReadable();
+  uint64_t indexDNetOffsets(const char*            filename,
+                            std::vector<uint64_t>& offsets);
+  bool     readDNetsParallel(bool& doSortingRSeg, uint& cnt);
+  void     skipDNetSections(uint cnt);
+  uint     commitDNet(extSpefDNetRecord& rec);
+  void     setCapNodeValues(odb::dbCapNode* cap, double* vals, uint cnt);
+  void     createCCSeg(uint srcId, uint dstId, double* vals, uint cnt);
+
+  // streaming diff against the extracted db
+  bool isStreamDiffable();
+  uint diffDNetsStreaming(uint debug);
+  void diffNetTotals(odb::dbNet*        net,
+                     extSpefDNetTotals& totals,
+                     extSpefDiffStats** stats);
+
+  // per-net byte offset index of written spef and section reuse
+  std::string getWriteSignature();
+  bool openNetIndex(const char* sig);
+  bool readReuseIndex(const char* sig);
+  bool isReusable(odb::dbNet* net);
+  void addReusedSection(odb::dbNet* net);
+  void flushReusedRun();
+  void closeNetIndex();
+
+  // binary parasitics
+  void writeBinaryNet(odb::dbNet*        net,
+                      extSpefBinWriter&  wr,
+                      std::vector<uint>& capLocal);
+  uint readBinaryNet(odb::dbNet* net, extSpefBinReader& rd);
   uint getSpefNode(char* nodeWord, uint* instNetId, int* nodeType);
   uint getITermId(uint instId, char* name);
   uint getBTermId(char* name);
@@ -546,6 +726,9 @@ class extSpef
   uint  getCapNodeId(char* nodeWord);
   uint  getCapIdFromCapTable(char* nodeWord);
   void  addNewCapIdOnCapTable(char* nodeWord, uint capId);
+  uint  getCapIdFromCapTable(uint netMapId, uint nodeNum);
+  void  addNewCapIdOnCapTable(uint netMapId, uint nodeNum, uint capId);
+  bool  parseInternalNode(const char* nodeWord, uint& netMapId, uint& nodeNum);
   uint  getItermCapNode(uint termId);
   uint  getBtermCapNode(uint termId);
   uint  writeSrcCouplingCapsNoSort(odb::dbNet* net);
@@ -612,7 +795,7 @@ class extSpef
   // 021610D END
 
   // 021810D BEGIN
-  void writeDnetHier(uint mapId, double* totCap);
+  void writeDnetHier(uint mapId, double* gndCap, double* ccCap);
   bool writeHierNet(odb::dbNet* net, double resBound, uint debug);
   void setHierBaseNameMap(uint instBase, uint netBase);
   // 021810D END
@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef ADS_EXTUTIL_H
+#define ADS_EXTUTIL_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "odb.h"
+
+namespace OpenRCX {
+
+// FNV-1a, 64 bit; the keys and signatures of the block, net, search index
+// and solver caches
+class extHash
+{
+ public:
+  extHash() { _h = 0xcbf29ce484222325ULL; }
+  explicit extHash(uint64_t seed) { _h = seed; }
+
+  void add(const void* p, size_t len)
+  {
+    const unsigned char* b = (const unsigned char*) p;
+    for (size_t ii = 0; ii < len; ii++) {
+      _h ^= b[ii];
+      _h *= 0x100000001b3ULL;
+    }
+  }
+  void add(int v) { add(&v, sizeof(v)); }
+  void add(const char* s) { add(s, strlen(s) + 1); }
+
+  uint64_t _h;
+};
+
+// Below this many items a range phase runs on the calling thread
+static const uint EXT_PARALLEL_MIN = 4096;
+
+// Threads for the parallel phases: the hardware threads, at least 1
+uint extThreadCnt();
+
+// Splits [0, cnt) in one contiguous range per thread and runs fn on them.
+// Fewer than minCnt items, or a single thread, run on the calling thread.
+void extRunRanges(uint cnt,
+                  uint threadCnt,
+                  uint minCnt,
+                  void (*fn)(void* arg, uint first, uint last),
+                  void* arg);
+
+// Runs fn on threadCnt threads; each takes jobs from arg until none are left
+void extRunWorkers(uint threadCnt, void (*fn)(void* arg), void* arg);
+
+}  // namespace OpenRCX
+
+#endif
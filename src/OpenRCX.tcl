@@ -41,6 +41,13 @@ sta::define_cmd_args "extract_parasitics" {
     [-lef_res]
     [-cc_model track]
     [-context_depth depth]
+    [-spef_file filename]
+    [-release_parasitics]
+    [-block_cache dir]
+    [-index_file filename]
+    [-net_cache filename]
+    [-measure_log filename]
+    [-compact_rules order]
 }
 
 proc extract_parasitics { args } {
@@ -52,8 +59,14 @@ proc extract_parasitics { args } {
         -signal_table
         -debug_net_id
         -context_depth
-        -cc_model } \
-      flags { -lef_res }
+        -cc_model
+        -spef_file
+        -block_cache
+        -index_file
+        -net_cache
+        -measure_log
+        -compact_rules } \
+      flags { -lef_res -release_parasitics }
 
   set ext_model_file ''
   if { [info exists keys(-ext_model_file)] } {
@@ -97,19 +110,101 @@ proc extract_parasitics { args } {
     set debug_net_id $keys(-debug_net_id)
   }
 
+  set spef_file ""
+  if { [info exists keys(-spef_file)] } {
+    set spef_file $keys(-spef_file)
+  }
+  set release_parasitics [info exists flags(-release_parasitics)]
+
+  set block_cache ""
+  if { [info exists keys(-block_cache)] } {
+    set block_cache $keys(-block_cache)
+  }
+
+  set index_file ""
+  if { [info exists keys(-index_file)] } {
+    set index_file $keys(-index_file)
+  }
+
+  set net_cache ""
+  if { [info exists keys(-net_cache)] } {
+    set net_cache $keys(-net_cache)
+  }
+
+  set measure_log ""
+  if { [info exists keys(-measure_log)] } {
+    set measure_log $keys(-measure_log)
+  }
+
+  set compact_rules 0
+  if { [info exists keys(-compact_rules)] } {
+    set compact_rules $keys(-compact_rules)
+    if { $compact_rules != 1 && $compact_rules != 3 } {
+      error "-compact_rules order must be 1 or 3"
+    }
+  }
+
   rcx::extract $ext_model_file $corner_cnt $max_res \
       $coupling_threshold $signal_table $cc_model \
-      $depth $debug_net_id $lef_res
+      $depth $debug_net_id $lef_res $spef_file $release_parasitics \
+      $block_cache $index_file $net_cache $measure_log $compact_rules
+}
+
+sta::define_cmd_args "reevaluate_parasitics" {
+    [-log filename]
+    -rules filename
+}
+
+proc reevaluate_parasitics { args } {
+  sta::parse_key_args "reevaluate_parasitics" args keys {-log -rules}
+
+  if { ![info exists keys(-rules)] } {
+    error "reevaluate_parasitics requires -rules"
+  }
+  set rules $keys(-rules)
+
+  set log ""
+  if { [info exists keys(-log)] } {
+    set log $keys(-log)
+  }
+
+  rcx::reevaluate_parasitics $log $rules
+}
+
+sta::define_cmd_args "verify_compact_rules" {
+    -file filename
+    [-order order]
+}
+
+proc verify_compact_rules { args } {
+  sta::parse_key_args "verify_compact_rules" args keys {-file -order}
+
+  if { ![info exists keys(-file)] } {
+    error "verify_compact_rules requires -file"
+  }
+  set file $keys(-file)
+
+  set order 3
+  if { [info exists keys(-order)] } {
+    set order $keys(-order)
+  }
+  if { $order != 1 && $order != 3 } {
+    error "-order must be 1 or 3"
+  }
+
+  rcx::verify_compact_rules $file $order
 }
 
 sta::define_cmd_args "write_spef" { 
   [-net_id net_id]
-  [-nets nets] filename }
+  [-nets nets]
+  [-reuse prev_spef] filename }
 
 proc write_spef { args } {
   sta::parse_key_args "write_spef" args keys \
       { -net_id 
-        -nets }
+        -nets
+        -reuse }
   sta::check_argc_eq1 "write_spef" $args
 
   set spef_file $args
@@ -124,7 +219,58 @@ proc write_spef { args } {
     set net_id $keys(-net_id)
   }
 
-  rcx::write_spef $spef_file $nets $net_id
+  set reuse ""
+  if { [info exists keys(-reuse)] } {
+    set reuse $keys(-reuse)
+  }
+
+  rcx::write_spef $spef_file $nets $net_id $reuse
+}
+
+sta::define_cmd_args "write_parasitics" {
+    [-binary]
+    [-float64]
+    filename
+}
+
+proc write_parasitics { args } {
+  sta::parse_key_args "write_parasitics" args keys {} \
+      flags { -binary -float64 }
+  sta::check_argc_eq1 "write_parasitics" $args
+
+  set filename $args
+
+  if { [info exists flags(-binary)] } {
+    set float64 [info exists flags(-float64)]
+    rcx::write_parasitics_binary $filename $float64
+  } else {
+    rcx::write_spef $filename "" 0 ""
+  }
+}
+
+sta::define_cmd_args "read_parasitics" {
+    [-binary]
+    [-nets nets]
+    filename
+}
+
+proc read_parasitics { args } {
+  sta::parse_key_args "read_parasitics" args keys {-nets} \
+      flags { -binary }
+  sta::check_argc_eq1 "read_parasitics" $args
+
+  set filename $args
+
+  set nets ""
+  if { [info exists keys(-nets)] } {
+    set nets $keys(-nets)
+  }
+
+  if { [info exists flags(-binary)] } {
+    rcx::read_parasitics_binary $filename $nets
+  } else {
+    rcx::read_spef $filename 1
+  }
 }
 
 sta::define_cmd_args "adjust_rc" {
@@ -163,12 +309,15 @@ sta::define_cmd_args "diff_spef" {
     [-r_cap]
     [-r_cc_cap]
     [-r_conn]
+    [-stream]
+    [-detail]
+    [-threads count]
 }
 
 proc diff_spef { args } {
   sta::parse_key_args "diff_spef" args keys \
-      { -file } \
-      flags { -r_res -r_cap -r_cc_cap -r_conn }
+      { -file -threads } \
+      flags { -r_res -r_cap -r_cc_cap -r_conn -stream -detail }
   
   set filename "" 
   if { [info exists keys(-file)] } {
@@ -178,8 +327,15 @@ proc diff_spef { args } {
   set cap [info exists flags(-over)]
   set cc_cap [info exists flags(-over)]
   set conn [info exists flags(-over)]
+  set stream [info exists flags(-stream)]
+  set detail [info exists flags(-detail)]
 
-  rcx::diff_spef $filename $conn $res $cap $cc_cap
+  set threads 1
+  if { [info exists keys(-threads)] } {
+    set threads $keys(-threads)
+  }
+
+  rcx::diff_spef $filename $conn $res $cap $cc_cap $stream $detail $threads
 }
 
 sta::define_cmd_args "bench_wires" {
@@ -246,11 +402,68 @@ proc bench_verilog { args } {
   rcx::bench_verilog $args
 }
 
-sta::define_cmd_args "bench_read_spef" { filename }
+sta::define_cmd_args "bench_read_spef" {
+    [-threads count]
+    filename
+}
 
 proc bench_read_spef { args } {
+  sta::parse_key_args "bench_read_spef" args keys {-threads}
   sta::check_argc_eq1 "bench_read_spef" $args
-  rcx::read_spef $args
+
+  set threads 1
+  if { [info exists keys(-threads)] } {
+    set threads $keys(-threads)
+  }
+
+  rcx::read_spef $args $threads
+}
+
+sta::define_cmd_args "define_rules_solver" {
+    [-jobs count]
+    [-command template]
+    [-retries count]
+    [-cache dir]
+    [-metal_jobs count]
+    [-max_error percent]
+}
+
+proc define_rules_solver { args } {
+  sta::parse_key_args "define_rules_solver" args keys \
+      { -jobs -command -retries -cache -metal_jobs -max_error }
+
+  set jobs 0
+  if { [info exists keys(-jobs)] } {
+    set jobs $keys(-jobs)
+  }
+
+  set command ""
+  if { [info exists keys(-command)] } {
+    set command $keys(-command)
+  }
+
+  set retries 2
+  if { [info exists keys(-retries)] } {
+    set retries $keys(-retries)
+  }
+
+  set cache ""
+  if { [info exists keys(-cache)] } {
+    set cache $keys(-cache)
+  }
+
+  set metal_jobs 0
+  if { [info exists keys(-metal_jobs)] } {
+    set metal_jobs $keys(-metal_jobs)
+  }
+
+  set max_error 0
+  if { [info exists keys(-max_error)] } {
+    set max_error $keys(-max_error)
+  }
+
+  rcx::define_rules_solver $jobs $command $retries $cache $metal_jobs \
+      $max_error
 }
 
 sta::define_cmd_args "write_rules" {
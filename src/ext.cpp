@@ -168,6 +168,50 @@ bool Ext::metal_rules_gen(const std::string& name,
   return TCL_OK;
 }
 
+bool Ext::define_rules_solver(int                jobs,
+                              const std::string& command,
+                              int                retries,
+                              const std::string& cache,
+                              int                metal_jobs,
+                              double             max_error)
+{
+  if (jobs < 0 || retries < 0 || metal_jobs < 0) {
+    odb::warning(0, "Solver jobs and retries cannot be negative\n");
+    return TCL_ERROR;
+  }
+  if (max_error < 0.0) {
+    odb::warning(0, "Solver max error cannot be negative\n");
+    return TCL_ERROR;
+  }
+  _ext->setRulesSolver(jobs,
+                       command.c_str(),
+                       retries,
+                       cache.c_str(),
+                       metal_jobs,
+                       max_error);
+  return TCL_OK;
+}
+
+bool Ext::solve_deck(const std::string& deck,
+                     const std::string& out,
+                     const std::string& command)
+{
+  bool solved;
+  if (command == "builtin")
+    solved = extRCModel::runBuiltinSolver(deck.c_str(), out.c_str());
+  else if (command == "stub")
+    solved = extRCModel::writeStubSolverOutput(deck.c_str(), out.c_str());
+  else {
+    odb::warning(0, "%s is not an in process solver\n", command.c_str());
+    return TCL_ERROR;
+  }
+  if (!solved) {
+    odb::warning(0, "Solver %s failed on %s\n", command.c_str(), deck.c_str());
+    return TCL_ERROR;
+  }
+  return TCL_OK;
+}
+
 bool Ext::write_rules(const std::string& name,
                       const std::string& dir,
                       const std::string& file,
@@ -480,6 +524,13 @@ bool Ext::flatten(odb::dbBlock* block, bool spef)
   if (block == NULL) {
     odb::error(0, "No block for flatten command\n");
   }
+  // a child block that was not extracted is read from the block cache
+  int cntnet, cntrseg, cntcapn, cntcc;
+  block->getExtCount(cntnet, cntrseg, cntcapn, cntcc);
+  if (cntrseg == 0 && !_ext->loadChildBlockCache(block))
+    odb::warning(0,
+                 "Block %s has no parasitics to flatten\n",
+                 block->getConstName());
   _ext->addRCtoTop(block, spef);
   return TCL_OK;
 }
@@ -604,33 +655,84 @@ bool Ext::extract(ExtractOptions opts)
     odb::notice(0, "777: Final rc segments = %d\n", cnt);
     odb::dbRSeg* rc = odb::dbRSeg::getRSeg(_ext->getBlock(), 113);
   }
-  if (_ext->makeBlockRCsegs(btermThresholdFlag,
-                            cmpFile,
-                            density_model,
-                            opts.litho,
-                            nets,
-                            opts.bbox,
-                            opts.ibox,
-                            ccUp,
-                            ccFlag,
-                            ccBandTracks,
-                            use_signal_table,
-                            opts.max_res,
-                            merge_via_res,
-                            extdbg,
-                            opts.preserve_geom,
-                            opts.re_run,
-                            opts.eco,
-                            gs,
-                            opts.rlog,
-                            dbNetSdb,
-                            ccThres,
-                            ccContextDepth,
-                            overCell,
-                            extRules,
-                            this)
-      == 0)
+  // options the parasitics of a block depend on, for -block_cache
+  const char* cacheDir = opts.block_cache_dir;
+  if (cacheDir != NULL && cacheDir[0] == '\0')
+    cacheDir = NULL;
+  char cacheOpts[256];
+  snprintf(cacheOpts,
+           sizeof(cacheOpts),
+           " %d %d %d %d %d %g %d %g %d %d %d",
+           opts.corner_cnt,
+           ccUp,
+           ccFlag,
+           ccBandTracks,
+           use_signal_table,
+           opts.max_res,
+           merge_via_res,
+           ccThres,
+           ccContextDepth,
+           overCell,
+           opts.lef_res);
+  std::string cacheKey = std::string(extRules ? extRules : "") + cacheOpts;
+  _ext->setBlockCacheOptions(cacheDir, cacheKey.c_str(), extRules, ccFlag);
+
+  // a flat block without parasitics is keyed as a child block is
+  int  cntnet, cntrseg, cntcapn, cntcc;
+  bool flatCache = false;
+  if (cacheDir && tilingDegree == 0 && !opts.eco
+      && (nets == NULL || nets[0] == '\0')
+      && (opts.spef_file == NULL || opts.spef_file[0] == '\0')
+      && _ext->getBlock()->getChildren().size() == 0) {
+    _ext->getBlock()->getExtCount(cntnet, cntrseg, cntcapn, cntcc);
+    flatCache = cntrseg == 0;
+  }
+  bool cached
+      = flatCache
+        && _ext->loadBlockCache(
+            cacheDir, cacheKey.c_str(), extRules, ccFlag, NULL);
+
+  _ext->setNetRetirement(opts.spef_file, opts.release_parasitics);
+  _ext->setSearchIndexFile(opts.index_file);
+  _ext->setNetCacheFile(opts.net_cache_file);
+  _ext->setMeasureLogFile(opts.measure_log_file);
+  _ext->setRulesFitOrder(opts.compact_rules);
+  uint rcGen = 1;
+  if (!cached)
+    rcGen = _ext->makeBlockRCsegs(btermThresholdFlag,
+                                  cmpFile,
+                                  density_model,
+                                  opts.litho,
+                                  nets,
+                                  opts.bbox,
+                                  opts.ibox,
+                                  ccUp,
+                                  ccFlag,
+                                  ccBandTracks,
+                                  use_signal_table,
+                                  opts.max_res,
+                                  merge_via_res,
+                                  extdbg,
+                                  opts.preserve_geom,
+                                  opts.re_run,
+                                  opts.eco,
+                                  gs,
+                                  opts.rlog,
+                                  dbNetSdb,
+                                  ccThres,
+                                  ccContextDepth,
+                                  overCell,
+                                  extRules,
+                                  this);
+  _ext->setNetRetirement(NULL, false);
+  _ext->setSearchIndexFile(NULL);
+  _ext->setNetCacheFile(NULL);
+  _ext->setMeasureLogFile(NULL);
+  _ext->setRulesFitOrder(0);
+  if (rcGen == 0)
     return TCL_ERROR;
+  if (flatCache && !cached)
+    _ext->saveBlockCache();
 
   odb::dbBlock* topBlock = _ext->getBlock();
   if (tilingDegree == 1) {
@@ -649,15 +751,24 @@ bool Ext::extract(ExtractOptions opts)
     odb::dbSet<odb::dbBlock>           children = topBlock->getChildren();
     odb::dbSet<odb::dbBlock>::iterator itr;
 
+
+    // parent wires binned once for the context keys of all the children
+    extBlockContext* cacheContext
+        = cacheDir ? extMain::newBlockContext(topBlock) : NULL;
+
     // Extraction
     for (itr = children.begin(); itr != children.end(); ++itr) {
       odb::dbBlock* blk = *itr;
-      odb::notice(0, "Extacting block %s...\n", blk->getConstName());
-      extMain* ext = new extMain(5);
+      extMain*      ext = new extMain(5);
       ext->setDB(_db);
 
       ext->setBlock(blk);
 
+      if (cacheDir
+          && ext->loadBlockCache(
+              cacheDir, cacheKey.c_str(), extRules, ccFlag, cacheContext))
+        continue;
+      odb::notice(0, "Extacting block %s...\n", blk->getConstName());
       if (ext->makeBlockRCsegs(btermThresholdFlag,
                                cmpFile,
                                density_model,
@@ -685,9 +796,13 @@ bool Ext::extract(ExtractOptions opts)
                                this)
           == 0) {
         odb::warning(0, "Failed to Extact block %s...\n", blk->getConstName());
+        extMain::deleteBlockContext(cacheContext);
         return TCL_ERROR;
       }
+      if (cacheDir)
+        ext->saveBlockCache();
     }
+    extMain::deleteBlockContext(cacheContext);
 
     for (itr = children.begin(); itr != children.end(); ++itr) {
       odb::dbBlock* blk = *itr;
@@ -728,6 +843,22 @@ bool Ext::extract(ExtractOptions opts)
   return 0;
 }
 
+bool Ext::reevaluate_parasitics(const std::string& log_file,
+                                const std::string& rules_file)
+{
+  dbUpdate();
+  if (_ext->reevaluateParasitics(log_file.c_str(), rules_file.c_str()) == 0)
+    return TCL_ERROR;
+  return 0;
+}
+
+bool Ext::verify_compact_rules(const std::string& file, int order)
+{
+  if (!_ext->verifyCompactRules(file.c_str(), order))
+    return TCL_ERROR;
+  return 0;
+}
+
 bool Ext::adjust_rc(float res_factor, float cc_factor, float gndc_factor)
 {
   dbUpdate();
@@ -810,13 +941,38 @@ bool Ext::write_spef(const SpefOptions& opts)
                   opts.corner,
                   name,
                   opts.flatten,
-                  opts.parallel);
+                  opts.parallel,
+                  opts.reuse_file);
 
   odb::notice(0, "Finished writing SPEF ...\n");
   // fprintf(stdout, "Hello Extraction %s\n", "Ext::write_spef");
   return 0;
 }
 
+bool Ext::write_parasitics_binary(const std::string& file, bool float64)
+{
+  dbUpdate();
+  odb::notice(0, "Writing binary parasitics %s ...\n", file.c_str());
+  _ext->writeBinaryParasitics(file.c_str(), float64);
+  return 0;
+}
+
+bool Ext::read_parasitics_binary(const std::string& file,
+                                 const std::string& nets)
+{
+  dbUpdate();
+  odb::notice(0, "reading binary parasitics %s\n", file.c_str());
+  _ext->readBinaryParasitics(file.c_str(), (char*) nets.c_str());
+  return 0;
+}
+
+bool Ext::remove_parasitics()
+{
+  dbUpdate();
+  _ext->removeExt();
+  return 0;
+}
+
 bool Ext::independent_spef_corner()
 {
   dbUpdate();
@@ -881,7 +1037,8 @@ bool Ext::read_spef(ReadSpefOpts& opt)
                  opt.more_to_read,
                  false /*diff*/,
                  false /*calibrate*/,
-                 opt.app_print_limit);
+                 opt.app_print_limit,
+                 opt.threads > 1 ? opt.threads : 1);
 
   for (int ii = 1; ii < parser.getWordCnt(); ii++)
     _ext->readSPEFincr(parser.get(ii));
@@ -945,7 +1102,10 @@ bool Ext::diff_spef(const DiffOptions& opt)
                  false /*moreToRead*/,
                  true /*diff*/,
                  false /*calibrate*/,
-                 0);
+                 0,
+                 opt.threads > 1 ? opt.threads : 1,
+                 opt.stream,
+                 !opt.stream || opt.detail);
 
   // for (uint ii=1; ii<parser.getWordCnt(); ii++)
   //	_ext->readSPEFincr(parser.get(ii));
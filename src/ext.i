@@ -65,7 +65,14 @@ extract(const char* ext_model_file,
         int cc_model,
         int context_depth,
         const char* debug_net_id,
-        bool lef_res)
+        bool lef_res,
+        const char* spef_file,
+        bool release_parasitics,
+        const char* block_cache,
+        const char* index_file,
+        const char* net_cache,
+        const char* measure_log,
+        int compact_rules)
 {
   Ext* ext = getOpenRCX();
   Ext::ExtractOptions opts;
@@ -79,23 +86,71 @@ extract(const char* ext_model_file,
   opts.context_depth = context_depth;
   opts.lef_res = lef_res;
   opts.debug_net = debug_net_id;
+  opts.spef_file = spef_file;
+  opts.release_parasitics = release_parasitics;
+  opts.block_cache_dir = block_cache;
+  opts.index_file = index_file;
+  opts.net_cache_file = net_cache;
+  opts.measure_log_file = measure_log;
+  opts.compact_rules = compact_rules;
 
   ext->extract(opts);
 }
 
+void
+reevaluate_parasitics(const char* log_file,
+                      const char* rules_file)
+{
+  Ext* ext = getOpenRCX();
+  ext->reevaluate_parasitics(log_file, rules_file);
+}
+
+void
+verify_compact_rules(const char* file,
+                     int order)
+{
+  Ext* ext = getOpenRCX();
+  ext->verify_compact_rules(file, order);
+}
+
 void
 write_spef(const char* file,
            const char* nets,
-           int net_id)
+           int net_id,
+           const char* reuse_file)
 {
   Ext* ext = getOpenRCX();
   Ext::SpefOptions opts;
   opts.file = file;
   opts.nets = nets;
   opts.net_id = net_id;
+  opts.reuse_file = reuse_file;
   ext->write_spef(opts);
 }
 
+void
+write_parasitics_binary(const char* file,
+                        bool float64)
+{
+  Ext* ext = getOpenRCX();
+  ext->write_parasitics_binary(file, float64);
+}
+
+void
+read_parasitics_binary(const char* file,
+                       const char* nets)
+{
+  Ext* ext = getOpenRCX();
+  ext->read_parasitics_binary(file, nets);
+}
+
+void
+remove_parasitics()
+{
+  Ext* ext = getOpenRCX();
+  ext->remove_parasitics();
+}
+
 void
 adjust_rc(double res_factor,
           double cc_factor,
@@ -110,7 +165,10 @@ diff_spef(const char* file,
           bool r_conn,
           bool r_res,
           bool r_cap,
-          bool r_cc_cap)
+          bool r_cc_cap,
+          bool stream,
+          bool detail,
+          int threads)
 {
   Ext* ext = getOpenRCX();
   Ext::DiffOptions opts;
@@ -119,6 +177,9 @@ diff_spef(const char* file,
   opts.r_cap = r_cap;
   opts.r_cc_cap = r_cc_cap;
   opts.r_conn = r_conn;
+  opts.stream = stream;
+  opts.detail = detail;
+  opts.threads = threads;
   ext->diff_spef(opts);
 }
 
@@ -158,6 +219,28 @@ bench_verilog(const char* file)
   ext->bench_verilog(file);
 }
 
+void
+define_rules_solver(int jobs,
+                    const char* command,
+                    int retries,
+                    const char* cache,
+                    int metal_jobs,
+                    double max_error)
+{
+  Ext* ext = getOpenRCX();
+  ext->define_rules_solver(jobs, command, retries, cache, metal_jobs,
+                           max_error);
+}
+
+void
+solve_deck(const char* deck,
+           const char* out,
+           const char* command)
+{
+  Ext* ext = getOpenRCX();
+  ext->solve_deck(deck, out, command);
+}
+
 void
 write_rules(const char* file,
             const char* dir,
@@ -174,12 +257,14 @@ write_rules(const char* file,
 }
 
 void 
-read_spef(const char* file)
+read_spef(const char* file,
+          int threads)
 {
   Ext* ext = getOpenRCX();
   Ext::ReadSpefOpts opts;
 
   opts.file = file;
+  opts.threads = threads;
   ext->read_spef(opts);
 }
 
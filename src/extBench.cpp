@@ -519,12 +519,21 @@ uint extMain::benchWires(extMainOptions* opt)
     m->setDataRateTable(1);
   }
   extRCModel* m = _modelTable->get(0);
+  if (sharedRCmodel(m, "bench_wires"))
+    return 0;
 
   m->setOptions(opt->_topDir,
                 opt->_name,
                 opt->_write_to_solver,
                 opt->_read_from_solver,
                 opt->_run_solver);
+  m->setSolverJobs(_solverJobCnt,
+                   _solverCmd.c_str(),
+                   _solverRetryCnt,
+                   _solverCacheDir.c_str());
+
+  // the patterns make db wires, so the decks of the jobs are not read back
+  bool solverJobs = m->queueSolverJobs();
 
   opt->_tech = _tech;
 
@@ -575,6 +584,9 @@ uint extMain::benchWires(extMainOptions* opt)
         m->linesUnderBench(opt);
     }
   }
+  if (solverJobs)
+    m->runSolverJobs();
+  m->reportSolverCache();
 
   /*
   if (opt->_over)
@@ -618,6 +630,8 @@ uint extMain::benchNets(extMainOptions* opt,
   extRCModel* m = _modelTable->get(0);
   if (m->getProcess() == NULL)
     m = _modelTable->get(1);
+  if (sharedRCmodel(m, "bench_net"))
+    return 0;
 
   m->setExtMain(this);
 
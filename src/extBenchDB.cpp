@@ -3,12 +3,14 @@
 #include "db.h"
 #include "extRCap.h"
 #include "extSpef.h"
+#include "extUtil.h"
 #include "extprocess.h"
 
 #ifdef _WIN32
 #include "direct.h"
 #endif
 
+#include <atomic>
 #include <map>
 #include <vector>
 
@@ -28,6 +30,7 @@ using odb::dbObstruction;
 using odb::dbRSeg;
 using odb::dbSet;
 using odb::dbShape;
+using odb::dbStringProperty;
 using odb::dbTechLayer;
 using odb::dbTechLayerRule;
 using odb::dbTechNonDefaultRule;
@@ -54,6 +57,127 @@ AthPool<extDistRC>* extMetRCTable::getRCPool()
 {
   return _rcPoolPtr;
 }
+// the pattern written by mkBenchPatternProperty
+static bool benchPatternFromProperty(dbNet* net, extBenchPattern* bp)
+{
+  dbStringProperty* p = dbStringProperty::find(net, "_benchPattern");
+  if (p == NULL)
+    return false;
+
+  std::string v = p->getValue();
+  return sscanf(v.c_str(),
+                "%d %d %d %d %lf %lf",
+                &bp->_kind,
+                &bp->_met,
+                &bp->_overMet,
+                &bp->_underMet,
+                &bp->_w,
+                &bp->_s)
+         == 6;
+}
+// bench DBs written before the property carry the pattern only in the net
+// names: <pattern>_<M2oM1uM3>_W<w>W<w2>_S<s>S<s2>_<wire>
+static bool benchPatternFromName(const char*      netName,
+                                 extBenchPattern* bp,
+                                 Ath__parser*     p,
+                                 Ath__parser*     w)
+{
+  uint wcnt = p->mkWords(netName, "_");
+  if (wcnt < 5)
+    return false;
+
+  int targetWire = 0;
+  if (p->getFirstChar() == 'U') {
+    targetWire = p->getInt(0, 1);
+  } else {
+    char* w1 = p->get(0);
+    if (w1[1] == 'U')  // OU
+      targetWire = p->getInt(0, 2);
+    else
+      targetWire = p->getInt(0, 1);
+  }
+  if (targetWire <= 0)
+    return false;
+
+  uint wireNum = p->getInt(4);
+  if (wireNum != targetWire / 2)
+    return false;
+
+  bp->_met      = p->getInt(0, 1);
+  bp->_overMet  = -1;
+  bp->_underMet = -1;
+
+  char* overUnderToken = strdup(p->get(1));  // M2oM1uM3
+  int   wCnt           = w->mkWords(overUnderToken, "ou");
+  bool  found          = true;
+  if (wCnt < 2) {
+    found = false;
+  } else if (wCnt == 3) {  // M2oM1uM3
+    bp->_kind     = BENCH_OVER_UNDER;
+    bp->_met      = w->getInt(0, 1);
+    bp->_underMet = w->getInt(1, 1);
+    bp->_overMet  = w->getInt(2, 1);
+  } else if (strstr(overUnderToken, "o") != NULL) {
+    bp->_kind     = BENCH_OVER;
+    bp->_met      = w->getInt(0, 1);
+    bp->_underMet = w->getInt(1, 1);
+  } else if (strstr(overUnderToken, "uu") != NULL) {
+    bp->_kind    = BENCH_DIAG;
+    bp->_met     = w->getInt(0, 1);
+    bp->_overMet = w->getInt(1, 1);
+  } else if (strstr(overUnderToken, "u") != NULL) {
+    bp->_kind    = BENCH_UNDER;
+    bp->_met     = w->getInt(0, 1);
+    bp->_overMet = w->getInt(1, 1);
+  } else {
+    found = false;
+  }
+  free(overUnderToken);
+  if (!found)
+    return false;
+
+  if (w->mkWords(p->get(2), "W") <= 0)
+    return false;
+  bp->_w = w->getDouble(0);
+
+  if (w->mkWords(p->get(3), "S") <= 0)
+    return false;
+  bp->_s = w->getDouble(0);
+  return true;
+}
+
+struct extBenchPatternJobs
+{
+  extMain*                      _ext;
+  std::vector<extBenchPattern>* _patterns;
+  std::atomic<uint>             _next;
+};
+
+// the parasitics of the pattern nets are only read, so the nets are split
+// between threads
+static void getBenchPatternCaps(void* arg)
+{
+  extBenchPatternJobs* jobs = (extBenchPatternJobs*) arg;
+  uint ii;
+  while ((ii = jobs->_next++) < jobs->_patterns->size()) {
+    extBenchPattern* bp  = &(*jobs->_patterns)[ii];
+    dbNet*           net = bp->_net;
+
+    uint wireCnt  = 0;
+    uint viaCnt   = 0;
+    uint len      = 0;
+    uint layerCnt = 0;
+    uint layerTable[20];
+    net->getNetStats(wireCnt, viaCnt, len, layerCnt, layerTable);
+
+    bp->_len    = len;
+    bp->_totCC  = net->getTotalCouplingCap();
+    bp->_totGnd = net->getTotalCapacitance();
+    bp->_res    = net->getTotalResistance();
+    bp->_cntxCC = jobs->_ext->getTotalCouplingCap(net, "cntxM", 0);
+  }
+}
+
 uint extMain::GenExtRules(const char* rulesFileName)
 {
   uint widthCnt = 12;
@@ -77,132 +201,66 @@ uint extMain::GenExtRules(const char* rulesFileName)
   Ath__parser* p = new Ath__parser();
   Ath__parser* w = new Ath__parser();
 
-  int                    prev_sep   = 0;
-  int                    prev_width = 0;
-  int                    n          = 0;
-  dbSet<dbNet>           nets       = _block->getNets();
-  dbSet<dbNet>::iterator itr;
+  // the patterns come from the _benchPattern properties of bench_wires,
+  // or from the net names of older bench DBs
+  std::vector<extBenchPattern> patterns;
+  dbSet<dbNet>                 nets = _block->getNets();
+  dbSet<dbNet>::iterator       itr;
   for (itr = nets.begin(); itr != nets.end(); ++itr) {
-    dbNet* net      = *itr;
-    uint   wireCnt  = 0;
-    uint   viaCnt   = 0;
-    uint   len      = 0;
-    uint   layerCnt = 0;
-    uint   layerTable[20];
-
-    net->getNetStats(wireCnt, viaCnt, len, layerCnt, layerTable);
-
-    const char* netName = net->getConstName();
-
-    uint wcnt = p->mkWords(netName, "_");
-    if (wcnt < 5)
+    extBenchPattern bp;
+    bp._net = *itr;
+    if (!benchPatternFromProperty(bp._net, &bp)
+        && !benchPatternFromName(bp._net->getConstName(), &bp, p, w))
       continue;
-
-    int targetWire = 0;
-    if (p->getFirstChar() == 'U') {
-      targetWire = p->getInt(0, 1);
-    } else {
-      char* w1 = p->get(0);
-      if (w1[1] == 'U')  // OU
-        targetWire = p->getInt(0, 2);
-      else
-        targetWire = p->getInt(0, 1);
-    }
-    if (targetWire <= 0)
-      continue;
-
-    uint wireNum = p->getInt(4);
-    if (wireNum != targetWire / 2)
-      continue;
-
-    // fprintf(logFP, "%s\n", netName);
-    bool over      = false;
-    bool overUnder = false;
-    bool under     = false;
-    bool diag      = false;
-
-    uint met      = p->getInt(0, 1);
-    uint overMet  = 0;
-    uint underMet = 0;
-
-    m._overMet   = -1;
-    m._underMet  = -1;
-    m._overUnder = false;
-    m._over      = false;
-
-    char* overUnderToken = strdup(p->get(1));  // M2oM1uM3
-    int   wCnt           = w->mkWords(overUnderToken, "ou");
-    if (wCnt < 2)
-      continue;
-
-    if (wCnt == 3) {  // M2oM1uM3
-      met       = w->getInt(0, 1);
-      overMet   = w->getInt(1, 1);
-      underMet  = w->getInt(2, 1);
-      overUnder = true;
-
-      m._overMet   = underMet;
-      m._underMet  = overMet;
-      m._overUnder = true;
-      m._over      = false;
-
-    } else if (strstr(overUnderToken, "o") != NULL) {
-      met     = w->getInt(0, 1);
-      overMet = w->getInt(1, 1);
-      over    = true;
-
-      m._overMet   = -1;
-      m._underMet  = overMet;
-      m._overUnder = false;
-      m._over      = true;
-    } else if (strstr(overUnderToken, "uu") != NULL) {
-      met          = w->getInt(0, 1);
-      underMet     = w->getInt(1, 1);
-      under        = false;
-      diag         = true;
-      m._diag      = true;
-      m._overMet   = underMet;
-      m._underMet  = -1;
-      m._overUnder = false;
-      m._over      = false;
-    } else if (strstr(overUnderToken, "u") != NULL) {
-      met      = w->getInt(0, 1);
-      underMet = w->getInt(1, 1);
-      under    = true;
-
-      m._overMet   = underMet;
-      m._underMet  = -1;
-      m._overUnder = false;
-      m._over      = false;
-    }
+    patterns.push_back(bp);
+  }
+  delete p;
+  delete w;
+
+  uint threadCnt = MIN(extThreadCnt(), (uint) patterns.size());
+
+  extBenchPatternJobs jobs;
+  jobs._ext      = this;
+  jobs._patterns = &patterns;
+  jobs._next     = 0;
+
+  extRunWorkers(threadCnt, getBenchPatternCaps, &jobs);
+
+  // a zero spacing takes the pitch of the previous pattern, so the tables
+  // are filled in net order
+  int prev_sep   = 0;
+  int prev_width = 0;
+  int n          = 0;
+  for (uint ii = 0; ii < patterns.size(); ii++) {
+    extBenchPattern* bp      = &patterns[ii];
+    dbNet*           net     = bp->_net;
+    const char*      netName = net->getConstName();
+    bool             diag    = bp->_kind == BENCH_DIAG;
+
+    m._met       = bp->_met;
+    m._overMet   = bp->_overMet;
+    m._underMet  = bp->_underMet;
+    m._overUnder = bp->_kind == BENCH_OVER_UNDER;
+    m._over      = bp->_kind == BENCH_OVER;
+    if (diag)
+      m._diag = true;
     // TODO DIAGUNDER
-    m._met = met;
-
-    if (w->mkWords(p->get(2), "W") <= 0)
-      continue;
-
-    double w1 = w->getDouble(0) / 1000;
-    double w2 = w->getDouble(1) / 1000;
-
-    m._w_m  = w1;
-    m._w_nm = Ath__double2int(m._w_m * 1000);
-
-    if (w->mkWords(p->get(3), "S") <= 0)
-      continue;
 
-    double s1 = w->getDouble(0) / 1000;
-    double s2 = w->getDouble(1) / 1000;
+    double w1 = bp->_w / 1000;
+    m._w_m    = w1;
+    m._w_nm   = Ath__double2int(m._w_m * 1000);
 
-    m._s_m  = s1;
-    m._s_nm = Ath__double2int(m._s_m * 1000);
+    double s1 = bp->_s / 1000;
+    m._s_m    = s1;
+    m._s_nm   = Ath__double2int(m._s_m * 1000);
 
     // double wLen= (len + w->getDouble(0)) * 1.0;
-    double wLen   = GetDBcoords2(len) * 1.0;
-    double totCC  = net->getTotalCouplingCap();
-    double totGnd = net->getTotalCapacitance();
-    double res    = net->getTotalResistance();
+    double wLen   = GetDBcoords2(bp->_len) * 1.0;
+    double totCC  = bp->_totCC;
+    double totGnd = bp->_totGnd;
+    double res    = bp->_res;
 
-    double contextCoupling = getTotalCouplingCap(net, "cntxM", 0);
+    double contextCoupling = bp->_cntxCC;
     if (contextCoupling > 0) {
       notice(0, "contextCoupling %g %s\n", contextCoupling, netName);
       totGnd += contextCoupling;
@@ -231,9 +289,9 @@ uint extMain::GenExtRules(const char* rulesFileName)
     fprintf(logFP,
             "M%2d OVER %2d UNDER %2d W %.3f S %.3f CC %.6f GND %.6f TC %.6f x "
             "%.6f R %g LEN %g  %s\n",
-            met,
-            overMet,
-            underMet,
+            bp->_met,
+            MAX(bp->_underMet, 0),
+            MAX(bp->_overMet, 0),
             w1,
             s1,
             totCC,
@@ -440,6 +498,7 @@ uint extRCModel::benchDB_WS(extMainOptions* opt, extMeasure* measure)
         // measurePatternVar(measure, top_width, bot_width, thickness,
         // measure->_wireCnt, NULL);
         writeBenchWires_DB(measure);
+        mkBenchPatternProperty(measure);
 
         cnt++;
       }
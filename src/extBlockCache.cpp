@@ -0,0 +1,413 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Block parasitics cache
+//
+// Hierarchical tops instantiate the same macro or subsystem many times. With
+// extract_parasitics -block_cache dir, every child block extracted in the
+// block flow, and a flat block extracted in full (a child block extracted on
+// its own included), is keyed by a hash of what its extraction depends on:
+// the routed wires and pins of its nets, its instances, the parent wires in
+// a coupling band around its instance, the extraction options and the size
+// and mtime of the rules file. The parent wires are binned once per parent
+// (extBlockContext) and every child only visits the bins of its band. The
+// parasitics of a block are saved under dir as <key>.rcxbin in the binary
+// parasitics format, which is keyed by net names, so a later block (in this
+// or another run) with the same key reads them back instead of extracting.
+// The parasitics are saved with their extraction graph, so a read block is
+// merged into the parent by assemblyExt like an extracted one. flatten
+// reads a child block that has no parasitics from the cache of the last
+// extraction and remaps it into the parent with addRCtoTop.
+
+#include <dbLogger.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "dbShape.h"
+#include "extRCap.h"
+#include "extUtil.h"
+
+namespace OpenRCX {
+
+using odb::dbBlock;
+using odb::dbBox;
+using odb::dbBPin;
+using odb::dbBTerm;
+using odb::dbInst;
+using odb::dbNet;
+using odb::dbSet;
+using odb::dbShape;
+using odb::dbTechLayer;
+using odb::dbTechVia;
+using odb::dbVia;
+using odb::dbWire;
+using odb::dbWireShapeItr;
+using odb::notice;
+using odb::Rect;
+using odb::warning;
+
+// Shapes hash relative to the block origin
+class extBlockHash : public extHash
+{
+ public:
+  using extHash::add;
+  void add(const Rect& r, int dx, int dy)
+  {
+    add(r.xMin() - dx);
+    add(r.yMin() - dy);
+    add(r.xMax() - dx);
+    add(r.yMax() - dy);
+  }
+};
+
+static void hashShape(extBlockHash& h, dbShape& s, int dx, int dy)
+{
+  dbTechVia* tv = s.getTechVia();
+  dbVia*     vv = s.getVia();
+  if (tv)
+    h.add(tv->getConstName());
+  else if (vv)
+    h.add(vv->getConstName());
+  else
+    h.add((int) s.getTechLayer()->getRoutingLevel());
+
+  Rect r;
+  s.getBox(r);
+  h.add(r, dx, dy);
+}
+
+static void hashWire(extBlockHash& h, dbWire* wire, int dx, int dy)
+{
+  if (wire == NULL) {
+    h.add(0);
+    return;
+  }
+  dbWireShapeItr shapes;
+  dbShape        s;
+  for (shapes.begin(wire); shapes.next(s);)
+    hashShape(h, s, dx, dy);
+}
+
+// parent wire shape, in parent net and wire order
+struct extBlockContextShape
+{
+  Rect        _box;
+  const char* _via;  // tech via or via name, NULL for a wire
+  int         _level;
+  uint        _seq;
+};
+
+// parent wires binned on a coarse grid, shared by all the children
+class extBlockContext
+{
+ public:
+  dbBlock*                          _block;
+  int                               _x0;
+  int                               _y0;
+  int                               _cellW;
+  int                               _cellH;
+  int                               _gridCnt;
+  std::vector<extBlockContextShape> _shapes;
+  std::vector<std::vector<uint> >   _bins;
+
+  void cellRange(const Rect& r, int& x1, int& y1, int& x2, int& y2)
+  {
+    x1 = std::max(0, (r.xMin() - _x0) / _cellW);
+    y1 = std::max(0, (r.yMin() - _y0) / _cellH);
+    x2 = std::min(_gridCnt - 1, (r.xMax() - _x0) / _cellW);
+    y2 = std::min(_gridCnt - 1, (r.yMax() - _y0) / _cellH);
+  }
+};
+
+extBlockContext* extMain::newBlockContext(dbBlock* parent)
+{
+  extBlockContext* ctx = new extBlockContext();
+  ctx->_block          = parent;
+
+  int minx = MAX_INT, miny = MAX_INT, maxx = -MAX_INT, maxy = -MAX_INT;
+  dbSet<dbNet>           nets = parent->getNets();
+  dbSet<dbNet>::iterator nitr;
+  for (nitr = nets.begin(); nitr != nets.end(); ++nitr) {
+    dbWire* wire = (*nitr)->getWire();
+    if (wire == NULL)
+      continue;
+
+    dbWireShapeItr shapes;
+    dbShape        s;
+    for (shapes.begin(wire); shapes.next(s);) {
+      extBlockContextShape c;
+      dbTechVia*           tv = s.getTechVia();
+      dbVia*               vv = s.getVia();
+      s.getBox(c._box);
+      c._via   = tv ? tv->getConstName() : (vv ? vv->getConstName() : NULL);
+      c._level = c._via ? 0 : s.getTechLayer()->getRoutingLevel();
+      c._seq   = ctx->_shapes.size();
+      ctx->_shapes.push_back(c);
+      minx = std::min(minx, c._box.xMin());
+      miny = std::min(miny, c._box.yMin());
+      maxx = std::max(maxx, c._box.xMax());
+      maxy = std::max(maxy, c._box.yMax());
+    }
+  }
+  uint cnt      = ctx->_shapes.size();
+  ctx->_gridCnt = std::max(1, std::min(1024, (int) sqrt((double) cnt) / 4));
+  ctx->_x0      = cnt ? minx : 0;
+  ctx->_y0      = cnt ? miny : 0;
+  ctx->_cellW   = cnt ? (maxx - minx) / ctx->_gridCnt + 1 : 1;
+  ctx->_cellH   = cnt ? (maxy - miny) / ctx->_gridCnt + 1 : 1;
+  ctx->_bins.resize(ctx->_gridCnt * ctx->_gridCnt);
+  for (uint ii = 0; ii < cnt; ii++) {
+    int x1, y1, x2, y2;
+    ctx->cellRange(ctx->_shapes[ii]._box, x1, y1, x2, y2);
+    for (int y = y1; y <= y2; y++) {
+      for (int x = x1; x <= x2; x++)
+        ctx->_bins[y * ctx->_gridCnt + x].push_back(ii);
+    }
+  }
+  return ctx;
+}
+
+void extMain::deleteBlockContext(extBlockContext* ctx)
+{
+  delete ctx;
+}
+
+// parent wires within band of the instance bbox, relative to the instance,
+// in the order of a scan over all parent wires
+static void hashContext(extBlockHash&    h,
+                        dbBlock*         blk,
+                        int              band,
+                        extBlockContext* ctx)
+{
+  dbInst* pinst = blk->getParentInst();
+  if (pinst == NULL)
+    return;
+
+  Rect ibox;
+  pinst->getBBox()->getBox(ibox);
+  int x, y;
+  pinst->getLocation(x, y);
+  h.add((int) pinst->getOrient());
+
+  Rect cbox(ibox.xMin() - band,
+            ibox.yMin() - band,
+            ibox.xMax() + band,
+            ibox.yMax() + band);
+
+  extBlockContext* own = NULL;
+  if (ctx == NULL || ctx->_block != pinst->getBlock())
+    ctx = own = extMain::newBlockContext(pinst->getBlock());
+
+  std::vector<uint> found;
+  int               x1, y1, x2, y2;
+  ctx->cellRange(cbox, x1, y1, x2, y2);
+  for (int cy = y1; cy <= y2; cy++) {
+    for (int cx = x1; cx <= x2; cx++) {
+      std::vector<uint>& bin = ctx->_bins[cy * ctx->_gridCnt + cx];
+      for (uint ii = 0; ii < bin.size(); ii++) {
+        Rect& r = ctx->_shapes[bin[ii]]._box;
+        if (r.xMax() < cbox.xMin() || r.xMin() > cbox.xMax()
+            || r.yMax() < cbox.yMin() || r.yMin() > cbox.yMax())
+          continue;
+        found.push_back(bin[ii]);
+      }
+    }
+  }
+  std::sort(found.begin(), found.end());
+  found.erase(std::unique(found.begin(), found.end()), found.end());
+  for (uint ii = 0; ii < found.size(); ii++) {
+    extBlockContextShape& c = ctx->_shapes[found[ii]];
+    if (c._via)
+      h.add(c._via);
+    else
+      h.add(c._level);
+    h.add(c._box, x, y);
+  }
+  if (own)
+    extMain::deleteBlockContext(own);
+}
+
+// distance within which wires couple: cc_model tracks of the widest pitch
+int extMain::couplingHalo(uint ccTracks)
+{
+  int                          maxPitch = 0;
+  dbSet<dbTechLayer>           layers   = _tech->getLayers();
+  dbSet<dbTechLayer>::iterator litr;
+  for (litr = layers.begin(); litr != layers.end(); ++litr) {
+    dbTechLayer* layer = *litr;
+    if (layer->getRoutingLevel() > 0 && layer->getPitch() > maxPitch)
+      maxPitch = layer->getPitch();
+  }
+  return (ccTracks + 1) * maxPitch;
+}
+
+uint64_t extMain::blockParasiticsKey(const char*      optionKey,
+                                     const char*      rulesFile,
+                                     uint             ccTracks,
+                                     extBlockContext* ctx)
+{
+  extBlockHash h;
+  h.add(optionKey);
+  struct stat st;
+  if (rulesFile && stat(rulesFile, &st) == 0) {
+    int64_t fst[2] = {(int64_t) st.st_size, (int64_t) st.st_mtime};
+    h.add(fst, sizeof(fst));
+  }
+
+  dbSet<dbNet>           nets = _block->getNets();
+  dbSet<dbNet>::iterator nitr;
+  for (nitr = nets.begin(); nitr != nets.end(); ++nitr) {
+    dbNet* net = *nitr;
+    h.add(net->getConstName());
+    h.add((int) net->getSigType());
+    hashWire(h, net->getWire(), 0, 0);
+  }
+  dbSet<dbBTerm>           bterms = _block->getBTerms();
+  dbSet<dbBTerm>::iterator bitr;
+  for (bitr = bterms.begin(); bitr != bterms.end(); ++bitr) {
+    dbBTerm* bterm = *bitr;
+    h.add(bterm->getConstName());
+    h.add((int) bterm->getIoType());
+
+    dbSet<dbBPin>           bpins = bterm->getBPins();
+    dbSet<dbBPin>::iterator pitr;
+    for (pitr = bpins.begin(); pitr != bpins.end(); ++pitr) {
+      dbBox* box = (*pitr)->getBox();
+      Rect   r;
+      box->getBox(r);
+      h.add((int) box->getTechLayer()->getRoutingLevel());
+      h.add(r, 0, 0);
+    }
+  }
+  dbSet<dbInst>           insts = _block->getInsts();
+  dbSet<dbInst>::iterator iitr;
+  for (iitr = insts.begin(); iitr != insts.end(); ++iitr) {
+    dbInst* inst = *iitr;
+    int     x, y;
+    inst->getLocation(x, y);
+    h.add(inst->getConstName());
+    h.add(inst->getMaster()->getConstName());
+    h.add(x);
+    h.add(y);
+    h.add((int) inst->getOrient());
+  }
+  hashContext(h, _block, couplingHalo(ccTracks), ctx);
+  return h._h;
+}
+
+bool extMain::loadBlockCache(const char*      dir,
+                             const char*      optionKey,
+                             const char*      rulesFile,
+                             uint             ccTracks,
+                             extBlockContext* ctx)
+{
+  uint64_t key = blockParasiticsKey(optionKey, rulesFile, ccTracks, ctx);
+
+  char name[32];
+  sprintf(name, "/%016llx.rcxbin", (unsigned long long) key);
+  _blockCacheFile = std::string(dir) + name;
+  const char* file = _blockCacheFile.c_str();
+
+  if (access(file, R_OK) != 0)
+    return false;
+
+  if (readBinaryParasitics(file, (char*) "", true) == 0) {
+    warning(0, "Ignoring unreadable block cache entry %s\n", file);
+    return false;
+  }
+  notice(0,
+         "Reused cached parasitics of block %s from %s\n",
+         _block->getConstName(),
+         dir);
+  return true;
+}
+
+void extMain::setBlockCacheOptions(const char* dir,
+                                   const char* optionKey,
+                                   const char* rulesFile,
+                                   uint        ccTracks)
+{
+  _blockCacheDir     = dir ? dir : "";
+  _blockCacheOptions = optionKey ? optionKey : "";
+  _blockCacheRules   = rulesFile ? rulesFile : "";
+  _blockCacheTracks  = ccTracks;
+}
+
+// Reads the parasitics of child block blk from the cache of the last
+// extraction with -block_cache, so flatten merges them with addRCtoTop
+// without extracting the block; false without an entry for its key.
+bool extMain::loadChildBlockCache(dbBlock* blk)
+{
+  if (_blockCacheDir.empty())
+    return false;
+
+  extMain* ext = (extMain*) blk->getExtmi();
+  if (ext == NULL || ext->_block != blk) {
+    ext = new extMain(5);
+    ext->setDB(_db);
+    ext->setBlock(blk);
+  }
+  bool hit = ext->loadBlockCache(
+      _blockCacheDir.c_str(),
+      _blockCacheOptions.c_str(),
+      _blockCacheRules.empty() ? NULL : _blockCacheRules.c_str(),
+      _blockCacheTracks,
+      NULL);
+  ext->_blockCacheFile.clear();
+  return hit;
+}
+
+void extMain::saveBlockCache()
+{
+  if (_blockCacheFile.empty())
+    return;
+
+  // write aside and rename, so concurrent runs never read a partial entry
+  char pid[32];
+  sprintf(pid, ".%d", (int) getpid());
+  std::string tmp = _blockCacheFile + pid;
+  if (writeBinaryParasitics(tmp.c_str(), true, true) == 0
+      || rename(tmp.c_str(), _blockCacheFile.c_str()) != 0) {
+    warning(0, "Can not save block cache entry %s\n", _blockCacheFile.c_str());
+    remove(tmp.c_str());
+  }
+  _blockCacheFile.clear();
+}
+
+}  // namespace OpenRCX
@@ -33,6 +33,9 @@
 #include <dbLogger.h>
 #include <math.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "extSpef.h"
 #include "parse.h"
 #include "wire.h"
@@ -242,6 +245,11 @@ void extSpef::resetNodeCoordTables()
   _y1CoordTable->resetCnt();
   _y2CoordTable->resetCnt();
   _levelTable->resetCnt();
+
+  // new *D_NET: entries of the previous net become stale by stamp
+  _nodeCoordNetStamp++;
+  _nodeCoordIndexCnt = 0;
+  _nodeShapeIdsDone  = false;
 }
 void extSpef::deleteNodeCoordTables()
 {
@@ -275,6 +283,12 @@ void extSpef::deleteNodeCoordTables()
   if (_idTable)
     delete _idTable;
   _idTable = NULL;
+
+  _nodeCoordSlot.clear();
+  _nodeCoordStamp.clear();
+  _nodeShapeIds.clear();
+  _nodeCoordIndexCnt = 0;
+  _nodeShapeIdsDone  = false;
 }
 bool extSpef::readNodeCoords(uint cpos)
 {
@@ -315,24 +329,44 @@ bool extSpef::readNodeCoords(uint cpos)
 void extSpef::adjustNodeCoords()
 {
   for (uint ii = 0; ii < _capNodeTable->getCnt(); ii++) {
-    char buff[128];
-    sprintf(buff, "*%d%s%d", _tmpNetSpefId, _delimiter, _capNodeTable->get(ii));
-    uint capId = getCapIdFromCapTable(buff);
+    uint capId = getCapIdFromCapTable(_tmpNetSpefId, _capNodeTable->get(ii));
     _capNodeTable->set(ii, capId);
   }
+  _nodeCoordNetStamp++;  // ids changed, re-index on next lookup
+  _nodeCoordIndexCnt = 0;
 }
-int extSpef::findNodeIndexFromNodeCoords(uint targetCapNodeId)  // TO OPTIMIZE
+// Maps the cap node ids of the coordinate tables to their index; entries
+// added since the last call are indexed incrementally. The first entry of a
+// cap node wins, as with a linear scan.
+void extSpef::indexNodeCoords()
 {
-  uint ii;
-  for (ii = 0; ii < _capNodeTable->getCnt(); ii++) {
+  uint cnt = _capNodeTable->getCnt();
+  for (uint ii = _nodeCoordIndexCnt; ii < cnt; ii++) {
     uint capId = _capNodeTable->get(ii);
-    if (capId == targetCapNodeId)
-      break;
+    if (capId >= _nodeCoordSlot.size()) {
+      uint size = capId + 1 > 2 * _nodeCoordSlot.size()
+                      ? capId + 1
+                      : 2 * _nodeCoordSlot.size();
+      _nodeCoordSlot.resize(size, 0);
+      _nodeCoordStamp.resize(size, 0);
+    }
+    if (_nodeCoordStamp[capId] == _nodeCoordNetStamp + 1)
+      continue;
+    _nodeCoordStamp[capId] = _nodeCoordNetStamp + 1;
+    _nodeCoordSlot[capId]  = ii;
   }
-  if (ii == _capNodeTable->getCnt())
+  _nodeCoordIndexCnt = cnt;
+}
+int extSpef::findNodeIndexFromNodeCoords(uint targetCapNodeId)
+{
+  if (_nodeCoordIndexCnt < _capNodeTable->getCnt())
+    indexNodeCoords();
+
+  if (targetCapNodeId >= _nodeCoordStamp.size()
+      || _nodeCoordStamp[targetCapNodeId] != _nodeCoordNetStamp + 1)
     return -1;
 
-  return ii;
+  return _nodeCoordSlot[targetCapNodeId];
 }
 uint extSpef::getITermShapeId(dbITerm* iterm)
 {
@@ -429,22 +463,155 @@ uint extSpef::getBTermShapeId(dbBTerm* bterm)
 }
 uint extSpef::getShapeIdFromNodeCoords(uint targetCapNodeId)
 {
-  uint shapeId;
-  int  ii = findNodeIndexFromNodeCoords(targetCapNodeId);
+  int ii = findNodeIndexFromNodeCoords(targetCapNodeId);
   if (ii < 0)
     return 0;
 
-  int  halo  = 20;
-  int  x1    = Ath__double2int(_nodeCoordFactor * _xCoordTable->get(ii));
-  int  y1    = Ath__double2int(_nodeCoordFactor * _yCoordTable->get(ii));
-  uint level = _levelTable->get(ii);
-  x1 -= halo;
-  y1 -= halo;
-  int x2 = x1 + halo;
-  int y2 = y1 + halo;
+  if (!_nodeShapeIdsDone || ii >= (int) _nodeShapeIds.size())
+    findNodeShapeIds(_d_net->getId());
 
-  shapeId = findShapeId(_d_net->getId(), x1, y1, x2, y2, level);
-  return shapeId;
+  return _nodeShapeIds[ii];
+}
+// Resolves the shape ids of all the coordinates read for the current net.
+// The nodes are bucketed on a coarse grid over their bbox; the search grids
+// are queried once per occupied cell on the levels of its nodes, and the
+// boxes of the net found there are bucketed by (level, cell) so every node is
+// only matched against the boxes of its own bucket.
+uint extSpef::findNodeShapeIds(uint netId)
+{
+  int  halo = 20;
+  uint cnt  = _capNodeTable->getCnt();
+  _nodeShapeIds.assign(cnt, 0);
+  _nodeShapeIdsDone = true;
+  if (cnt == 0)
+    return 0;
+
+  std::vector<int> nx(cnt);
+  std::vector<int> ny(cnt);
+  int              minx = MAX_INT;
+  int              miny = MAX_INT;
+  int              maxx = -MAX_INT;
+  int              maxy = -MAX_INT;
+  uint             ii;
+  for (ii = 0; ii < cnt; ii++) {
+    nx[ii] = Ath__double2int(_nodeCoordFactor * _xCoordTable->get(ii));
+    ny[ii] = Ath__double2int(_nodeCoordFactor * _yCoordTable->get(ii));
+    minx   = MIN(minx, nx[ii]);
+    miny   = MIN(miny, ny[ii]);
+    maxx   = MAX(maxx, nx[ii]);
+    maxy   = MAX(maxy, ny[ii]);
+  }
+  int  gridCnt  = MAX(1, MIN(256, (int) sqrt((double) cnt)));
+  int  cellW    = (maxx - minx) / gridCnt + 1;
+  int  cellH    = (maxy - miny) / gridCnt + 1;
+  uint cellCnt  = gridCnt * gridCnt;
+  uint levelCnt = _search->getColCnt();
+
+  // occupied cells: tight bbox of their nodes and the levels to search
+  std::vector<int>  nodeCell(cnt);
+  std::vector<int>  cx1(cellCnt, MAX_INT), cy1(cellCnt, MAX_INT);
+  std::vector<int>  cx2(cellCnt, -MAX_INT), cy2(cellCnt, -MAX_INT);
+  std::vector<uint> cellLevels(cellCnt, 0);
+  for (ii = 0; ii < cnt; ii++) {
+    int c = ((ny[ii] - miny) / cellH) * gridCnt + (nx[ii] - minx) / cellW;
+    uint nlevel  = _levelTable->get(ii);
+    nodeCell[ii] = c;
+    cx1[c]       = MIN(cx1[c], nx[ii]);
+    cy1[c]       = MIN(cy1[c], ny[ii]);
+    cx2[c]       = MAX(cx2[c], nx[ii]);
+    cy2[c]       = MAX(cy2[c], ny[ii]);
+    if (nlevel > 0 && nlevel < 32)
+      cellLevels[c] |= 1 << nlevel;
+    else
+      cellLevels[c] = ~0U;
+  }
+  _idTable->resetCnt(0);
+  uint c;
+  for (c = 0; c < cellCnt; c++) {
+    if (cellLevels[c] == 0)
+      continue;
+    for (uint dir = 0; dir < _search->getRowCnt(); dir++) {
+      for (uint layer = 1; layer < levelCnt; layer++) {
+        if (layer < 32 && !(cellLevels[c] & (1 << layer)))
+          continue;
+        _search->search(cx1[c] - halo,
+                        cy1[c] - halo,
+                        cx2[c],
+                        cy2[c],
+                        dir,
+                        layer,
+                        _idTable,
+                        true);
+      }
+    }
+  }
+  std::vector<uint> boxIds(_idTable->getCnt());
+  for (ii = 0; ii < _idTable->getCnt(); ii++)
+    boxIds[ii] = _idTable->get(ii);
+  std::sort(boxIds.begin(), boxIds.end());
+  boxIds.erase(std::unique(boxIds.begin(), boxIds.end()), boxIds.end());
+
+  // (level * cellCnt + cell, box index) for every cell a box can match in
+  std::vector<std::pair<uint, uint>> buckets;
+  std::vector<uint>                  bshape;
+  std::vector<int>                   bx1, by1, bx2, by2;
+  int                                loX, loY, hiX, hiY;
+  uint                               level, id1, id2, wtype;
+  for (ii = 0; ii < boxIds.size(); ii++) {
+    _search->getBox(
+        boxIds[ii], &loX, &loY, &hiX, &hiY, &level, &id1, &id2, &wtype);
+    if (id1 != netId)
+      continue;
+    // a node at (x, y) matches when its [x - halo, x] x [y - halo, y] box
+    // overlaps the shape
+    if (hiX + halo < minx || hiY + halo < miny || loX > maxx || loY > maxy)
+      continue;
+    int  gx1      = MAX(0, (loX - minx) / cellW);
+    int  gy1      = MAX(0, (loY - miny) / cellH);
+    int  gx2      = MIN(gridCnt - 1, (hiX + halo - minx) / cellW);
+    int  gy2      = MIN(gridCnt - 1, (hiY + halo - miny) / cellH);
+    uint boxIndex = bshape.size();
+    bshape.push_back(id2);
+    bx1.push_back(loX);
+    by1.push_back(loY);
+    bx2.push_back(hiX);
+    by2.push_back(hiY);
+    for (int gy = gy1; gy <= gy2; gy++) {
+      for (int gx = gx1; gx <= gx2; gx++)
+        buckets.push_back(
+            std::make_pair(level * cellCnt + gy * gridCnt + gx, boxIndex));
+    }
+  }
+  std::sort(buckets.begin(), buckets.end());
+
+  uint found = 0;
+  for (ii = 0; ii < cnt; ii++) {
+    uint nlevel = _levelTable->get(ii);
+    int  x1     = nx[ii] - halo;
+    int  y1     = ny[ii] - halo;
+    uint lo     = nlevel > 0 ? nlevel : 1;
+    uint hi     = nlevel > 0 ? nlevel : levelCnt - 1;
+    uint best   = bshape.size();
+    for (level = lo; level <= hi; level++) {
+      uint key = level * cellCnt + nodeCell[ii];
+      std::vector<std::pair<uint, uint>>::iterator it = std::lower_bound(
+          buckets.begin(), buckets.end(), std::make_pair(key, 0U));
+      for (; it != buckets.end() && it->first == key && it->second < best;
+           ++it) {
+        uint jj = it->second;
+        if (bx2[jj] < x1 || bx1[jj] > nx[ii] || by2[jj] < y1
+            || by1[jj] > ny[ii])
+          continue;
+        best = jj;
+        break;
+      }
+    }
+    if (best == bshape.size())
+      continue;
+    _nodeShapeIds[ii] = bshape[best];
+    found++;
+  }
+  return found;
 }
 
 /*
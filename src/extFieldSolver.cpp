@@ -0,0 +1,563 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Built-in 2D field solver for rules generation: solves the pattern decks
+// in process by finite volumes on a rectilinear grid and writes the charges
+// in F/um like the external solver outputs readCapacitanceBench reads.
+
+#include <dbLogger.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "extRCap.h"
+#include "extUtil.h"
+
+namespace OpenRCX {
+
+using odb::notice;
+using odb::warning;
+
+static const double FS_EPS0      = 8.854187817e-18;  // F/um
+static const double FS_GRADE     = 1.2;      // growth of the cells off a vertex
+static const double FS_TOL       = 1.0e-5;   // um, on-boundary tolerance
+static const uint   FS_MAX_NODES = 2000000;
+
+struct extFsShape
+{
+  std::string         _name;
+  std::vector<double> _x;
+  std::vector<double> _y;
+  double              _xlo, _xhi, _ylo, _yhi;
+  bool                _conductor;
+  double              _value;  // VOLT of a conductor, DIEL of a dielectric
+};
+
+struct extFsDeck
+{
+  double                  _x1, _y1, _x2, _y2;
+  double                  _diel;
+  std::vector<extFsShape> _shapes;
+};
+
+// number, name of a param, or number*name as written by writeWindow
+static bool fsEval(const char*                    s,
+                   std::map<std::string, double>& params,
+                   double&                        v)
+{
+  char  buf[256] = "";
+  char* e;
+  sscanf(s, "%255[^;]", buf);
+
+  double coef = 1.0;
+  char*  name = buf;
+  char*  star = strchr(buf, '*');
+  if (star != NULL) {
+    *star = '\0';
+    coef  = strtod(buf, &e);
+    name  = star + 1;
+  } else {
+    v = strtod(buf, &e);
+    if (e != buf)
+      return true;
+  }
+  while (*name == ' ')
+    name++;
+  std::map<std::string, double>::iterator it = params.find(name);
+  if (it == params.end())
+    return false;
+  v = coef * it->second;
+  return true;
+}
+
+static bool fsKeyVal(const char*                    line,
+                     const char*                    key,
+                     std::map<std::string, double>& params,
+                     double&                        v)
+{
+  const char* s = strstr(line, key);
+  if (s == NULL)
+    return false;
+  return fsEval(s + strlen(key), params, v);
+}
+
+static bool fsReadDeck(const char* deck, extFsDeck* d)
+{
+  FILE* fp = fopen(deck, "r");
+  if (fp == NULL)
+    return false;
+
+  std::map<std::string, double> params;
+  bool                          window = false;
+  char                          line[16384];
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    if (strncmp(line, "POLY3D", 6) == 0 || strncmp(line, "WINDOW3D", 8) == 0
+        || strncmp(line, "BLOCK", 5) == 0) {
+      fclose(fp);
+      return false;  // 3D deck
+    }
+    if (strncmp(line, "param ", 6) == 0) {
+      char   name[256];
+      double v;
+      if (sscanf(line + 6, " %255[^= ] = %lf", name, &v) == 2)
+        params[name] = v;
+      continue;
+    }
+    if (strncmp(line, "WINDOW ", 7) == 0) {
+      window = fsKeyVal(line, "X1=", params, d->_x1)
+               && fsKeyVal(line, "Y1=", params, d->_y1)
+               && fsKeyVal(line, "X2=", params, d->_x2)
+               && fsKeyVal(line, "Y2=", params, d->_y2);
+      d->_diel = 1.0;
+      fsKeyVal(line, "DIEL=", params, d->_diel);
+      continue;
+    }
+    if (strncmp(line, "POLY NAME=", 10) != 0)
+      continue;
+
+    extFsShape s;
+    char       name[256];
+    int        n = 0;
+    if (sscanf(line + 10, " %255[^;];%n", name, &n) != 1 || n == 0)
+      continue;
+    s._name = name;
+
+    const char* p = line + 10 + n;
+    while (*p == ' ')
+      p++;
+    if (strncmp(p, "COORD=", 6) == 0)
+      p += 6;
+    double x, y;
+    while (sscanf(p, " %lf,%lf ;%n", &x, &y, &n) == 2) {
+      s._x.push_back(x);
+      s._y.push_back(y);
+      p += n;
+    }
+    if (s._x.size() < 3)
+      continue;
+
+    if (strstr(p, "VOLT=") != NULL) {
+      s._conductor = true;
+      s._value     = atof(strstr(p, "VOLT=") + 5);
+    } else if (strstr(p, "DIEL=") != NULL) {
+      s._conductor = false;
+      s._value     = atof(strstr(p, "DIEL=") + 5);
+    } else {
+      continue;
+    }
+    s._xlo = *std::min_element(s._x.begin(), s._x.end());
+    s._xhi = *std::max_element(s._x.begin(), s._x.end());
+    s._ylo = *std::min_element(s._y.begin(), s._y.end());
+    s._yhi = *std::max_element(s._y.begin(), s._y.end());
+    d->_shapes.push_back(s);
+  }
+  fclose(fp);
+
+  return window && d->_x2 > d->_x1 && d->_y2 > d->_y1;
+}
+
+// inside or on the boundary
+static bool fsInside(extFsShape* s, double x, double y)
+{
+  if (x < s->_xlo - FS_TOL || x > s->_xhi + FS_TOL || y < s->_ylo - FS_TOL
+      || y > s->_yhi + FS_TOL)
+    return false;
+
+  uint n      = s->_x.size();
+  bool inside = false;
+  for (uint ii = 0, jj = n - 1; ii < n; jj = ii++) {
+    double xi = s->_x[ii], yi = s->_y[ii];
+    double xj = s->_x[jj], yj = s->_y[jj];
+
+    // on the edge
+    double dx  = xj - xi;
+    double dy  = yj - yi;
+    double len = sqrt(dx * dx + dy * dy);
+    if (len > 0.0) {
+      double t    = ((x - xi) * dx + (y - yi) * dy) / (len * len);
+      double dist = fabs((x - xi) * dy - (y - yi) * dx) / len;
+      if (t >= -FS_TOL / len && t <= 1.0 + FS_TOL / len && dist <= FS_TOL)
+        return true;
+    }
+    if ((yi > y) != (yj > y) && x < dx * (y - yi) / dy + xi)
+      inside = !inside;
+  }
+  return inside;
+}
+
+// grid lines through the vertices, graded from both ends of every interval
+static void fsGrid(std::vector<double>& lines, double lo, double hi, double h0)
+{
+  std::vector<double> v;
+  for (uint ii = 0; ii < lines.size(); ii++) {
+    if (lines[ii] > lo && lines[ii] < hi)
+      v.push_back(lines[ii]);
+  }
+  v.push_back(lo);
+  v.push_back(hi);
+  std::sort(v.begin(), v.end());
+
+  lines.clear();
+  lines.push_back(v[0]);
+  for (uint ii = 1; ii < v.size(); ii++) {
+    double a = lines.back();
+    double b = v[ii];
+    if (b - a < FS_TOL)
+      continue;
+
+    std::vector<double> right;
+    double              h = MIN(h0, (b - a) * 0.25);
+    double              l = a;
+    double              r = b;
+    while (r - l > 2.5 * h) {
+      l += h;
+      r -= h;
+      lines.push_back(l);
+      right.push_back(r);
+      h *= FS_GRADE;
+    }
+    if (r - l > 1.5 * h)
+      lines.push_back(0.5 * (l + r));
+    for (int jj = right.size() - 1; jj >= 0; jj--)
+      lines.push_back(right[jj]);
+    lines.push_back(b);
+  }
+}
+
+bool extRCModel::runBuiltinSolver(const char* deck, const char* out)
+{
+  extFsDeck d;
+  if (!fsReadDeck(deck, &d))
+    return false;
+
+  // smallest conductor feature sets the finest cells
+  double              feature = d._y2 - d._y1;
+  std::vector<double> xs;
+  std::vector<double> ys;
+  for (uint ii = 0; ii < d._shapes.size(); ii++) {
+    extFsShape* s = &d._shapes[ii];
+    xs.insert(xs.end(), s->_x.begin(), s->_x.end());
+    ys.insert(ys.end(), s->_y.begin(), s->_y.end());
+    if (s->_conductor) {
+      if (s->_xhi - s->_xlo > FS_TOL)
+        feature = MIN(feature, s->_xhi - s->_xlo);
+      if (s->_yhi - s->_ylo > FS_TOL)
+        feature = MIN(feature, s->_yhi - s->_ylo);
+    }
+  }
+  double h0 = MAX(feature / 10.0, 10 * FS_TOL);
+  fsGrid(xs, d._x1, d._x2, h0);
+  fsGrid(ys, d._y1, d._y2, h0);
+
+  uint nx = xs.size();
+  uint ny = ys.size();
+  if (nx < 2 || ny < 2 || (double) nx * ny > FS_MAX_NODES)
+    return false;
+
+  // permittivity of the cells, from the dielectric shapes only
+  std::vector<double> eps((nx - 1) * (ny - 1), d._diel);
+  for (uint jj = 0; jj + 1 < ny; jj++) {
+    double y = 0.5 * (ys[jj] + ys[jj + 1]);
+    for (uint ii = 0; ii + 1 < nx; ii++) {
+      double x = 0.5 * (xs[ii] + xs[ii + 1]);
+      for (uint kk = 0; kk < d._shapes.size(); kk++) {
+        extFsShape* s = &d._shapes[kk];
+        if (!s->_conductor && fsInside(s, x, y))
+          eps[jj * (nx - 1) + ii] = s->_value;
+      }
+    }
+  }
+
+  // conductor of the nodes, -1 for free nodes
+  std::vector<int> cond(nx * ny, -1);
+  std::vector<int> condShape;
+  for (uint kk = 0; kk < d._shapes.size(); kk++) {
+    if (d._shapes[kk]._conductor)
+      condShape.push_back(kk);
+  }
+  if (condShape.empty())
+    return false;
+  for (uint jj = 0; jj < ny; jj++) {
+    for (uint ii = 0; ii < nx; ii++) {
+      for (uint cc = 0; cc < condShape.size(); cc++) {
+        if (fsInside(&d._shapes[condShape[cc]], xs[ii], ys[jj]))
+          cond[jj * nx + ii] = cc;
+      }
+    }
+  }
+
+  // edge couplings: cx between (i,j) and (i+1,j), cy between (i,j) and (i,j+1)
+  std::vector<double> cx((nx - 1) * ny, 0.0);
+  std::vector<double> cy(nx * (ny - 1), 0.0);
+  for (uint jj = 0; jj < ny; jj++) {
+    for (uint ii = 0; ii + 1 < nx; ii++) {
+      double w = 0.0;
+      if (jj > 0)
+        w += eps[(jj - 1) * (nx - 1) + ii] * (ys[jj] - ys[jj - 1]);
+      if (jj + 1 < ny)
+        w += eps[jj * (nx - 1) + ii] * (ys[jj + 1] - ys[jj]);
+      cx[jj * (nx - 1) + ii] = 0.5 * w / (xs[ii + 1] - xs[ii]);
+    }
+  }
+  for (uint jj = 0; jj + 1 < ny; jj++) {
+    for (uint ii = 0; ii < nx; ii++) {
+      double w = 0.0;
+      if (ii > 0)
+        w += eps[jj * (nx - 1) + ii - 1] * (xs[ii] - xs[ii - 1]);
+      if (ii + 1 < nx)
+        w += eps[jj * (nx - 1) + ii] * (xs[ii + 1] - xs[ii]);
+      cy[jj * nx + ii] = 0.5 * w / (ys[jj + 1] - ys[jj]);
+    }
+  }
+
+  // fixed potentials, right hand side and preconditioner of the free nodes
+  uint                nodeCnt = nx * ny;
+  std::vector<double> v(nodeCnt, 0.0);
+  std::vector<double> b(nodeCnt, 0.0);
+  std::vector<double> diag(nodeCnt, 0.0);
+  for (uint p = 0; p < nodeCnt; p++) {
+    if (cond[p] >= 0)
+      v[p] = d._shapes[condShape[cond[p]]]._value;
+  }
+  for (uint jj = 0; jj < ny; jj++) {
+    for (uint ii = 0; ii < nx; ii++) {
+      uint p = jj * nx + ii;
+      if (cond[p] >= 0)
+        continue;
+      double c[4] = {0.0, 0.0, 0.0, 0.0};
+      uint   q[4] = {p, p, p, p};
+      if (ii > 0) {
+        c[0] = cx[jj * (nx - 1) + ii - 1];
+        q[0] = p - 1;
+      }
+      if (ii + 1 < nx) {
+        c[1] = cx[jj * (nx - 1) + ii];
+        q[1] = p + 1;
+      }
+      if (jj > 0) {
+        c[2] = cy[(jj - 1) * nx + ii];
+        q[2] = p - nx;
+      }
+      if (jj + 1 < ny) {
+        c[3] = cy[jj * nx + ii];
+        q[3] = p + nx;
+      }
+      for (uint kk = 0; kk < 4; kk++) {
+        diag[p] += c[kk];
+        if (q[kk] != p && cond[q[kk]] >= 0)
+          b[p] += c[kk] * v[q[kk]];
+      }
+      if (diag[p] <= 0.0)
+        diag[p] = 1.0;
+    }
+  }
+
+  // A*x over the free nodes, fixed nodes read as 0
+  auto mult = [&](std::vector<double>& x, std::vector<double>& y) {
+    for (uint jj = 0; jj < ny; jj++) {
+      for (uint ii = 0; ii < nx; ii++) {
+        uint p = jj * nx + ii;
+        if (cond[p] >= 0) {
+          y[p] = 0.0;
+          continue;
+        }
+        double s = 0.0;
+        if (ii > 0 && cond[p - 1] < 0)
+          s += cx[jj * (nx - 1) + ii - 1] * x[p - 1];
+        if (ii + 1 < nx && cond[p + 1] < 0)
+          s += cx[jj * (nx - 1) + ii] * x[p + 1];
+        if (jj > 0 && cond[p - nx] < 0)
+          s += cy[(jj - 1) * nx + ii] * x[p - nx];
+        if (jj + 1 < ny && cond[p + nx] < 0)
+          s += cy[jj * nx + ii] * x[p + nx];
+        y[p] = diag[p] * x[p] - s;
+      }
+    }
+  };
+
+  std::vector<double> x(nodeCnt, 0.0);
+  std::vector<double> r(b);
+  std::vector<double> z(nodeCnt, 0.0);
+  std::vector<double> pp(nodeCnt, 0.0);
+  std::vector<double> ap(nodeCnt, 0.0);
+
+  double bnorm = 0.0;
+  double rz    = 0.0;
+  for (uint p = 0; p < nodeCnt; p++) {
+    if (cond[p] >= 0)
+      continue;
+    bnorm += b[p] * b[p];
+    z[p]  = r[p] / diag[p];
+    pp[p] = z[p];
+    rz += r[p] * z[p];
+  }
+  bnorm = sqrt(bnorm);
+
+  bool converged = bnorm == 0.0;
+  for (uint it = 0; !converged && it < 10 * nodeCnt; it++) {
+    mult(pp, ap);
+    double pap = 0.0;
+    for (uint p = 0; p < nodeCnt; p++)
+      pap += pp[p] * ap[p];
+    if (pap <= 0.0)
+      break;
+    double alpha = rz / pap;
+    double rnorm = 0.0;
+    for (uint p = 0; p < nodeCnt; p++) {
+      x[p] += alpha * pp[p];
+      r[p] -= alpha * ap[p];
+      rnorm += r[p] * r[p];
+    }
+    if (sqrt(rnorm) <= 1.0e-8 * bnorm) {
+      converged = true;
+      break;
+    }
+    double rz1 = 0.0;
+    for (uint p = 0; p < nodeCnt; p++) {
+      z[p] = cond[p] >= 0 ? 0.0 : r[p] / diag[p];
+      rz1 += r[p] * z[p];
+    }
+    double beta = rz1 / rz;
+    rz          = rz1;
+    for (uint p = 0; p < nodeCnt; p++)
+      pp[p] = z[p] + beta * pp[p];
+  }
+  if (!converged)
+    return false;
+
+  for (uint p = 0; p < nodeCnt; p++) {
+    if (cond[p] < 0)
+      v[p] = x[p];
+  }
+
+  // flux leaving the nodes of every conductor
+  std::vector<double> charge(condShape.size(), 0.0);
+  for (uint jj = 0; jj < ny; jj++) {
+    for (uint ii = 0; ii < nx; ii++) {
+      uint p = jj * nx + ii;
+      if (ii + 1 < nx && cond[p] != cond[p + 1]) {
+        double f = cx[jj * (nx - 1) + ii] * (v[p] - v[p + 1]);
+        if (cond[p] >= 0)
+          charge[cond[p]] += f;
+        if (cond[p + 1] >= 0)
+          charge[cond[p + 1]] -= f;
+      }
+      if (jj + 1 < ny && cond[p] != cond[p + nx]) {
+        double f = cy[jj * nx + ii] * (v[p] - v[p + nx]);
+        if (cond[p] >= 0)
+          charge[cond[p]] += f;
+        if (cond[p + nx] >= 0)
+          charge[cond[p + nx]] -= f;
+      }
+    }
+  }
+
+  FILE* fp = fopen(out, "w");
+  if (fp == NULL)
+    return false;
+
+  fprintf(fp,
+          "*** POTENTIAL builtin 2D solver %s, %d x %d grid\n\n",
+          deck,
+          nx,
+          ny);
+  for (uint cc = 0; cc < condShape.size(); cc++) {
+    const char* name = d._shapes[condShape[cc]]._name.c_str();
+    if (strstr(name, "__") != NULL)  // ground planes
+      continue;
+    fprintf(fp, "   Charge on %s = %e\n", name, FS_EPS0 * charge[cc]);
+  }
+  fprintf(fp, "END\n");
+  fclose(fp);
+  return true;
+}
+
+struct extBuiltinSolverJobs
+{
+  std::vector<extSolverJob*>* _jobs;
+  bool (*_solve)(const char* deck, const char* out);
+  std::atomic<uint>           _next;
+  std::atomic<uint>           _doneCnt;
+  std::vector<char>           _failed;
+};
+
+static void runBuiltinSolverThread(void* arg)
+{
+  extBuiltinSolverJobs* jobs = (extBuiltinSolverJobs*) arg;
+  for (uint ii = jobs->_next++; ii < jobs->_jobs->size(); ii = jobs->_next++) {
+    extSolverJob* job = (*jobs->_jobs)[ii];
+    std::string   deck = job->_dir + "/" + job->_file;
+    std::string   out  = deck + ".out";
+
+    job->_tryCnt++;
+    if (jobs->_solve(deck.c_str(), out.c_str()))
+      jobs->_doneCnt++;
+    else
+      jobs->_failed[ii] = 1;
+  }
+}
+
+// The builtin solver and the stub run in threads of this process; neither
+// needs a process of its own.
+void extRCModel::runBuiltinSolverJobs(uint& doneCnt, uint& failCnt)
+{
+  extBuiltinSolverJobs jobs;
+  jobs._jobs    = &_solverJobTable;
+  jobs._solve   = _solverCmd == "stub" ? writeStubSolverOutput
+                                       : runBuiltinSolver;
+  jobs._next    = 0;
+  jobs._doneCnt = 0;
+  jobs._failed.resize(_solverJobTable.size(), 0);
+
+  extRunWorkers(_solverJobCnt, runBuiltinSolverThread, &jobs);
+
+  doneCnt = jobs._doneCnt;
+  for (uint ii = 0; ii < jobs._failed.size(); ii++) {
+    if (!jobs._failed[ii])
+      continue;
+    warning(0,
+            "%s solver failed on %s/%s\n",
+            _solverCmd == "stub" ? "Stub" : "Builtin",
+            _solverJobTable[ii]->_dir.c_str(),
+            _solverJobTable[ii]->_file.c_str());
+    failCnt++;
+  }
+}
+
+}  // namespace OpenRCX
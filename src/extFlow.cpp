@@ -31,6 +31,7 @@
 // POSSIBILITY OF SUCH DAMAGE.
 
 #include "extRCap.h"
+#include "extUtil.h"
 //#include "wire.h"
 #include <wire.h>
 
@@ -508,7 +509,7 @@ uint extMain::mkSignalTables2(uint*                 nm_step,
     }
 
     Rect maxRect;
-    uint cnt1 = getNetBbox(net, maxRect);
+    uint cnt1 = getIndexedNetBbox(net, maxRect);
     if (cnt1 == 0)
       continue;
 
@@ -2511,9 +2512,14 @@ uint extMain::couplingFlow(bool        rlog,
 
   _seqPool = m->_seqPool;
 
+  openSearchIndex();
   uint maxWidth        = 0;
   uint totPowerWireCnt = powerWireCounter(maxWidth);
-  uint totWireCnt      = signalWireCounter(maxWidth);
+  uint totWireCnt      = 0;
+  if (!getIndexedWireCounts(totWireCnt, maxWidth)) {
+    totWireCnt = signalWireCounter(maxWidth);
+    setIndexedWireCounts(totWireCnt, maxWidth);
+  }
   totWireCnt += totPowerWireCnt;
 
   notice(0, "%d wires to be extracted\n", totWireCnt);
@@ -2731,6 +2737,8 @@ uint extMain::couplingFlow(bool        rlog,
                 minExtracted,
                 deallocLimit);
       _search->dealloc(dir, deallocLimit);
+      if (dir == 0 && _retiring)
+        retireExtractedNets(deallocLimit);
 
       lo_sdb[dir] = hiXY;
       gs_limit    = minExtracted - (ccDist + 2) * maxPitch;
@@ -2760,6 +2768,7 @@ uint extMain::couplingFlow(bool        rlog,
   if (use_signal_tables) {
     freeSignalTables(true, sdbSignalTable, NULL, sdbBucketCnt);
   }
+  closeSearchIndex();
 
   if (_geomSeq != NULL) {
     delete _geomSeq;
@@ -4151,29 +4160,92 @@ void extMain::updateRseg(dbRSeg* rseg1, dbRSeg* rseg2, uint cornerCnt)
     rseg2->setCapacitance(cap, ii);
   }
 }
+// Tile assembly runs in two phases: the child rsegs and ccsegs are read
+// into records in parallel (only the child block is read), then the main
+// block is updated serially from the records since odb is not thread safe.
+
+struct extAssemblySegs
+{
+  std::vector<dbRSeg*>  _rsegs;
+  std::vector<dbCCSeg*> _ccs;
+  std::vector<uint>     _srcRsegId;  // main rseg id by record; 0 not found
+  std::vector<uint>     _dstRsegId;
+  std::vector<double>   _cap;  // cornerCnt values by record
+  uint                  _cornerCnt;
+};
+
+static void readAssemblyRCs(void* arg, uint first, uint last)
+{
+  extAssemblySegs* segs = (extAssemblySegs*) arg;
+  for (uint ii = first; ii < last; ii++) {
+    dbRSeg* rseg = segs->_rsegs[ii];
+    segs->_dstRsegId[ii] = rseg->getTargetCapNode()->getShapeId();
+
+    double gndCapTable[10];
+    rseg->getCapTable(gndCapTable);
+    for (uint jj = 0; jj < segs->_cornerCnt; jj++)
+      segs->_cap[ii * segs->_cornerCnt + jj] = gndCapTable[jj];
+  }
+}
+
+static void readAssemblyCCs(void* arg, uint first, uint last)
+{
+  extAssemblySegs* segs = (extAssemblySegs*) arg;
+  for (uint ii = first; ii < last; ii++) {
+    dbCCSeg* cc = segs->_ccs[ii];
+    segs->_srcRsegId[ii] = cc->getSourceCapNode()->getShapeId();
+    segs->_dstRsegId[ii] = cc->getTargetCapNode()->getShapeId();
+    for (uint jj = 0; jj < segs->_cornerCnt; jj++)
+      segs->_cap[ii * segs->_cornerCnt + jj] = cc->getCapacitance(jj);
+  }
+}
+
+// the parser-less getMainRseg(), given the rseg id phase 1 read
+static dbRSeg* getAssemblyRseg(dbBlock* mainBlock, uint rsegId, uint nodeId)
+{
+  if (rsegId == 0) {
+    warning(0, "CCap: cannot find rseg for capNode %d\n", nodeId);
+    return NULL;
+  }
+  dbRSeg* rseg = dbRSeg::getRSeg(mainBlock, rsegId);
+  if (rseg == NULL)
+    warning(0, "CCap: cannot find rseg %d\n", rsegId);
+  return rseg;
+}
+
 uint extMain::assembly_RCs(dbBlock* mainBlock, dbBlock* blk, uint cornerCnt)
 {
   uint rcCnt = 0;
 
-  Ath__parser  p;
-  Ath__parser* parser = NULL;
+  extAssemblySegs segs;
+  segs._cornerCnt = cornerCnt;
 
   dbSet<dbRSeg>           rcSegs = blk->getRSegs();
   dbSet<dbRSeg>::iterator rcitr;
 
   for (rcitr = rcSegs.begin(); rcitr != rcSegs.end(); ++rcitr) {
     dbRSeg* rseg1 = *rcitr;
-    if (!rseg1->updatedCap())
-      continue;
-
-    dbRSeg* rseg2 = getMainRseg(rseg1->getTargetCapNode(), mainBlock, parser);
+    if (rseg1->updatedCap())
+      segs._rsegs.push_back(rseg1);
+  }
+  uint cnt = segs._rsegs.size();
+  segs._dstRsegId.resize(cnt);
+  segs._cap.resize(cnt * cornerCnt);
+  extRunRanges(cnt, extThreadCnt(), EXT_PARALLEL_MIN, readAssemblyRCs, &segs);
 
+  for (uint ii = 0; ii < cnt; ii++) {
+    dbRSeg* rseg2 = getAssemblyRseg(
+        mainBlock, segs._dstRsegId[ii], segs._rsegs[ii]->getTargetNode());
     if (rseg2 == NULL)
       continue;
 
-    uint rsgeId1 = rseg1->getId();
-    updateRseg(rseg1, rseg2, cornerCnt);
+    double gndCapTable2[10];
+    rseg2->getCapTable(gndCapTable2);
 
+    for (uint jj = 0; jj < cornerCnt; jj++) {
+      double cap = segs._cap[ii * cornerCnt + jj] + gndCapTable2[jj];
+      rseg2->setCapacitance(cap, jj);
+    }
     rcCnt++;
   }
   return rcCnt;
@@ -4186,22 +4258,32 @@ uint extMain::assemblyCCs(dbBlock* mainBlock,
 {
   uint ccCnt = 0;
 
-  Ath__parser  p;
-  Ath__parser* parser = NULL;
+  extAssemblySegs segs;
+  segs._cornerCnt = cornerCnt;
 
   dbSet<dbCCSeg>           ccSegs = blk->getCCSegs();
   dbSet<dbCCSeg>::iterator ccitr;
 
-  for (ccitr = ccSegs.begin(); ccitr != ccSegs.end(); ++ccitr) {
-    dbCCSeg* cc = *ccitr;
+  for (ccitr = ccSegs.begin(); ccitr != ccSegs.end(); ++ccitr)
+    segs._ccs.push_back(*ccitr);
+
+  uint cnt = segs._ccs.size();
+  segs._srcRsegId.resize(cnt);
+  segs._dstRsegId.resize(cnt);
+  segs._cap.resize(cnt * cornerCnt);
+  extRunRanges(cnt, extThreadCnt(), EXT_PARALLEL_MIN, readAssemblyCCs, &segs);
 
-    dbRSeg* srcRC = getMainRseg(cc->getSourceCapNode(), mainBlock, parser);
+  for (uint ii = 0; ii < cnt; ii++) {
+    dbCCSeg* cc = segs._ccs[ii];
 
+    dbRSeg* srcRC = getAssemblyRseg(
+        mainBlock, segs._srcRsegId[ii], cc->getSourceCapNode()->getId());
     if (srcRC == NULL) {
       missCCcnt++;
       continue;
     }
-    dbRSeg* dstRC = getMainRseg(cc->getTargetCapNode(), mainBlock, parser);
+    dbRSeg* dstRC = getAssemblyRseg(
+        mainBlock, segs._dstRsegId[ii], cc->getTargetCapNode()->getId());
     if (dstRC == NULL) {
       missCCcnt++;
       continue;
@@ -4210,11 +4292,8 @@ uint extMain::assemblyCCs(dbBlock* mainBlock,
     dbCCSeg* ccap = dbCCSeg::create(
         srcRC->getTargetCapNode(), dstRC->getTargetCapNode(), false);
 
-    for (uint ii = 0; ii < cornerCnt; ii++) {
-      double cap = cc->getCapacitance(ii);
-      ;
-      ccap->setCapacitance(cap, ii);
-    }
+    for (uint jj = 0; jj < cornerCnt; jj++)
+      ccap->setCapacitance(segs._cap[ii * cornerCnt + jj], jj);
     ccCnt++;
   }
   return ccCnt;
@@ -0,0 +1,548 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Measurement log for rules what-if runs
+//
+// extract_parasitics -measure_log file records what the sweep feeds to the
+// rules model. For every measured segment pair it keeps the layer, width,
+// spacing, length and the two rsegs, followed by the pieces extMeasure found
+// for it: the lengths covered over, under and between context layers, and
+// the diagonal couplings, in the order they were computed.
+//
+// reevaluate_parasitics puts the rsegs back to what rcgen made of them,
+// reads the new rules for the current corner set and runs every piece
+// through the same extMeasure code the sweep uses, so the parasitics are
+// those of a full extraction with the new rules, without the geometry sweep.
+// The log belongs to the wires and rsegs it was made on; it is rejected
+// when the wires or the rseg count of the block changed since.
+//
+// file: header, the rsegs of the signal nets with their res and caps per
+// corner before the sweep, then per measurement an event record followed by
+// its pieces.
+
+#include <dbLogger.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "extRCap.h"
+
+namespace OpenRCX {
+
+using odb::dbCCSeg;
+using odb::dbNet;
+using odb::dbRSeg;
+using odb::dbSet;
+using odb::dbSigType;
+using odb::notice;
+using odb::warning;
+
+static const char     MLG_MAGIC[8] = {'R', 'C', 'X', 'M', 'L', 'G', '0', '1'};
+static const uint32_t MLG_VERSION  = 1;
+
+// header flags
+static const uint32_t MLG_BTERM_THRESHOLD = 1;
+static const uint32_t MLG_LEF_RES         = 2;
+
+// event flags
+static const uint32_t MLG_SAME_NET = 1;
+
+struct extMeasureLogHeader
+{
+  char     _magic[8];
+  uint32_t _version;
+  uint32_t _cornerCnt;
+  uint32_t _extDbCnt;
+  uint32_t _ccFlag;
+  uint64_t _wireSum;
+  uint32_t _blockRSegCnt;
+  uint32_t _rsegCnt;  // rsegs with saved values
+  double   _coupleThreshold;
+  uint64_t _eventCnt;
+  uint64_t _recordCnt;
+  uint32_t _flags;
+  uint32_t _spare;
+};
+
+struct extMeasureLogRSeg  // + cornerCnt res, cornerCnt caps
+{
+  uint32_t _id;
+  uint32_t _spare;
+};
+
+// event: met, flags, len, rsegs, width, dist, covered length, piece count
+// coverage: over met in _met, under met in _met2, len
+// diag: target met in _met2, len, rsegs, diag width and dist
+struct extMeasureLogRec
+{
+  uint8_t  _kind;
+  int8_t   _met;
+  int8_t   _met2;
+  uint8_t  _flags;
+  int32_t  _len;
+  int32_t  _rseg1;
+  int32_t  _rseg2;
+  int32_t  _width;
+  int32_t  _dist;
+  int32_t  _covered;
+  uint32_t _cnt;
+};
+
+class extMeasureLog
+{
+ public:
+  extMeasureLog()
+  {
+    _fp        = NULL;
+    _measure   = NULL;
+    _ok        = true;
+    _eventCnt  = 0;
+    _recordCnt = 0;
+  }
+  void put(const void* p, size_t size)
+  {
+    if (_ok && size > 0 && fwrite(p, size, 1, _fp) != 1)
+      _ok = false;
+  }
+
+  std::string                   _file;
+  FILE*                         _fp;
+  extMeasure*                   _measure;
+  extMeasureLogHeader           _hdr;
+  std::vector<extMeasureLogRec> _pieces;  // of the current event
+  bool                          _ok;
+  uint64_t                      _eventCnt;
+  uint64_t                      _recordCnt;
+};
+
+void extMeasure::logCoverage(uint kind, uint len)
+{
+  extMeasureLogRec r;
+  memset(&r, 0, sizeof(r));
+  r._kind = kind;
+  r._met  = _overMet;
+  r._met2 = _underMet;
+  r._len  = len;
+  _measureLog->_pieces.push_back(r);
+}
+
+void extMeasure::logDiag(uint kind,
+                         int  rsegId1,
+                         uint rsegId2,
+                         uint len,
+                         uint diagWidth,
+                         uint diagDist,
+                         uint tgtMet)
+{
+  extMeasureLogRec r;
+  memset(&r, 0, sizeof(r));
+  r._kind  = kind;
+  r._met2  = tgtMet;
+  r._len   = len;
+  r._rseg1 = rsegId1;
+  r._rseg2 = rsegId2;
+  r._width = diagWidth;
+  r._dist  = diagDist;
+  _measureLog->_pieces.push_back(r);
+}
+
+void extMeasure::logEvent(int totLenCovered)
+{
+  extMeasureLog* ml = _measureLog;
+
+  extMeasureLogRec r;
+  memset(&r, 0, sizeof(r));
+  r._kind    = MLG_EVENT;
+  r._met     = _met;
+  r._flags   = _sameNetFlag ? MLG_SAME_NET : 0;
+  r._len     = _len;
+  r._rseg1   = _rsegSrcId;
+  r._rseg2   = _rsegTgtId;
+  r._width   = _width;
+  r._dist    = _dist;
+  r._covered = totLenCovered;
+  r._cnt     = ml->_pieces.size();
+  ml->put(&r, sizeof(r));
+  if (r._cnt)
+    ml->put(&ml->_pieces[0], r._cnt * sizeof(extMeasureLogRec));
+
+  ml->_eventCnt++;
+  ml->_recordCnt += r._cnt + 1;
+  ml->_pieces.clear();
+}
+
+static bool isSignalNet(dbNet* net)
+{
+  dbSigType type = net->getSigType();
+  return (type != dbSigType::POWER) && (type != dbSigType::GROUND);
+}
+
+static uint blockRSegCnt(odb::dbBlock* block)
+{
+  int netCnt, rsegCnt, capCnt, ccCnt;
+  block->getExtCount(netCnt, rsegCnt, capCnt, ccCnt);
+  return rsegCnt;
+}
+
+void extMain::setMeasureLogFile(const char* file)
+{
+  _measureLogFile = file;
+}
+
+// Starts the log of the sweep m is about to run with the rseg values rcgen
+// left. Only a full extraction that keeps its parasitics in the db is logged.
+bool extMain::openMeasureLog(extMeasure* m)
+{
+  if (_measureLog != NULL) {  // left by an early return
+    fclose(_measureLog->_fp);
+    delete _measureLog;
+    _measureLog = NULL;
+  }
+  m->_measureLog = NULL;
+  if (_measureLogFile == NULL || _measureLogFile[0] == '\0')
+    return false;
+  if (!_allNet || _lefRC || _power_extract_only
+      || (_retireSpefFile != NULL && _retireSpefFile[0] != '\0')) {
+    warning(0,
+            "-measure_log needs a full extraction that keeps the parasitics "
+            "in the db, no log is written\n");
+    return false;
+  }
+  FILE* fp = fopen(_measureLogFile, "wb");
+  if (fp == NULL) {
+    warning(0, "Can not open measure log %s\n", _measureLogFile);
+    return false;
+  }
+  uint cornerCnt = _block->getCornerCount();
+
+  std::vector<dbRSeg*>   rsegs;
+  dbSet<dbNet>           nets = _block->getNets();
+  dbSet<dbNet>::iterator nitr;
+  for (nitr = nets.begin(); nitr != nets.end(); ++nitr) {
+    dbNet* net = *nitr;
+    if (!isSignalNet(net))
+      continue;
+    dbSet<dbRSeg>           rSet = net->getRSegs();
+    dbSet<dbRSeg>::iterator rc_itr;
+    for (rc_itr = rSet.begin(); rc_itr != rSet.end(); ++rc_itr)
+      rsegs.push_back(*rc_itr);
+  }
+
+  extMeasureLog* ml = new extMeasureLog();
+  ml->_file         = _measureLogFile;
+  ml->_fp           = fp;
+  ml->_measure      = m;
+
+  extMeasureLogHeader& hdr = ml->_hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr._magic, MLG_MAGIC, 8);
+  hdr._version         = MLG_VERSION;
+  hdr._cornerCnt       = cornerCnt;
+  hdr._extDbCnt        = _extDbCnt;
+  hdr._ccFlag          = _couplingFlag;
+  hdr._wireSum         = wireChecksum();
+  hdr._blockRSegCnt    = blockRSegCnt(_block);
+  hdr._rsegCnt         = rsegs.size();
+  hdr._coupleThreshold = _coupleThreshold;
+  if (m->_btermThreshold)
+    hdr._flags |= MLG_BTERM_THRESHOLD;
+  if (_lef_res)
+    hdr._flags |= MLG_LEF_RES;
+  ml->put(&hdr, sizeof(hdr));
+
+  std::vector<double> vals(2 * cornerCnt);
+  for (uint ii = 0; ii < rsegs.size(); ii++) {
+    dbRSeg*           rc = rsegs[ii];
+    extMeasureLogRSeg r;
+    r._id    = rc->getId();
+    r._spare = 0;
+    for (uint jj = 0; jj < cornerCnt; jj++) {
+      vals[jj]             = rc->getResistance(jj);
+      vals[cornerCnt + jj] = rc->getCapacitance(jj);
+    }
+    ml->put(&r, sizeof(r));
+    ml->put(&vals[0], vals.size() * sizeof(double));
+  }
+  _measureLog    = ml;
+  m->_measureLog = ml;
+  return true;
+}
+
+void extMain::closeMeasureLog()
+{
+  extMeasureLog* ml = _measureLog;
+  if (ml == NULL)
+    return;
+  _measureLog               = NULL;
+  ml->_measure->_measureLog = NULL;
+
+  ml->_hdr._eventCnt  = ml->_eventCnt;
+  ml->_hdr._recordCnt = ml->_recordCnt;
+  if (ml->_ok && fseeko(ml->_fp, 0, SEEK_SET) != 0)
+    ml->_ok = false;
+  ml->put(&ml->_hdr, sizeof(ml->_hdr));
+  if (fclose(ml->_fp) != 0)
+    ml->_ok = false;
+
+  if (!ml->_ok) {
+    warning(0, "Can not write measure log %s\n", ml->_file.c_str());
+    remove(ml->_file.c_str());
+  } else {
+    _measureLogPath = ml->_file;
+    notice(0,
+           "Wrote %lld measurements, %lld records to measure log %s\n",
+           (long long) ml->_eventCnt,
+           (long long) ml->_recordCnt,
+           ml->_file.c_str());
+  }
+  delete ml;
+}
+
+// Replays a measure log against rulesFile for the current process corners;
+// logFile NULL or empty takes the last log written in the session.
+uint extMain::reevaluateParasitics(const char* logFile, const char* rulesFile)
+{
+  if (logFile == NULL || logFile[0] == '\0')
+    logFile = _measureLogPath.c_str();
+  if (logFile[0] == '\0') {
+    warning(0, "No measure log, run extract_parasitics -measure_log first\n");
+    return 0;
+  }
+  if (rulesFile == NULL || rulesFile[0] == '\0') {
+    warning(0, "reevaluate_parasitics needs a rules file\n");
+    return 0;
+  }
+
+  std::vector<char> buf;
+  FILE*             fp = fopen(logFile, "rb");
+  if (fp == NULL) {
+    warning(0, "Can not open measure log %s\n", logFile);
+    return 0;
+  }
+  fseeko(fp, 0, SEEK_END);
+  buf.resize(ftello(fp) + 1);
+  fseeko(fp, 0, SEEK_SET);
+  buf.resize(fread(&buf[0], 1, buf.size(), fp));
+  fclose(fp);
+
+  if (buf.size() < sizeof(extMeasureLogHeader)) {
+    warning(0, "%s is not a measure log\n", logFile);
+    return 0;
+  }
+  const extMeasureLogHeader* hdr = (const extMeasureLogHeader*) &buf[0];
+  uint                       cornerCnt = _block->getCornerCount();
+  if (memcmp(hdr->_magic, MLG_MAGIC, 8) != 0 || hdr->_version != MLG_VERSION) {
+    warning(0, "%s is not a measure log\n", logFile);
+    return 0;
+  }
+  size_t rsegSize = sizeof(extMeasureLogRSeg) + 2 * cornerCnt * sizeof(double);
+  if (buf.size() != sizeof(extMeasureLogHeader) + hdr->_rsegCnt * rsegSize
+                        + hdr->_recordCnt * sizeof(extMeasureLogRec)) {
+    warning(0, "Measure log %s is incomplete\n", logFile);
+    return 0;
+  }
+  if (hdr->_cornerCnt != cornerCnt
+      || hdr->_blockRSegCnt != blockRSegCnt(_block)
+      || hdr->_wireSum != wireChecksum()) {
+    warning(0,
+            "Measure log %s was made on other wires or parasitics of block "
+            "%s\n",
+            logFile,
+            _block->getConstName());
+    return 0;
+  }
+
+  // the process corners pick the models of the new rules
+  if (_processCornerTable == NULL)
+    getExtractedCorners();
+  if (_processCornerTable == NULL
+      || _processCornerTable->getCnt() != hdr->_extDbCnt) {
+    warning(0,
+            "The corner set has %d process corners, measure log %s has %d\n",
+            _processCornerTable ? _processCornerTable->getCnt() : 0,
+            logFile,
+            hdr->_extDbCnt);
+    return 0;
+  }
+  _lefRC           = false;
+  _couplingFlag    = hdr->_ccFlag;
+  _coupleThreshold = hdr->_coupleThreshold;
+  _lef_res         = (hdr->_flags & MLG_LEF_RES) != 0;
+  releaseRCmodels();
+  if (!setCorners(rulesFile, NULL)) {
+    warning(0, "Can not read extraction rules %s\n", rulesFile);
+    return 0;
+  }
+
+  // back to the values rcgen left and no ccsegs
+  const char* p = &buf[0] + sizeof(extMeasureLogHeader);
+  uint        ii;
+  for (ii = 0; ii < hdr->_rsegCnt; ii++, p += rsegSize) {
+    const extMeasureLogRSeg* r    = (const extMeasureLogRSeg*) p;
+    const double*            vals = (const double*) (r + 1);
+    dbRSeg*                  rc   = dbRSeg::getRSeg(_block, r->_id);
+    for (uint jj = 0; jj < cornerCnt; jj++) {
+      rc->setResistance(vals[jj], jj);
+      rc->setCapacitance(vals[cornerCnt + jj], jj);
+    }
+  }
+  dbSet<dbNet>           nets = _block->getNets();
+  dbSet<dbNet>::iterator nitr;
+  std::vector<dbCCSeg*>  ccs;
+  for (nitr = nets.begin(); nitr != nets.end(); ++nitr) {
+    dbNet* net = *nitr;
+    if (!isSignalNet(net))
+      continue;
+    ccs.clear();
+    net->getSrcCCSegs(ccs);
+    for (uint jj = 0; jj < ccs.size(); jj++)
+      dbCCSeg::destroy(ccs[jj]);
+  }
+
+  extMeasure m;
+  m._extMain       = this;
+  m._block         = _block;
+  m._diagFlow      = true;
+  m._resFactor     = _resFactor;
+  m._resModify     = _resModify;
+  m._ccFactor      = _ccFactor;
+  m._ccModify      = _ccModify;
+  m._gndcFactor    = _gndcFactor;
+  m._gndcModify    = _gndcModify;
+  m._minModelIndex = 0;
+  m._maxModelIndex = 0;
+  m._currentModel  = _currentModel;
+  m._diagModel     = _currentModel->getDiagModel();
+  for (ii = 0; ii < _modelMap.getCnt(); ii++)
+    m._metRCTable.add(_currentModel->getMetRCTable(_modelMap.get(ii)));
+  uint techLayerCnt  = getExtLayerCnt(_tech) + 1;
+  uint modelLayerCnt = _currentModel->getLayerCnt();
+  m._layerCnt = techLayerCnt < modelLayerCnt ? techLayerCnt : modelLayerCnt;
+  if (techLayerCnt == 5 && modelLayerCnt == 8)
+    m._layerCnt = modelLayerCnt;
+  m._btermThreshold = (hdr->_flags & MLG_BTERM_THRESHOLD) != 0;
+  m._netId          = 0;
+  m._debugFP        = NULL;
+
+  const extMeasureLogRec* rec     = (const extMeasureLogRec*) p;
+  const extMeasureLogRec* end     = rec + hdr->_recordCnt;
+  uint                    skipCnt = 0;
+  while (rec < end) {
+    const extMeasureLogRec* ev     = rec++;
+    const extMeasureLogRec* pieces = rec;
+    rec += ev->_cnt;
+    if (ev->_kind != extMeasure::MLG_EVENT || rec > end) {
+      warning(0, "Measure log %s is corrupt\n", logFile);
+      break;
+    }
+    if (ev->_met >= (int) m._layerCnt) {
+      skipCnt++;
+      continue;
+    }
+    m._met         = ev->_met;
+    m._len         = ev->_len;
+    m._width       = ev->_width;
+    m._dist        = ev->_dist;
+    m._sameNetFlag = (ev->_flags & MLG_SAME_NET) != 0;
+    m._rsegSrcId   = ev->_rseg1;
+    m._rsegTgtId   = ev->_rseg2;
+    m._diagLen     = 0;
+    for (uint jj = 0; jj < m._metRCTable.getCnt(); jj++) {
+      m._rc[jj]->_coupling = 0.0;
+      m._rc[jj]->_fringe   = 0.0;
+      m._rc[jj]->_diag     = 0.0;
+      m._rc[jj]->_res      = 0.0;
+      m._rc[jj]->_sep      = 0;
+    }
+    for (uint jj = 0; jj < ev->_cnt; jj++) {
+      const extMeasureLogRec* pc = pieces + jj;
+      switch (pc->_kind) {
+        case extMeasure::MLG_OVER:
+        case extMeasure::MLG_UNDER:
+        case extMeasure::MLG_OVER_UNDER:
+          m._overMet  = pc->_met;
+          m._underMet = pc->_met2;
+          if (pc->_kind == extMeasure::MLG_OVER)
+            m.computeOverRC(pc->_len);
+          else if (pc->_kind == extMeasure::MLG_UNDER)
+            m.computeUnderRC(pc->_len);
+          else
+            m.computeOverUnderRC(pc->_len);
+          break;
+        case extMeasure::MLG_DIAG:
+          m.calcDiagRC(
+              pc->_rseg1, pc->_rseg2, pc->_len, pc->_dist, pc->_met2);
+          break;
+        case extMeasure::MLG_DIAG_WIDTH:
+          m.calcDiagRC(pc->_rseg1,
+                       pc->_rseg2,
+                       pc->_len,
+                       pc->_width,
+                       pc->_dist,
+                       pc->_met2);
+          break;
+      }
+    }
+    dbRSeg* rseg1 = NULL;
+    dbRSeg* rseg2 = NULL;
+    if (ev->_rseg1 > 0)
+      rseg1 = dbRSeg::getRSeg(_block, ev->_rseg1);
+    if (ev->_rseg2 > 0)
+      rseg2 = dbRSeg::getRSeg(_block, ev->_rseg2);
+    if (rseg1 != NULL || rseg2 != NULL)
+      m.storeRC(rseg1, rseg2, ev->_covered);
+  }
+  if (skipCnt)
+    warning(0,
+            "%d measurements are on layers the rules %s do not have\n",
+            skipCnt,
+            rulesFile);
+
+  updatePrevControl();
+  releaseRCmodels();
+  if (_batchScaleExt)
+    genScaledExt();
+
+  int numOfNet, numOfRSeg, numOfCapNode, numOfCCSeg;
+  _block->getExtCount(numOfNet, numOfRSeg, numOfCapNode, numOfCCSeg);
+  notice(0,
+         "Reevaluated %lld measurements of %s with rules %s, %d ccs\n",
+         (long long) hdr->_eventCnt,
+         logFile,
+         rulesFile,
+         numOfCCSeg);
+  return 1;
+}
+
+}  // namespace OpenRCX
@@ -0,0 +1,205 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Rules generation by metal
+//
+// rules_gen walks the patterns of all metals through one extRCModel, with
+// one process, one log and one caps.log per pattern. With
+// define_rules_solver -metal_jobs count, every metal gets a model of its
+// own instead: a copy of the process read again from the process file, its
+// own rulesGen.log and caps.log files under <topDir>/M<met>, and its own
+// tables. The metals are generated on count threads, each running the
+// patterns with the metal level set as metal_rules_gen does, with the
+// solver jobs of define_rules_solver -jobs of its own. The tables of every
+// metal are then moved into the tables of the rules_gen model, which writes
+// the rules file as before. The metal models keep the pools the moved
+// tables were allocated from, so the rules_gen model owns them until it is
+// deleted.
+//
+// The pattern directories already carry the metal in their names, so the
+// decks of different metals never share a directory.
+
+#include <dbLogger.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <vector>
+
+#include "extRCap.h"
+#include "extUtil.h"
+
+namespace OpenRCX {
+
+using odb::notice;
+using odb::warning;
+
+void extRCModel::setMetalOptions(extRCModel* m, const char* topDir, uint met)
+{
+  char dir[1024];
+  sprintf(dir, "%s/M%d", topDir, met);
+  _parser->mkDirTree(dir, "/");
+
+  _logFP = openFile(dir, "rulesGen", ".log", "w");
+  strcpy(_topDir, dir);
+  strcpy(_patternName, m->_patternName);
+
+  _writeFiles      = m->_writeFiles;
+  _readSolver      = m->_readSolver;
+  _runSolver       = m->_runSolver;
+  _keepFile        = m->_keepFile;
+  _metLevel        = met;
+  _queueSolverJobs = false;
+  _readAfterJobs   = false;
+
+  // the jobs wait for their own solver processes only, so the metals can
+  // run them side by side
+  setSolverJobs(m->_solverJobCnt,
+                m->_solverCmd.c_str(),
+                m->_solverRetryCnt,
+                m->_solverCacheDir.c_str());
+  setSolverMaxError(m->_solverMaxError);
+}
+
+void extRCModel::mergeMetalTables(extRCModel* w, uint met)
+{
+  for (uint ii = 0; ii < _modelCnt && ii < w->_modelCnt; ii++) {
+    extMetRCTable* to   = _modelTable[ii];
+    extMetRCTable* from = w->_modelTable[ii];
+
+    if (from->_capOver[met] != NULL) {
+      delete to->_capOver[met];
+      to->_capOver[met]   = from->_capOver[met];
+      from->_capOver[met] = NULL;
+    }
+    if (from->_capUnder[met] != NULL) {
+      delete to->_capUnder[met];
+      to->_capUnder[met]   = from->_capUnder[met];
+      from->_capUnder[met] = NULL;
+    }
+    if (from->_capOverUnder[met] != NULL) {
+      delete to->_capOverUnder[met];
+      to->_capOverUnder[met]   = from->_capOverUnder[met];
+      from->_capOverUnder[met] = NULL;
+    }
+    if (from->_capDiagUnder[met] != NULL) {
+      delete to->_capDiagUnder[met];
+      to->_capDiagUnder[met]   = from->_capDiagUnder[met];
+      from->_capDiagUnder[met] = NULL;
+    }
+  }
+  if (w->_diag)
+    _diag = true;
+  if (w->_diagModel > 0)
+    _diagModel = w->_diagModel;
+
+  _solverCacheHitCnt += w->_solverCacheHitCnt;
+  _solverCacheMissCnt += w->_solverCacheMissCnt;
+  _adaptiveSolveCnt += w->_adaptiveSolveCnt;
+  _adaptiveSkipCnt += w->_adaptiveSkipCnt;
+
+  _metalWorkerTable.push_back(w);
+}
+
+struct extMetalRulesJobs
+{
+  extMain*                  _ext;
+  std::vector<extRCModel*>* _models;
+  std::vector<uint>*        _mets;
+  int                       _pattern;
+  std::atomic<uint>         _next;
+};
+
+static void genMetalRulesThread(void* arg)
+{
+  extMetalRulesJobs* jobs = (extMetalRulesJobs*) arg;
+  uint ii;
+  while ((ii = jobs->_next++) < jobs->_models->size()) {
+    extRCModel* w   = (*jobs->_models)[ii];
+    uint        met = (*jobs->_mets)[ii];
+    if (w->queueSolverJobs()) {
+      jobs->_ext->genRulePatterns(w, jobs->_pattern, met);
+      if (w->runSolverJobs())
+        jobs->_ext->genRulePatterns(w, jobs->_pattern, met);
+    } else {
+      jobs->_ext->genRulePatterns(w, jobs->_pattern, met);
+    }
+    w->closeFiles();
+  }
+}
+
+void extMain::genMetalRulePatterns(extRCModel* m,
+                                   const char* topDir,
+                                   int         pattern)
+{
+  if (_processFile.empty()) {
+    warning(0, "No process file to copy for the metal jobs, run serially\n");
+    genRulePatterns(m, pattern, 0);
+    return;
+  }
+
+  // the models are set up here, so no two threads read the process file
+  std::vector<extRCModel*> models;
+  std::vector<uint>        mets;
+  for (int met = 1; met < m->getLayerCnt(); met++) {
+    extProcess* p = new extProcess(32, 32);
+    p->readProcess(_processName.c_str(), (char*) _processFile.c_str());
+
+    extRCModel* w = new extRCModel(m->getLayerCnt(), _processName.c_str());
+    w->setProcess(p);
+    w->setDataRateTable(1);
+    w->setMetalOptions(m, topDir, met);
+
+    models.push_back(w);
+    mets.push_back(met);
+  }
+
+  uint threadCnt = MIN(_solverMetalJobCnt, (uint) models.size());
+  notice(0,
+         "Generating the patterns of %d metals, %d at a time ...\n",
+         (uint) models.size(),
+         threadCnt);
+
+  extMetalRulesJobs jobs;
+  jobs._ext     = this;
+  jobs._models  = &models;
+  jobs._mets    = &mets;
+  jobs._pattern = pattern;
+  jobs._next    = 0;
+
+  extRunWorkers(threadCnt, genMetalRulesThread, &jobs);
+
+  for (uint ii = 0; ii < models.size(); ii++)
+    m->mergeMetalTables(models[ii], mets[ii]);
+}
+
+}  // namespace OpenRCX
@@ -0,0 +1,858 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Cross-session per-net parasitics cache
+//
+// extract_parasitics -net_cache file keeps the parasitics of every signal net
+// from one full extraction to the next, for the common case of a block where
+// only a few nets moved since the last run, e.g. a reroute in a new session.
+// Each net gets a signature that covers what its parasitics depend on:
+//
+//   - its own raw wire data, terminals and calibration factors,
+//   - the same for every net whose bbox comes within the coupling halo of
+//     its bbox, (cc_model + 1) pitches on all layers, so the context_depth
+//     layers above and below are in it too,
+//   - the power wires, the cell placement with -over_cell, the extraction
+//     options, and the rules file and corner set.
+//
+// A net whose signature is in the file is restored as extraction made it:
+// capnodes, rsegs, ccsegs to other restored nets, and the links of its wire
+// shapes to rsegs. The other nets are extracted the way -nets extracts a
+// subset, coupling to restored neighbours through those links. A moved net
+// changes the signature of every net within its halo, so a restored net
+// never has a stale neighbour. The file is rewritten with all nets after
+// extraction.
+//
+// file: header, then per net a record header, the name, the capnodes with
+// their caps, the rsegs with coordinates, res and caps, the ccsegs it is the
+// source of, and its shape links; values are per corner.
+
+#include <dbLogger.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "extRCap.h"
+#include "extUtil.h"
+
+namespace OpenRCX {
+
+using odb::dbBTerm;
+using odb::dbCapNode;
+using odb::dbCCSeg;
+using odb::dbInst;
+using odb::dbITerm;
+using odb::dbNet;
+using odb::dbRSeg;
+using odb::dbSet;
+using odb::dbShape;
+using odb::dbSigType;
+using odb::dbWire;
+using odb::dbWireShapeItr;
+using odb::notice;
+using odb::Rect;
+using odb::warning;
+
+static const char     NCC_MAGIC[8] = {'R', 'C', 'X', 'N', 'C', 'C', '0', '1'};
+static const uint32_t NCC_VERSION  = 1;
+
+// capnode flags
+static const uint32_t NCC_ITERM    = 1;
+static const uint32_t NCC_BTERM    = 2;
+static const uint32_t NCC_INTERNAL = 4;
+static const uint32_t NCC_BRANCH   = 8;
+
+struct extNetCacheHeader
+{
+  char     _magic[8];
+  uint32_t _version;
+  uint32_t _cornerCnt;
+  uint64_t _optionKey;
+  uint32_t _netCnt;
+  uint32_t _spare;
+};
+
+struct extNetCacheNet
+{
+  uint64_t _sig;
+  uint32_t _nameLen;
+  uint32_t _capCnt;
+  uint32_t _rsegCnt;
+  uint32_t _ccCnt;
+  uint32_t _linkCnt;
+  uint32_t _spare;
+};
+
+struct extNetCacheCap  // + cornerCnt caps
+{
+  uint32_t _flags;
+  uint32_t _node;
+};
+
+struct extNetCacheRSeg  // + cornerCnt res, cornerCnt caps
+{
+  uint32_t _src;  // capnode index + 1, 0 for none
+  uint32_t _tgt;
+  int32_t  _x;
+  int32_t  _y;
+  uint32_t _pathDir;
+  uint32_t _spare;
+};
+
+struct extNetCacheCC  // + cornerCnt caps
+{
+  uint32_t _src;     // capnode index
+  uint32_t _tgtNet;  // record index
+  uint32_t _tgt;     // capnode index in the target record
+  uint32_t _spare;
+};
+
+struct extNetCacheLink
+{
+  uint32_t _shapeId;
+  uint32_t _rseg;  // rseg index
+  uint32_t _via;   // 1: via shape, linked by property
+  uint32_t _spare;
+};
+
+class extNetCache
+{
+ public:
+  extNetCache()
+  {
+    _ext        = NULL;
+    _halo       = 0;
+    _binSize    = 1;
+    _binCntX    = 0;
+    _binCntY    = 0;
+    _hitCnt     = 0;
+    _changedCnt = 0;
+    _newCnt     = 0;
+    _failedCnt  = 0;
+    _optionKey  = 0;
+    _cornerCnt  = 0;
+  }
+
+  void        binNets();
+  void        neighbors(uint ii, std::vector<uint>& nbs);
+  static void ownSignatures(void* arg, uint first, uint last);
+  static void haloSignatures(void* arg, uint first, uint last);
+
+  std::string                     _file;
+  uint64_t                        _optionKey;
+  uint                            _cornerCnt;
+  std::vector<dbNet*>             _nets;  // signal nets with wires
+  std::vector<uint64_t>           _own;   // by _nets index
+  std::vector<uint64_t>           _sig;
+  std::vector<Rect>               _box;
+  std::vector<char>               _boxed;
+  Rect                            _area;
+  int                             _halo;
+  int                             _binSize;
+  uint                            _binCntX;
+  uint                            _binCntY;
+  std::vector<std::vector<uint> > _bins;
+  extMain*                        _ext;
+  uint                            _hitCnt;
+  uint                            _changedCnt;
+  uint                            _newCnt;
+  uint                            _failedCnt;
+};
+
+// names are padded to keep the records 8 byte aligned
+static uint namePad(uint len)
+{
+  return (len + 7) & ~7;
+}
+
+static bool isSignalNet(dbNet* net)
+{
+  dbSigType type = net->getSigType();
+  return (type != dbSigType::POWER) && (type != dbSigType::GROUND);
+}
+
+void extNetCache::ownSignatures(void* arg, uint first, uint last)
+{
+  extNetCache*               nc = (extNetCache*) arg;
+  std::vector<int>           data;
+  std::vector<unsigned char> opcodes;
+  for (uint ii = first; ii < last; ii++) {
+    dbNet*  net = nc->_nets[ii];
+    extHash h;
+
+    // the raw data fixes the shapes and their ids, which the links use
+    net->getWire()->getRawWireData(data, opcodes);
+    if (data.size())
+      h.add(&data[0], data.size() * sizeof(int));
+    if (opcodes.size())
+      h.add(&opcodes[0], opcodes.size());
+
+    // capnodes keep iterm and bterm ids
+    dbSet<dbITerm>           iterms = net->getITerms();
+    dbSet<dbITerm>::iterator iitr;
+    for (iitr = iterms.begin(); iitr != iterms.end(); ++iitr) {
+      uint id = (*iitr)->getId();
+      h.add(&id, sizeof(id));
+    }
+    dbSet<dbBTerm>           bterms = net->getBTerms();
+    dbSet<dbBTerm>::iterator bitr;
+    for (bitr = bterms.begin(); bitr != bterms.end(); ++bitr) {
+      uint id = (*bitr)->getId() | 0x80000000;
+      h.add(&id, sizeof(id));
+    }
+    double calib[2] = {net->getGndcCalibFactor(), net->getCcCalibFactor()};
+    h.add(calib, sizeof(calib));
+    nc->_own[ii] = h._h;
+
+    nc->_boxed[ii] = nc->_ext->getNetBbox(net, nc->_box[ii]) > 0;
+  }
+}
+
+void extNetCache::binNets()
+{
+  _area.reset(MAX_INT, MAX_INT, MIN_INT, MIN_INT);
+  uint ii;
+  for (ii = 0; ii < _nets.size(); ii++) {
+    if (_boxed[ii])
+      _area.merge(_box[ii]);
+  }
+  if (_area.xMin() > _area.xMax())
+    return;
+
+  // about 64 nets per bin, never narrower than the halo
+  uint64_t dx     = (uint64_t) _area.dx() + 1;
+  uint64_t dy     = (uint64_t) _area.dy() + 1;
+  uint     binCnt = _nets.size() / 64 + 1;
+  double   side   = sqrt((double) dx * dy / binCnt);
+  _binSize        = side > _halo ? (int) side + 1 : _halo + 1;
+  _binCntX        = dx / _binSize + 1;
+  _binCntY        = dy / _binSize + 1;
+  _bins.resize(_binCntX * _binCntY);
+
+  for (ii = 0; ii < _nets.size(); ii++) {
+    if (!_boxed[ii])
+      continue;
+    Rect& r  = _box[ii];
+    uint  x1 = (r.xMin() - _area.xMin()) / _binSize;
+    uint  x2 = (r.xMax() - _area.xMin()) / _binSize;
+    uint  y1 = (r.yMin() - _area.yMin()) / _binSize;
+    uint  y2 = (r.yMax() - _area.yMin()) / _binSize;
+    for (uint yy = y1; yy <= y2; yy++)
+      for (uint xx = x1; xx <= x2; xx++)
+        _bins[yy * _binCntX + xx].push_back(ii);
+  }
+}
+
+// nets whose bbox comes within the halo of the bbox of net ii
+void extNetCache::neighbors(uint ii, std::vector<uint>& nbs)
+{
+  nbs.clear();
+  if (!_boxed[ii] || _bins.empty())
+    return;
+  Rect r = _box[ii];
+  r.reset(r.xMin() - _halo,
+          r.yMin() - _halo,
+          r.xMax() + _halo,
+          r.yMax() + _halo);
+  int x1 = (r.xMin() - _area.xMin()) / _binSize;
+  int x2 = (r.xMax() - _area.xMin()) / _binSize;
+  int y1 = (r.yMin() - _area.yMin()) / _binSize;
+  int y2 = (r.yMax() - _area.yMin()) / _binSize;
+  x1     = std::max(x1, 0);
+  y1     = std::max(y1, 0);
+  x2     = std::min(x2, (int) _binCntX - 1);
+  y2     = std::min(y2, (int) _binCntY - 1);
+  for (int yy = y1; yy <= y2; yy++) {
+    for (int xx = x1; xx <= x2; xx++) {
+      std::vector<uint>& bin = _bins[yy * _binCntX + xx];
+      for (uint jj = 0; jj < bin.size(); jj++) {
+        uint nb = bin[jj];
+        if (nb != ii && _box[nb].intersects(r))
+          nbs.push_back(nb);
+      }
+    }
+  }
+  std::sort(nbs.begin(), nbs.end());
+  nbs.erase(std::unique(nbs.begin(), nbs.end()), nbs.end());
+}
+
+void extNetCache::haloSignatures(void* arg, uint first, uint last)
+{
+  extNetCache*      nc = (extNetCache*) arg;
+  std::vector<uint> nbs;
+  for (uint ii = first; ii < last; ii++) {
+    extHash h(nc->_optionKey);
+    h.add(&nc->_own[ii], sizeof(uint64_t));
+    nc->neighbors(ii, nbs);
+    for (uint jj = 0; jj < nbs.size(); jj++)
+      h.add(&nc->_own[nbs[jj]], sizeof(uint64_t));
+    nc->_sig[ii] = h._h;
+  }
+}
+
+// rules, corners, options, power wires and, with over_cell, cell placement
+uint64_t extMain::netCacheOptionKey(const char* rulesFile)
+{
+  extHash h;
+  if (rulesFile) {
+    h.add(rulesFile, strlen(rulesFile));
+    struct stat st;
+    if (stat(rulesFile, &st) == 0) {
+      int64_t fst[2] = {(int64_t) st.st_size, (int64_t) st.st_mtime};
+      h.add(fst, sizeof(fst));
+    }
+  }
+  int iopts[10] = {(int) _block->getCornerCount(),
+                   (int) _couplingFlag,
+                   (int) _ccUp,
+                   (int) _ccContextDepth,
+                   (int) _mergeViaRes,
+                   (int) _usingMetalPlanes,
+                   (int) _lefRC,
+                   (int) _overCell,
+                   (int) _cc_band_tracks,
+                   (int) _use_signal_tables};
+  double dopts[2] = {_coupleThreshold, _mergeResBound};
+  h.add(iopts, sizeof(iopts));
+  h.add(dopts, sizeof(dopts));
+
+  uint ii;
+  for (ii = 0; _processCornerTable && ii < _processCornerTable->getCnt();
+       ii++) {
+    extCorner* c = _processCornerTable->get(ii);
+    if (c->_name)
+      h.add(c->_name, strlen(c->_name));
+    h.add(&c->_model, sizeof(c->_model));
+  }
+  for (ii = 0; _scaledCornerTable && ii < _scaledCornerTable->getCnt(); ii++) {
+    extCorner* c = _scaledCornerTable->get(ii);
+    if (c->_name)
+      h.add(c->_name, strlen(c->_name));
+    float f[3] = {c->_resFactor, c->_ccFactor, c->_gndFactor};
+    h.add(&c->_model, sizeof(c->_model));
+    h.add(f, sizeof(f));
+  }
+
+  dbSet<dbNet>           nets = _block->getNets();
+  dbSet<dbNet>::iterator nitr;
+  for (nitr = nets.begin(); nitr != nets.end(); ++nitr) {
+    if (!isSignalNet(*nitr))
+      hashSWires(h, *nitr);
+  }
+  if (_overCell) {
+    dbSet<dbInst>           insts = _block->getInsts();
+    dbSet<dbInst>::iterator iitr;
+    for (iitr = insts.begin(); iitr != insts.end(); ++iitr) {
+      dbInst*     inst   = *iitr;
+      const char* master = inst->getMaster()->getConstName();
+      int         loc[3];
+      inst->getLocation(loc[0], loc[1]);
+      loc[2] = (int) inst->getOrient();
+      h.add(master, strlen(master));
+      h.add(loc, sizeof(loc));
+    }
+  }
+  return h._h;
+}
+
+void extMain::setNetCacheFile(const char* file)
+{
+  _netCacheFile = file;
+}
+
+class extNetCacheReader
+{
+ public:
+  extNetCacheReader(const char* p, const char* end)
+  {
+    _p   = p;
+    _end = end;
+    _bad = false;
+  }
+  const void* get(size_t size)
+  {
+    if (_bad || _p + size > _end) {
+      _bad = true;
+      return NULL;
+    }
+    const char* p = _p;
+    _p += size;
+    return p;
+  }
+  const char* _p;
+  const char* _end;
+  bool        _bad;
+};
+
+// Restores the nets whose signature is in the cache file. Returns false
+// when nothing was restored; otherwise inets gets the nets to extract.
+bool extMain::openNetCache(const char* rulesFile, std::vector<dbNet*>& inets)
+{
+  delete _netCache;  // left by a failed run
+  _netCache = NULL;
+  if (_netCacheFile == NULL || _netCacheFile[0] == '\0' || _power_extract_only)
+    return false;
+  if (_retireSpefFile != NULL && _retireSpefFile[0] != '\0') {
+    warning(0, "-net_cache is ignored when writing spef during extraction\n");
+    return false;
+  }
+  if (_measureLogFile != NULL && _measureLogFile[0] != '\0') {
+    warning(0, "-net_cache is ignored when writing a measure log\n");
+    return false;
+  }
+
+  extNetCache* nc = new extNetCache();
+  _netCache       = nc;
+  nc->_file       = _netCacheFile;
+  nc->_ext        = this;
+  nc->_cornerCnt  = _block->getCornerCount();
+  nc->_optionKey  = netCacheOptionKey(rulesFile);
+  nc->_halo       = couplingHalo(_couplingFlag);
+
+  dbSet<dbNet>           nets = _block->getNets();
+  dbSet<dbNet>::iterator nitr;
+  for (nitr = nets.begin(); nitr != nets.end(); ++nitr) {
+    dbNet* net = *nitr;
+    if (isSignalNet(net) && net->getWire() != NULL)
+      nc->_nets.push_back(net);
+  }
+  uint netCnt = nc->_nets.size();
+  nc->_own.resize(netCnt);
+  nc->_sig.resize(netCnt);
+  nc->_box.resize(netCnt);
+  nc->_boxed.resize(netCnt);
+  uint threadCnt = extThreadCnt();
+  extRunRanges(
+      netCnt, threadCnt, EXT_PARALLEL_MIN, extNetCache::ownSignatures, nc);
+  nc->binNets();
+  extRunRanges(
+      netCnt, threadCnt, EXT_PARALLEL_MIN, extNetCache::haloSignatures, nc);
+
+  std::vector<char> buf;
+  FILE*             fp = fopen(_netCacheFile, "rb");
+  if (fp != NULL) {
+    fseeko(fp, 0, SEEK_END);
+    buf.resize(ftello(fp) + 1);
+    fseeko(fp, 0, SEEK_SET);
+    buf.resize(fread(&buf[0], 1, buf.size(), fp));
+    fclose(fp);
+  }
+  if (buf.size() < sizeof(extNetCacheHeader)) {
+    nc->_newCnt = netCnt;
+    return false;
+  }
+  extNetCacheReader        rd(&buf[0], &buf[0] + buf.size());
+  const extNetCacheHeader* hdr
+      = (const extNetCacheHeader*) rd.get(sizeof(extNetCacheHeader));
+  if (memcmp(hdr->_magic, NCC_MAGIC, 8) != 0
+      || hdr->_version != NCC_VERSION || hdr->_cornerCnt != nc->_cornerCnt
+      || hdr->_optionKey != nc->_optionKey) {
+    notice(0, "Net cache %s is out of date\n", _netCacheFile);
+    nc->_newCnt = netCnt;
+    return false;
+  }
+
+  // record offsets by net name
+  uint                        cornerCnt = nc->_cornerCnt;
+  std::map<std::string, uint> recordOf;
+  std::vector<const char*>    records;
+  std::vector<uint64_t>       recordSig;
+  uint                        ii;
+  for (ii = 0; ii < hdr->_netCnt && !rd._bad; ii++) {
+    const char*           start = rd._p;
+    const extNetCacheNet* rec
+        = (const extNetCacheNet*) rd.get(sizeof(extNetCacheNet));
+    if (rec == NULL)
+      break;
+    const char* name = (const char*) rd.get(namePad(rec->_nameLen));
+    rd.get(rec->_capCnt * (sizeof(extNetCacheCap) + cornerCnt * sizeof(double))
+           + rec->_rsegCnt
+                 * (sizeof(extNetCacheRSeg) + 2 * cornerCnt * sizeof(double))
+           + rec->_ccCnt
+                 * (sizeof(extNetCacheCC) + cornerCnt * sizeof(double))
+           + rec->_linkCnt * sizeof(extNetCacheLink));
+    if (rd._bad)
+      break;
+    recordOf[std::string(name, rec->_nameLen)] = records.size();
+    records.push_back(start);
+    recordSig.push_back(rec->_sig);
+  }
+  if (rd._bad) {
+    warning(0, "Corrupted net cache %s\n", _netCacheFile);
+    nc->_newCnt = netCnt;
+    return false;
+  }
+
+  // rsegs, capnodes and shape links of the unchanged nets
+  std::vector<std::vector<uint> > capIds(records.size());
+  std::vector<uint>               restored;
+  std::vector<double>             vals(2 * cornerCnt);
+  inets.clear();
+  for (ii = 0; ii < netCnt; ii++) {
+    dbNet* net = nc->_nets[ii];
+    std::map<std::string, uint>::iterator it
+        = recordOf.find(net->getConstName());
+    if (it == recordOf.end()) {
+      nc->_newCnt++;
+      inets.push_back(net);
+      continue;
+    }
+    uint r = it->second;
+    if (recordSig[r] != nc->_sig[ii]) {
+      nc->_changedCnt++;
+      inets.push_back(net);
+      continue;
+    }
+    if (net->getZeroRSeg() != NULL) {  // not extracted again
+      nc->_failedCnt++;
+      continue;
+    }
+    extNetCacheReader     nr(records[r], &buf[0] + buf.size());
+    const extNetCacheNet* rec
+        = (const extNetCacheNet*) nr.get(sizeof(extNetCacheNet));
+    nr.get(namePad(rec->_nameLen));
+
+    std::vector<uint>& caps = capIds[r];
+    caps.resize(rec->_capCnt);
+    uint jj, kk;
+    for (jj = 0; jj < rec->_capCnt; jj++) {
+      const extNetCacheCap* c
+          = (const extNetCacheCap*) nr.get(sizeof(extNetCacheCap));
+      memcpy(&vals[0],
+             nr.get(cornerCnt * sizeof(double)),
+             cornerCnt * sizeof(double));
+      dbCapNode* cap = dbCapNode::create(net, 0, false);
+      cap->setNode(c->_node);
+      if (c->_flags & NCC_ITERM)
+        cap->setITermFlag();
+      if (c->_flags & NCC_BTERM)
+        cap->setBTermFlag();
+      if (c->_flags & NCC_INTERNAL)
+        cap->setInternalFlag();
+      if (c->_flags & NCC_BRANCH)
+        cap->setBranchFlag();
+      for (kk = 0; kk < cornerCnt; kk++)
+        cap->setCapacitance(vals[kk], kk);
+      caps[jj] = cap->getId();
+    }
+    net->getCapNodes().reverse();
+
+    std::vector<uint> rsegIds(rec->_rsegCnt);
+    for (jj = 0; jj < rec->_rsegCnt; jj++) {
+      const extNetCacheRSeg* s
+          = (const extNetCacheRSeg*) nr.get(sizeof(extNetCacheRSeg));
+      memcpy(&vals[0],
+             nr.get(2 * cornerCnt * sizeof(double)),
+             2 * cornerCnt * sizeof(double));
+      dbRSeg* rc    = dbRSeg::create(net, s->_x, s->_y, s->_pathDir, true);
+      uint    srcId = s->_src ? caps[s->_src - 1] : 0;
+      uint    tgtId = s->_tgt ? caps[s->_tgt - 1] : 0;
+      rc->setSourceNode(srcId);
+      rc->setTargetNode(tgtId);
+      if (srcId > 0) {  // as addRSeg counts them; not the zero rseg
+        (dbCapNode::getCapNode(_block, srcId))->incrChildrenCnt();
+        if (tgtId > 0)
+          (dbCapNode::getCapNode(_block, tgtId))->incrChildrenCnt();
+      }
+      for (kk = 0; kk < cornerCnt; kk++) {
+        rc->setResistance(vals[kk], kk);
+        rc->setCapacitance(vals[cornerCnt + kk], kk);
+      }
+      rsegIds[jj] = rc->getId();
+    }
+    net->getRSegs().reverse();
+
+    nr.get(rec->_ccCnt * (sizeof(extNetCacheCC) + cornerCnt * sizeof(double)));
+    dbWire* wire = net->getWire();
+    for (jj = 0; jj < rec->_linkCnt; jj++) {
+      const extNetCacheLink* l
+          = (const extNetCacheLink*) nr.get(sizeof(extNetCacheLink));
+      if (l->_rseg >= rsegIds.size())
+        continue;
+      if (l->_via)
+        createShapeProperty(net, l->_shapeId, rsegIds[l->_rseg]);
+      else
+        wire->setProperty(l->_shapeId, rsegIds[l->_rseg]);
+    }
+    net->setRCgraph(true);
+    clearWireAltered(net);
+    restored.push_back(r);
+    nc->_hitCnt++;
+  }
+
+  // ccsegs between restored nets
+  uint ccCnt = 0;
+  for (ii = 0; ii < restored.size(); ii++) {
+    uint                  r = restored[ii];
+    extNetCacheReader     nr(records[r], &buf[0] + buf.size());
+    const extNetCacheNet* rec
+        = (const extNetCacheNet*) nr.get(sizeof(extNetCacheNet));
+    nr.get(namePad(rec->_nameLen));
+    nr.get(rec->_capCnt * (sizeof(extNetCacheCap) + cornerCnt * sizeof(double))
+           + rec->_rsegCnt
+                 * (sizeof(extNetCacheRSeg) + 2 * cornerCnt * sizeof(double)));
+    for (uint jj = 0; jj < rec->_ccCnt; jj++) {
+      const extNetCacheCC* c
+          = (const extNetCacheCC*) nr.get(sizeof(extNetCacheCC));
+      memcpy(&vals[0],
+             nr.get(cornerCnt * sizeof(double)),
+             cornerCnt * sizeof(double));
+      if (c->_tgtNet >= capIds.size() || c->_tgt >= capIds[c->_tgtNet].size()
+          || c->_src >= capIds[r].size())
+        continue;  // target net not restored
+      dbCCSeg* cc = dbCCSeg::create(
+          dbCapNode::getCapNode(_block, capIds[r][c->_src]),
+          dbCapNode::getCapNode(_block, capIds[c->_tgtNet][c->_tgt]),
+          true);
+      for (uint kk = 0; kk < cornerCnt; kk++)
+        cc->setCapacitance(vals[kk], kk);
+      ccCnt++;
+    }
+  }
+  notice(0,
+         "Restored %d nets, %d coupling caps from net cache %s\n",
+         nc->_hitCnt,
+         ccCnt,
+         _netCacheFile);
+  return nc->_hitCnt > 0;
+}
+
+static void putRecord(FILE* fp, const void* p, size_t size, bool& ok)
+{
+  if (ok && size > 0 && fwrite(p, size, 1, fp) != 1)
+    ok = false;
+}
+
+static void putValues(FILE* fp, double* vals, uint cnt, bool& ok)
+{
+  putRecord(fp, vals, cnt * sizeof(double), ok);
+}
+
+// Saves all nets with their signatures and reports the cache statistics.
+void extMain::closeNetCache()
+{
+  extNetCache* nc = _netCache;
+  if (nc == NULL)
+    return;
+  _netCache = NULL;
+
+  uint cornerCnt = nc->_cornerCnt;
+  uint netCnt    = nc->_nets.size();
+  uint ii;
+
+  // record index by net id, for the ccseg targets
+  std::vector<int>  recordOf(_block->getNets().size() + 1, -1);
+  std::vector<uint> saved;
+  for (ii = 0; ii < netCnt; ii++) {
+    dbNet* net = nc->_nets[ii];
+    if (net->getZeroRSeg() == NULL)
+      continue;
+    if (net->getId() >= recordOf.size())
+      recordOf.resize(net->getId() + 1, -1);
+    recordOf[net->getId()] = saved.size();
+    saved.push_back(ii);
+  }
+
+  std::string tmp = nc->_file;
+  char        pid[32];
+  sprintf(pid, ".%d", (int) getpid());
+  tmp += pid;
+  FILE* fp = fopen(tmp.c_str(), "wb");
+  bool  ok = fp != NULL;
+
+  extNetCacheHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr._magic, NCC_MAGIC, 8);
+  hdr._version   = NCC_VERSION;
+  hdr._cornerCnt = cornerCnt;
+  hdr._optionKey = nc->_optionKey;
+  hdr._netCnt    = saved.size();
+  putRecord(fp, &hdr, sizeof(hdr), ok);
+
+  // capnode index within its net by capnode id
+  std::vector<int> capIdx;
+  for (ii = 0; ii < saved.size(); ii++) {
+    dbSet<dbCapNode>           capSet = nc->_nets[saved[ii]]->getCapNodes();
+    dbSet<dbCapNode>::iterator cap_itr;
+    int                        capCnt = 0;
+    for (cap_itr = capSet.begin(); cap_itr != capSet.end(); ++cap_itr) {
+      uint id = (*cap_itr)->getId();
+      if (id >= capIdx.size())
+        capIdx.resize(id + 1, -1);
+      capIdx[id] = capCnt++;
+    }
+  }
+
+  std::vector<double>          vals(2 * cornerCnt);
+  std::map<uint, uint>         rsegIdx;
+  std::vector<extNetCacheLink> links;
+  for (ii = 0; ok && ii < saved.size(); ii++) {
+    dbNet* net = nc->_nets[saved[ii]];
+    uint   kk;
+
+    dbSet<dbCapNode>           capSet = net->getCapNodes();
+    dbSet<dbCapNode>::iterator cap_itr;
+    dbSet<dbRSeg>              rSet = net->getRSegs();
+    dbSet<dbRSeg>::iterator    rc_itr;
+    std::vector<dbCCSeg*>      ccs;
+    std::vector<dbCCSeg*>      srcCCs;
+    net->getSrcCCSegs(srcCCs);
+    for (kk = 0; kk < srcCCs.size(); kk++) {
+      dbNet* tgtNet = srcCCs[kk]->getTargetCapNode()->getNet();
+      if (tgtNet != net && tgtNet->getId() < recordOf.size()
+          && recordOf[tgtNet->getId()] >= 0)
+        ccs.push_back(srcCCs[kk]);
+    }
+
+    rsegIdx.clear();
+    uint rsegCnt = 0;
+    for (rc_itr = rSet.begin(); rc_itr != rSet.end(); ++rc_itr)
+      rsegIdx[(*rc_itr)->getId()] = rsegCnt++;
+
+    links.clear();
+    dbWire*        wire = net->getWire();
+    dbWireShapeItr shapes;
+    dbShape        s;
+    for (shapes.begin(wire); shapes.next(s);) {
+      int shapeId = shapes.getShapeId();
+      int rsegId  = 0;
+      if (s.isVia())
+        rsegId = getShapeProperty(net, shapeId);
+      else if (!wire->getProperty(shapeId, rsegId))
+        rsegId = 0;
+      std::map<uint, uint>::iterator it = rsegIdx.find(rsegId);
+      if (rsegId == 0 || it == rsegIdx.end())
+        continue;
+      extNetCacheLink l;
+      l._shapeId = shapeId;
+      l._rseg    = it->second;
+      l._via     = s.isVia() ? 1 : 0;
+      l._spare   = 0;
+      links.push_back(l);
+    }
+
+    std::string    name = net->getConstName();
+    extNetCacheNet rec;
+    rec._sig     = nc->_sig[saved[ii]];
+    rec._nameLen = name.size();
+    rec._capCnt  = capSet.size();
+    rec._rsegCnt = rsegCnt;
+    rec._ccCnt   = ccs.size();
+    rec._linkCnt = links.size();
+    rec._spare   = 0;
+    putRecord(fp, &rec, sizeof(rec), ok);
+    name.resize(namePad(name.size()), '\0');
+    putRecord(fp, name.c_str(), name.size(), ok);
+
+    for (cap_itr = capSet.begin(); cap_itr != capSet.end(); ++cap_itr) {
+      dbCapNode*     cap = *cap_itr;
+      extNetCacheCap c;
+      c._flags = 0;
+      if (cap->isITerm())
+        c._flags |= NCC_ITERM;
+      if (cap->isBTerm())
+        c._flags |= NCC_BTERM;
+      if (cap->isInternal())
+        c._flags |= NCC_INTERNAL;
+      if (cap->isBranch())
+        c._flags |= NCC_BRANCH;
+      c._node = cap->getNode();
+      for (kk = 0; kk < cornerCnt; kk++)
+        vals[kk] = cap->getCapacitance(kk);
+      putRecord(fp, &c, sizeof(c), ok);
+      putValues(fp, &vals[0], cornerCnt, ok);
+    }
+    for (rc_itr = rSet.begin(); rc_itr != rSet.end(); ++rc_itr) {
+      dbRSeg*         rc = *rc_itr;
+      extNetCacheRSeg r;
+      uint            src = rc->getSourceNode();
+      uint            tgt = rc->getTargetNode();
+      r._src     = src ? capIdx[src] + 1 : 0;
+      r._tgt     = tgt ? capIdx[tgt] + 1 : 0;
+      rc->getCoords(r._x, r._y);
+      r._pathDir = rc->pathLowToHigh() ? 0 : 1;
+      r._spare   = 0;
+      for (kk = 0; kk < cornerCnt; kk++) {
+        vals[kk]             = rc->getResistance(kk);
+        vals[cornerCnt + kk] = rc->getCapacitance(kk);
+      }
+      putRecord(fp, &r, sizeof(r), ok);
+      putValues(fp, &vals[0], 2 * cornerCnt, ok);
+    }
+    for (kk = 0; kk < ccs.size(); kk++) {
+      dbCCSeg*      cc  = ccs[kk];
+      dbCapNode*    tgt = cc->getTargetCapNode();
+      extNetCacheCC c;
+      c._src    = capIdx[cc->getSourceCapNode()->getId()];
+      c._tgtNet = recordOf[tgt->getNet()->getId()];
+      c._tgt    = capIdx[tgt->getId()];
+      c._spare  = 0;
+      for (uint jj = 0; jj < cornerCnt; jj++)
+        vals[jj] = cc->getCapacitance(jj);
+      putRecord(fp, &c, sizeof(c), ok);
+      putValues(fp, &vals[0], cornerCnt, ok);
+    }
+    if (links.size())
+      putRecord(fp, &links[0], links.size() * sizeof(extNetCacheLink), ok);
+  }
+  if (fp != NULL && fclose(fp) != 0)
+    ok = false;
+  if (!ok || rename(tmp.c_str(), nc->_file.c_str()) != 0) {
+    warning(0, "Can not write net cache %s\n", nc->_file.c_str());
+    remove(tmp.c_str());
+  }
+
+  uint extracted = nc->_changedCnt + nc->_newCnt;
+  notice(0,
+         "Net cache %s: %d nets restored, %d extracted (%d changed, %d new), "
+         "%.1f%% reuse\n",
+         nc->_file.c_str(),
+         nc->_hitCnt,
+         extracted,
+         nc->_changedCnt,
+         nc->_newCnt,
+         netCnt ? 100.0 * nc->_hitCnt / netCnt : 0.0);
+  if (nc->_failedCnt)
+    warning(0,
+            "%d unchanged nets of the net cache already had parasitics\n",
+            nc->_failedCnt);
+  delete nc;
+}
+
+}  // namespace OpenRCX
@@ -165,6 +165,7 @@ void extMain::reportTotalCap(const char* file,
                              const char* ref,
                              const char* rd_file)
 {
+  applyLazyRC();
   FILE* fp = stdout;
   if (file != NULL)
     fp = fopen(file, "w");
@@ -248,6 +249,7 @@ void extMain::reportTotalCap(const char* file,
                              const char* ref,
                              const char* rd_file)
 {
+  applyLazyRC();
   bool cap = icap;
   bool res = ires;
   if (!res && !cap)
@@ -630,6 +632,7 @@ void extMain::reportTotalCc(const char* file,
                             const char* ref,
                             const char* rd_file)
 {
+  applyLazyRC();
   notice(0, "\n");
   Darr<ext_cctot>        V;
   dbSet<dbNet>           nets = _block->getNets();
@@ -42,6 +42,7 @@
 #include "direct.h"
 #endif
 
+#include <cmath>
 #include <map>
 #include <vector>
 
@@ -186,6 +187,9 @@ extDistRCTable::extDistRCTable(uint distCnt)
   _measureTable = new Ath__array1D<extDistRC*>(n);
 
   _computeTable = NULL;
+  _fitOrder     = 0;
+  _fitCnt       = 0;
+  _fitSlope     = NULL;
 }
 
 extDistRCTable::~extDistRCTable()
@@ -194,6 +198,8 @@ extDistRCTable::~extDistRCTable()
     delete _measureTable;
   if (_computeTable != NULL)
     delete _computeTable;
+  if (_fitSlope != NULL)
+    delete[] _fitSlope;
 }
 uint extDistRCTable::mapExtrapolate(uint                loDist,
                                     extDistRC*          rc2,
@@ -252,14 +258,13 @@ uint extDistRCTable::mapInterpolate(extDistRC*          rc1,
   }
   return cnt;
 }
-uint extDistRCTable::interpolate(uint                distUnit,
-                                 int                 maxDist,
-                                 AthPool<extDistRC>* rcPool)
+// measured points the compute table interpolates over: the 99um and 100um
+// "infinite" spacing entries are left out and get the scratch entry 31 of
+// getComputeRC
+uint extDistRCTable::getKnotCnt(int& maxDist, AthPool<extDistRC>* rcPool)
 {
   uint cnt = _measureTable->getCnt();
   uint Cnt = cnt;
-  if (cnt == 0)
-    return 0;
 
   if (maxDist < 0) {
     extDistRC* lastRC = _measureTable->get(cnt - 1);
@@ -276,6 +281,17 @@ uint extDistRCTable::interpolate(uint                distUnit,
       _measureTable->set(31, rc31);
     }
   }
+  return Cnt;
+}
+uint extDistRCTable::interpolate(uint                distUnit,
+                                 int                 maxDist,
+                                 AthPool<extDistRC>* rcPool)
+{
+  uint cnt = _measureTable->getCnt();
+  if (cnt == 0)
+    return 0;
+
+  uint Cnt = getKnotCnt(maxDist, rcPool);
 
   makeComputeTable(maxDist, distUnit);
 
@@ -339,7 +355,7 @@ uint extDistRCTable::writeDiagRules(FILE*                     fp,
 }
 uint extDistRCTable::writeRules(FILE* fp, double w, bool compute, bool bin)
 {
-  if (compute)
+  if (compute && _computeTable != NULL)
     return writeRules(fp, _computeTable, w, bin);
   else
     return writeRules(fp, _measureTable, w, bin);
@@ -351,7 +367,7 @@ uint extDistRCTable::writeDiagRules(FILE*  fp,
                                     bool   compute,
                                     bool   bin)
 {
-  if (compute)
+  if (compute && _computeTable != NULL)
     return writeDiagRules(fp, _computeTable, w1, w2, s, bin);
   else
     return writeDiagRules(fp, _measureTable, w1, w2, s, bin);
@@ -442,7 +458,8 @@ uint extDistRCTable::readRules(Ath__parser*        parser,
                                bool                compute,
                                bool                bin,
                                bool                ignore,
-                               double              dbFactor)
+                               double              dbFactor,
+                               uint                fitOrder)
 {
   parser->parseNextLine();
   uint cnt = parser->getInt(2);
@@ -475,7 +492,9 @@ uint extDistRCTable::readRules(Ath__parser*        parser,
 
   _measureTable = table;
 
-  if (compute)
+  if (compute && fitOrder > 0)
+    makeFitTable(4, fitOrder, rcPool);
+  else if (compute)
 #ifdef HI_ACC_1
     // interpolate(12, -1, rcPool);
     interpolate(4, -1, rcPool);
@@ -538,7 +557,7 @@ extDistRC* extDistRCTable::getRC_99()
 
   return NULL;
 }
-extDistRC* extDistRCTable::getComputeRC(uint dist)
+extDistRC* extDistRCTable::getComputeRC(uint dist, extDistRC* fitRC)
 {
   if (_measureTable == NULL)
     return NULL;
@@ -599,15 +618,13 @@ extDistRC* extDistRCTable::getComputeRC(uint dist)
   }
 
   uint n = dist / _unit;
-  return _computeTable->geti(n);
-}
-/*
-extDistRC* extDistRCTable::getComputeRC(double dist)
-{
-        uint n= dist/_unit);
-        return _computeTable->get(n);
+  if (_computeTable != NULL)
+    return _computeTable->geti(n);
+  // compact tables evaluate into the caller's record
+  if (fitRC == NULL || !getFitRC(n, fitRC))
+    return NULL;
+  return fitRC;
 }
-*/
 uint extDistWidthRCTable::getWidthIndex(uint w)
 {
   if ((int) w >= _lastWidth)
@@ -1127,7 +1144,8 @@ uint extDistWidthRCTable::readRulesOver(Ath__parser* parser,
                                         uint         widthCnt,
                                         bool         bin,
                                         bool         ignore,
-                                        double       dbFactor)
+                                        double       dbFactor,
+                                        uint         fitOrder)
 {
   uint cnt = 0;
   for (uint ii = 0; ii < _met; ii++) {
@@ -1140,10 +1158,10 @@ uint extDistWidthRCTable::readRulesOver(Ath__parser* parser,
     for (uint jj = 0; jj < widthCnt; jj++) {
       if (!ignore)
         cnt += _rcDistTable[ii][jj]->readRules(
-            parser, _rcPoolPtr, true, bin, ignore, dbFactor);
+            parser, _rcPoolPtr, true, bin, ignore, dbFactor, fitOrder);
       else
         cnt += _rcDistTable[0][0]->readRules(
-            parser, _rcPoolPtr, true, bin, ignore, dbFactor);
+            parser, _rcPoolPtr, true, bin, ignore, dbFactor, fitOrder);
     }
   }
   return cnt;
@@ -1152,7 +1170,8 @@ uint extDistWidthRCTable::readRulesUnder(Ath__parser* parser,
                                          uint         widthCnt,
                                          bool         bin,
                                          bool         ignore,
-                                         double       dbFactor)
+                                         double       dbFactor,
+                                         uint         fitOrder)
 {
   uint cnt = 0;
   for (uint ii = _met + 1; ii < _layerCnt; ii++) {
@@ -1168,7 +1187,7 @@ uint extDistWidthRCTable::readRulesUnder(Ath__parser* parser,
 
     for (uint jj = 0; jj < widthCnt; jj++) {
       cnt += _rcDistTable[metIndex][jj]->readRules(
-          parser, _rcPoolPtr, true, bin, ignore, dbFactor);
+          parser, _rcPoolPtr, true, bin, ignore, dbFactor, fitOrder);
     }
   }
   return cnt;
@@ -1179,7 +1198,8 @@ uint extDistWidthRCTable::readRulesDiagUnder(Ath__parser* parser,
                                              uint         diagDistCnt,
                                              bool         bin,
                                              bool         ignore,
-                                             double       dbFactor)
+                                             double       dbFactor,
+                                             uint         fitOrder)
 {
   uint cnt = 0;
   for (uint ii = _met + 1; ii < _met + 5 && ii < _layerCnt; ii++) {
@@ -1208,10 +1228,10 @@ uint extDistWidthRCTable::readRulesDiagUnder(Ath__parser* parser,
         for (uint ll = 0; ll < diagDistCnt; ll++) {
           if (!ignore)
             cnt += _rcDiagDistTable[metIndex][jj][kk][ll]->readRules(
-                parser, _rcPoolPtr, true, bin, ignore, dbFactor);
+                parser, _rcPoolPtr, true, bin, ignore, dbFactor, fitOrder);
           else
             cnt += _rcDistTable[0][0]->readRules(
-                parser, _rcPoolPtr, true, bin, ignore, dbFactor);
+                parser, _rcPoolPtr, true, bin, ignore, dbFactor, fitOrder);
         }
       }
     }
@@ -1224,7 +1244,8 @@ uint extDistWidthRCTable::readRulesDiagUnder(Ath__parser* parser,
                                              uint         widthCnt,
                                              bool         bin,
                                              bool         ignore,
-                                             double       dbFactor)
+                                             double       dbFactor,
+                                             uint         fitOrder)
 {
   uint cnt = 0;
   for (uint ii = _met + 1; ii < _layerCnt; ii++) {
@@ -1237,7 +1258,7 @@ uint extDistWidthRCTable::readRulesDiagUnder(Ath__parser* parser,
 
     for (uint jj = 0; jj < widthCnt; jj++) {
       cnt += _rcDistTable[metIndex][jj]->readRules(
-          parser, _rcPoolPtr, true, bin, ignore, dbFactor);
+          parser, _rcPoolPtr, true, bin, ignore, dbFactor, fitOrder);
     }
   }
   return cnt;
@@ -1246,7 +1267,8 @@ uint extDistWidthRCTable::readRulesOverUnder(Ath__parser* parser,
                                              uint         widthCnt,
                                              bool         bin,
                                              bool         ignore,
-                                             double       dbFactor)
+                                             double       dbFactor,
+                                             uint         fitOrder)
 {
   uint cnt = 0;
   for (uint u = 1; u < _met; u++) {
@@ -1275,10 +1297,10 @@ uint extDistWidthRCTable::readRulesOverUnder(Ath__parser* parser,
       for (uint jj = 0; jj < widthCnt; jj++) {
         if (!ignore)
           mcnt += _rcDistTable[metIndex][jj]->readRules(
-              parser, _rcPoolPtr, true, bin, ignore, dbFactor);
+              parser, _rcPoolPtr, true, bin, ignore, dbFactor, fitOrder);
         else
           mcnt += _rcDistTable[0][0]->readRules(
-              parser, _rcPoolPtr, true, bin, ignore, dbFactor);
+              parser, _rcPoolPtr, true, bin, ignore, dbFactor, fitOrder);
       }
       cnt += mcnt;
       // notice(0,"OU metIndex=%d met=%d  mUnder=%d  mOver=%d layerCnt=%d
@@ -1524,10 +1546,10 @@ extDistRC* extDistRCTable::getLastRC()
   return _measureTable->get(cnt - 1);
 }
 
-extDistRC* extDistRCTable::getRC(uint s, bool compute)
+extDistRC* extDistRCTable::getRC(uint s, bool compute, extDistRC* fitRC)
 {
   if (compute)
-    return getComputeRC(s);
+    return getComputeRC(s, fitRC);
   else
     return NULL;
   // return interpolate _measureTable->findNextBiggestIndex((double) s);
@@ -1537,7 +1559,7 @@ void extDistRCTable::getFringeTable(Ath__array1D<int>*    sTable,
                                     bool                  compute)
 {
   Ath__array1D<extDistRC*>* table = _computeTable;
-  if (!compute)
+  if (!compute || table == NULL)
     table = _measureTable;
 
   for (uint ii = 0; ii < table->getCnt(); ii++) {
@@ -1607,19 +1629,23 @@ extDistRC* extDistWidthRCTable::getLastWidthFringeRC(uint mou)
 
   return _rcDistTable[mou][wIndex]->getLastRC();
 }
-extDistRC* extDistWidthRCTable::getRC(uint mou, uint w, uint s)
+extDistRC* extDistWidthRCTable::getRC(uint       mou,
+                                      uint       w,
+                                      uint       s,
+                                      extDistRC* fitRC)
 {
   int wIndex = getWidthIndex(w);
   if (wIndex < 0)
     return NULL;
 
-  return _rcDistTable[mou][wIndex]->getRC(s, true);
+  return _rcDistTable[mou][wIndex]->getRC(s, true, fitRC);
 }
-extDistRC* extDistWidthRCTable::getRC(uint mou,
-                                      uint w,
-                                      uint dw,
-                                      uint ds,
-                                      uint s)
+extDistRC* extDistWidthRCTable::getRC(uint       mou,
+                                      uint       w,
+                                      uint       dw,
+                                      uint       ds,
+                                      uint       s,
+                                      extDistRC* fitRC)
 {
   int wIndex = getWidthIndex(w);
   if (wIndex < 0)
@@ -1630,7 +1656,8 @@ extDistRC* extDistWidthRCTable::getRC(uint mou,
   int dsIndex = getDiagDistIndex(mou, ds);
   if (dsIndex < 0)
     return NULL;
-  return _rcDiagDistTable[mou][wIndex][dwIndex][dsIndex]->getRC(s, true);
+  return _rcDiagDistTable[mou][wIndex][dwIndex][dsIndex]->getRC(
+      s, true, fitRC);
 }
 extDistRC* extDistWidthRCTable::getRC_99(uint mou, uint w, uint dw, uint ds)
 {
@@ -1677,13 +1704,17 @@ extDistRC* extDistWidthRCTable::getRC_99(uint mou, uint w, uint dw, uint ds)
 }
 double extRCModel::getFringeOver(uint met, uint mUnder, uint w, uint s)
 {
-  extDistRC* rc = _modelTable[_tmpDataRate]->_capOver[met]->getRC(mUnder, w, s);
+  extDistRC  fitRC;
+  extDistRC* rc
+      = _modelTable[_tmpDataRate]->_capOver[met]->getRC(mUnder, w, s, &fitRC);
 
   return rc->getFringe();
 }
 double extRCModel::getCouplingOver(uint met, uint mUnder, uint w, uint s)
 {
-  extDistRC* rc = _modelTable[_tmpDataRate]->_capOver[met]->getRC(mUnder, w, s);
+  extDistRC  fitRC;
+  extDistRC* rc
+      = _modelTable[_tmpDataRate]->_capOver[met]->getRC(mUnder, w, s, &fitRC);
 
   return rc->getCoupling();
 }
@@ -1693,7 +1724,7 @@ extDistRC* extRCModel::getOverRC(extMeasure* m)
       || _modelTable[_tmpDataRate]->_capOver[m->_met] == NULL)
     return NULL;
   extDistRC* rc = _modelTable[_tmpDataRate]->_capOver[m->_met]->getRC(
-      m->_underMet, m->_width, m->_dist);
+      m->_underMet, m->_width, m->_dist, &m->_fitRC);
 
   return rc;
 }
@@ -1704,7 +1735,7 @@ extDistRC* extRCModel::getUnderRC(extMeasure* m)
       || _modelTable[_tmpDataRate]->_capUnder[m->_met] == NULL)
     return NULL;
   extDistRC* rc = _modelTable[_tmpDataRate]->_capUnder[m->_met]->getRC(
-      n, m->_width, m->_dist);
+      n, m->_width, m->_dist, &m->_fitRC);
 
   return rc;
 }
@@ -1714,7 +1745,7 @@ extDistRC* extRCModel::getOverUnderRC(extMeasure* m)
       = _modelTable[_tmpDataRate]->_capOverUnder[m->_met]->_metCnt;
   uint       n  = getOverUnderIndex(m, maxOverUnderIndex);
   extDistRC* rc = _modelTable[_tmpDataRate]->_capOverUnder[m->_met]->getRC(
-      n, m->_width, m->_dist);
+      n, m->_width, m->_dist, &m->_fitRC);
 
   return rc;
 }
@@ -1804,7 +1835,7 @@ extDistRC* extMeasure::getOverUnderRC(extMetRCTable* rcModel)
   if (_dist < 0)
     rc = rcModel->_capOverUnder[_met]->getFringeRC(n, _width);
   else
-    rc = rcModel->_capOverUnder[_met]->getRC(n, _width, _dist);
+    rc = rcModel->_capOverUnder[_met]->getRC(n, _width, _dist, &_fitRC);
 
   return rc;
 }
@@ -1817,7 +1848,7 @@ extDistRC* extMeasure::getOverRC(extMetRCTable* rcModel)
   if (_dist < 0)
     rc = rcModel->_capOver[_met]->getFringeRC(_underMet, _width);
   else
-    rc = rcModel->_capOver[_met]->getRC(_underMet, _width, _dist);
+    rc = rcModel->_capOver[_met]->getRC(_underMet, _width, _dist, &_fitRC);
 
   return rc;
 }
@@ -1851,7 +1882,7 @@ extDistRC* extMeasure::getUnderRC(extMetRCTable* rcModel)
   if (_dist < 0)
     rc = rcModel->_capUnder[_met]->getFringeRC(n, _width);
   else
-    rc = rcModel->_capUnder[_met]->getRC(n, _width, _dist);
+    rc = rcModel->_capUnder[_met]->getRC(n, _width, _dist, &_fitRC);
 
   return rc;
 }
@@ -1882,7 +1913,8 @@ double extMeasure::getDiagUnderCC(extMetRCTable* rcModel,
 
   uint n = getUnderIndex(overMet);
 
-  extDistRC* rc = rcModel->_capDiagUnder[_met]->getRC(n, _width, dist);
+  extDistRC* rc
+      = rcModel->_capDiagUnder[_met]->getRC(n, _width, dist, &_fitRC);
 
   if (rc != NULL)
     return rc->_fringe;  // TODO 620
@@ -1900,7 +1932,7 @@ double extMeasure::getDiagUnderCC(extMetRCTable* rcModel,
   uint n = getUnderIndex(overMet);
 
   extDistRC* rc = rcModel->_capDiagUnder[_met]->getRC(
-      n, _width, diagWidth, diagDist, _dist);
+      n, _width, diagWidth, diagDist, _dist, &_fitRC);
 
   if (rc != NULL)
     return rc->_fringe;
@@ -1918,7 +1950,7 @@ extDistRC* extMeasure::getDiagUnderCC2(extMetRCTable* rcModel,
   uint n = getUnderIndex(overMet);
 
   extDistRC* rc = rcModel->_capDiagUnder[_met]->getRC(
-      n, _width, diagWidth, diagDist, _dist);
+      n, _width, diagWidth, diagDist, _dist, &_fitRC);
 
   if (rc == NULL)
     return NULL;
@@ -1968,10 +2000,27 @@ extRCModel::extRCModel(uint layerCnt, const char* name)
   _tmpDataRate   = 0;
   _extMain       = NULL;
   _ruleFileName  = NULL;
+  _diag          = false;
   _diagModel     = 0;
   _verticalDiag  = false;
   _keepFile      = false;
   _metLevel      = 0;
+
+  _solverJobCnt    = 0;
+  _solverRetryCnt  = 0;
+  _queueSolverJobs = false;
+  _readAfterJobs   = false;
+
+  _solverCacheHitCnt  = 0;
+  _solverCacheMissCnt = 0;
+
+  _solverMaxError   = 0.0;
+  _deferAddRC       = false;
+  _adaptiveSolveCnt = 0;
+  _adaptiveSkipCnt  = 0;
+
+  _sharedRefCnt = 0;
+  _fitOrder     = 0;
 }
 extRCModel::extRCModel(const char* name)
 {
@@ -2008,6 +2057,22 @@ extRCModel::extRCModel(const char* name)
   _verticalDiag = false;
   _keepFile     = false;
   _metLevel     = 0;
+
+  _solverJobCnt    = 0;
+  _solverRetryCnt  = 0;
+  _queueSolverJobs = false;
+  _readAfterJobs   = false;
+
+  _solverCacheHitCnt  = 0;
+  _solverCacheMissCnt = 0;
+
+  _solverMaxError   = 0.0;
+  _deferAddRC       = false;
+  _adaptiveSolveCnt = 0;
+  _adaptiveSkipCnt  = 0;
+
+  _sharedRefCnt = 0;
+  _fitOrder     = 0;
 }
 
 extRCModel::~extRCModel()
@@ -2024,6 +2089,9 @@ extRCModel::~extRCModel()
   delete[] _solverFileName;
   delete[] _wireFileName;
 
+  for (uint ii = 0; ii < _solverJobTable.size(); ii++)
+    delete _solverJobTable[ii];
+
   if (_modelCnt > 0) {
     for (uint ii = 0; ii < _modelCnt; ii++)
       delete _modelTable[ii];
@@ -2031,6 +2099,15 @@ extRCModel::~extRCModel()
     delete[] _modelTable;
     delete _dataRateTable;
   }
+  for (uint ii = 0; ii < _metalWorkerTable.size(); ii++)
+    delete _metalWorkerTable[ii];
+
+  std::map<std::string, extSolverOutput*>::iterator it;
+  for (it = _solverOutputTable.begin(); it != _solverOutputTable.end(); ++it)
+    delete it->second;
+
+  for (uint ii = 0; ii < _rulesPoolTable.size(); ii++)
+    delete _rulesPoolTable[ii];
 }
 void extRCModel::setExtMain(extMain* x)
 {
@@ -2218,6 +2295,7 @@ extMeasure::extMeasure()
   _btermThreshold = false;
   _rotatedGs      = false;
   _sameNetFlag    = false;
+  _measureLog     = NULL;
 }
 void extMeasure::allocOUpool()
 {
@@ -2410,6 +2488,8 @@ extDistRC* extMeasure::addRC(extDistRC* rcUnit, uint len, uint jj)
 extDistRC* extMeasure::computeOverUnderRC(uint len)
 {
   extDistRC* rcUnit = NULL;
+  if (_measureLog != NULL)
+    logCoverage(MLG_OVER_UNDER, len);
 
   for (uint ii = 0; ii < _metRCTable.getCnt(); ii++) {
     extMetRCTable* rcModel = _metRCTable.get(ii);
@@ -2425,6 +2505,8 @@ extDistRC* extMeasure::computeOverUnderRC(uint len)
 extDistRC* extMeasure::computeOverRC(uint len)
 {
   extDistRC* rcUnit = NULL;
+  if (_measureLog != NULL)
+    logCoverage(MLG_OVER, len);
 
   for (uint ii = 0; ii < _metRCTable.getCnt(); ii++) {
     extMetRCTable* rcModel = _metRCTable.get(ii);
@@ -2458,6 +2540,8 @@ extDistRC* extMeasure::computeR(uint len, double* valTable)
 extDistRC* extMeasure::computeUnderRC(uint len)
 {
   extDistRC* rcUnit = NULL;
+  if (_measureLog != NULL)
+    logCoverage(MLG_UNDER, len);
 
   for (uint ii = 0; ii < _metRCTable.getCnt(); ii++) {
     extMetRCTable* rcModel = _metRCTable.get(ii);
@@ -2800,21 +2884,72 @@ uint extRCModel::getCapMatrixValues3D(uint lastNode, extMeasure* m)
   return 0;
 }
 
+void extRCModel::beginCapLog(extMeasure* m, bool printWires, bool wires3D)
+{
+  fprintf(_capLogFP, "BEGIN %s\n", _wireDirName);
+  fprintf(_capLogFP, "%s\n", _commentLine);
+  if (!printWires || m == NULL)
+    return;
+
+  if (wires3D) {
+    if (m->_benchFlag)
+      writeWires2_3D(_capLogFP, m, m->_wireCnt);
+    else
+      writeRuleWires_3D(_capLogFP, m, m->_wireCnt);
+  } else {
+    if (m->_benchFlag)
+      writeWires2(_capLogFP, m, m->_wireCnt);
+    else
+      writeRuleWires(_capLogFP, m, m->_wireCnt);
+  }
+}
+void extRCModel::addBenchCharge(extMeasure* m,
+                                int         met,
+                                int         wire,
+                                double      cap,
+                                uint&       cnt)
+{
+  if (m->_benchFlag || met == 0 || wire < 0)
+    return;
+
+  uint n  = m->_wireCnt / 2 + 1;
+  uint n1 = wire;
+  if (n1 == n - 1) {
+    m->_capMatrix[1][1] = cap;  // left cc
+    cnt++;
+  } else if (n1 == n) {
+    m->_capMatrix[1][0] = cap;
+    m->_idTable[cnt]    = n1;
+    cnt++;
+  } else if (n1 == n + 1) {
+    m->_capMatrix[1][2] = cap;  // right cc
+    cnt++;
+  }
+}
 uint extRCModel::readCapacitanceBench(bool readCapLog, extMeasure* m)
 {
   double units = 1.0e+12;
 
-  FILE* solverFP = NULL;
+  uint cnt            = 0;
+  m->_capMatrix[1][0] = 0.0;
+  m->_capMatrix[1][1] = 0.0;
+  m->_capMatrix[1][2] = 0.0;
+
   if (!readCapLog) {
-    solverFP = openSolverFile();
-    if (solverFP == NULL) {
+    extSolverOutput* out = getSolverOutput();
+    if (out == NULL)
       return 0;
+    if (out->_potential)
+      beginCapLog(m, _keepFile, false);
+    for (uint ii = 0; ii < out->_chargeTable.size(); ii++) {
+      extSolverCharge* c = &out->_chargeTable[ii];
+      out->printCharge(_capLogFP, c);
+      addBenchCharge(m, c->_met, c->_wire, fabs(c->_cap) * units, cnt);
     }
-    _parser->setInputFP(solverFP);
+    delete out;
+    return cnt;
   }
 
-  Ath__parser wParser;
-
   bool matrixFlag = false;
   /*
    C_1_2 M1_w1 M1_w2 6.367907e-17
@@ -2825,11 +2960,6 @@ uint extRCModel::readCapacitanceBench(bool readCapLog, extMeasure* m)
    C_3_0 M1_w3 GROUND_RC2 4.842436e-17
   */
 
-  uint n              = m->_wireCnt / 2 + 1;
-  uint cnt            = 0;
-  m->_capMatrix[1][0] = 0.0;
-  m->_capMatrix[1][1] = 0.0;
-  m->_capMatrix[1][2] = 0.0;
   //	while (_parser->parseNextLine()>0) {
   while (1) {
     if (!_parser->isKeyword(0, "BEGIN") || matrixFlag)
@@ -2850,40 +2980,17 @@ uint extRCModel::readCapacitanceBench(bool readCapLog, extMeasure* m)
         cap = -cap;
       cap *= units;
 
-      wParser.mkWords(_parser->get(2), "M");
-      if (!m->_benchFlag && wParser.getInt(0) != 0) {
-        if (wParser.mkWords(_parser->get(2), "w") < 2)
-          continue;
-        uint n1 = wParser.getInt(1);
-        if (n1 == n - 1) {
-          m->_capMatrix[1][1] = cap;  // left cc
-          cnt++;
-        } else if (n1 == n) {
-          m->_capMatrix[1][0] = cap;
-          m->_idTable[cnt]    = n1;
-          cnt++;
-        } else if (n1 == n + 1) {
-          m->_capMatrix[1][2] = cap;  // right cc
-          cnt++;
-        }
-      }
+      int met, wire;
+      extSolverOutput::parseWireName(
+          _parser->get(2), strlen(_parser->get(2)), met, wire);
+      addBenchCharge(m, met, wire, cap, cnt);
       continue;
     }
 
     if (_parser->isKeyword(0, "***") && _parser->isKeyword(1, "POTENTIAL")) {
       matrixFlag = true;
 
-      //			if (_parser->isKeyword(4, "Total")) {
-
-      fprintf(_capLogFP, "BEGIN %s\n", _wireDirName);
-      fprintf(_capLogFP, "%s\n", _commentLine);
-      if (_keepFile && m != NULL) {
-        if (m->_benchFlag)
-          writeWires2(_capLogFP, m, m->_wireCnt);
-        else
-          writeRuleWires(_capLogFP, m, m->_wireCnt);
-      }
-      //			}
+      beginCapLog(m, _keepFile, false);
       continue;
     } else if (_parser->isKeyword(0, "BEGIN")
                && (strcmp(_parser->get(1), _wireDirName) == 0)) {
@@ -2898,11 +3005,43 @@ uint extRCModel::readCapacitanceBench(bool readCapLog, extMeasure* m)
       break;
     }
   }
-  if (solverFP != NULL)
-    fclose(solverFP);
-
   return cnt;
 }
+void extRCModel::addDiagCharge(extMeasure* m,
+                               int         diagMet,
+                               int         met,
+                               int         wire,
+                               double      cap,
+                               uint&       cnt)
+{
+  uint n  = m->_wireCnt / 2 + 1;
+  uint n1 = wire;
+  if (_diagModel == 1) {
+    if (met != diagMet || n1 != n)
+      return;
+    m->_capMatrix[1][0] = cap;
+    m->_idTable[cnt]    = n1;
+    cnt++;
+  }
+  if (_diagModel == 2) {
+    if (met == diagMet) {
+      if (n1 != n)
+        return;
+      m->_capMatrix[1][0] = cap;  // diag
+      m->_idTable[cnt]    = n1;
+      cnt++;
+    } else if (!m->_benchFlag && met != 0) {
+      if (n1 == n - 1) {
+        m->_capMatrix[1][1] = cap;  // left cc in diag side
+        cnt++;
+      }
+      if (n1 == n + 1) {
+        m->_capMatrix[1][2] = cap;  // right cc
+        cnt++;
+      }
+    }
+  }
+}
 uint extRCModel::readCapacitanceBenchDiag(bool readCapLog, extMeasure* m)
 {
   int met;
@@ -2910,26 +3049,30 @@ uint extRCModel::readCapacitanceBenchDiag(bool readCapLog, extMeasure* m)
     met = m->_overMet;
   else if (m->_underMet > 0)
     met = m->_underMet;
-  uint n = m->_wireCnt / 2 + 1;
 
   double units = 1.0e+12;
 
-  FILE* solverFP = NULL;
+  uint cnt            = 0;
+  m->_capMatrix[1][0] = 0.0;
+  m->_capMatrix[1][1] = 0.0;
+  m->_capMatrix[1][2] = 0.0;
+
   if (!readCapLog) {
-    solverFP = openSolverFile();
-    if (solverFP == NULL) {
+    extSolverOutput* out = getSolverOutput();
+    if (out == NULL)
       return 0;
+    if (out->_potential)
+      beginCapLog(m, _keepFile, false);
+    for (uint ii = 0; ii < out->_chargeTable.size(); ii++) {
+      extSolverCharge* c = &out->_chargeTable[ii];
+      out->printCharge(_capLogFP, c);
+      addDiagCharge(m, met, c->_met, c->_wire, fabs(c->_cap) * units, cnt);
     }
-    _parser->setInputFP(solverFP);
+    delete out;
+    return cnt;
   }
 
-  Ath__parser wParser;
-
-  bool matrixFlag     = false;
-  uint cnt            = 0;
-  m->_capMatrix[1][0] = 0.0;
-  m->_capMatrix[1][1] = 0.0;
-  m->_capMatrix[1][2] = 0.0;
+  bool matrixFlag = false;
   //        while (_parser->parseNextLine()>0) {
   while (1) {
     if (!_parser->isKeyword(0, "BEGIN") || matrixFlag)
@@ -2949,54 +3092,17 @@ uint extRCModel::readCapacitanceBenchDiag(bool readCapLog, extMeasure* m)
         cap = -cap;
       cap *= units;
 
-      wParser.mkWords(_parser->get(2), "M");
-      if (_diagModel == 1) {
-        if (wParser.getInt(0) != met)
-          continue;
-        wParser.mkWords(_parser->get(2), "w");
-        uint n1 = wParser.getInt(1);
-        if (n1 != n)
-          continue;
-        m->_capMatrix[1][0] = cap;
-        m->_idTable[cnt]    = n1;
-        cnt++;
-      }
-      if (_diagModel == 2) {
-        if (wParser.getInt(0) == met) {
-          wParser.mkWords(_parser->get(2), "w");
-          uint n1 = wParser.getInt(1);
-          if (n1 != n)
-            continue;
-          m->_capMatrix[1][0] = cap;  // diag
-          m->_idTable[cnt]    = n1;
-          cnt++;
-        } else if (!m->_benchFlag && wParser.getInt(0) != 0) {
-          wParser.mkWords(_parser->get(2), "w");
-          uint n1 = wParser.getInt(1);
-          if (n1 == n - 1) {
-            m->_capMatrix[1][1] = cap;  // left cc in diag side
-            cnt++;
-          }
-          if (n1 == n + 1) {
-            m->_capMatrix[1][2] = cap;  // right cc
-            cnt++;
-          }
-        }
-      }
+      int wMet, wire;
+      extSolverOutput::parseWireName(
+          _parser->get(2), strlen(_parser->get(2)), wMet, wire);
+      addDiagCharge(m, met, wMet, wire, cap, cnt);
       continue;
     }
 
     if (_parser->isKeyword(0, "***") && _parser->isKeyword(1, "POTENTIAL")) {
       matrixFlag = true;
 
-      fprintf(_capLogFP, "BEGIN %s\n", _wireDirName);
-      fprintf(_capLogFP, "%s\n", _commentLine);
-      if (_keepFile && m != NULL) {
-        if (m->_benchFlag)
-          writeWires2(_capLogFP, m, m->_wireCnt);
-        else
-          writeRuleWires(_capLogFP, m, m->_wireCnt);
-      }
+      beginCapLog(m, _keepFile, false);
       continue;
     } else if (_parser->isKeyword(0, "BEGIN")
                && (strcmp(_parser->get(1), _wireDirName) == 0)) {
@@ -3010,10 +3116,6 @@ uint extRCModel::readCapacitanceBenchDiag(bool readCapLog, extMeasure* m)
       break;
     }
   }
-
-  if (solverFP != NULL)
-    fclose(solverFP);
-
   return cnt;
 }
 // void extRCModel::mkFileNames(uint met, const char* ou, uint ouMet, double w,
@@ -3153,6 +3255,56 @@ void extRCModel::mkNet_prefix(extMeasure* m, const char* wiresNameSuffix)
   fprintf(_logFP, "pattern Dir %s\n\n", _wireDirName);
   fflush(_logFP);
 }
+// keeps the pattern of mkNet_prefix on the middle net of a bench pattern,
+// so GenExtRules does not have to parse it back from the net names
+void extRCModel::mkBenchPatternProperty(extMeasure* m)
+{
+  int met      = m->_met;
+  int overMet  = -1;
+  int underMet = -1;
+  int kind;
+  if ((m->_overMet > 0) && (m->_underMet > 0)) {
+    kind     = BENCH_OVER_UNDER;
+    overMet  = m->_overMet;
+    underMet = m->_underMet;
+  } else if (m->_overMet > 0) {
+    kind    = m->_diag ? BENCH_DIAG : BENCH_UNDER;
+    overMet = m->_overMet;
+  } else if (m->_underMet >= 0) {
+    if (m->_diag) {  // named M<underMet>uuM<met>
+      kind    = BENCH_DIAG;
+      met     = m->_underMet;
+      overMet = m->_met;
+    } else {
+      kind     = BENCH_OVER;
+      underMet = m->_underMet;
+    }
+  } else {
+    return;
+  }
+
+  char netName[1024];
+  sprintf(netName, "%s_%d", _wireDirName, (m->_wireCnt + 1) / 2);
+  odb::dbNet* net = m->_block->findNet(netName);
+  if (net == NULL)
+    return;
+
+  char value[256];
+  sprintf(value,
+          "%d %d %d %d %g %g",
+          kind,
+          met,
+          overMet,
+          underMet,
+          get_nm(m, m->_w_m),
+          get_nm(m, m->_s_m));
+
+  odb::dbStringProperty* p = odb::dbStringProperty::find(net, "_benchPattern");
+  if (p == NULL)
+    odb::dbStringProperty::create(net, "_benchPattern", value);
+  else
+    p->setValue(value);
+}
 
 FILE* extRCModel::mkPatternFile()
 {
@@ -3186,6 +3338,17 @@ bool extRCModel::openCapLogFile()
   sprintf(buff, "%s/%s", _topDir, _patternName);
   _parser->mkDirTree(buff, "/");
 
+  if (_queueSolverJobs) {  // nothing is read while the decks are queued
+    _readCapLog = false;
+    _capLogFP   = NULL;
+    return false;
+  }
+  if (_readAfterJobs) {  // the caps come from the outputs of the jobs
+    _readCapLog = false;
+    _capLogFP   = openFile(buff, capLog, NULL, _metLevel > 0 ? "a" : "w");
+    return false;
+  }
+
   FILE* fp = openFile(buff, capLog, NULL, "r");
 
   if (fp == NULL) {  // no previous run
@@ -3228,7 +3391,9 @@ bool extRCModel::openCapLogFile()
 }
 void extRCModel::closeCapLogFile()
 {
-  fclose(_capLogFP);
+  if (_capLogFP != NULL)
+    fclose(_capLogFP);
+  _capLogFP = NULL;
 }
 void extRCModel::writeRuleWires(FILE* fp, extMeasure* measure, uint wireCnt)
 {
@@ -3780,6 +3945,8 @@ void extRCModel::setOptions(const char* topDir,
     _keepFile = true;
   if (metLevel)
     _metLevel = metLevel;
+  _queueSolverJobs = false;
+  _readAfterJobs   = false;
 #ifdef _WIN32
   _runSolver = false;
 #endif
@@ -3799,6 +3966,9 @@ void extRCModel::setOptions(const char* topDir,
   _runSolver  = true;
   _keepFile   = true;
 
+  _queueSolverJobs = false;
+  _readAfterJobs   = false;
+
   if (writeFiles) {
     _writeFiles = true;
     _readSolver = false;
@@ -3825,27 +3995,48 @@ void extRCModel::closeFiles()
 }
 void extRCModel::runSolver(const char* solverOption)
 {
-  char cmd[4000];
+  char cmd[8192];
 #ifndef _WIN32
+  if (_queueSolverJobs) {
+    extSolverJob* job = new extSolverJob;
+    job->_dir         = _wireDirName;
+    job->_file        = _wireFileName;
+    job->_option      = solverOption;
+    job->_pid         = 0;
+    job->_tryCnt      = 0;
+    _solverOutputNames.push_back(job->_dir + "/" + job->_file + ".out");
+    if (readSolverCache(
+            _wireDirName, _wireFileName, solverOption, job->_cacheKey))
+      delete job;
+    else
+      _solverJobTable.push_back(job);
+    return;
+  }
+  uint64_t cacheKey = 0;
+  if (readSolverCache(_wireDirName, _wireFileName, solverOption, cacheKey))
+    return;
+  if (_solverCmd == "stub" || _solverCmd == "builtin") {
+    char deck[4096];
+    snprintf(deck, sizeof(deck), "%s/%s", _wireDirName, _wireFileName);
+    snprintf(cmd, sizeof(cmd), "%s.out", deck);
+    bool solved = _solverCmd == "stub" ? writeStubSolverOutput(deck, cmd)
+                                       : runBuiltinSolver(deck, cmd);
+    if (!solved) {
+      warning(0,
+              "%s solver failed on %s\n",
+              _solverCmd == "stub" ? "Stub" : "Builtin",
+              deck);
+      return;
+    }
+    saveSolverCache(_wireDirName, _wireFileName, cacheKey);
+    return;
+  }
   //	sprintf(cmd, "cd %s ; /opt/ads/bin/casyn raphael %s %s ; cd
   //../../../../../../ ", _wireDirName, solverOption, _wireFileName);
-  // this is for check in
-  if (_diagModel == 2)
-    sprintf(cmd,
-            "ca raphael %s %s/%s -o %s/%s.out",
-            solverOption,
-            _wireDirName,
-            _wireFileName,
-            _wireDirName,
-            _wireFileName);
-  else
-    sprintf(cmd,
-            "ca raphael %s %s/%s -o %s/%s.out",
-            solverOption,
-            _wireDirName,
-            _wireFileName,
-            _wireDirName,
-            _wireFileName);
+  // this is for check in; the command template is set by define_rules_solver
+  if (!mkSolverCmd(
+          cmd, sizeof(cmd), solverOption, _wireDirName, _wireFileName))
+    return;
 
   // this is for local run
   /*	if (_diagModel==2)
@@ -3868,6 +4059,9 @@ void extRCModel::runSolver(const char* solverOption)
   notice(0, "%s\n", cmd);
 #endif
   system(cmd);
+#ifndef _WIN32
+  saveSolverCache(_wireDirName, _wireFileName, cacheKey);
+#endif
 }
 void extRCModel::cleanFiles()
 {
@@ -4136,7 +4330,6 @@ uint extRCModel::readRules(Ath__parser* parser,
                            bool         ignore,
                            double       dbFactor)
 {
-  uint                  cnt = 0;
   uint                  met = 0;
   Ath__array1D<double>* wTable
       = readHeaderAndWidth(parser, met, ouKey, wKey, bin, false);
@@ -4144,6 +4337,36 @@ uint extRCModel::readRules(Ath__parser* parser,
   if (wTable == NULL)
     return 0;
 
+  uint cnt = readRulesTables(parser,
+                             ignore ? NULL : _modelTable[m],
+                             met,
+                             wTable,
+                             ouKey,
+                             over,
+                             under,
+                             bin,
+                             diag,
+                             dbFactor);
+  delete wTable;
+
+  return cnt;
+}
+// reads the tables of one Metal section into rcTable, or skips them when
+// rcTable is NULL
+uint extRCModel::readRulesTables(Ath__parser*          parser,
+                                 extMetRCTable*        rcTable,
+                                 uint                  met,
+                                 Ath__array1D<double>* wTable,
+                                 const char*           ouKey,
+                                 bool                  over,
+                                 bool                  under,
+                                 bool                  bin,
+                                 bool                  diag,
+                                 double                dbFactor)
+{
+  uint cnt    = 0;
+  bool ignore = rcTable == NULL;
+
   uint widthCnt = wTable->getCnt();
 
   extDistWidthRCTable* dummy = NULL;
@@ -4164,36 +4387,42 @@ uint extRCModel::readRules(Ath__parser* parser,
 
   if (over && under && (met > 1)) {
     if (!ignore) {
-      _modelTable[m]->allocOverUnderTable(met, wTable, dbFactor);
-      _modelTable[m]->_capOverUnder[met]->readRulesOverUnder(
-          parser, widthCnt, bin, ignore, dbFactor);
+      rcTable->allocOverUnderTable(met, wTable, dbFactor);
+      rcTable->_capOverUnder[met]->readRulesOverUnder(
+          parser, widthCnt, bin, ignore, dbFactor, _fitOrder);
     } else
       dummy->readRulesOverUnder(parser, widthCnt, bin, ignore, dbFactor);
   } else if (over) {
     if (!ignore) {
-      _modelTable[m]->allocOverTable(met, wTable, dbFactor);
-      _modelTable[m]->_capOver[met]->readRulesOver(
-          parser, widthCnt, bin, ignore, dbFactor);
+      rcTable->allocOverTable(met, wTable, dbFactor);
+      rcTable->_capOver[met]->readRulesOver(
+          parser, widthCnt, bin, ignore, dbFactor, _fitOrder);
     } else
       dummy->readRulesOver(parser, widthCnt, bin, ignore, dbFactor);
 
   } else if (under) {
     if (!ignore) {
-      _modelTable[m]->allocUnderTable(met, wTable, dbFactor);
-      _modelTable[m]->_capUnder[met]->readRulesUnder(
-          parser, widthCnt, bin, ignore, dbFactor);
+      rcTable->allocUnderTable(met, wTable, dbFactor);
+      rcTable->_capUnder[met]->readRulesUnder(
+          parser, widthCnt, bin, ignore, dbFactor, _fitOrder);
     } else
       dummy->readRulesUnder(parser, widthCnt, bin, ignore, dbFactor);
   } else if (diag) {
     if (!ignore && _diagModel == 2) {
-      _modelTable[m]->allocDiagUnderTable(
+      rcTable->allocDiagUnderTable(
           met, wTable, diagWidthCnt, diagDistCnt, dbFactor);
-      _modelTable[m]->_capDiagUnder[met]->readRulesDiagUnder(
-          parser, widthCnt, diagWidthCnt, diagDistCnt, bin, ignore, dbFactor);
+      rcTable->_capDiagUnder[met]->readRulesDiagUnder(parser,
+                                                      widthCnt,
+                                                      diagWidthCnt,
+                                                      diagDistCnt,
+                                                      bin,
+                                                      ignore,
+                                                      dbFactor,
+                                                      _fitOrder);
     } else if (!ignore && _diagModel == 1) {
-      _modelTable[m]->allocDiagUnderTable(met, wTable, dbFactor);
-      _modelTable[m]->_capDiagUnder[met]->readRulesDiagUnder(
-          parser, widthCnt, bin, ignore, dbFactor);
+      rcTable->allocDiagUnderTable(met, wTable, dbFactor);
+      rcTable->_capDiagUnder[met]->readRulesDiagUnder(
+          parser, widthCnt, bin, ignore, dbFactor, _fitOrder);
     } else if (ignore) {
       if (_diagModel == 2)
         dummy->readRulesDiagUnder(
@@ -4205,9 +4434,6 @@ uint extRCModel::readRules(Ath__parser* parser,
   if (ignore)
     delete dummy;
 
-  if (wTable != NULL)
-    delete wTable;
-
   return cnt;
 }
 
@@ -4316,6 +4542,19 @@ bool extRCModel::readRules(char*  name,
     // parser.setDbg(1);
 
     if (parser.isKeyword(0, "DensityModel")) {
+      // the Metal sections of the models are read on threads at their file
+      // offsets
+      if (readRulesParallel(name,
+                            bin,
+                            over,
+                            under,
+                            overUnder,
+                            diag,
+                            cornerCnt,
+                            cornerTable,
+                            dbFactor))
+        return true;
+
       uint m          = parser.getInt(1);
       uint modelIndex = m;
       bool skipModel  = false;
@@ -4561,7 +4800,8 @@ bool extRCModel::measurePatternVar(extMeasure* m,
       m->_rcValid = true;
 
       // m->addCap();
-      addRC(m);
+      if (!_deferAddRC)
+        addRC(m);
     }
     if (m->_benchFlag && (lineCnt > 0)) {
       if (m->_3dFlag)
@@ -4570,30 +4810,64 @@ bool extRCModel::measurePatternVar(extMeasure* m,
         getCapMatrixValues(lineCnt, m);
     }
   }
-  if (!_keepFile)
+  if (!_keepFile && !_queueSolverJobs)
     cleanFiles();
   return true;
 }
+void extRCModel::addBench3DCharge(extMeasure* m,
+                                  int         wire,
+                                  double      cap,
+                                  uint&       cnt)
+{
+  if (wire <= 0) {
+    m->_capMatrix[1][0] += cap;
+    return;
+  }
+  m->_capMatrix[1][cnt + 1] = cap;
+  m->_idTable[cnt + 1]      = wire;
+  cnt++;
+}
+void extRCModel::sortBench3DCharges(extMeasure* m, uint cnt)
+{
+  for (uint i = 1; i < cnt; i++) {
+    for (uint j = i + 1; j < cnt + 1; j++) {
+      if (m->_idTable[j] < m->_idTable[i]) {
+        uint   t            = m->_idTable[i];
+        double tt           = m->_capMatrix[1][i];
+        m->_idTable[i]      = m->_idTable[j];
+        m->_capMatrix[1][i] = m->_capMatrix[1][j];
+        m->_idTable[j]      = t;
+        m->_capMatrix[1][j] = tt;
+      }
+    }
+  }
+}
 uint extRCModel::readCapacitanceBench3D(bool        readCapLog,
                                         extMeasure* m,
                                         bool        skipPrintWires)
 {
   double units = 1.0e+15;
 
-  FILE* solverFP = NULL;
+  uint cnt            = 0;
+  m->_capMatrix[1][0] = 0.0;
+
   if (!readCapLog) {
-    solverFP = openSolverFile();
-    if (solverFP == NULL) {
+    extSolverOutput* out = getSolverOutput();
+    if (out == NULL)
       return 0;
+    if (out->_potential)
+      beginCapLog(m, !skipPrintWires, true);
+    for (uint ii = 0; ii < out->_chargeTable.size(); ii++) {
+      extSolverCharge* c = &out->_chargeTable[ii];
+      out->printCharge(_capLogFP, c);
+      addBench3DCharge(m, c->_wire, fabs(c->_cap) * units, cnt);
     }
-    _parser->setInputFP(solverFP);
+    delete out;
+    sortBench3DCharges(m, cnt);
+    return cnt;
   }
 
-  Ath__parser wParser;
-
-  bool matrixFlag     = false;
-  uint cnt            = 0;
-  m->_capMatrix[1][0] = 0.0;
+  bool matrixFlag = false;
   while (_parser->parseNextLine() > 0) {
     if (matrixFlag) {
       if (_parser->isKeyword(0, "END"))
@@ -4610,31 +4884,17 @@ uint extRCModel::readCapacitanceBench3D(bool        readCapLog,
         cap = -cap;
       cap *= units;
 
-      wParser.mkWords(_parser->get(2), "w");
-      uint n1 = wParser.getInt(1);
-      if (!n1) {
-        m->_capMatrix[1][0] += cap;
-        continue;
-      }
-      m->_capMatrix[1][cnt + 1] = cap;
-      m->_idTable[cnt + 1]      = n1;
-      cnt++;
+      int met, wire;
+      extSolverOutput::parseWireName(
+          _parser->get(2), strlen(_parser->get(2)), met, wire);
+      addBench3DCharge(m, wire, cap, cnt);
       continue;
     }
 
     if (_parser->isKeyword(0, "***") && _parser->isKeyword(1, "POTENTIAL")) {
       matrixFlag = true;
 
-      fprintf(_capLogFP, "BEGIN %s\n", _wireDirName);
-      fprintf(_capLogFP, "%s\n", _commentLine);
-      if (!skipPrintWires) {
-        if (m != NULL) {
-          if (m->_benchFlag)
-            writeWires2_3D(_capLogFP, m, m->_wireCnt);
-          else
-            writeRuleWires_3D(_capLogFP, m, m->_wireCnt);
-        }
-      }
+      beginCapLog(m, !skipPrintWires, true);
       continue;
     } else if (_parser->isKeyword(0, "BEGIN")
                && (strcmp(_parser->get(1), _wireDirName) == 0)) {
@@ -4645,23 +4905,7 @@ uint extRCModel::readCapacitanceBench3D(bool        readCapLog,
       continue;
     }
   }
-
-  for (uint i = 1; i < cnt; i++) {
-    for (uint j = i + 1; j < cnt + 1; j++) {
-      if (m->_idTable[j] < m->_idTable[i]) {
-        uint   t            = m->_idTable[i];
-        double tt           = m->_capMatrix[1][i];
-        m->_idTable[i]      = m->_idTable[j];
-        m->_capMatrix[1][i] = m->_capMatrix[1][j];
-        m->_idTable[j]      = t;
-        m->_capMatrix[1][j] = tt;
-      }
-    }
-  }
-
-  if (solverFP != NULL)
-    fclose(solverFP);
-
+  sortBench3DCharges(m, cnt);
   return cnt;
 }
 void extRCModel::printCommentLine(char commentChar, extMeasure* m)
@@ -4988,6 +5232,79 @@ uint extRCModel::measureDiagWithVar(extMeasure* measure)
   }
   return cnt;
 }
+
+// define_rules_solver -max_error: every ADAPTIVE_SPACING_STEP-th spacing and
+// the last two are solved first
+#define ADAPTIVE_SPACING_STEP 4
+
+// define_rules_solver -max_error: a skipped spacing is reconstructed by the
+// line between the solved spacings around it. Where the parabola through
+// them and the next solved spacing differs from that line by more than
+// maxError percent of the total cap, the spacing in the middle is solved.
+// Returns true when spacings were added.
+static bool refineSpacingSamples(std::vector<char>&       solve,
+                                 std::vector<extDistRC*>& rcTab,
+                                 std::vector<double>&     sTab,
+                                 uint                     curveCnt,
+                                 double                   maxError)
+{
+  std::vector<uint> known;
+  for (uint ii = 0; ii < curveCnt; ii++) {
+    if (rcTab[ii] != NULL)
+      known.push_back(ii);
+  }
+  if (known.size() < 3)
+    return false;
+
+  bool refined = false;
+  for (uint jj = 0; jj + 1 < known.size(); jj++) {
+    uint a = known[jj];
+    uint b = known[jj + 1];
+    if (b - a < 2)
+      continue;
+    uint mid = (a + b) / 2;
+    if (solve[mid])
+      continue;
+
+    uint   c  = jj + 2 < known.size() ? known[jj + 2] : known[jj - 1];
+    double xa = sTab[a];
+    double xb = sTab[b];
+    double xc = sTab[c];
+
+    double maxErr = 0.0;
+    for (uint ii = a + 1; ii < b; ii++) {
+      double x  = sTab[ii];
+      double la = (x - xb) * (x - xc) / ((xa - xb) * (xa - xc));
+      double lb = (x - xa) * (x - xc) / ((xb - xa) * (xb - xc));
+      double lc = (x - xa) * (x - xb) / ((xc - xa) * (xc - xb));
+
+      double cc = lineSegment(x,
+                              xa,
+                              xb,
+                              rcTab[a]->getCoupling(),
+                              rcTab[b]->getCoupling());
+      double fr = lineSegment(
+          x, xa, xb, rcTab[a]->getFringe(), rcTab[b]->getFringe());
+      double qcc = la * rcTab[a]->getCoupling() + lb * rcTab[b]->getCoupling()
+                   + lc * rcTab[c]->getCoupling();
+      double qfr = la * rcTab[a]->getFringe() + lb * rcTab[b]->getFringe()
+                   + lc * rcTab[c]->getFringe();
+
+      double tot = fabs(cc) + fabs(fr);
+      if (tot <= 0.0)
+        continue;
+      double err = 100.0 * (fabs(qcc - cc) + fabs(qfr - fr)) / tot;
+      if (err > maxErr)
+        maxErr = err;
+    }
+    if (maxErr > maxError) {
+      solve[mid] = 1;
+      refined    = true;
+    }
+  }
+  return refined;
+}
+
 uint extRCModel::measureWithVar(extMeasure* measure)
 {
   uint          cnt  = 0;
@@ -5008,6 +5325,12 @@ uint extRCModel::measureWithVar(extMeasure* measure)
     measure->_metExtFlag = true;
   }
 
+  // define_rules_solver -max_error: solved one deck at a time to decide
+  // which spacings still need the solver
+  bool adaptive = _solverMaxError > 0.0 && _readSolver && _runSolver
+                  && _solverJobCnt == 0 && !measure->_diag;
+  _deferAddRC   = adaptive;
+
   for (uint dIndex = 0; dIndex < measure->_dataTable.getCnt(); dIndex++) {
     double r         = measure->_dataTable.get(dIndex);  // layout
     measure->_rIndex = dIndex;
@@ -5036,110 +5359,157 @@ uint extRCModel::measureWithVar(extMeasure* measure)
         w = measure->_widthTable.get(wIndex);  // layout
       measure->_wIndex = wIndex;
 
-      for (uint sIndex = 0; sIndex < scnt; sIndex++) {
-        double s;
-        if (!measure->_diag) {
+      // the plate spacing is no point of the spacing curve
+      uint curveCnt = scnt;
+      if (!measure->_diag && wIndex == wcnt - 1 && !measure->_overUnder)
+        curveCnt = scnt - 1;
+
+      std::vector<char>       solve(scnt, 1);
+      std::vector<char>       solved(scnt, 0);
+      std::vector<double>     sTab(scnt, 0.0);
+      std::vector<extDistRC*> rcTab(scnt, NULL);
+      if (adaptive) {
+        for (uint ii = 0; ii < curveCnt; ii++) {
           if (!dIndex)
-            s = measure->_spaceTable0.get(sIndex);
+            sTab[ii] = measure->_spaceTable0.get(ii);
           else
-            s = measure->_spaceTable.get(sIndex);  // layout
-          if (sIndex == scnt - 1 && wIndex == wcnt - 1 && !measure->_overUnder)
-            measure->_plate = true;
-          else
-            measure->_plate = false;
-        } else
-          s = measure->_diagSpaceTable0.get(sIndex);
-
-        double top_width  = w + 2 * top_ext;
-        double top_widthR = w + 2 * top_ext;
-        double bot_width  = w + 2 * bot_ext;
-        double thickness  = t;
-        double bot_widthR = w + 2 * bot_ext;
-        double thicknessR = t;
-
-        if (r == 0.0) {
-          //					top_width= w;
-          //					top_widthR= w;
-          if (xvar != NULL) {
-            double a = xvar->getP(w);
+            sTab[ii] = measure->_spaceTable.get(ii);
+          solve[ii] = ii % ADAPTIVE_SPACING_STEP == 0 || ii + 2 >= curveCnt;
+        }
+      }
+      do {
+        for (uint sIndex = 0; sIndex < scnt; sIndex++) {
+          if (!solve[sIndex] || solved[sIndex])
+            continue;
+          solved[sIndex] = 1;
+
+          double s;
+          if (!measure->_diag) {
+            if (!dIndex)
+              s = measure->_spaceTable0.get(sIndex);
+            else
+              s = measure->_spaceTable.get(sIndex);  // layout
+            if (sIndex == scnt - 1 && wIndex == wcnt - 1
+                && !measure->_overUnder)
+              measure->_plate = true;
+            else
+              measure->_plate = false;
+          } else
+            s = measure->_diagSpaceTable0.get(sIndex);
+
+          double top_width  = w + 2 * top_ext;
+          double top_widthR = w + 2 * top_ext;
+          double bot_width  = w + 2 * bot_ext;
+          double thickness  = t;
+          double bot_widthR = w + 2 * bot_ext;
+          double thicknessR = t;
+
+          if (r == 0.0) {
+            //					top_width= w;
+            //					top_widthR= w;
+            if (xvar != NULL) {
+              double a = xvar->getP(w);
+              if (a != 0.0)
+                ro = a;
+            }
+            res = measureResistance(
+                measure, ro, top_widthR, bot_widthR, thicknessR);
+          } else if (xvar != NULL && !_maxMinFlag) {
+            uint ss;
+            if (measure->_diag)
+              ss = 5;
+            else {
+              if (sIndex < scnt - 1)
+                ss = sIndex;
+              else
+                ss = scnt - 2;
+            }
+            /*
+                                                    top_width=
+               xvar->getTopWidth(wIndex, sIndex); top_widthR=
+               xvar->getTopWidthR(wIndex, sIndex);
+            */
+            top_width  = xvar->getTopWidth(wIndex, ss);
+            top_widthR = xvar->getTopWidthR(wIndex, ss);
+
+            bot_width = xvar->getBottomWidth(w, dIndex - 1);
+            bot_width = top_width - bot_width;
+
+            thickness = xvar->getThickness(w, dIndex - 1);
+
+            bot_widthR = xvar->getBottomWidthR(w, dIndex - 1);
+            bot_widthR = top_widthR - bot_widthR;
+
+            thicknessR = xvar->getThicknessR(w, dIndex - 1);
+            double a   = xvar->getP(w);
             if (a != 0.0)
               ro = a;
+            res = measureResistance(
+                measure, ro, top_widthR, bot_widthR, thicknessR);
+          } else if (_maxMinFlag && r == 1.0) {
+            top_width = w - 2 * cond->_min_cw_del;
+            thickness = t - cond->_min_ct_del;
+            bot_width = top_width - 2 * thickness * cond->_min_ca;
+            if (bot_width > w)
+              bot_width = w;
+            res = measureResistance(
+                measure, ro, top_widthR, bot_widthR, thicknessR);
+          } else if (_maxMinFlag && r == 2.0) {
+            top_width = w + 2 * cond->_max_cw_del;
+            thickness = t + cond->_max_ct_del;
+            bot_width = top_width - 2 * thickness * cond->_max_ca;
+            if (bot_width < w)
+              bot_width = w;
+            res = measureResistance(
+                measure, ro, top_widthR, bot_widthR, thicknessR);
+          } else if (measure->_thickVarFlag) {
+            thickness *= 1 + r;
+            thicknessR *= 1 + r;
+          } else {
+            continue;
           }
-          res = measureResistance(
-              measure, ro, top_widthR, bot_widthR, thicknessR);
-        } else if (xvar != NULL && !_maxMinFlag) {
-          uint ss;
-          if (measure->_diag)
-            ss = 5;
-          else {
-            if (sIndex < scnt - 1)
-              ss = sIndex;
-            else
-              ss = scnt - 2;
-          }
-          /*
-                                                  top_width=
-             xvar->getTopWidth(wIndex, sIndex); top_widthR=
-             xvar->getTopWidthR(wIndex, sIndex);
-          */
-          top_width  = xvar->getTopWidth(wIndex, ss);
-          top_widthR = xvar->getTopWidthR(wIndex, ss);
-
-          bot_width = xvar->getBottomWidth(w, dIndex - 1);
-          bot_width = top_width - bot_width;
-
-          thickness = xvar->getThickness(w, dIndex - 1);
-
-          bot_widthR = xvar->getBottomWidthR(w, dIndex - 1);
-          bot_widthR = top_widthR - bot_widthR;
-
-          thicknessR = xvar->getThicknessR(w, dIndex - 1);
-          double a   = xvar->getP(w);
-          if (a != 0.0)
-            ro = a;
-          res = measureResistance(
-              measure, ro, top_widthR, bot_widthR, thicknessR);
-        } else if (_maxMinFlag && r == 1.0) {
-          top_width = w - 2 * cond->_min_cw_del;
-          thickness = t - cond->_min_ct_del;
-          bot_width = top_width - 2 * thickness * cond->_min_ca;
-          if (bot_width > w)
-            bot_width = w;
-          res = measureResistance(
-              measure, ro, top_widthR, bot_widthR, thicknessR);
-        } else if (_maxMinFlag && r == 2.0) {
-          top_width = w + 2 * cond->_max_cw_del;
-          thickness = t + cond->_max_ct_del;
-          bot_width = top_width - 2 * thickness * cond->_max_ca;
-          if (bot_width < w)
-            bot_width = w;
-          res = measureResistance(
-              measure, ro, top_widthR, bot_widthR, thicknessR);
-        } else if (measure->_thickVarFlag) {
-          thickness *= 1 + r;
-          thicknessR *= 1 + r;
-        } else {
-          continue;
-        }
 
-        measure->setTargetParams(w, s, r, t, h);
-        measurePatternVar(measure,
-                          top_width,
-                          bot_width,
-                          thickness,
-                          measure->_wireCnt,
-                          NULL,
-                          res * 0.5);
+          measure->_rcValid = false;
+          measure->setTargetParams(w, s, r, t, h);
+          measurePatternVar(measure,
+                            top_width,
+                            bot_width,
+                            thickness,
+                            measure->_wireCnt,
+                            NULL,
+                            res * 0.5);
+          if (adaptive && measure->_rcValid)
+            rcTab[sIndex] = measure->_tmpRC;
+
+          //				measure->setTargetParams(w, s, 0.0, t,
+          // h); 				measurePatternVar(measure, w, w, t,
+          // measure->_wireCnt, "2");
 
-        //				measure->setTargetParams(w, s, 0.0, t,
-        // h); 				measurePatternVar(measure, w, w, t,
-        // measure->_wireCnt, "2");
-
-        cnt++;
+          cnt++;
+        }
+      } while (adaptive
+               && refineSpacingSamples(
+                   solve, rcTab, sTab, curveCnt, _solverMaxError));
+
+      if (adaptive) {
+        // in the order of the spacings, which the interpolation expects
+        for (uint sIndex = 0; sIndex < scnt; sIndex++) {
+          if (!solve[sIndex]) {
+            _adaptiveSkipCnt++;
+            continue;
+          }
+          _adaptiveSolveCnt++;
+          if (rcTab[sIndex] == NULL)
+            continue;
+          measure->_tmpRC = rcTab[sIndex];
+          addRC(measure);
+        }
       }
     }
   }
 
+  _deferAddRC = false;
+
   return cnt;
 }
 void extRCModel::allocOverTable(extMeasure* measure)
@@ -5406,22 +5776,26 @@ uint extMain::metRulesGen(const char* name,
                           uint        met)
 {
   extRCModel* m = _modelTable->get(0);
+  if (sharedRCmodel(m, "metal_rules_gen"))
+    return 0;
 
   m->setOptions(topDir, name, writeFiles, readFiles, runSolver, keepFile, met);
-  if ((pattern > 0) && (pattern <= 9))
-    m->linesOver(pattern, 20, 20, 20, met);
-  else if ((pattern > 10) && (pattern <= 19))
-    m->linesUnder(pattern - 10, 20, 20, 20, met);
-  else if ((pattern > 20) && (pattern <= 29))
-    m->linesOverUnder(pattern - 20, 20, 20, 20, met);
-  else if ((pattern > 30) && (pattern <= 39)) {
-    m->setDiagModel(1);
-    m->linesDiagUnder(pattern - 30, 20, 20, 20, met);
-  } else if ((pattern > 40) && (pattern <= 49)) {
-    m->setDiagModel(2);
-    m->linesDiagUnder(pattern - 40, 20, 20, 20, met);
+  m->setSolverJobs(_solverJobCnt,
+                   _solverCmd.c_str(),
+                   _solverRetryCnt,
+                   _solverCacheDir.c_str());
+  m->setSolverMaxError(_solverMaxError);
+
+  if (m->queueSolverJobs()) {
+    genRulePatterns(m, pattern, met);
+    if (m->runSolverJobs())
+      genRulePatterns(m, pattern, met);
+  } else {
+    genRulePatterns(m, pattern, met);
   }
   m->closeFiles();
+  m->reportSolverCache();
+  m->reportAdaptiveSpacing();
   return 0;
 }
 uint extMain::writeRules(const char* name,
@@ -5438,6 +5812,8 @@ uint extMain::writeRules(const char* name,
 
   if (!readFiles) {
     extRCModel* m = _modelTable->get(0);
+    if (sharedRCmodel(m, "write_rules"))
+      return 0;
 
     m->setOptions(topDir, name, false, true, false, false);
     m->writeRules((char*) rulesFile, false);
@@ -5460,35 +5836,56 @@ uint extMain::rulesGen(const char* name,
                        bool        keepFile)
 {
   extRCModel* m = _modelTable->get(0);
+  if (sharedRCmodel(m, "rules_gen"))
+    return 0;
 
   m->setOptions(topDir, name, writeFiles, readFiles, runSolver, keepFile);
+  m->setSolverJobs(_solverJobCnt,
+                   _solverCmd.c_str(),
+                   _solverRetryCnt,
+                   _solverCacheDir.c_str());
+  m->setSolverMaxError(_solverMaxError);
+
+  if (_solverMetalJobCnt > 0) {
+    genMetalRulePatterns(m, topDir, pattern);
+  } else if (m->queueSolverJobs()) {
+    genRulePatterns(m, pattern, 0);
+    if (m->runSolverJobs())
+      genRulePatterns(m, pattern, 0);
+  } else {
+    genRulePatterns(m, pattern, 0);
+  }
+  m->closeFiles();
+  m->reportSolverCache();
+  m->reportAdaptiveSpacing();
 
+  m->writeRules((char*) rulesFile, false);
+  return 0;
+}
+void extMain::genRulePatterns(extRCModel* m, int pattern, uint met)
+{
   if ((pattern > 0) && (pattern <= 9))
-    m->linesOver(pattern, 20, 20, 20);
+    m->linesOver(pattern, 20, 20, 20, met);
   else if ((pattern > 10) && (pattern <= 19))
-    m->linesUnder(pattern - 10, 20, 20, 20);
+    m->linesUnder(pattern - 10, 20, 20, 20, met);
   else if ((pattern > 20) && (pattern <= 29))
-    m->linesOverUnder(pattern - 20, 20, 20, 20);
+    m->linesOverUnder(pattern - 20, 20, 20, 20, met);
   else if ((pattern > 30) && (pattern <= 39)) {
     m->setDiagModel(1);
-    m->linesDiagUnder(pattern - 30, 20, 20, 20);
+    m->linesDiagUnder(pattern - 30, 20, 20, 20, met);
   } else if ((pattern > 40) && (pattern <= 49)) {
     m->setDiagModel(2);
-    m->linesDiagUnder(pattern - 40, 20, 20, 20);
+    m->linesDiagUnder(pattern - 40, 20, 20, 20, met);
   } else if (pattern > 100) {
-    m->linesOver(pattern % 10, 20, 20, 20);
-    m->linesUnder(pattern % 10, 20, 20, 20);
-    m->linesOverUnder(pattern % 10, 20, 20, 20);
+    m->linesOver(pattern % 10, 20, 20, 20, met);
+    m->linesUnder(pattern % 10, 20, 20, 20, met);
+    m->linesOverUnder(pattern % 10, 20, 20, 20, met);
     if (pattern > 200)
       m->setDiagModel(2);
     else
       m->setDiagModel(1);
-    m->linesDiagUnder(pattern % 10, 20, 20, 20);
+    m->linesDiagUnder(pattern % 10, 20, 20, 20, met);
   }
-  m->closeFiles();
-
-  m->writeRules((char*) rulesFile, false);
-  return 0;
 }
 uint extMain::readProcess(const char* name, const char* filename)
 {
@@ -5515,6 +5912,8 @@ uint extMain::readProcess(const char* name, const char* filename)
 
   p->readProcess(name, (char*) filename);
   p->writeProcess("process.out");
+  _processName = name;
+  _processFile = filename;
 
   // create rc model
 
@@ -5537,11 +5936,6 @@ uint extMain::readExtRules(const char* name,
 
   //	p->readProcess(name, (char *) filename);
 
-  // create rc model
-
-  extRCModel* m = new extRCModel((char*) name);
-  _modelTable->add(m);
-
   uint   cornerTable[10];
   uint   cornerCnt = 0;
   int    dbunit    = _block->getDbUnitsPerMicron();
@@ -5569,26 +5963,15 @@ uint extMain::readExtRules(const char* name,
       _maxModelIndex           = max;
       cornerTable[cornerCnt++] = max;
     }
-    m->readRules((char*) filename,
-                 false,
-                 true,
-                 true,
-                 true,
-                 true,
-                 cornerCnt,
-                 cornerTable,
-                 dbFactor);
-    //		int modelCnt= getRCmodel(0)->getModelCnt();
-  } else {
-    m->readRules((char*) filename,
-                 false,
-                 true,
-                 true,
-                 true,
-                 true,
-                 0,
-                 cornerTable,
-                 dbFactor);
+  }
+  // the model of the file is shared by the extMain instances that read it
+  extRCModel* m = extRCModel::getSharedRules(
+      name, filename, cornerCnt, cornerTable, dbFactor, _rulesFitOrder);
+  if (m == NULL)
+    return 0;
+  _modelTable->add(m);
+
+  if (cornerCnt == 0) {
     int modelCnt   = getRCmodel(0)->getModelCnt();
     _minModelIndex = 0;
     _maxModelIndex = modelCnt - 1;
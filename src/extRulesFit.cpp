@@ -0,0 +1,308 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Compact distance tables of the extraction rules
+//
+// readRules expands every measured distance table into a compute table with
+// one record per 4nm of spacing, which makes most of the memory of a model.
+// With extract_parasitics -compact_rules a table keeps only its measured
+// points and evaluates polynomial pieces between them on lookup: order 1 is
+// the linear interpolation of the compute table and returns the same values,
+// order 3 is a monotone cubic (Fritsch-Carlson) with one slope per point and
+// quantity. verify_compact_rules reads a rules file both ways and reports the
+// largest relative difference against the compute tables.
+
+#include <dbLogger.h>
+#include <math.h>
+#include <string.h>
+
+#include "extRCap.h"
+
+namespace OpenRCX {
+
+using odb::notice;
+using odb::warning;
+
+static double fitValue(extDistRC* rc, uint q)
+{
+  if (q == 0)
+    return rc->getCoupling();
+  if (q == 1)
+    return rc->getFringe();
+  return rc->getRes();
+}
+static double fitSecant(double h, double y1, double y2)
+{
+  if (h <= 0.0)
+    return 0.0;
+  return (y2 - y1) / h;
+}
+uint extDistRCTable::makeFitTable(uint                distUnit,
+                                  uint                order,
+                                  AthPool<extDistRC>* rcPool)
+{
+  if (_measureTable->getCnt() == 0)
+    return 0;
+
+  int maxDist = -1;
+  _unit       = distUnit;
+  _fitOrder   = order;
+  _fitCnt     = getKnotCnt(maxDist, rcPool);
+  if (order != 3 || _fitCnt < 2)
+    return _fitCnt;
+
+  // secants of the pieces, then the slopes at the points
+  double* secant = new double[3 * _fitCnt];
+  for (uint k = 0; k + 1 < _fitCnt; k++) {
+    extDistRC* rc1 = _measureTable->get(k);
+    extDistRC* rc2 = _measureTable->get(k + 1);
+    double     h   = rc2->_sep - rc1->_sep;
+    for (uint q = 0; q < 3; q++)
+      secant[3 * k + q] = fitSecant(h, fitValue(rc1, q), fitValue(rc2, q));
+  }
+  _fitSlope = new double[3 * _fitCnt];
+  for (uint q = 0; q < 3; q++) {
+    for (uint k = 0; k < _fitCnt; k++) {
+      double d1 = k > 0 ? secant[3 * (k - 1) + q] : secant[q];
+      double d2 = k + 1 < _fitCnt ? secant[3 * k + q] : d1;
+
+      double m = 0.5 * (d1 + d2);
+      if (d1 * d2 <= 0.0)  // local extremum
+        m = 0.0;
+      _fitSlope[3 * k + q] = m;
+    }
+    // limit the slopes so that no piece overshoots its end points
+    for (uint k = 0; k + 1 < _fitCnt; k++) {
+      double  d  = secant[3 * k + q];
+      double* m1 = _fitSlope + 3 * k + q;
+      double* m2 = m1 + 3;
+      if (d == 0.0) {
+        *m1 = 0.0;
+        *m2 = 0.0;
+        continue;
+      }
+      double a = *m1 / d;
+      double b = *m2 / d;
+      double r = a * a + b * b;
+      if (r > 9.0) {
+        double t = 3.0 / sqrt(r);
+        *m1      = t * a * d;
+        *m2      = t * b * d;
+      }
+    }
+  }
+  delete[] secant;
+  return _fitCnt;
+}
+// value at the spacing index n of the compute table into the caller's record:
+// the spacing is the one interpolate() stored at n, so order 1 gives the
+// compute table record; false when the compute table has no record at n
+bool extDistRCTable::getFitRC(uint n, extDistRC* rc)
+{
+  if (_fitCnt == 0)
+    return false;
+
+  extDistRC* firstRC = _measureTable->get(0);
+  uint       firstN  = firstRC->_sep / _unit;
+  if (n < firstN || (n == firstN && _fitCnt == 1)) {  // mapExtrapolate
+    rc->set(
+        n * _unit, firstRC->_coupling, firstRC->_fringe, 0.0, firstRC->_res);
+    return true;
+  }
+  if (_fitCnt == 1)
+    return false;
+
+  // the last piece starting at or below n wrote n in the compute table
+  uint lo = 0;
+  uint hi = _fitCnt - 2;
+  while (lo < hi) {
+    uint mid = (lo + hi + 1) / 2;
+    if (_measureTable->get(mid)->_sep / _unit <= n)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  extDistRC* rc1 = _measureTable->get(lo);
+  extDistRC* rc2 = _measureTable->get(lo + 1);
+
+  uint d = rc1->_sep;
+  if (n * _unit > d)
+    d += ((n * _unit - d + _unit - 1) / _unit) * _unit;
+  if ((int) d > rc2->_sep)
+    return false;
+
+  double h = rc2->_sep - rc1->_sep;
+  if (_fitSlope == NULL || h <= 0.0) {
+    rc->interpolate(d, rc1, rc2);
+    rc->_diag = 0.0;
+    return true;
+  }
+  double  t   = ((double) d - rc1->_sep) / h;
+  double  t2  = t * t;
+  double  t3  = t2 * t;
+  double  h00 = 2 * t3 - 3 * t2 + 1;
+  double  h10 = t3 - 2 * t2 + t;
+  double  h01 = 3 * t2 - 2 * t3;
+  double  h11 = t3 - t2;
+  double* m1  = _fitSlope + 3 * lo;
+  double* m2  = m1 + 3;
+
+  double v[3];
+  for (uint q = 0; q < 3; q++)
+    v[q] = h00 * fitValue(rc1, q) + h10 * h * m1[q] + h01 * fitValue(rc2, q)
+           + h11 * h * m2[q];
+
+  rc->set(d, v[0], v[1], 0.0, v[2]);
+  return true;
+}
+void extDistRCTable::compareFitTable(extDistRCTable* dense, extFitStats* stats)
+{
+  if (_fitCnt == 0 || dense->_computeTable == NULL)
+    return;
+
+  stats->_tableCnt++;
+  if (_fitSlope != NULL)
+    stats->_fitBytes += 3 * _fitCnt * sizeof(double);
+
+  extDistRC  fitRC;
+  extDistRC* rc    = &fitRC;
+  uint       lastN = _measureTable->get(_fitCnt - 1)->_sep / _unit;
+  for (uint n = 0; n <= lastN; n++) {
+    if (!getFitRC(n, rc))
+      continue;
+    extDistRC* denseRC = dense->_computeTable->geti(n);
+    if (denseRC == NULL)
+      continue;
+
+    stats->_pointCnt++;
+    stats->_denseBytes += sizeof(extDistRC) + sizeof(extDistRC*);
+
+    for (uint q = 0; q < 3; q++) {
+      double v   = fitValue(denseRC, q);
+      double f   = fitValue(rc, q);
+      double err = 0.0;
+      if (v != 0.0)
+        err = fabs(f - v) / fabs(v);
+      else if (f != 0.0)
+        err = 1.0;
+      if (err > stats->_maxErr[q])
+        stats->_maxErr[q] = err;
+    }
+  }
+}
+void extDistWidthRCTable::compareFitTables(extDistWidthRCTable* dense,
+                                           extFitStats*         stats)
+{
+  uint widthCnt = _widthTable->getCnt();
+  if (_rcDistTable != NULL && dense->_rcDistTable != NULL) {
+    for (uint jj = 0; jj < _metCnt; jj++)
+      for (uint ii = 0; ii < widthCnt; ii++)
+        _rcDistTable[jj][ii]->compareFitTable(dense->_rcDistTable[jj][ii],
+                                              stats);
+  }
+  if (_rcDiagDistTable != NULL && dense->_rcDiagDistTable != NULL) {
+    for (uint jj = 0; jj < _metCnt; jj++)
+      for (uint ii = 0; ii < widthCnt; ii++)
+        for (uint kk = 0; kk < _diagWidthTable[jj]->getCnt(); kk++)
+          for (uint ll = 0; ll < _diagDistTable[jj]->getCnt(); ll++)
+            _rcDiagDistTable[jj][ii][kk][ll]->compareFitTable(
+                dense->_rcDiagDistTable[jj][ii][kk][ll], stats);
+  }
+}
+void extMetRCTable::compareFitTables(extMetRCTable* dense, extFitStats* stats)
+{
+  for (uint ii = 0; ii < _layerCnt && ii < dense->_layerCnt; ii++) {
+    if (_capOver[ii] != NULL && dense->_capOver[ii] != NULL)
+      _capOver[ii]->compareFitTables(dense->_capOver[ii], stats);
+    if (_capUnder[ii] != NULL && dense->_capUnder[ii] != NULL)
+      _capUnder[ii]->compareFitTables(dense->_capUnder[ii], stats);
+    if (_capOverUnder[ii] != NULL && dense->_capOverUnder[ii] != NULL)
+      _capOverUnder[ii]->compareFitTables(dense->_capOverUnder[ii], stats);
+    if (_capDiagUnder[ii] != NULL && dense->_capDiagUnder[ii] != NULL)
+      _capDiagUnder[ii]->compareFitTables(dense->_capDiagUnder[ii], stats);
+  }
+}
+void extRCModel::compareFitTables(extRCModel* dense, extFitStats* stats)
+{
+  for (uint ii = 0; ii < _modelCnt && ii < dense->_modelCnt; ii++)
+    _modelTable[ii]->compareFitTables(dense->_modelTable[ii], stats);
+}
+
+void extMain::setRulesFitOrder(uint order)
+{
+  if (order != 0 && order != 1 && order != 3) {
+    warning(0, "Compact rules order %d is not 1 or 3, ignored\n", order);
+    order = 0;
+  }
+  _rulesFitOrder = order;
+}
+
+bool extMain::verifyCompactRules(const char* filename, uint order)
+{
+  if (order != 1 && order != 3) {
+    warning(0, "Compact rules order %d is not 1 or 3\n", order);
+    return false;
+  }
+  extRCModel* dense = new extRCModel("DENSE");
+  extRCModel* fit   = new extRCModel("COMPACT");
+  fit->setFitOrder(order);
+
+  bool ok = dense->readRules((char*) filename, false, true, true, true, true)
+            && fit->readRules((char*) filename, false, true, true, true, true);
+  if (ok) {
+    extFitStats stats;
+    memset(&stats, 0, sizeof(extFitStats));
+    fit->compareFitTables(dense, &stats);
+
+    notice(0,
+           "Compared %d distance tables at %d spacings of %s\n",
+           stats._tableCnt,
+           stats._pointCnt,
+           filename);
+    notice(0,
+           "Order %d max relative error: coupling %g%%  fringe %g%%  res "
+           "%g%%\n",
+           order,
+           100.0 * stats._maxErr[0],
+           100.0 * stats._maxErr[1],
+           100.0 * stats._maxErr[2]);
+    notice(0,
+           "Compute tables %.1f KB, fit tables %.1f KB\n",
+           stats._denseBytes / 1024,
+           stats._fitBytes / 1024);
+  }
+  delete dense;
+  delete fit;
+  return ok;
+}
+
+}  // namespace OpenRCX
@@ -0,0 +1,256 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Parallel loader of extraction rules files
+//
+// A rules file holds, for every DensityModel, one "Metal N OVER", "UNDER",
+// "DIAGUNDER" and "OVERUNDER" section per metal. The sequential reader goes
+// through all of them in file order and reads the sections of the models
+// not selected by the corner table into a dummy table. readRulesParallel
+// indexes the file offsets of the sections first, then reads only the
+// sections of the selected models on threads. Every section builds its
+// extDistWidthRCTable in a table and a pool of its own; the tables are
+// stitched into the extMetRCTable of their model once all are read.
+
+#include <dbLogger.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <vector>
+
+#include "extRCap.h"
+#include "extUtil.h"
+
+namespace OpenRCX {
+
+using odb::warning;
+
+struct extRulesSection
+{
+  uint           _model;   // index in the model table
+  uint           _met;
+  long           _offset;  // of the Metal line
+  char           _key[16];
+  bool           _over;
+  bool           _under;
+  bool           _diag;
+  extMetRCTable* _rcTable;
+  bool           _read;
+};
+
+struct extRulesJobs
+{
+  extRCModel*                   _model;
+  const char*                   _fileName;
+  std::vector<extRulesSection>* _sections;
+  std::atomic<uint>             _next;
+  bool                          _bin;
+  double                        _dbFactor;
+};
+
+static void readRulesThread(void* arg)
+{
+  extRulesJobs* jobs = (extRulesJobs*) arg;
+  uint ii;
+  while ((ii = jobs->_next++) < jobs->_sections->size()) {
+    extRulesSection* s  = &(*jobs->_sections)[ii];
+    FILE*            fp = fopen(jobs->_fileName, "r");
+    if (fp == NULL)
+      continue;
+
+    if (fseek(fp, s->_offset, SEEK_SET) == 0) {
+      Ath__parser parser;
+      parser.addSeparator("\r");
+      parser.setInputFP(fp);
+
+      Ath__array1D<double>* wTable = NULL;
+      if (parser.parseNextLine() > 0 && parser.isKeyword(0, "Metal")
+          && parser.parseNextLine() > 0)
+        wTable = parser.readDoubleArray("WIDTH", 4);
+
+      if (wTable != NULL) {
+        jobs->_model->readRulesTables(&parser,
+                                      s->_rcTable,
+                                      s->_met,
+                                      wTable,
+                                      s->_key,
+                                      s->_over,
+                                      s->_under,
+                                      jobs->_bin,
+                                      s->_diag,
+                                      jobs->_dbFactor);
+        delete wTable;
+        s->_read = true;
+      }
+    }
+    fclose(fp);
+  }
+}
+
+// index in the model table of DensityModel m, -1 when it is not read
+static int rulesModelIndex(uint m, uint cornerCnt, uint* cornerTable)
+{
+  if (cornerCnt == 0)  // old behavior: the first model only
+    return m == 0 ? 0 : -1;
+
+  for (uint jj = 0; jj < cornerCnt; jj++) {
+    if (m == cornerTable[jj])
+      return jj;
+  }
+  return -1;
+}
+
+bool extRCModel::readRulesParallel(const char* name,
+                                   bool        bin,
+                                   bool        over,
+                                   bool        under,
+                                   bool        overUnder,
+                                   bool        diag,
+                                   uint        cornerCnt,
+                                   uint*       cornerTable,
+                                   double      dbFactor)
+{
+  uint threadCnt = extThreadCnt();
+  if (threadCnt < 2)
+    return false;
+
+  FILE* fp = fopen(name, "r");
+  if (fp == NULL)
+    return false;
+
+  // the section headers have no more words than "Metal N KEY"; the metal
+  // headers inside the sections have the context metals after the key
+  std::vector<extRulesSection> sections;
+
+  int    modelIndex = -1;
+  char*  line       = NULL;
+  size_t lineSize   = 0;
+  long   offset     = ftell(fp);
+  while (getline(&line, &lineSize, fp) > 0) {
+    int  n;
+    char key[16];
+    char more;
+    if (sscanf(line, " DensityModel %d", &n) == 1) {
+      modelIndex = rulesModelIndex(n, cornerCnt, cornerTable);
+    } else if (modelIndex >= 0
+               && sscanf(line, " Metal %d %15s %c", &n, key, &more) == 2) {
+      extRulesSection s;
+      s._model   = modelIndex;
+      s._met     = n;
+      s._offset  = offset;
+      s._over    = false;
+      s._under   = false;
+      s._diag    = false;
+      s._rcTable = NULL;
+      s._read    = false;
+      strcpy(s._key, key);
+
+      if (strcmp(key, "OVER") == 0)
+        s._over = over;
+      else if (strcmp(key, "UNDER") == 0)
+        s._under = under;
+      else if (strcmp(key, "DIAGUNDER") == 0)
+        s._diag = diag;
+      else if (strcmp(key, "OVERUNDER") == 0 && n > 1)
+        s._over = s._under = overUnder;
+
+      if (s._over || s._under || s._diag)
+        sections.push_back(s);
+    }
+    offset = ftell(fp);
+  }
+  free(line);
+  fclose(fp);
+
+  if (sections.empty())
+    return false;
+
+  for (uint ii = 0; ii < sections.size(); ii++) {
+    AthPool<extDistRC>* pool = new AthPool<extDistRC>(false, 1024);
+    _rulesPoolTable.push_back(pool);
+    sections[ii]._rcTable = new extMetRCTable(_layerCnt, pool);
+  }
+
+  extRulesJobs jobs;
+  jobs._model    = this;
+  jobs._fileName = name;
+  jobs._sections = &sections;
+  jobs._next     = 0;
+  jobs._bin      = bin;
+  jobs._dbFactor = dbFactor;
+
+  threadCnt = MIN(threadCnt, (uint) sections.size());
+
+  extRunWorkers(threadCnt, readRulesThread, &jobs);
+
+  for (uint ii = 0; ii < sections.size(); ii++) {
+    extRulesSection* s    = &sections[ii];
+    extMetRCTable*   from = s->_rcTable;
+    extMetRCTable*   to   = _modelTable[s->_model];
+    uint             met  = s->_met;
+
+    if (!s->_read)
+      warning(0,
+              "Cannot read section Metal %d %s of rules file %s\n",
+              met,
+              s->_key,
+              name);
+    if (met < _layerCnt) {
+      if (from->_capOver[met] != NULL) {
+        delete to->_capOver[met];
+        to->_capOver[met]   = from->_capOver[met];
+        from->_capOver[met] = NULL;
+      }
+      if (from->_capUnder[met] != NULL) {
+        delete to->_capUnder[met];
+        to->_capUnder[met]   = from->_capUnder[met];
+        from->_capUnder[met] = NULL;
+      }
+      if (from->_capOverUnder[met] != NULL) {
+        delete to->_capOverUnder[met];
+        to->_capOverUnder[met]   = from->_capOverUnder[met];
+        from->_capOverUnder[met] = NULL;
+      }
+      if (from->_capDiagUnder[met] != NULL) {
+        delete to->_capDiagUnder[met];
+        to->_capDiagUnder[met]   = from->_capDiagUnder[met];
+        from->_capDiagUnder[met] = NULL;
+      }
+    }
+    delete from;
+  }
+  return true;
+}
+
+}  // namespace OpenRCX
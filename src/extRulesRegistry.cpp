@@ -0,0 +1,156 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Process-wide registry of extraction rules models
+//
+// Every extMain reads its rules file into a model of its own: the blocks
+// of a tiled flow and the blocks of a batch script read the same file over
+// and over. getSharedRules keeps the models read from rules files, keyed by
+// the file identity and modification time, the selected corners, the db
+// unit factor and the table fit order, and hands the same model to every
+// extMain asking for the same key. A shared model is read only; the bench
+// and rules generation commands refuse to work on one. The extMain
+// instances count their references and the last one to release a model
+// deletes it.
+//
+// The lock only guards the table. A file is parsed outside of it, with its
+// entry marked as loading: the callers asking for the same key wait for it,
+// the others go on.
+
+#include <dbLogger.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "extRCap.h"
+
+namespace OpenRCX {
+
+using odb::notice;
+using odb::warning;
+
+// a NULL model is being read
+static std::mutex                         sharedRulesLock;
+static std::condition_variable            sharedRulesRead;
+static std::map<std::string, extRCModel*> sharedRulesTable;
+
+extRCModel* extRCModel::getSharedRules(const char* name,
+                                       const char* fileName,
+                                       uint        cornerCnt,
+                                       uint*       cornerTable,
+                                       double      dbFactor,
+                                       uint        fitOrder)
+{
+  struct stat st;
+  if (stat(fileName, &st) != 0) {
+    warning(0, "Cannot open extraction rules file %s\n", fileName);
+    return NULL;
+  }
+
+  char key[1024];
+  int  n = sprintf(key,
+                   "%llu:%llu:%lld:%lld:%g:%d:",
+                   (unsigned long long) st.st_dev,
+                   (unsigned long long) st.st_ino,
+                   (long long) st.st_mtime,
+                   (long long) st.st_size,
+                   dbFactor,
+                   fitOrder);
+  for (uint ii = 0; ii < cornerCnt && n < 1000; ii++)
+    n += sprintf(key + n, " %d", cornerTable[ii]);
+
+  std::unique_lock<std::mutex> lock(sharedRulesLock);
+
+  std::map<std::string, extRCModel*>::iterator it;
+  while ((it = sharedRulesTable.find(key)) != sharedRulesTable.end()
+         && it->second == NULL)
+    sharedRulesRead.wait(lock);
+  if (it != sharedRulesTable.end()) {
+    it->second->_sharedRefCnt++;
+    notice(0, "Reusing extraction model file %s\n", fileName);
+    return it->second;
+  }
+  sharedRulesTable[key] = NULL;
+  lock.unlock();
+
+  extRCModel* m = new extRCModel(name);
+  m->setFitOrder(fitOrder);
+  if (!m->readRules((char*) fileName,
+                    false,
+                    true,
+                    true,
+                    true,
+                    true,
+                    cornerCnt,
+                    cornerTable,
+                    dbFactor)) {
+    delete m;
+    m = NULL;
+  }
+
+  lock.lock();
+  if (m == NULL)
+    sharedRulesTable.erase(key);
+  else {
+    m->_sharedRefCnt      = 1;
+    sharedRulesTable[key] = m;
+  }
+  sharedRulesRead.notify_all();
+  return m;
+}
+
+void extRCModel::releaseSharedRules(extRCModel* m)
+{
+  if (m == NULL)
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(sharedRulesLock);
+
+    if (m->_sharedRefCnt == 0 || --m->_sharedRefCnt > 0)
+      return;
+    std::map<std::string, extRCModel*>::iterator it;
+    for (it = sharedRulesTable.begin(); it != sharedRulesTable.end(); ++it) {
+      if (it->second == m) {
+        sharedRulesTable.erase(it);
+        break;
+      }
+    }
+  }
+  delete m;
+}
+
+}  // namespace OpenRCX
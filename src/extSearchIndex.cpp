@@ -0,0 +1,412 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Extraction search index sidecar
+//
+// Before its sweep couplingFlow decodes every signal wire twice, once to
+// count the wires and once for the net bboxes of the signal tables.
+// extract_parasitics -index_file saves those results next to the db:
+//
+//   header  "RCXIDX02", uint32 version, uint32 record count,
+//           uint64 stamp, uint32 block net count, uint32 signal wire count,
+//           uint32 max wire width, uint32 flags
+//   nets    per signal net with wires: uint32 id, uint32 shape count,
+//           int32 xMin yMin xMax yMax
+//
+// The net bboxes are only collected by runs that build signal tables
+// (-signal_table 1 or 2); flag 1 tells they are present.
+//
+// Writing the file also stores a fresh random stamp on the block as the
+// string property _rcxIndexStamp. The file is used when the block carries
+// the same stamp, has the same number of nets and no signal net has its
+// wireAltered flag set; odb sets that flag on every wire edit and the
+// extraction clears it, so the check costs one pass over the nets instead
+// of reading their wires. Clearing a set flag (extraction, net cache or
+// binary parasitics restore) drops the stamp, unless the same extraction
+// just wrote the index. The db has to be saved after the run for the
+// stamp to outlive the session. The power wires are cheap to walk and are
+// always counted. The search grid and the ground planes are filled band by
+// band during the sweep, so they are not part of the file.
+
+#include <dbLogger.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include <string>
+#include <vector>
+
+#include "extRCap.h"
+#include "extUtil.h"
+
+namespace OpenRCX {
+
+using odb::dbNet;
+using odb::dbProperty;
+using odb::dbSBox;
+using odb::dbSet;
+using odb::dbSigType;
+using odb::dbStringProperty;
+using odb::dbSWire;
+using odb::dbWire;
+using odb::notice;
+using odb::Rect;
+using odb::warning;
+
+static const char     IDX_MAGIC[8] = {'R', 'C', 'X', 'I', 'D', 'X', '0', '2'};
+static const uint32_t IDX_VERSION  = 2;
+static const uint32_t IDX_HAS_NETS = 1;
+
+struct extSearchIndexHeader
+{
+  char     _magic[8];
+  uint32_t _version;
+  uint32_t _netCnt;
+  uint64_t _stamp;
+  uint32_t _blockNetCnt;
+  uint32_t _signalWireCnt;
+  uint32_t _maxWidth;
+  uint32_t _flags;
+};
+
+struct extSearchIndexNet
+{
+  uint32_t _id;
+  uint32_t _shapeCnt;
+  int32_t  _box[4];
+};
+
+class extSearchIndex
+{
+ public:
+  extSearchIndex()
+  {
+    _map        = NULL;
+    _mapSize    = 0;
+    _mappedNets = NULL;
+    _loaded     = false;
+    _counted    = false;
+  }
+  ~extSearchIndex();
+
+  extSearchIndexHeader           _header;
+  bool                           _loaded;
+  bool                           _counted;  // recording: counts are set
+  void*                          _map;
+  size_t                         _mapSize;
+  extSearchIndexNet*             _mappedNets;
+  std::vector<extSearchIndexNet> _nets;  // recorded
+  std::vector<int>               _byId;  // loaded: record index + 1
+};
+
+extSearchIndex::~extSearchIndex()
+{
+#ifndef _WIN32
+  if (_map)
+    munmap(_map, _mapSize);
+#endif
+}
+
+void extMain::hashSWires(extHash& h, dbNet* net)
+{
+  dbSet<dbSWire>           swires = net->getSWires();
+  dbSet<dbSWire>::iterator itr;
+  for (itr = swires.begin(); itr != swires.end(); ++itr) {
+    dbSet<dbSBox>           wires = (*itr)->getWires();
+    dbSet<dbSBox>::iterator box_itr;
+    for (box_itr = wires.begin(); box_itr != wires.end(); ++box_itr) {
+      dbSBox* s      = *box_itr;
+      int     box[5] = {s->xMin(), s->yMin(), s->xMax(), s->yMax(), 0};
+      if (!s->isVia())
+        box[4] = s->getTechLayer()->getRoutingLevel();
+      h.add(box, sizeof(box));
+    }
+  }
+}
+
+// Checksum of the raw wire data of the signal nets and the sboxes of the
+// power nets; cheaper than decoding the shapes, for keys that must follow
+// the wires themselves rather than their wireAltered flags
+uint64_t extMain::wireChecksum()
+{
+  extHash                    h;
+  std::vector<int>           data;
+  std::vector<unsigned char> opcodes;
+
+  dbSet<dbNet>           nets = _block->getNets();
+  dbSet<dbNet>::iterator net_itr;
+  for (net_itr = nets.begin(); net_itr != nets.end(); ++net_itr) {
+    dbNet* net = *net_itr;
+    uint   id  = net->getId();
+    h.add(&id, sizeof(id));
+
+    if ((net->getSigType() == dbSigType::POWER)
+        || (net->getSigType() == dbSigType::GROUND)) {
+      hashSWires(h, net);
+      continue;
+    }
+    dbWire* wire = net->getWire();
+    if (wire == NULL)
+      continue;
+    wire->getRawWireData(data, opcodes);
+    if (data.size())
+      h.add(&data[0], data.size() * sizeof(int));
+    if (opcodes.size())
+      h.add(&opcodes[0], opcodes.size());
+  }
+  return h._h;
+}
+
+static const char* IDX_STAMP_PROP = "_rcxIndexStamp";
+
+// Stamp of the last index written for the block, 0 if there is none or the
+// wires changed since.
+uint64_t extMain::searchIndexStamp()
+{
+  dbProperty* p = dbProperty::find(_block, IDX_STAMP_PROP);
+  if (p == NULL || p->getType() != dbProperty::STRING_PROP)
+    return 0;
+  unsigned long long stamp = 0;
+  std::string        val   = ((dbStringProperty*) p)->getValue();
+  if (sscanf(val.c_str(), "%llx", &stamp) != 1)
+    return 0;
+
+  dbSet<dbNet>           nets = _block->getNets();
+  dbSet<dbNet>::iterator net_itr;
+  for (net_itr = nets.begin(); net_itr != nets.end(); ++net_itr) {
+    dbNet* net = *net_itr;
+    if ((net->getSigType() == dbSigType::POWER)
+        || (net->getSigType() == dbSigType::GROUND))
+      continue;
+    if (net->isWireAltered())
+      return 0;
+  }
+  return stamp;
+}
+
+void extMain::setSearchIndexStamp(uint64_t stamp)
+{
+  char val[32];
+  sprintf(val, "%016llx", (unsigned long long) stamp);
+  dbProperty* p = dbProperty::find(_block, IDX_STAMP_PROP);
+  if (p != NULL && p->getType() == dbProperty::STRING_PROP)
+    ((dbStringProperty*) p)->setValue(val);
+  else {
+    if (p != NULL)
+      dbProperty::destroy(p);
+    dbStringProperty::create(_block, IDX_STAMP_PROP, val);
+  }
+}
+
+// Clears the wireAltered flag of net. An edit the flag records is not in
+// an index written before it, so the stamp of that index goes too;
+// otherwise a run that clears the flags would make a stale index look
+// current. An index the running extraction wrote already has the edit.
+void extMain::clearWireAltered(dbNet* net)
+{
+  if (net->isWireAltered() && !_searchIndexWritten) {
+    dbProperty* p = dbProperty::find(_block, IDX_STAMP_PROP);
+    if (p != NULL)
+      dbProperty::destroy(p);
+  }
+  net->setWireAltered(false);
+}
+
+void extMain::setSearchIndexFile(const char* file)
+{
+  _searchIndexFile = file;
+}
+
+bool extMain::openSearchIndex()
+{
+  closeSearchIndex();
+  _searchIndexWritten = false;
+  if (_searchIndexFile == NULL || _searchIndexFile[0] == '\0')
+    return false;
+#ifdef _WIN32
+  return false;
+#else
+  _searchIndex = new extSearchIndex();
+  extSearchIndex* idx = _searchIndex;
+
+  memset(&idx->_header, 0, sizeof(idx->_header));
+  memcpy(idx->_header._magic, IDX_MAGIC, sizeof(IDX_MAGIC));
+  idx->_header._version     = IDX_VERSION;
+  idx->_header._blockNetCnt = _block->getNets().size();
+
+  uint64_t stamp = searchIndexStamp();
+  if (stamp == 0)
+    return false;
+
+  int fd = open(_searchIndexFile, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0
+      || st.st_size < (off_t) sizeof(extSearchIndexHeader)) {
+    close(fd);
+    return false;
+  }
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return false;
+
+  extSearchIndexHeader* hdr = (extSearchIndexHeader*) map;
+  size_t                size
+      = sizeof(extSearchIndexHeader) + hdr->_netCnt * sizeof(extSearchIndexNet);
+  if (memcmp(hdr->_magic, IDX_MAGIC, sizeof(IDX_MAGIC)) != 0
+      || hdr->_version != IDX_VERSION
+      || hdr->_stamp != stamp
+      || hdr->_blockNetCnt != idx->_header._blockNetCnt
+      || size != (size_t) st.st_size) {
+    munmap(map, st.st_size);
+    notice(0, "Search index %s is out of date\n", _searchIndexFile);
+    return false;
+  }
+  idx->_map        = map;
+  idx->_mapSize    = st.st_size;
+  idx->_mappedNets = (extSearchIndexNet*) (hdr + 1);
+  idx->_header     = *hdr;
+  idx->_loaded     = true;
+
+  extSearchIndexNet* nets = idx->_mappedNets;
+  for (uint ii = 0; ii < hdr->_netCnt; ii++) {
+    if (nets[ii]._id >= idx->_byId.size())
+      idx->_byId.resize(nets[ii]._id + 1, 0);
+    idx->_byId[nets[ii]._id] = ii + 1;
+  }
+  notice(0, "Using search index %s: %d nets\n", _searchIndexFile, hdr->_netCnt);
+  return true;
+#endif
+}
+
+bool extMain::getIndexedWireCounts(uint& signalCnt, uint& maxWidth)
+{
+  if (_searchIndex == NULL || !_searchIndex->_loaded)
+    return false;
+  signalCnt = _searchIndex->_header._signalWireCnt;
+  maxWidth  = _searchIndex->_header._maxWidth;
+  return true;
+}
+
+void extMain::setIndexedWireCounts(uint signalCnt, uint maxWidth)
+{
+  if (_searchIndex == NULL || _searchIndex->_loaded)
+    return;
+  _searchIndex->_header._signalWireCnt = signalCnt;
+  _searchIndex->_header._maxWidth      = maxWidth;
+  _searchIndex->_counted               = true;
+}
+
+uint extMain::getIndexedNetBbox(dbNet* net, Rect& maxRect)
+{
+  if (_searchIndex == NULL)
+    return getNetBbox(net, maxRect);
+
+  extSearchIndex* idx = _searchIndex;
+  uint            id  = net->getId();
+  if (idx->_loaded) {
+    if (!(idx->_header._flags & IDX_HAS_NETS))
+      return getNetBbox(net, maxRect);
+    if (id >= idx->_byId.size() || idx->_byId[id] == 0)
+      return 0;
+    extSearchIndexNet* rec = idx->_mappedNets + idx->_byId[id] - 1;
+    maxRect.reset(rec->_box[0], rec->_box[1], rec->_box[2], rec->_box[3]);
+    return rec->_shapeCnt;
+  }
+  idx->_header._flags |= IDX_HAS_NETS;
+  uint cnt = getNetBbox(net, maxRect);
+  if (cnt > 0) {
+    extSearchIndexNet rec;
+    rec._id       = id;
+    rec._shapeCnt = cnt;
+    rec._box[0]   = maxRect.xMin();
+    rec._box[1]   = maxRect.yMin();
+    rec._box[2]   = maxRect.xMax();
+    rec._box[3]   = maxRect.yMax();
+    idx->_nets.push_back(rec);
+  }
+  return cnt;
+}
+
+void extMain::closeSearchIndex()
+{
+  extSearchIndex* idx = _searchIndex;
+  if (idx == NULL)
+    return;
+  _searchIndex = NULL;
+
+  if (!idx->_loaded && idx->_counted) {
+    idx->_header._netCnt = idx->_nets.size();
+
+    uint64_t seed[3]
+        = {(uint64_t) time(NULL), (uint64_t) getpid(), (uint64_t) (size_t) idx};
+    extHash h;
+    h.add(seed, sizeof(seed));
+    uint64_t stamp = h._h;
+    if (stamp == 0)
+      stamp = 1;
+    idx->_header._stamp = stamp;
+
+    FILE* fp = fopen(_searchIndexFile, "wb");
+    if (fp == NULL
+        || fwrite(&idx->_header, sizeof(idx->_header), 1, fp) != 1
+        || (idx->_nets.size() > 0
+            && fwrite(&idx->_nets[0],
+                      sizeof(extSearchIndexNet),
+                      idx->_nets.size(),
+                      fp)
+                   != idx->_nets.size())) {
+      warning(0, "Can not write search index %s\n", _searchIndexFile);
+    } else {
+      setSearchIndexStamp(stamp);
+      _searchIndexWritten = true;
+      notice(0,
+             "Wrote search index %s: %d nets\n",
+             _searchIndexFile,
+             idx->_header._netCnt);
+    }
+    if (fp)
+      fclose(fp);
+  }
+  delete idx;
+}
+
+}  // namespace OpenRCX
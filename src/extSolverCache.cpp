@@ -0,0 +1,450 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Solver result cache for rules generation
+//
+// Many pattern decks of rules_gen and metal_rules_gen repeat: metals with
+// the same stack cross-section give the same decks up to the metal numbers
+// and a vertical offset, and a rerun after a small process change rewrites
+// mostly unchanged ones. With define_rules_solver -cache dir every solver
+// output is kept in dir under a key hashed from the normalized deck, the
+// solver options and the solver command.
+//
+// The deck is normalized before hashing: the "$" comment lines, which carry
+// the pattern directory, and the white space layout are left out, the
+// params are replaced by their values, the metals of the "M<n>_" names are
+// renumbered in the order they first appear and every y is taken relative
+// to the bottom of the lowest wire. The cache entries hold the outputs with
+// the renumbered names; on a hit the entry is copied next to the deck with
+// the names of the deck.
+
+#include <dbLogger.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "extRCap.h"
+#include "extUtil.h"
+
+namespace OpenRCX {
+
+using odb::notice;
+using odb::warning;
+
+// Metal number of an "M<n>_" name starting at p, -1 if there is none there.
+static int deckMetalAt(const char* line, const char* p, const char** end)
+{
+  if (*p != 'M' || !isdigit(p[1]))
+    return -1;
+  if (p > line && (isalnum(p[-1]) || p[-1] == '_'))
+    return -1;
+  char* e;
+  long  met = strtol(p + 1, &e, 10);
+  if (*e != '_')
+    return -1;
+  *end = e;
+  return (int) met;
+}
+
+// Renumbers the metals of the "M<n>_" names: to the order of metals, or
+// back to the deck metals with toDeck.
+static std::string renumberMetals(const char*             line,
+                                  const std::vector<int>& metals,
+                                  bool                    toDeck)
+{
+  std::string s;
+  for (const char* p = line; *p != '\0';) {
+    const char* e;
+    int         met = deckMetalAt(line, p, &e);
+    if (met < 0) {
+      s += *p++;
+      continue;
+    }
+    int to = -1;
+    if (toDeck) {
+      if (met >= 1 && met <= (int) metals.size())
+        to = metals[met - 1];
+    } else {
+      for (uint ii = 0; ii < metals.size() && to < 0; ii++) {
+        if (metals[ii] == met)
+          to = ii + 1;
+      }
+    }
+    if (to < 0) {
+      s.append(p, e - p);
+    } else {
+      char buf[16];
+      sprintf(buf, "M%d", to);
+      s += buf;
+    }
+    p = e;
+  }
+  return s;
+}
+
+// Reads the deck without its comment lines, with its white space collapsed
+// and none around '=', ',' and ';', and the metals in the order they first
+// appear.
+static bool readSolverDeck(const char*               deck,
+                           std::vector<std::string>& lines,
+                           std::vector<int>&         metals)
+{
+  FILE* fp = fopen(deck, "r");
+  if (fp == NULL)
+    return false;
+
+  char line[16384];
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    const char* p = line;
+    while (isspace(*p))
+      p++;
+    if (*p == '\0' || *p == '$')
+      continue;
+
+    std::string s;
+    bool        space = false;
+    for (; *p != '\0'; p++) {
+      if (isspace(*p)) {
+        space = true;
+        continue;
+      }
+      bool sep = *p == '=' || *p == ',' || *p == ';';
+      if (space && !sep && !s.empty() && s[s.size() - 1] != '='
+          && s[s.size() - 1] != ',' && s[s.size() - 1] != ';')
+        s += ' ';
+      s += *p;
+      space = false;
+    }
+    for (const char* q = s.c_str(); *q != '\0'; q++) {
+      const char* e;
+      int         met = deckMetalAt(s.c_str(), q, &e);
+      if (met < 0)
+        continue;
+      uint ii = 0;
+      while (ii < metals.size() && metals[ii] != met)
+        ii++;
+      if (ii == metals.size())
+        metals.push_back(met);
+      q = e - 1;
+    }
+    lines.push_back(s);
+  }
+  fclose(fp);
+  return true;
+}
+
+// number, name of a param, or number*name
+static bool deckValue(const std::string&             v,
+                      std::map<std::string, double>& params,
+                      double&                        val)
+{
+  char* e;
+  val = strtod(v.c_str(), &e);
+  if (e != v.c_str() && *e == '\0')
+    return true;
+
+  double      coef = 1.0;
+  std::string name = v;
+  size_t      star = v.find('*');
+  if (star != std::string::npos) {
+    coef = strtod(v.c_str(), &e);
+    if (e != v.c_str() + star)
+      return false;
+    name = v.substr(star + 1);
+  }
+  std::map<std::string, double>::iterator it = params.find(name);
+  if (it == params.end())
+    return false;
+  val = coef * it->second;
+  return true;
+}
+
+// value of the first "key=" of a line that is not part of a longer key
+static bool deckKeyValue(const std::string&             line,
+                         const char*                    key,
+                         std::map<std::string, double>& params,
+                         double&                        val)
+{
+  size_t p = line.find(key);
+  while (p != std::string::npos && p > 0
+         && (isalnum(line[p - 1]) || line[p - 1] == '_'))
+    p = line.find(key, p + 1);
+  if (p == std::string::npos)
+    return false;
+  p += strlen(key);
+  return deckValue(line.substr(p, line.find(';', p) - p), params, val);
+}
+
+// Rewrites a field of a deck line, the text between two ';': params are
+// replaced by their values and the y values are moved by -y0.
+static std::string normDeckField(const std::string&             f,
+                                 std::map<std::string, double>& params,
+                                 double                         y0,
+                                 double*                        yMin)
+{
+  size_t      eq     = f.rfind('=');
+  std::string prefix = eq == std::string::npos ? "" : f.substr(0, eq + 1);
+  std::string v      = eq == std::string::npos ? f : f.substr(eq + 1);
+
+  char   buf[64];
+  double x, y;
+  int    n = 0;
+  if (v.find(',') != std::string::npos) {
+    if (sscanf(v.c_str(), "%lf,%lf%n", &x, &y, &n) != 2
+        || n != (int) v.size())
+      return f;
+    if (yMin != NULL && y < *yMin)
+      *yMin = y;
+    sprintf(buf, "%.4f,%.4f", x, y - y0);
+    return prefix + buf;
+  }
+  if (eq == std::string::npos || !deckValue(v, params, x))
+    return f;
+
+  size_t k = prefix.size() - 1;
+  while (k > 0 && (isalnum(prefix[k - 1]) || prefix[k - 1] == '_'))
+    k--;
+  std::string key = prefix.substr(k, prefix.size() - 1 - k);
+  if (key == "Y1" || key == "Y2" || key == "CY")
+    x -= y0;
+  sprintf(buf, "%.6g", x);
+  return prefix + buf;
+}
+
+static std::string normDeckLine(const std::string&             line,
+                                std::map<std::string, double>& params,
+                                double                         y0,
+                                double*                        yMin)
+{
+  std::string s;
+  size_t      start = 0;
+  while (start <= line.size()) {
+    size_t end = line.find(';', start);
+    if (end == std::string::npos)
+      end = line.size();
+    s += normDeckField(line.substr(start, end - start), params, y0, yMin);
+    if (end < line.size())
+      s += ';';
+    start = end + 1;
+  }
+  return s;
+}
+
+// the name of a wire conductor, as "M<n>_w<k>"
+static bool deckWireLine(const std::string& line)
+{
+  size_t name = line.find("NAME=");
+  if (name == std::string::npos || line.find("VOLT=") == std::string::npos)
+    return false;
+  const char* p = line.c_str() + name + 5;
+  const char* e;
+  return deckMetalAt(line.c_str(), p, &e) >= 0 && e[1] == 'w';
+}
+
+uint64_t extRCModel::solverDeckKey(const char*       dir,
+                                   const char*       file,
+                                   const char*       option,
+                                   std::vector<int>& metals)
+{
+  char deck[4096];
+  snprintf(deck, sizeof(deck), "%s/%s", dir, file);
+
+  std::vector<std::string> lines;
+  metals.clear();
+  if (!readSolverDeck(deck, lines, metals))
+    return 0;
+
+  std::map<std::string, double> params;
+  for (uint ii = 0; ii < lines.size(); ii++) {
+    char   name[256];
+    double v;
+    if (sscanf(lines[ii].c_str(), "param %255[^=]=%lf", name, &v) == 2)
+      params[name] = v;
+  }
+  double y0 = 1.0e+30;
+  for (uint ii = 0; ii < lines.size(); ii++) {
+    if (!deckWireLine(lines[ii]))
+      continue;
+    double cy, h;
+    if (lines[ii].compare(0, 4, "BOX ") != 0)
+      normDeckLine(lines[ii], params, 0.0, &y0);
+    else if (deckKeyValue(lines[ii], "CY=", params, cy)
+             && deckKeyValue(lines[ii], "H=", params, h))
+      y0 = MIN(y0, cy - 0.5 * h);
+  }
+  if (y0 > 1.0e+29)
+    y0 = 0.0;
+
+  extHash key;
+  key.add("deck2", 5);
+  key.add(_solverCmd.c_str());
+  key.add(option);
+
+  for (uint ii = 0; ii < lines.size(); ii++) {
+    if (lines[ii].compare(0, 6, "param ") == 0)
+      continue;
+    std::string s = normDeckLine(
+        renumberMetals(lines[ii].c_str(), metals, false), params, y0, NULL);
+    key.add(s.c_str(), s.size());
+    key.add("\n", 1);
+  }
+  return key._h != 0 ? key._h : 1;
+}
+
+// Copies a solver output with its metals renumbered.
+static bool copySolverOutput(const char*             src,
+                             FILE*                   out,
+                             const std::vector<int>& metals,
+                             bool                    toDeck)
+{
+  FILE* in = fopen(src, "r");
+  if (in == NULL)
+    return false;
+  char line[16384];
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), in) != NULL) {
+    std::string s = renumberMetals(line, metals, toDeck);
+    ok            = fwrite(s.c_str(), 1, s.size(), out) == s.size();
+  }
+  fclose(in);
+  return ok;
+}
+
+bool extRCModel::readSolverCache(const char* dir,
+                                 const char* file,
+                                 const char* option,
+                                 uint64_t&   key)
+{
+  key = 0;
+  if (_solverCacheDir.empty())
+    return false;
+
+  std::vector<int> metals;
+  key = solverDeckKey(dir, file, option, metals);
+  if (key == 0)
+    return false;
+
+  char entry[4096];
+  char out[4096];
+  snprintf(entry,
+           sizeof(entry),
+           "%s/%016llx.out",
+           _solverCacheDir.c_str(),
+           (unsigned long long) key);
+  snprintf(out, sizeof(out), "%s/%s.out", dir, file);
+
+  FILE* fp = NULL;
+  bool  ok = access(entry, R_OK) == 0 && (fp = fopen(out, "w")) != NULL
+            && copySolverOutput(entry, fp, metals, true);
+  if (fp != NULL && fclose(fp) != 0)
+    ok = false;
+  if (!ok) {
+    if (fp != NULL)
+      remove(out);
+    _solverCacheMissCnt++;
+    return false;
+  }
+  if (_logFP != NULL)
+    fprintf(_logFP,
+            "solver cache %016llx %s\n",
+            (unsigned long long) key,
+            dir);
+  _solverCacheHitCnt++;
+  return true;
+}
+
+void extRCModel::saveSolverCache(const char* dir,
+                                 const char* file,
+                                 uint64_t    key)
+{
+  if (key == 0 || !solverOutputValid(dir, file))
+    return;
+
+  char deck[4096];
+  char entry[4096];
+  char out[4096];
+  char tmp[4200];
+  snprintf(deck, sizeof(deck), "%s/%s", dir, file);
+  snprintf(entry,
+           sizeof(entry),
+           "%s/%016llx.out",
+           _solverCacheDir.c_str(),
+           (unsigned long long) key);
+  snprintf(out, sizeof(out), "%s/%s.out", dir, file);
+
+  std::vector<std::string> lines;
+  std::vector<int>         metals;
+  if (!readSolverDeck(deck, lines, metals))
+    return;
+
+  // write aside and rename, so concurrent runs and the metal threads of one
+  // run never read a partial entry
+  snprintf(tmp, sizeof(tmp), "%s.XXXXXX", entry);
+  int fd = mkstemp(tmp);
+  if (fd < 0) {
+    warning(0, "Can not save solver cache entry %s\n", entry);
+    return;
+  }
+  fchmod(fd, 0644);  // the cache can be shared, mkstemp makes it private
+  FILE* fp = fdopen(fd, "w");
+  bool  ok = fp != NULL && copySolverOutput(out, fp, metals, false);
+  if (fp != NULL) {
+    if (fclose(fp) != 0)
+      ok = false;
+  } else {
+    close(fd);
+  }
+  if (!ok || rename(tmp, entry) != 0) {
+    warning(0, "Can not save solver cache entry %s\n", entry);
+    remove(tmp);
+  }
+}
+
+void extRCModel::reportSolverCache()
+{
+  if (_solverCacheDir.empty())
+    return;
+
+  notice(0,
+         "Solver cache: %d decks from cache, %d solved\n",
+         _solverCacheHitCnt,
+         _solverCacheMissCnt);
+}
+
+}  // namespace OpenRCX
@@ -0,0 +1,457 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Solver jobs for rules generation
+//
+// Without jobs every pattern of rules_gen, metal_rules_gen and bench_wires
+// writes its deck, runs the field solver on it and reads the result back
+// before the next pattern is written. With define_rules_solver -jobs the
+// pattern loops are run twice: the first pass only writes the decks and
+// queues one job per deck, the jobs are run by a pool of solver processes
+// and a job whose process fails or leaves no usable output is run again,
+// up to -retries times. The second pass walks the same patterns without
+// writing and reads every .out file back through readCapacitanceBench, so
+// the tables are built in the same order as with the serial flow.
+//
+// The solver command is a template: {options} is replaced by the solver
+// options of the pattern, {deck} by the deck file, {out} by the output file
+// and {dir} by the pattern directory. The commands "builtin" and "stub" run
+// in threads of this process instead of solver processes; the stub writes an
+// output in the solver format with caps made up from the wire geometry of a
+// 2D deck, for testing the flow.
+
+#include <dbLogger.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "extRCap.h"
+
+namespace OpenRCX {
+
+using odb::notice;
+using odb::warning;
+
+static const char* SOLVER_CMD_DEFAULT = "ca raphael {options} {deck} -o {out}";
+
+void extMain::setRulesSolver(uint        jobCnt,
+                             const char* cmd,
+                             uint        retryCnt,
+                             const char* cacheDir,
+                             uint        metalJobCnt,
+                             double      maxError)
+{
+  _solverJobCnt      = jobCnt;
+  _solverRetryCnt    = retryCnt;
+  _solverCmd         = cmd != NULL ? cmd : "";
+  _solverCacheDir    = cacheDir != NULL ? cacheDir : "";
+  _solverMetalJobCnt = metalJobCnt;
+  _solverMaxError    = maxError;
+
+  if (_solverJobCnt > 0)
+    notice(0,
+           "Rules solver: %d jobs, %d retries, command \"%s\"\n",
+           _solverJobCnt,
+           _solverRetryCnt,
+           _solverCmd.empty() ? SOLVER_CMD_DEFAULT : _solverCmd.c_str());
+  if (!_solverCacheDir.empty())
+    notice(0, "Rules solver cache: %s\n", _solverCacheDir.c_str());
+  if (_solverMetalJobCnt > 0)
+    notice(0, "Rules generation: %d metals at a time\n", _solverMetalJobCnt);
+  if (_solverMaxError > 0.0)
+    notice(0, "Rules generation: %g%% spacing error budget\n", _solverMaxError);
+}
+
+void extRCModel::setSolverJobs(uint        jobCnt,
+                               const char* cmd,
+                               uint        retryCnt,
+                               const char* cacheDir)
+{
+  _solverJobCnt   = jobCnt;
+  _solverRetryCnt = retryCnt;
+  _solverCmd      = cmd != NULL ? cmd : "";
+  _solverCacheDir = cacheDir != NULL ? cacheDir : "";
+
+  _solverCacheHitCnt  = 0;
+  _solverCacheMissCnt = 0;
+  if (!_solverCacheDir.empty())
+    mkdir(_solverCacheDir.c_str(), 0777);  // the parent has to exist
+}
+
+void extRCModel::setSolverMaxError(double maxError)
+{
+  _solverMaxError   = maxError;
+  _adaptiveSolveCnt = 0;
+  _adaptiveSkipCnt  = 0;
+}
+
+void extRCModel::reportAdaptiveSpacing()
+{
+  if (_solverMaxError <= 0.0)
+    return;
+
+  notice(0,
+         "Adaptive spacing: %d decks solved, %d skipped within %g%%\n",
+         _adaptiveSolveCnt,
+         _adaptiveSkipCnt,
+         _solverMaxError);
+}
+
+bool extRCModel::queueSolverJobs()
+{
+  if (_solverJobCnt == 0 || !_runSolver)
+    return false;
+
+  _queueSolverJobs = true;
+  _readAfterJobs   = _readSolver;
+  _readSolver      = false;
+  return true;
+}
+
+bool extRCModel::mkSolverCmd(char*       cmd,
+                             uint        cmdSize,
+                             const char* option,
+                             const char* dir,
+                             const char* file)
+{
+  const char* t = _solverCmd.empty() ? SOLVER_CMD_DEFAULT : _solverCmd.c_str();
+
+  std::string deck = std::string(dir) + "/" + file;
+  std::string out  = deck + ".out";
+
+  std::string s;
+  while (*t != '\0') {
+    if (strncmp(t, "{options}", 9) == 0) {
+      s += option;
+      t += 9;
+    } else if (strncmp(t, "{deck}", 6) == 0) {
+      s += deck;
+      t += 6;
+    } else if (strncmp(t, "{out}", 5) == 0) {
+      s += out;
+      t += 5;
+    } else if (strncmp(t, "{dir}", 5) == 0) {
+      s += dir;
+      t += 5;
+    } else {
+      s += *t++;
+    }
+  }
+  if (snprintf(cmd, cmdSize, "%s", s.c_str()) >= (int) cmdSize) {
+    warning(0, "Solver command for %s is too long\n", deck.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool extRCModel::solverOutputValid(const char* dir, const char* file)
+{
+  FILE* fp = openFile(dir, file, ".out", "r");
+  if (fp == NULL)
+    return false;
+
+  bool valid = false;
+  char line[8192];
+  while (!valid && fgets(line, sizeof(line), fp) != NULL) {
+    char w0[64];
+    char w1[64];
+    if (sscanf(line, "%63s %63s", w0, w1) == 2 && strcmp(w0, "***") == 0
+        && strcmp(w1, "POTENTIAL") == 0)
+      valid = true;
+  }
+  fclose(fp);
+  return valid;
+}
+
+bool extRCModel::startSolverJob(extSolverJob* job)
+{
+  char out[4096];
+  snprintf(
+      out, sizeof(out), "%s/%s.out", job->_dir.c_str(), job->_file.c_str());
+
+  // an output left from an earlier try or run must not pass for this one
+  unlink(out);
+  job->_tryCnt++;
+
+  char cmd[8192];
+  if (!mkSolverCmd(cmd,
+                   sizeof(cmd),
+                   job->_option.c_str(),
+                   job->_dir.c_str(),
+                   job->_file.c_str()))
+    return false;
+  if (_logFP != NULL)
+    fprintf(_logFP, "%s\n", cmd);
+
+  int pid = fork();
+  if (pid < 0) {
+    warning(0, "Cannot start solver job for %s\n", job->_dir.c_str());
+    return false;
+  }
+  if (pid == 0) {
+    execl("/bin/sh", "sh", "-c", cmd, (char*) NULL);
+    _exit(127);
+  }
+  job->_pid = pid;
+  return true;
+}
+
+// Reaps a finished job of the running list, -1 when none has finished.
+// Only the pids of the jobs are waited for, so the child processes of the
+// rest of the application are left to their owners.
+static int reapSolverJob(std::vector<extSolverJob*>& running, int& status)
+{
+  for (uint ii = 0; ii < running.size(); ii++) {
+    int pid = waitpid(running[ii]->_pid, &status, WNOHANG);
+    if (pid == running[ii]->_pid)
+      return ii;
+    if (pid < 0 && errno != EINTR) {
+      status = -1;
+      return ii;
+    }
+  }
+  return -1;
+}
+
+void extRCModel::runSolverProcesses(uint& doneCnt,
+                                    uint& failCnt,
+                                    uint& retryCnt)
+{
+  // retries go to the end of the queue, behind the decks not run yet
+  std::vector<extSolverJob*> queue = _solverJobTable;
+  std::vector<extSolverJob*> running;
+  uint                       next   = 0;
+  uint                       jobCnt = (uint) _solverJobTable.size();
+
+  while (next < queue.size() || !running.empty()) {
+    while (running.size() < _solverJobCnt && next < queue.size()) {
+      extSolverJob* job = queue[next++];
+      if (startSolverJob(job)) {
+        running.push_back(job);
+      } else if (job->_tryCnt <= _solverRetryCnt) {
+        queue.push_back(job);
+        retryCnt++;
+      } else {
+        failCnt++;
+      }
+    }
+    if (running.empty())
+      continue;
+
+    int status = 0;
+    int ii     = reapSolverJob(running, status);
+    if (ii < 0) {
+      usleep(10000);
+      continue;
+    }
+    extSolverJob* job = running[ii];
+    running.erase(running.begin() + ii);
+
+    if (status != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0
+        && solverOutputValid(job->_dir.c_str(), job->_file.c_str())) {
+      doneCnt++;
+      if (doneCnt % 100 == 0)
+        notice(0, "\t%d of %d solver decks done\n", doneCnt, jobCnt);
+      continue;
+    }
+    if (job->_tryCnt <= _solverRetryCnt) {
+      warning(0,
+              "Solver job for %s failed, try %d of %d\n",
+              job->_dir.c_str(),
+              job->_tryCnt,
+              _solverRetryCnt + 1);
+      queue.push_back(job);
+      retryCnt++;
+    } else {
+      warning(0,
+              "Solver job for %s failed after %d tries\n",
+              job->_dir.c_str(),
+              job->_tryCnt);
+      failCnt++;
+    }
+  }
+}
+
+bool extRCModel::runSolverJobs()
+{
+  _queueSolverJobs = false;
+  if (_logFP != NULL)
+    fflush(_logFP);
+
+  uint jobCnt = (uint) _solverJobTable.size();
+  notice(0,
+         "Running %d solver decks, %d jobs at a time ...\n",
+         jobCnt,
+         _solverJobCnt);
+
+  uint doneCnt  = 0;
+  uint failCnt  = 0;
+  uint retryCnt = 0;
+  if (_solverCmd == "builtin" || _solverCmd == "stub")
+    runBuiltinSolverJobs(doneCnt, failCnt);
+  else
+    runSolverProcesses(doneCnt, failCnt, retryCnt);
+
+  notice(0,
+         "Finished %d solver decks: %d done, %d failed, %d retries\n",
+         jobCnt,
+         doneCnt,
+         failCnt,
+         retryCnt);
+
+  for (uint ii = 0; ii < _solverJobTable.size(); ii++) {
+    extSolverJob* job = _solverJobTable[ii];
+    saveSolverCache(job->_dir.c_str(), job->_file.c_str(), job->_cacheKey);
+    delete job;
+  }
+  _solverJobTable.clear();
+
+  if (!_readAfterJobs) {
+    _solverOutputNames.clear();
+    return false;
+  }
+  readSolverOutputs();
+
+  _writeFiles = false;
+  _runSolver  = false;
+  _readSolver = true;
+  return true;
+}
+
+// permittivity of oxide, F/um
+static const double STUB_EPS = 3.9 * 8.854e-18;
+
+struct extStubWire
+{
+  int    _met;
+  int    _num;
+  double _xlo;
+  double _xhi;
+  double _ylo;
+  double _yhi;
+  double _volt;
+};
+
+// per unit length coupling of two wires of a 2D deck, in F/um
+static double stubCoupling(extStubWire* w1, extStubWire* w2)
+{
+  double dx = MAX(w2->_xlo - w1->_xhi, w1->_xlo - w2->_xhi);
+  double dy = MAX(w2->_ylo - w1->_yhi, w1->_ylo - w2->_yhi);
+
+  if (dx > 0.0 && dy <= 0.0)  // side by side, -dy is the overlap
+    return -STUB_EPS * dy / dx;
+  if (dy > 0.0 && dx <= 0.0)  // one over the other
+    return -STUB_EPS * dx / dy;
+  if (dx > 0.0 && dy > 0.0)  // diagonal
+    return STUB_EPS * 0.5 * MIN(w1->_xhi - w1->_xlo, w2->_xhi - w2->_xlo)
+           / sqrt(dx * dx + dy * dy);
+  return 0.0;
+}
+
+bool extRCModel::writeStubSolverOutput(const char* deck, const char* out)
+{
+  FILE* in = fopen(deck, "r");
+  if (in == NULL)
+    return false;
+
+  std::vector<extStubWire> wires;
+  char                     line[8192];
+  while (fgets(line, sizeof(line), in) != NULL) {
+    if (strncmp(line, "POLY NAME=", 10) != 0)
+      continue;
+    extStubWire w;
+    if (sscanf(line + 10, " M%d_w%d;", &w._met, &w._num) != 2)
+      continue;
+    const char* c = strstr(line, "COORD=");
+    const char* v = strstr(line, "VOLT=");
+    if (c == NULL || v == NULL)
+      continue;
+
+    c += 6;
+    w._xlo = w._ylo = 1.0e+30;
+    w._xhi = w._yhi = -1.0e+30;
+    double x, y;
+    int    n;
+    while (sscanf(c, " %lf,%lf ;%n", &x, &y, &n) == 2) {
+      w._xlo = MIN(w._xlo, x);
+      w._xhi = MAX(w._xhi, x);
+      w._ylo = MIN(w._ylo, y);
+      w._yhi = MAX(w._yhi, y);
+      c += n;
+    }
+    if (w._xlo > w._xhi)
+      continue;
+    w._volt = atof(v + 5);
+    wires.push_back(w);
+  }
+  fclose(in);
+
+  FILE* fp = fopen(out, "w");
+  if (fp == NULL)
+    return false;
+
+  fprintf(fp, "*** POTENTIAL stub solver %s\n\n", deck);
+  for (uint ii = 0; ii < wires.size(); ii++) {
+    extStubWire* victim = &wires[ii];
+    if (victim->_volt <= 0.0)
+      continue;
+
+    double tot
+        = STUB_EPS * (victim->_xhi - victim->_xlo) / MAX(victim->_ylo, 0.05);
+    for (uint jj = 0; jj < wires.size(); jj++) {
+      if (jj == ii)
+        continue;
+      double cc = stubCoupling(victim, &wires[jj]);
+      tot += cc;
+      fprintf(fp,
+              "   Charge on M%d_w%d = %e\n",
+              wires[jj]._met,
+              wires[jj]._num,
+              -cc);
+    }
+    fprintf(fp, "   Charge on M%d_w%d = %e\n", victim->_met, victim->_num, tot);
+    break;
+  }
+  fprintf(fp, "END\n");
+  fclose(fp);
+  return true;
+}
+
+}  // namespace OpenRCX
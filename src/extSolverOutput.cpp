@@ -0,0 +1,293 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Solver output parser for rules generation
+//
+// Every pattern of rules_gen and bench_wires reads the capacitance of its
+// wires from the "Charge on <wire> = <cap>" lines of its solver output. The
+// output is mapped in memory and scanned in place: the charges keep the
+// position of their line in the mapping for caps.log, so nothing is copied
+// but the cap value. When define_rules_solver queues the decks, the outputs
+// of all jobs are parsed on threads once the solver is done, and the reads
+// of the patterns take the parsed outputs from the table.
+
+#include <dbLogger.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "extRCap.h"
+#include "extUtil.h"
+
+namespace OpenRCX {
+
+using odb::notice;
+using odb::warning;
+
+extSolverOutput::extSolverOutput()
+{
+  _potential = false;
+  _buf       = NULL;
+  _size      = 0;
+}
+
+extSolverOutput::~extSolverOutput()
+{
+  if (_buf != NULL)
+    munmap(_buf, _size);
+}
+
+bool extSolverOutput::read(const char* fileName)
+{
+  _fileName = fileName;
+
+  int fd = open(fileName, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  _size = st.st_size;
+  if (_size > 0) {
+    void* buf = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (buf == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+    _buf = (char*) buf;
+  }
+  close(fd);
+
+  parse();
+  return true;
+}
+
+static bool isSpace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+static bool isWord(const char* word, uint len, const char* key)
+{
+  return len == strlen(key) && strncmp(word, key, len) == 0;
+}
+
+// digits at the start of the span, as atoi
+static int spanInt(const char* s, const char* end)
+{
+  int n = 0;
+  for (; s < end && *s >= '0' && *s <= '9'; s++)
+    n = 10 * n + *s - '0';
+  return n;
+}
+
+// first maxCnt white space separated words of [p, end)
+static uint lineWords(const char*  p,
+                      const char*  end,
+                      const char** word,
+                      uint*        len,
+                      uint         maxCnt)
+{
+  uint cnt = 0;
+  while (cnt < maxCnt) {
+    while (p < end && isSpace(*p))
+      p++;
+    if (p >= end)
+      break;
+    word[cnt] = p;
+    while (p < end && !isSpace(*p))
+      p++;
+    len[cnt] = p - word[cnt];
+    cnt++;
+  }
+  return cnt;
+}
+
+void extSolverOutput::parseWireName(const char* name,
+                                    uint        len,
+                                    int&        met,
+                                    int&        wire)
+{
+  const char* end = name + len;
+
+  met = 0;
+  if (len > 0 && name[0] == 'M')
+    met = spanInt(name + 1, end);
+
+  const char* w = (const char*) memchr(name, 'w', len);
+
+  wire = -1;
+  if (w != NULL)
+    wire = spanInt(w + 1, end);
+}
+
+void extSolverOutput::parse()
+{
+  const char* p   = _buf;
+  const char* end = _buf + _size;
+
+  bool matrixFlag = false;
+  while (p < end) {
+    const char* line = p;
+    const char* eol  = (const char*) memchr(p, '\n', end - p);
+    if (eol == NULL)
+      eol = end;
+    p = eol + 1;
+
+    const char* word[5];
+    uint        len[5];
+    uint        wordCnt = lineWords(line, eol, word, len, 5);
+    if (wordCnt == 0)
+      continue;
+
+    if (!matrixFlag) {
+      if (wordCnt > 1 && isWord(word[0], len[0], "***")
+          && isWord(word[1], len[1], "POTENTIAL")) {
+        matrixFlag = true;
+        _potential = true;
+      }
+      continue;
+    }
+    if (isWord(word[0], len[0], "END"))
+      break;
+    if (wordCnt < 5 || !isWord(word[0], len[0], "Charge"))
+      continue;
+
+    extSolverCharge c;
+    c._line    = line;
+    c._lineLen = eol - line;
+    if (c._lineLen > 0 && line[c._lineLen - 1] == '\r')
+      c._lineLen--;
+    parseWireName(word[2], len[2], c._met, c._wire);
+
+    char num[64];  // the mapping has no terminating 0 to stop atof
+    uint n = MIN(len[4], sizeof(num) - 1);
+    memcpy(num, word[4], n);
+    num[n] = '\0';
+    c._cap = atof(num);
+
+    _chargeTable.push_back(c);
+  }
+}
+
+void extSolverOutput::printCharge(FILE* fp, extSolverCharge* c)
+{
+  fwrite(c->_line, 1, c->_lineLen, fp);
+  fputc('\n', fp);
+}
+
+struct extSolverOutputJobs
+{
+  std::vector<std::string>*      _names;
+  std::vector<extSolverOutput*>* _outputs;
+  std::atomic<uint>              _next;
+};
+
+static void readSolverOutputThread(void* arg)
+{
+  extSolverOutputJobs* jobs = (extSolverOutputJobs*) arg;
+  uint ii;
+  while ((ii = jobs->_next++) < jobs->_names->size()) {
+    extSolverOutput* out = new extSolverOutput;
+    if (!out->read((*jobs->_names)[ii].c_str())) {
+      delete out;
+      out = NULL;
+    }
+    (*jobs->_outputs)[ii] = out;
+  }
+}
+
+void extRCModel::readSolverOutputs()
+{
+  std::vector<extSolverOutput*> outputs(_solverOutputNames.size(), NULL);
+
+  extSolverOutputJobs jobs;
+  jobs._names   = &_solverOutputNames;
+  jobs._outputs = &outputs;
+  jobs._next    = 0;
+
+  uint threadCnt = MIN(MAX(_solverJobCnt, 1), (uint) outputs.size());
+
+  extRunWorkers(threadCnt, readSolverOutputThread, &jobs);
+
+  uint readCnt = 0;
+  for (uint ii = 0; ii < outputs.size(); ii++) {
+    if (outputs[ii] == NULL)
+      continue;
+    delete _solverOutputTable[_solverOutputNames[ii]];
+    _solverOutputTable[_solverOutputNames[ii]] = outputs[ii];
+    readCnt++;
+  }
+  notice(0,
+         "Parsed %d of %d solver outputs on %d threads\n",
+         readCnt,
+         (uint) outputs.size(),
+         threadCnt);
+
+  _solverOutputNames.clear();
+}
+
+extSolverOutput* extRCModel::getSolverOutput()
+{
+  char fileName[2048];
+  sprintf(fileName, "%s/%s.out", _wireDirName, _wireFileName);
+
+  std::map<std::string, extSolverOutput*>::iterator it
+      = _solverOutputTable.find(fileName);
+  if (it != _solverOutputTable.end()) {
+    extSolverOutput* out = it->second;
+    _solverOutputTable.erase(it);
+    return out;
+  }
+
+  extSolverOutput* out = new extSolverOutput;
+  if (!out->read(fileName)) {
+    notice(0, "Cannot open file %s with permissions r\n", fileName);
+    delete out;
+    return NULL;
+  }
+  return out;
+}
+
+}  // namespace OpenRCX
@@ -35,7 +35,9 @@
 #include "extRCap.h"
 //#include "dbExtControl.h"
 #include <dbExtControl.h>
+#include <fcntl.h>
 #include <math.h>
+#include <unistd.h>
 
 #include <algorithm>
 
@@ -67,7 +69,9 @@ extSpef::extSpef(odb::dbTech*  tech,
   if (blk != NULL)
     _blockId = blk->getId();
 
-  _outFP = NULL;
+  _outFP     = NULL;
+  _inFile[0]  = '\0';
+  _outFile[0] = '\0';
 
   // strcpy(_divider, ".");
   strcpy(_divider, "/");
@@ -138,6 +142,10 @@ extSpef::extSpef(odb::dbTech*  tech,
   _search       = NULL;
   _idTable      = NULL;
 
+  _nodeCoordNetStamp = 0;
+  _nodeCoordIndexCnt = 0;
+  _nodeShapeIdsDone  = false;
+
   _partial = false;
 
   _noBackSlash       = false;
@@ -152,6 +160,7 @@ extSpef::extSpef(odb::dbTech*  tech,
   _addRepeatedCapValue = true;
 
   _nodeHashTable      = NULL;
+  _nodeIdTable        = NULL;
   _node2nodeHashTable = NULL;
   _tmpCapId           = 1;
 
@@ -200,6 +209,28 @@ extSpef::extSpef(odb::dbTech*  tech,
   _useBaseCornerRc = false;
 
   _incrPlusCcNets = false;
+  _readThreadCnt  = 1;
+  _streamDiff     = false;
+  _diffDetail     = true;
+
+  _reuseSpefFile   = NULL;
+  _netIndexWritten = false;
+  _netIndexFP      = NULL;
+  _reuseFd         = -1;
+  _runBegin        = 0;
+  _runEnd          = 0;
+  _runOutPos       = 0;
+  _reusedCnt       = 0;
+
+  _retireWriter = NULL;
+  _retiredCnt   = 0;
+  _nameCache    = NULL;
+
+  for (uint ii = 0; ii < 32; ii++) {
+    _resScale[ii] = 1.0;
+    _gndScale[ii] = 1.0;
+    _ccScale[ii]  = 1.0;
+  }
 
   _bufString = NULL;
   _msgBuf1   = (char*) malloc(sizeof(char) * 2048);
@@ -213,6 +244,9 @@ extSpef::extSpef(odb::dbTech*  tech,
 
 extSpef::~extSpef()
 {
+  if (_retireWriter)
+    finishRetireWrite();
+  releaseSpefNames();
   delete _idMapTable;
   if (_nodeParser)
     delete _nodeParser;
@@ -240,6 +274,8 @@ extSpef::~extSpef()
     delete _nameMapTable;
   if (_nodeHashTable)
     delete _nodeHashTable;
+  if (_nodeIdTable)
+    delete _nodeIdTable;
   if (_node2nodeHashTable)
     delete _node2nodeHashTable;
   if (_rcPool)
@@ -432,7 +468,7 @@ void extSpef::writeITermNode(uint node)
     else
       sprintf(_msgBuf1,
               "%s%s%s ",
-              tinkerSpefName((char*) inst->getConstName()),
+              spefInstName(inst),
               _delimiter,
               iterm->getMTerm()->getName(inst, &ttname[0]));
     strcat(_bufString, _msgBuf1);
@@ -446,7 +482,7 @@ void extSpef::writeITermNode(uint node)
     else
       ATH__fprintf(_outFP,
                    "%s%s%s ",
-                   tinkerSpefName((char*) inst->getConstName()),
+                   spefInstName(inst),
                    _delimiter,
                    iterm->getMTerm()->getName(inst, &ttname[0]));
   }
@@ -531,7 +567,7 @@ bool extSpef::writeNode(uint netId, uint node)
     else
       sprintf(_msgBuf1,
               "%s%s%d ",
-              tinkerSpefName((char*) tnet->getConstName()),
+              spefNetName(tnet),
               _delimiter,
               node);
     strcat(_bufString, _msgBuf1);
@@ -541,7 +577,7 @@ bool extSpef::writeNode(uint netId, uint node)
     else
       ATH__fprintf(_outFP,
                    "%s%s%d ",
-                   tinkerSpefName((char*) tnet->getConstName()),
+                   spefNetName(tnet),
                    _delimiter,
                    node);
   }
@@ -651,23 +687,55 @@ void extSpef::writeSingleRC(double val, bool delimeter)
 }
 void extSpef::writeRCvalue(double* totCap, double units)
 {
-  ATH__fprintf(_outFP, "%g", totCap[_active_corner_number[0]] * units);
+  ATH__fprintf(
+      _outFP, "%g", totCap[_active_corner_number[0]] * units * _gndScale[0]);
   for (int ii = 1; ii < _active_corner_cnt; ii++)
-    ATH__fprintf(
-        _outFP, "%s%g", _delimiter, totCap[_active_corner_number[ii]] * units);
+    ATH__fprintf(_outFP,
+                 "%s%g",
+                 _delimiter,
+                 totCap[_active_corner_number[ii]] * units * _gndScale[ii]);
 }
-void extSpef::writeDnet(uint netId, double* totCap)
+void extSpef::writeDnet(uint netId, double* gndCap, double* ccCap)
 {
   netId = getNetMapId(netId);
 
   if (_writeNameMap)
     ATH__fprintf(_outFP, "\n*D_NET *%d ", netId);
   else
-    ATH__fprintf(
-        _outFP, "\n*D_NET %s ", tinkerSpefName((char*) _d_net->getConstName()));
-  writeRCvalue(totCap, _cap_unit);
+    ATH__fprintf(_outFP, "\n*D_NET %s ", spefNetName(_d_net));
+  writeTotCap(gndCap, ccCap);
   ATH__fprintf(_outFP, "\n");
 }
+// total cap of a *D_NET, ground and coupling parts scaled separately
+void extSpef::writeTotCap(double* gndCap, double* ccCap)
+{
+  for (int ii = 0; ii < _active_corner_cnt; ii++) {
+    int    n   = _active_corner_number[ii];
+    double cap = gndCap[n] * _gndScale[ii] + ccCap[n] * _ccScale[ii];
+    if (ii == 0)
+      ATH__fprintf(_outFP, "%g", cap * _cap_unit);
+    else
+      ATH__fprintf(_outFP, "%s%g", _delimiter, cap * _cap_unit);
+  }
+}
+void extSpef::setupWriteScales()
+{
+  for (int ii = 0; ii < _active_corner_cnt; ii++) {
+    _resScale[ii] = 1.0;
+    _gndScale[ii] = 1.0;
+    _ccScale[ii]  = 1.0;
+    if (_ext == NULL)
+      continue;
+    if (_independentExtCorners) {  // corner blocks: adjust_rc factors only
+      _ext->getPendingAdjust(_resScale[ii], _ccScale[ii], _gndScale[ii]);
+      continue;
+    }
+    // a lazily derived corner reads the values of its process corner
+    int n = _active_corner_number[ii];
+    _ext->getLazyScale(n, n, _resScale[ii], _ccScale[ii], _gndScale[ii]);
+    _active_corner_number[ii] = n;
+  }
+}
 void extSpef::writeKeyword(const char* keyword)
 {
   ATH__fprintf(_outFP, "%s\n", keyword);
@@ -902,9 +970,13 @@ uint extSpef::writeInternalCaps(odb::dbNet*                 net,
     writeCNodeNumber();
     writeNode(net->getId(), capNode->getNode());
 
-    writeSingleRC(capNode->getCapacitance(_active_corner_number[0]), false);
+    writeSingleRC(
+        capNode->getCapacitance(_active_corner_number[0]) * _gndScale[0],
+        false);
     for (int ii = 1; ii < _active_corner_cnt; ii++)
-      writeSingleRC(capNode->getCapacitance(_active_corner_number[ii]), true);
+      writeSingleRC(
+          capNode->getCapacitance(_active_corner_number[ii]) * _gndScale[ii],
+          true);
 
     ATH__fprintf(_outFP, "\n");
   }
@@ -935,9 +1007,13 @@ uint extSpef::writeCapPortsAndIterms(odb::dbSet<odb::dbCapNode>& capSet,
     } else
       continue;
 
-    writeSingleRC(capNode->getCapacitance(_active_corner_number[0]), false);
+    writeSingleRC(
+        capNode->getCapacitance(_active_corner_number[0]) * _gndScale[0],
+        false);
     for (int ii = 1; ii < _active_corner_cnt; ii++)
-      writeSingleRC(capNode->getCapacitance(_active_corner_number[ii]), true);
+      writeSingleRC(
+          capNode->getCapacitance(_active_corner_number[ii]) * _gndScale[ii],
+          true);
 
     ATH__fprintf(_outFP, "\n");
   }
@@ -1118,13 +1194,16 @@ uint extSpef::writeCouplingCapsNoSort(odb::dbSet<odb::dbCCSeg>& capSet,
     writeCapNode(cc->getSourceCapNode()->getId(), netId);
     writeCapNode(cc->getTargetCapNode()->getId(), netId);
 
-    ATH__fprintf(
-        _outFP, "%g", cc->getCapacitance(_active_corner_number[0]) * _cap_unit);
+    ATH__fprintf(_outFP,
+                 "%g",
+                 cc->getCapacitance(_active_corner_number[0]) * _cap_unit
+                     * _ccScale[0]);
     for (int ii = 1; ii < _active_corner_cnt; ii++)
       ATH__fprintf(_outFP,
                    "%s%g",
                    _delimiter,
-                   cc->getCapacitance(_active_corner_number[ii]) * _cap_unit);
+                   cc->getCapacitance(_active_corner_number[ii]) * _cap_unit
+                       * _ccScale[ii]);
 
     ATH__fprintf(_outFP, "\n");
   }
@@ -1152,13 +1231,16 @@ uint extSpef::writeCouplingCaps(odb::dbSet<odb::dbCCSeg>& capSet, uint netId)
     writeCapNode(cc->getSourceCapNode()->getId(), netId);
     writeCapNode(cc->getTargetCapNode()->getId(), netId);
 
-    ATH__fprintf(
-        _outFP, "%g", cc->getCapacitance(_active_corner_number[0]) * _cap_unit);
+    ATH__fprintf(_outFP,
+                 "%g",
+                 cc->getCapacitance(_active_corner_number[0]) * _cap_unit
+                     * _ccScale[0]);
     for (int ii = 1; ii < _active_corner_cnt; ii++)
       ATH__fprintf(_outFP,
                    "%s%g",
                    _delimiter,
-                   cc->getCapacitance(_active_corner_number[ii]) * _cap_unit);
+                   cc->getCapacitance(_active_corner_number[ii]) * _cap_unit
+                       * _ccScale[ii]);
 
     ATH__fprintf(_outFP, "\n");
   }
@@ -1224,13 +1306,16 @@ uint extSpef::writeCouplingCaps(std::vector<odb::dbCCSeg*>& vec_cc, uint netId)
     writeCapNode(cc->getSourceCapNode(), netId);
     writeCapNode(cc->getTargetCapNode(), netId);
 
-    ATH__fprintf(
-        _outFP, "%g", cc->getCapacitance(_active_corner_number[0]) * _cap_unit);
+    ATH__fprintf(_outFP,
+                 "%g",
+                 cc->getCapacitance(_active_corner_number[0]) * _cap_unit
+                     * _ccScale[0]);
     for (int ii = 1; ii < _active_corner_cnt; ii++)
       ATH__fprintf(_outFP,
                    "%s%g",
                    _delimiter,
-                   cc->getCapacitance(_active_corner_number[ii]) * _cap_unit);
+                   cc->getCapacitance(_active_corner_number[ii]) * _cap_unit
+                       * _ccScale[ii]);
 
     ATH__fprintf(_outFP, "\n");
   }
@@ -1347,13 +1432,16 @@ uint extSpef::writeRes(uint netId, odb::dbSet<odb::dbRSeg>& rSet)
     writeCapNode(rc->getSourceNode(), netId);
     writeCapNode(rc->getTargetNode(), netId);
 
-    ATH__fprintf(
-        _outFP, "%g", rc->getResistance(_active_corner_number[0]) * _res_unit);
+    ATH__fprintf(_outFP,
+                 "%g",
+                 rc->getResistance(_active_corner_number[0]) * _res_unit
+                     * _resScale[0]);
     for (int ii = 1; ii < _active_corner_cnt; ii++)
       ATH__fprintf(_outFP,
                    "%s%g",
                    _delimiter,
-                   rc->getResistance(_active_corner_number[ii]) * _res_unit);
+                   rc->getResistance(_active_corner_number[ii]) * _res_unit
+                       * _resScale[ii]);
 
     ATH__fprintf(_outFP, " \n");
   }
@@ -1385,6 +1473,8 @@ uint extSpef::writeNet(odb::dbNet* net, double resBound, uint debug)
 
     double totCap[5];
     resetCap(totCap);
+    double ccCap[5];
+    resetCap(ccCap);
 
     /* dimitris_change_
     odb::dbSet<odb::dbCCSeg> srcCCcaps= net->getSrcCCSegs();
@@ -1395,7 +1485,7 @@ uint extSpef::writeNet(odb::dbNet* net, double resBound, uint debug)
     */
 
     if (_symmetricCCcaps)
-      addCouplingCaps(net, totCap);
+      addCouplingCaps(net, ccCap);
     else
       odb::notice(0, "dimitris_change NEED TO IMPLEMENT NON SYMMTRIC CASE\n");
 
@@ -1403,7 +1493,7 @@ uint extSpef::writeNet(odb::dbNet* net, double resBound, uint debug)
 
     if (_preserveCapValues) {
       getCaps(net, totCap);
-      writeDnet(netId, totCap);
+      writeDnet(netId, totCap, ccCap);
 
       if (_wConn) {
         writeKeyword("*CONN");
@@ -1432,7 +1522,7 @@ uint extSpef::writeNet(odb::dbNet* net, double resBound, uint debug)
       else
         computeCaps(rcSet, totCap);
 
-      writeDnet(netId, totCap);
+      writeDnet(netId, totCap, ccCap);
       if (_wConn) {
         writeKeyword("*CONN");
         writePorts(net);
@@ -1595,7 +1685,6 @@ char* extSpef::tinkerSpefName(char* iname)
 uint extSpef::writeNetMap(odb::dbSet<odb::dbNet>& nets)
 {
   uint                             cnt = 0;
-  char *                           nname, *nname1;
   odb::dbSet<odb::dbNet>::iterator net_itr;
   _btermFound = false;
   for (net_itr = nets.begin(); net_itr != nets.end(); ++net_itr) {
@@ -1651,11 +1740,8 @@ uint extSpef::writeNetMap(odb::dbSet<odb::dbNet>& nets)
 
     if (_useIds)
       ATH__fprintf(_outFP, "*%d N%d\n", netMapId, netMapId);
-    else {
-      nname  = (char*) net->getConstName();
-      nname1 = tinkerSpefName(nname);
-      ATH__fprintf(_outFP, "*%d %s\n", netMapId, nname1);
-    }
+    else
+      ATH__fprintf(_outFP, "*%d %s\n", netMapId, spefNetName(net));
 
     cnt++;
   }
@@ -1663,9 +1749,8 @@ uint extSpef::writeNetMap(odb::dbSet<odb::dbNet>& nets)
 }
 uint extSpef::writeInstMap()
 {
-  uint  cnt = 0;
-  char *nname, *nname1;
-  uint  instMapId = 0;
+  uint cnt       = 0;
+  uint instMapId = 0;
 
   odb::dbSet<odb::dbInst>           insts = _block->getInsts();
   odb::dbSet<odb::dbInst>::iterator inst_itr;
@@ -1699,11 +1784,8 @@ uint extSpef::writeInstMap()
 
     if (_useIds)
       ATH__fprintf(_outFP, "*%d I%d\n", instMapId, inst->getId());
-    else {
-      nname  = (char*) inst->getConstName();
-      nname1 = tinkerSpefName(nname);
-      ATH__fprintf(_outFP, "*%d %s\n", instMapId, nname1);
-    }
+    else
+      ATH__fprintf(_outFP, "*%d %s\n", instMapId, spefInstName(inst));
 
     cnt++;
   }
@@ -1754,6 +1836,203 @@ uint extSpef::writeBlock(char*                     nodeCoord,
   return rtc;
 }
 
+// Everything that changes the text of a *D_NET section; sections of a
+// previous file are only reused when it was written with the same signature
+std::string extSpef::getWriteSignature()
+{
+  char buf[128];
+  snprintf(buf,
+           sizeof(buf),
+           "%d %d %d %d %d %d %d %d %d %d %d %d ",
+           _baseNameMap,
+           _writeNameMap,
+           _useIds,
+           _preserveCapValues,
+           _singleP,
+           _wConn,
+           _wCap,
+           _wOnlyCCcap,
+           _wRes,
+           _noCnum,
+           _noBackSlash,
+           _writingNodeCoords);
+  std::string sig = buf;
+  sig += _cap_unit_word;
+  sig += " ";
+  sig += _res_unit_word;
+  for (int ii = 0; ii < _active_corner_cnt; ii++) {
+    snprintf(buf, sizeof(buf), " %d", _active_corner_number[ii]);
+    sig += buf;
+  }
+  return sig;
+}
+
+// <file>.idx: signature line, then "netId begin end" byte offsets of the
+// *D_NET section of every written net
+bool extSpef::openNetIndex(const char* sig)
+{
+  if (_outFP == NULL || _gzipFlag || _outFile[0] == '\0')
+    return false;
+  std::string fname = std::string(_outFile) + ".idx";
+  _netIndexFP       = fopen(fname.c_str(), "w");
+  if (_netIndexFP == NULL) {
+    odb::warning(0, "Can't open file %s to write\n", fname.c_str());
+    return false;
+  }
+  fprintf(_netIndexFP, "%s\n", sig);
+  return true;
+}
+
+bool extSpef::readReuseIndex(const char* sig)
+{
+  if (_reuseSpefFile == NULL)
+    return false;
+
+  std::string fname = std::string(_reuseSpefFile) + ".idx";
+  FILE*       fp    = fopen(fname.c_str(), "r");
+  if (fp == NULL) {
+    odb::notice(
+        0, "No section index %s; all nets are written\n", fname.c_str());
+    return false;
+  }
+  char line[2048];
+  if (fgets(line, sizeof(line), fp) == NULL
+      || strncmp(line, sig, strlen(sig)) != 0 || line[strlen(sig)] != '\n') {
+    odb::notice(0,
+                "%s was written with different options or name map; all "
+                "nets are written\n",
+                _reuseSpefFile);
+    fclose(fp);
+    return false;
+  }
+  uint               netId;
+  unsigned long long begin, end;
+  while (fscanf(fp, "%u %llu %llu", &netId, &begin, &end) == 3) {
+    if (netId >= _reuseEnd.size()) {
+      _reuseBegin.resize(netId + 1024, 0);
+      _reuseEnd.resize(netId + 1024, 0);
+    }
+    _reuseBegin[netId] = begin;
+    _reuseEnd[netId]   = end;
+  }
+  fclose(fp);
+
+  _reuseFd = open(_reuseSpefFile, O_RDONLY);
+  if (_reuseFd < 0) {
+    odb::warning(0, "Can't open file %s\n", _reuseSpefFile);
+    return false;
+  }
+
+  // re-extracted nets, the nets coupled to them before (recorded at eco
+  // time) and the nets coupled to them now
+  std::vector<odb::dbNet*> dirtyNets;
+  uint                     ii;
+  for (ii = 0; ii < _reuseNetIds.size(); ii++) {
+    odb::dbNet* net = odb::dbNet::getNet(_block, _reuseNetIds[ii]);
+    if (net != NULL)
+      dirtyNets.push_back(net);
+  }
+  std::vector<odb::dbNet*> ccHaloNets;
+  _block->getCcHaloNets(dirtyNets, ccHaloNets);
+  _reuseDirty.assign(_reuseEnd.size(), false);
+  for (ii = 0; ii < _reuseNetIds.size(); ii++) {
+    if (_reuseNetIds[ii] < _reuseDirty.size())
+      _reuseDirty[_reuseNetIds[ii]] = true;
+  }
+  for (ii = 0; ii < ccHaloNets.size(); ii++) {
+    if (ccHaloNets[ii]->getId() < _reuseDirty.size())
+      _reuseDirty[ccHaloNets[ii]->getId()] = true;
+  }
+  _runBegin  = 0;
+  _runEnd    = 0;
+  _reusedCnt = 0;
+  return true;
+}
+
+bool extSpef::isReusable(odb::dbNet* net)
+{
+  uint netId = net->getId();
+  return netId < _reuseEnd.size() && _reuseEnd[netId] > 0
+         && !_reuseDirty[netId];
+}
+
+// Sections of consecutive nets are contiguous in the old file and are
+// copied as one run
+void extSpef::addReusedSection(odb::dbNet* net)
+{
+  uint     netId = net->getId();
+  uint64_t begin = _reuseBegin[netId];
+  uint64_t end   = _reuseEnd[netId];
+  if (_runEnd == 0 || begin != _runEnd) {
+    flushReusedRun();
+    fflush(_outFP);
+    _runOutPos = ftello(_outFP);
+    _runBegin  = begin;
+  }
+  uint64_t outBegin = _runOutPos + (begin - _runBegin);
+  _runEnd           = end;
+  if (_netIndexFP)
+    fprintf(_netIndexFP,
+            "%u %llu %llu\n",
+            netId,
+            (unsigned long long) outBegin,
+            (unsigned long long) (outBegin + end - begin));
+  _reusedCnt++;
+}
+
+void extSpef::flushReusedRun()
+{
+  if (_runEnd == 0)
+    return;
+
+  int     outFd  = fileno(_outFP);
+  off_t   inOff  = (off_t) _runBegin;
+  off_t   outOff = (off_t) _runOutPos;
+  int64_t left   = _runEnd - _runBegin;
+#ifdef __linux__
+  while (left > 0) {
+    ssize_t n = copy_file_range(_reuseFd, &inOff, outFd, &outOff, left, 0);
+    if (n <= 0)
+      break;
+    left -= n;
+  }
+#endif
+  char buf[65536];
+  while (left > 0) {  // no copy_file_range across these file systems
+    ssize_t n = pread(_reuseFd, buf, left < 65536 ? left : 65536, inOff);
+    if (n <= 0 || pwrite(outFd, buf, n, outOff) != n) {
+      odb::warning(0,
+                   "Failed to copy %lld bytes from %s\n",
+                   (long long) left,
+                   _reuseSpefFile);
+      break;
+    }
+    inOff += n;
+    outOff += n;
+    left -= n;
+  }
+  fseeko(_outFP, outOff, SEEK_SET);
+  _runEnd = 0;
+}
+
+void extSpef::closeNetIndex()
+{
+  flushReusedRun();
+  if (_reuseFd >= 0) {
+    close(_reuseFd);
+    _reuseFd = -1;
+    odb::notice(0,
+                "Reused %d unchanged D_NET sections of %s\n",
+                _reusedCnt,
+                _reuseSpefFile);
+  }
+  if (_netIndexFP != NULL) {
+    fclose(_netIndexFP);
+    _netIndexFP      = NULL;
+    _netIndexWritten = true;
+  }
+}
+
 uint extSpef::writeBlock(char*                    nodeCoord,
                          const char*              excludeCell,
                          const char*              capUnit,
@@ -1843,6 +2122,7 @@ uint extSpef::writeBlock(char*                    nodeCoord,
     odb::dbSet<odb::dbNet> nets = _block->getNets();
 
     writeHeaderInfo(0);
+    internSpefNames(_block);
 
     if (_writeNameMap) {
       writeKeyword("\n*NAME_MAP");
@@ -1912,11 +2192,21 @@ uint extSpef::writeBlock(char*                    nodeCoord,
   } else
     _cornerBlock = _block;
 
+  setupWriteScales();
+
   odb::dbSet<odb::dbNet>           nets = _block->getNets();
   odb::dbSet<odb::dbNet>::iterator net_itr;
 
   uint cnt = 0;
 
+  // only full spef files are indexed
+  bool indexed = false;
+  bool reuse   = false;
+  if (!tnets.size() && !_wOnlyClock && !parallel) {
+    std::string sig = getWriteSignature();
+    indexed         = openNetIndex(sig.c_str());
+    reuse           = indexed && readReuseIndex(sig.c_str());
+  }
   for (net_itr = nets.begin(); net_itr != nets.end(); ++net_itr) {
     odb::dbNet* net = *net_itr;
 
@@ -1930,11 +2220,28 @@ uint extSpef::writeBlock(char*                    nodeCoord,
     if (_wOnlyClock && type != odb::dbSigType::CLOCK)
       continue;
 
-    cnt += writeNet(net, 0.0, 0);
+    if (reuse && isReusable(net)) {
+      addReusedSection(net);
+      cnt++;
+    } else if (indexed) {
+      flushReusedRun();
+      uint64_t begin = ftello(_outFP);
+      cnt += writeNet(net, 0.0, 0);
+      uint64_t end = ftello(_outFP);
+      if (end > begin)
+        fprintf(_netIndexFP,
+                "%u %llu %llu\n",
+                net->getId(),
+                (unsigned long long) begin,
+                (unsigned long long) end);
+    } else
+      cnt += writeNet(net, 0.0, 0);
 
     if (cnt % repChunk == 0)
       odb::notice(0, "%d nets finished\n", cnt);
   }
+  if (indexed)
+    closeNetIndex();
   for (ii = 0; ii < (int) excmaster.size(); ii++)
     ((odb::dbMaster*) excmaster[ii])->setMark(0);
   for (j = 0; j < tnets.size(); j++)
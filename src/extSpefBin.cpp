@@ -0,0 +1,908 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Binary parasitics file
+//
+//   header   "RCXBIN01", uint32 version, uint32 corner count,
+//            uint32 value bytes (4 or 8), uint32 flags
+//   sections one per signal net, in net order:
+//            net name index, capnode count,
+//              per capnode: node (see below), corner values of the cap
+//            rseg count,
+//              foreign: per rseg except the zero rseg, source and target
+//                capnode local index as deltas, corner values of the
+//                resistance
+//              graph: per rseg, source and target local index + 1 (0 for
+//                none), x, y, path direction, updated cap flag, corner
+//                values of the resistance and of the capacitance
+//            graph: link count, per link: shape id, rseg index, via flag
+//            ccseg count, per ccseg: local index on this net, other net name
+//              index delta, other local index + 1, or 0 followed by the node
+//              of a net without a section (power/ground), corner values of
+//              the capacitance
+//   strings  count, per string: length and bytes
+//   index    net count, per net: name index and uint64 section offset
+//   footer   uint64 strings offset, uint64 index offset, "RCXBIN01"
+//
+// A node is a kind byte (+ branch flag) followed by, for an iterm the inst
+// and mterm name index, for a bterm its name index and for an internal node
+// the delta of its node number (absolute for nodes of nets without section).
+//
+// Dbs read from SPEF are written in foreign mode, with the ground cap on the
+// capnodes. Extracted dbs are written as their extraction graph (flag
+// BIN_GRAPH): rsegs keep their own caps, coordinates and the shape links of
+// the wire, so a read db can be assembled into a parent like an extracted one.
+// Coupling caps are written once, on the signal net side.
+//
+// Integers are LEB128 varints, signed deltas zigzag encoded. Fixed width
+// integers and values (fF, ohm) are little endian.
+
+#include <dbLogger.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <unordered_map>
+
+#include "dbShape.h"
+#include "extRCap.h"
+#include "extSpef.h"
+
+namespace OpenRCX {
+
+using odb::dbBlock;
+using odb::dbBTerm;
+using odb::dbCapNode;
+using odb::dbCCSeg;
+using odb::dbInst;
+using odb::dbITerm;
+using odb::dbNet;
+using odb::dbRSeg;
+using odb::dbShape;
+using odb::dbSigType;
+using odb::dbWire;
+using odb::dbWireShapeItr;
+using odb::notice;
+using odb::warning;
+
+static const char     BIN_MAGIC[8]   = {'R', 'C', 'X', 'B', 'I', 'N', '0', '1'};
+static const uint32_t BIN_VERSION    = 2;
+static const uint     BIN_HEADER_LEN = 24;
+static const uint     BIN_FOOTER_LEN = 24;
+
+enum
+{
+  BIN_INTERNAL = 0,
+  BIN_ITERM    = 1,
+  BIN_BTERM    = 2,
+  BIN_KIND     = 3,
+  BIN_BRANCH   = 4
+};
+
+enum
+{
+  BIN_GRAPH = 1  // extraction graph instead of foreign capnode caps
+};
+
+class extSpefBinWriter
+{
+ public:
+  bool                                  _float64;
+  uint                                  _cornerCnt;
+  std::vector<unsigned char>            _buf;
+  std::vector<std::string>              _names;
+  std::unordered_map<std::string, uint> _ids;
+
+  uint nameIdx(const char* name)
+  {
+    std::unordered_map<std::string, uint>::iterator it = _ids.find(name);
+    if (it != _ids.end())
+      return it->second;
+    uint id    = _names.size();
+    _ids[name] = id;
+    _names.push_back(name);
+    return id;
+  }
+  void putByte(uint v) { _buf.push_back((unsigned char) v); }
+  void putVarint(uint64_t v)
+  {
+    while (v >= 0x80) {
+      _buf.push_back((unsigned char) (v | 0x80));
+      v >>= 7;
+    }
+    _buf.push_back((unsigned char) v);
+  }
+  void putSigned(int64_t v) { putVarint(((uint64_t) v << 1) ^ (v >> 63)); }
+  void putBytes(const void* p, uint n)
+  {
+    const unsigned char* c = (const unsigned char*) p;
+    _buf.insert(_buf.end(), c, c + n);
+  }
+  void putFixed(uint64_t v, uint n)  // little endian
+  {
+    for (uint ii = 0; ii < n; ii++, v >>= 8)
+      _buf.push_back((unsigned char) (v & 0xff));
+  }
+  void putValue(double v)
+  {
+    if (_float64) {
+      uint64_t b;
+      memcpy(&b, &v, sizeof(b));
+      putFixed(b, sizeof(b));
+    } else {
+      float    f = (float) v;
+      uint32_t b;
+      memcpy(&b, &f, sizeof(b));
+      putFixed(b, sizeof(b));
+    }
+  }
+};
+
+// coupling cap read from a section; its target may be in a later section
+class extSpefBinCC
+{
+ public:
+  uint _srcCapId;
+  uint _tgtCapId;  // non 0 when the target net has no section
+  uint _tgtNameIdx;
+  uint _tgtLocal;
+  uint _valIndex;
+};
+
+class extSpefBinNode
+{
+ public:
+  uint _kind;
+  uint _node;  // iterm id, bterm id or node number
+  bool _branch;
+  bool _found;
+};
+
+class extSpefBinReader
+{
+ public:
+  const unsigned char*               _p;
+  const unsigned char*               _end;
+  bool                               _bad;
+  bool                               _float64;
+  bool                               _graph;
+  uint                               _cornerCnt;
+  std::vector<std::string>           _names;
+  std::vector<std::vector<uint>>     _capIds;       // by net name index
+  std::unordered_map<uint64_t, uint> _otherCapIds;  // nets without section
+  std::vector<extSpefBinCC>          _ccs;
+  std::vector<double>                _ccVals;
+
+  uint getByte()
+  {
+    if (_p >= _end) {
+      _bad = true;
+      return 0;
+    }
+    return *_p++;
+  }
+  uint64_t getVarint()
+  {
+    uint64_t v     = 0;
+    uint     shift = 0;
+    while (_p < _end && shift < 64) {
+      unsigned char c = *_p++;
+      v |= (uint64_t) (c & 0x7f) << shift;
+      if (!(c & 0x80))
+        return v;
+      shift += 7;
+    }
+    _bad = true;
+    return 0;
+  }
+  int64_t getSigned()
+  {
+    uint64_t v = getVarint();
+    return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+  }
+  uint64_t getFixed(uint n)
+  {
+    if (_p + n > _end) {
+      _bad = true;
+      return 0;
+    }
+    uint64_t v = 0;
+    for (uint ii = 0; ii < n; ii++)
+      v |= (uint64_t) _p[ii] << (8 * ii);
+    _p += n;
+    return v;
+  }
+  const char* getName()
+  {
+    uint64_t idx = getVarint();
+    if (idx >= _names.size()) {
+      _bad = true;
+      return "";
+    }
+    return _names[idx].c_str();
+  }
+  double getValue()
+  {
+    if (_float64) {
+      uint64_t b = getFixed(sizeof(b));
+      double   v;
+      memcpy(&v, &b, sizeof(v));
+      return v;
+    }
+    uint32_t b = getFixed(sizeof(b));
+    float    f;
+    memcpy(&f, &b, sizeof(f));
+    return f;
+  }
+};
+
+static bool isSignalNet(dbNet* net)
+{
+  dbSigType type = net->getSigType();
+  return (type != dbSigType::POWER) && (type != dbSigType::GROUND);
+}
+
+static void putBinaryNode(extSpefBinWriter& wr,
+                          dbBlock*          block,
+                          dbCapNode*        capNode,
+                          int&              prevNode)
+{
+  uint branch = capNode->isBranch() ? BIN_BRANCH : 0;
+  if (capNode->isITerm()) {
+    dbITerm* iterm = capNode->getITerm(block);
+    wr.putByte(BIN_ITERM | branch);
+    wr.putVarint(wr.nameIdx(iterm->getInst()->getConstName()));
+    wr.putVarint(wr.nameIdx(iterm->getMTerm()->getConstName()));
+  } else if (capNode->isBTerm()) {
+    wr.putByte(BIN_BTERM | branch);
+    wr.putVarint(wr.nameIdx(capNode->getBTerm(block)->getConstName()));
+  } else {  // internal; name nodes of lower levels keep their number
+    int node = capNode->getNode();
+    wr.putByte(BIN_INTERNAL | branch);
+    wr.putSigned(node - prevNode);
+    prevNode = node;
+  }
+}
+
+static void getBinaryNode(extSpefBinReader& rd,
+                          dbBlock*          block,
+                          int&              prevNode,
+                          extSpefBinNode&   n)
+{
+  uint kind = rd.getByte();
+  n._kind   = kind & BIN_KIND;
+  n._branch = (kind & BIN_BRANCH) != 0;
+  n._node   = 0;
+  n._found  = true;
+  if (n._kind == BIN_ITERM) {
+    const char* iname = rd.getName();
+    const char* mname = rd.getName();
+    dbInst*     inst  = block->findInst(iname);
+    dbITerm*    iterm = inst ? inst->findITerm(mname) : NULL;
+    if (iterm == NULL) {
+      warning(0, "Can't find iterm %s/%s in db\n", iname, mname);
+      n._found = false;
+    } else {
+      n._node = iterm->getId();
+    }
+  } else if (n._kind == BIN_BTERM) {
+    const char* bname = rd.getName();
+    dbBTerm*    bterm = block->findBTerm(bname);
+    if (bterm == NULL) {
+      warning(0, "Can't find bterm %s in db\n", bname);
+      n._found = false;
+    } else {
+      n._node = bterm->getId();
+    }
+  } else {
+    prevNode += rd.getSigned();
+    n._node = prevNode;
+  }
+}
+
+static void setBinaryNode(dbCapNode* cap, extSpefBinNode& n)
+{
+  if (!n._found) {
+    cap->setInternalFlag();
+    return;
+  }
+  cap->setNode(n._node);
+  if (n._kind == BIN_ITERM)
+    cap->setITermFlag();
+  else if (n._kind == BIN_BTERM)
+    cap->setBTermFlag();
+  else
+    cap->setInternalFlag();
+  if (n._branch)
+    cap->setBranchFlag();
+}
+
+void extSpef::writeBinaryNet(dbNet*             net,
+                             extSpefBinWriter&  wr,
+                             std::vector<uint>& capLocal)
+{
+  bool graph   = !_preserveCapValues;
+  uint nameIdx = wr.nameIdx(net->getConstName());
+  wr.putVarint(nameIdx);
+
+  odb::dbSet<dbCapNode>           capSet = net->getCapNodes();
+  odb::dbSet<dbCapNode>::iterator cap_itr;
+  wr.putVarint(capSet.size());
+  int prevNode = 0;
+  for (cap_itr = capSet.begin(); cap_itr != capSet.end(); ++cap_itr) {
+    dbCapNode* capNode = *cap_itr;
+    putBinaryNode(wr, _block, capNode, prevNode);
+    for (uint ii = 0; ii < _cornerCnt; ii++)
+      wr.putValue(capNode->getCapacitance(ii));
+  }
+
+  std::vector<dbRSeg*>         rsegs;
+  odb::dbSet<dbRSeg>           rSet = net->getRSegs();
+  odb::dbSet<dbRSeg>::iterator rc_itr;
+  for (rc_itr = rSet.begin(); rc_itr != rSet.end(); ++rc_itr) {
+    if (graph || (*rc_itr)->getSourceNode() != 0)  // foreign: no zero rseg
+      rsegs.push_back(*rc_itr);
+  }
+  wr.putVarint(rsegs.size());
+  int                            prevTgt = 0;
+  std::unordered_map<uint, uint> rsegIdx;
+  for (uint jj = 0; jj < rsegs.size(); jj++) {
+    dbRSeg* rc = rsegs[jj];
+    uint    ii;
+    if (graph) {
+      uint src = rc->getSourceNode();
+      uint tgt = rc->getTargetNode();
+      int  x, y;
+      rc->getCoords(x, y);
+      wr.putVarint(src ? capLocal[src] + 1 : 0);
+      wr.putVarint(tgt ? capLocal[tgt] + 1 : 0);
+      wr.putSigned(x);
+      wr.putSigned(y);
+      wr.putByte(rc->pathLowToHigh() ? 0 : 1);
+      wr.putByte(rc->updatedCap() ? 1 : 0);
+      for (ii = 0; ii < _cornerCnt; ii++)
+        wr.putValue(rc->getResistance(ii));
+      for (ii = 0; ii < _cornerCnt; ii++)
+        wr.putValue(rc->getCapacitance(ii));
+      rsegIdx[rc->getId()] = jj;
+      continue;
+    }
+    int src = capLocal[rc->getSourceNode()];
+    int tgt = capLocal[rc->getTargetNode()];
+    wr.putSigned(src - prevTgt);
+    wr.putSigned(tgt - src);
+    prevTgt = tgt;
+    for (ii = 0; ii < _cornerCnt; ii++)
+      wr.putValue(rc->getResistance(ii));
+  }
+
+  if (graph) {  // shape to rseg links, as set by the extraction
+    std::vector<uint> links;
+    dbWire*           wire = net->getWire();
+    dbWireShapeItr    shapes;
+    dbShape           s;
+    if (wire != NULL) {
+      for (shapes.begin(wire); shapes.next(s);) {
+        int shapeId = shapes.getShapeId();
+        int rsegId  = 0;
+        if (s.isVia())
+          rsegId = _ext->getShapeProperty(net, shapeId);
+        else if (!wire->getProperty(shapeId, rsegId))
+          rsegId = 0;
+        std::unordered_map<uint, uint>::iterator it = rsegIdx.find(rsegId);
+        if (rsegId == 0 || it == rsegIdx.end())
+          continue;
+        links.push_back(shapeId);
+        links.push_back(it->second);
+        links.push_back(s.isVia() ? 1 : 0);
+      }
+    }
+    wr.putVarint(links.size() / 3);
+    for (uint jj = 0; jj < links.size(); jj += 3) {
+      wr.putVarint(links[jj]);
+      wr.putVarint(links[jj + 1]);
+      wr.putByte(links[jj + 2]);
+    }
+  }
+
+  // (capnode of this net, capnode of the other net): ccsegs this net is the
+  // source of, and the ones to it from nets without section
+  std::vector<dbCCSeg*>   vec_cc;
+  std::vector<dbCapNode*> ccNodes;
+  std::vector<dbCCSeg*>   ccs;
+  net->getSrcCCSegs(vec_cc);
+  uint jj;
+  for (jj = 0; jj < vec_cc.size(); jj++) {
+    dbCapNode* tgt = vec_cc[jj]->getTargetCapNode();
+    if (tgt->getNet() == net)
+      continue;
+    ccNodes.push_back(vec_cc[jj]->getSourceCapNode());
+    ccNodes.push_back(tgt);
+    ccs.push_back(vec_cc[jj]);
+  }
+  vec_cc.clear();
+  net->getTgtCCSegs(vec_cc);
+  for (jj = 0; jj < vec_cc.size(); jj++) {
+    dbCapNode* src = vec_cc[jj]->getSourceCapNode();
+    if (src->getNet() == net || isSignalNet(src->getNet()))
+      continue;
+    ccNodes.push_back(vec_cc[jj]->getTargetCapNode());
+    ccNodes.push_back(src);
+    ccs.push_back(vec_cc[jj]);
+  }
+  wr.putVarint(ccs.size());
+  for (jj = 0; jj < ccs.size(); jj++) {
+    dbCCSeg*   cc       = ccs[jj];
+    dbCapNode* other    = ccNodes[2 * jj + 1];
+    dbNet*     otherNet = other->getNet();
+    uint       tIdx     = wr.nameIdx(otherNet->getConstName());
+    wr.putVarint(capLocal[ccNodes[2 * jj]->getId()]);
+    wr.putSigned((int64_t) tIdx - (int64_t) nameIdx);
+    if (isSignalNet(otherNet)) {
+      wr.putVarint(capLocal[other->getId()] + 1);
+    } else {
+      int prev = 0;
+      wr.putVarint(0);
+      putBinaryNode(wr, _block, other, prev);
+    }
+    for (uint ii = 0; ii < _cornerCnt; ii++)
+      wr.putValue(cc->getCapacitance(ii));
+  }
+}
+
+uint extSpef::writeBinary(const char* filename, bool float64, bool quiet)
+{
+  if (_independentExtCorners) {
+    warning(0,
+            "Binary parasitics can not be written for independent extraction "
+            "corners\n");
+    return 0;
+  }
+  setCornerCnt(_block->getCornerCount());
+  _cornersPerBlock = _cornerCnt;
+  _cornerBlock     = _block;
+
+  FILE* fp = fopen(filename, "wb");
+  if (fp == NULL) {
+    warning(0, "Can not open file %s to write binary parasitics\n", filename);
+    return 0;
+  }
+  extSpefBinWriter wr;
+  wr._float64   = float64;
+  wr._cornerCnt = _cornerCnt;
+
+  // local index of every capnode in its net, referenced by rsegs and ccsegs;
+  // net names are interned first so targets of ccsegs resolve to any section
+  std::vector<dbNet*>         nets;
+  std::vector<uint>           capLocal;
+  odb::dbSet<dbNet>           bnets = _block->getNets();
+  odb::dbSet<dbNet>::iterator net_itr;
+  for (net_itr = bnets.begin(); net_itr != bnets.end(); ++net_itr) {
+    dbNet* net = *net_itr;
+    if (!isSignalNet(net))
+      continue;
+    odb::dbSet<dbCapNode> capSet = net->getCapNodes();
+    if (capSet.size() == 0)
+      continue;
+    nets.push_back(net);
+    wr.nameIdx(net->getConstName());
+
+    uint                            kk = 0;
+    odb::dbSet<dbCapNode>::iterator cap_itr;
+    for (cap_itr = capSet.begin(); cap_itr != capSet.end(); ++cap_itr) {
+      uint id = (*cap_itr)->getId();
+      if (id >= capLocal.size())
+        capLocal.resize(id + 1024, 0);
+      capLocal[id] = kk++;
+    }
+  }
+
+  wr.putBytes(BIN_MAGIC, sizeof(BIN_MAGIC));
+  wr.putFixed(BIN_VERSION, 4);
+  wr.putFixed(_cornerCnt, 4);
+  wr.putFixed(float64 ? sizeof(double) : sizeof(float), 4);
+  wr.putFixed(_preserveCapValues ? 0 : BIN_GRAPH, 4);
+  fwrite(&wr._buf[0], 1, wr._buf.size(), fp);
+  uint64_t pos = BIN_HEADER_LEN;
+
+  std::vector<uint64_t> offsets;
+  std::vector<uint>     nameIds;
+  for (uint ii = 0; ii < nets.size(); ii++) {
+    offsets.push_back(pos);
+    nameIds.push_back(wr.nameIdx(nets[ii]->getConstName()));
+    wr._buf.clear();
+    writeBinaryNet(nets[ii], wr, capLocal);
+    fwrite(&wr._buf[0], 1, wr._buf.size(), fp);
+    pos += wr._buf.size();
+
+    if ((ii + 1) % 100000 == 0)
+      notice(0, "%d nets finished\n", ii + 1);
+  }
+
+  uint64_t stringsOffset = pos;
+  wr._buf.clear();
+  wr.putVarint(wr._names.size());
+  for (uint ii = 0; ii < wr._names.size(); ii++) {
+    wr.putVarint(wr._names[ii].size());
+    wr.putBytes(wr._names[ii].c_str(), wr._names[ii].size());
+  }
+  fwrite(&wr._buf[0], 1, wr._buf.size(), fp);
+  pos += wr._buf.size();
+
+  uint64_t indexOffset = pos;
+  wr._buf.clear();
+  wr.putVarint(nets.size());
+  for (uint ii = 0; ii < nets.size(); ii++) {
+    wr.putVarint(nameIds[ii]);
+    wr.putFixed(offsets[ii], 8);
+  }
+  wr.putFixed(stringsOffset, 8);
+  wr.putFixed(indexOffset, 8);
+  wr.putBytes(BIN_MAGIC, sizeof(BIN_MAGIC));
+  fwrite(&wr._buf[0], 1, wr._buf.size(), fp);
+  if (fclose(fp) != 0) {
+    warning(0, "Can not write binary parasitics file %s\n", filename);
+    return 0;
+  }
+
+  if (!quiet)
+    notice(0,
+           "%d nets finished, %d names in string table\n",
+           (uint) nets.size(),
+           (uint) wr._names.size());
+  return nets.size();
+}
+
+uint extSpef::readBinaryNet(dbNet* net, extSpefBinReader& rd)
+{
+  uint nameIdx = rd.getVarint();
+  if (rd._bad || nameIdx >= rd._names.size())
+    return 0;
+
+  if (net->getZeroRSeg()) {
+    warning(0,
+            "net %d %s has rseg before reading parasitics\n",
+            net->getId(),
+            net->getConstName());
+    return 0;
+  }
+  dbRSeg* zrseg = NULL;
+  if (!rd._graph)
+    zrseg = dbRSeg::create(net, 0, 0, 0, false);  // "foreign" mode
+
+  uint               capCnt = rd.getVarint();
+  std::vector<uint>& capIds = rd._capIds[nameIdx];
+  capIds.resize(capCnt);
+  int            node = 0;
+  extSpefBinNode n;
+  for (uint ii = 0; ii < capCnt && !rd._bad; ii++) {
+    dbCapNode* cap = dbCapNode::create(net, 0, !rd._graph);
+    getBinaryNode(rd, _block, node, n);
+    if (!n._found && n._kind == BIN_ITERM)
+      _unmatchedSpefInst++;
+    setBinaryNode(cap, n);
+    for (uint jj = 0; jj < rd._cornerCnt; jj++)
+      cap->setCapacitance(rd.getValue(), jj);
+    capIds[ii] = cap->getId();
+  }
+  net->getCapNodes().reverse();
+
+  uint              rsegCnt = rd.getVarint();
+  std::vector<uint> rsegIds;
+  int               tgt = 0;
+  for (uint ii = 0; ii < rsegCnt && !rd._bad; ii++) {
+    uint jj;
+    if (rd._graph) {
+      uint src     = rd.getVarint();
+      uint dst     = rd.getVarint();
+      int  x       = rd.getSigned();
+      int  y       = rd.getSigned();
+      uint pathDir = rd.getByte();
+      bool updated = rd.getByte() != 0;
+      if (src > capCnt || dst > capCnt) {
+        rd._bad = true;
+        break;
+      }
+      dbRSeg* rc    = dbRSeg::create(net, x, y, pathDir, true);
+      uint    srcId = src ? capIds[src - 1] : 0;
+      uint    dstId = dst ? capIds[dst - 1] : 0;
+      rc->setSourceNode(srcId);
+      rc->setTargetNode(dstId);
+      if (srcId > 0) {  // as addRSeg counts them; not the zero rseg
+        (dbCapNode::getCapNode(_block, srcId))->incrChildrenCnt();
+        if (dstId > 0)
+          (dbCapNode::getCapNode(_block, dstId))->incrChildrenCnt();
+      }
+      for (jj = 0; jj < rd._cornerCnt; jj++)
+        rc->setResistance(rd.getValue(), jj);
+      for (jj = 0; jj < rd._cornerCnt; jj++) {
+        double cap = rd.getValue();
+        if (updated)  // set caps mark the rsegs assembly_RCs merges
+          rc->setCapacitance(cap, jj);
+      }
+      rsegIds.push_back(rc->getId());
+      continue;
+    }
+    int src = tgt + rd.getSigned();
+    tgt     = src + rd.getSigned();
+    if (src < 0 || tgt < 0 || src >= (int) capCnt || tgt >= (int) capCnt) {
+      rd._bad = true;
+      break;
+    }
+    if (ii == 0) {
+      int ttx, tty;
+      zrseg->setTargetNode(capIds[src]);
+      dbCapNode::getCapNode(_block, capIds[src])->getTermCoords(ttx, tty);
+      zrseg->setCoords(ttx, tty);
+    }
+    dbRSeg* rseg = dbRSeg::create(net, 0, 0, 0, false);
+    for (jj = 0; jj < rd._cornerCnt; jj++)
+      rseg->setResistance(rd.getValue(), jj);
+    rseg->setSourceNode(capIds[src]);
+    rseg->setTargetNode(capIds[tgt]);
+  }
+  net->getRSegs().reverse();
+
+  if (rd._graph) {
+    uint    linkCnt = rd.getVarint();
+    dbWire* wire    = net->getWire();
+    for (uint ii = 0; ii < linkCnt && !rd._bad; ii++) {
+      uint shapeId = rd.getVarint();
+      uint rseg    = rd.getVarint();
+      bool via     = rd.getByte() != 0;
+      if (wire == NULL || rseg >= rsegIds.size())
+        continue;
+      if (via)
+        _ext->createShapeProperty(net, shapeId, rsegIds[rseg]);
+      else
+        wire->setProperty(shapeId, rsegIds[rseg]);
+    }
+    net->setRCgraph(true);
+    _ext->clearWireAltered(net);
+  }
+
+  uint ccCnt = rd.getVarint();
+  for (uint ii = 0; ii < ccCnt && !rd._bad; ii++) {
+    extSpefBinCC cc;
+    uint         srcLocal = rd.getVarint();
+    uint         tgtRef;
+    cc._tgtNameIdx = nameIdx + rd.getSigned();
+    cc._tgtLocal   = 0;
+    cc._tgtCapId   = 0;
+    tgtRef         = rd.getVarint();
+    if (srcLocal >= capCnt || cc._tgtNameIdx >= rd._names.size()) {
+      rd._bad = true;
+      break;
+    }
+    if (tgtRef > 0) {
+      cc._tgtLocal = tgtRef - 1;
+    } else {  // node of a power/ground net, created on first reference
+      int prev = 0;
+      getBinaryNode(rd, _block, prev, n);
+      dbNet* tnet = _block->findNet(rd._names[cc._tgtNameIdx].c_str());
+      if (tnet != NULL && n._found) {
+        uint64_t key = ((uint64_t) cc._tgtNameIdx << 34)
+                       | ((uint64_t) n._kind << 32) | n._node;
+        uint& capId = rd._otherCapIds[key];
+        if (capId == 0) {
+          dbCapNode* cap = dbCapNode::create(tnet, 0, !rd._graph);
+          setBinaryNode(cap, n);
+          capId = cap->getId();
+        }
+        cc._tgtCapId = capId;
+      }
+    }
+    cc._valIndex = rd._ccVals.size();
+    for (uint jj = 0; jj < rd._cornerCnt; jj++)
+      rd._ccVals.push_back(rd.getValue());
+    if (tgtRef == 0 && cc._tgtCapId == 0)
+      continue;  // other net not in db
+    cc._srcCapId = capIds[srcLocal];
+    rd._ccs.push_back(cc);
+  }
+  net->setSpef(true);
+  return rd._bad ? 0 : 1;
+}
+
+uint extSpef::readBinary(const char*          filename,
+                         std::vector<dbNet*>& tnets,
+                         bool                 quiet)
+{
+  FILE* fp = fopen(filename, "rb");
+  if (fp == NULL) {
+    warning(0, "Can not open binary parasitics file %s\n", filename);
+    return 0;
+  }
+  extSpefBinReader           rd;
+  std::vector<unsigned char> head(BIN_HEADER_LEN);
+  rd._p   = &head[0];
+  rd._end = rd._p + fread(&head[0], 1, BIN_HEADER_LEN, fp);
+  rd._bad = false;
+  if (rd._end - rd._p < (long) BIN_HEADER_LEN
+      || memcmp(rd._p, BIN_MAGIC, sizeof(BIN_MAGIC)) != 0) {
+    warning(0, "%s is not a binary parasitics file\n", filename);
+    fclose(fp);
+    return 0;
+  }
+  rd._p += sizeof(BIN_MAGIC);
+  uint version = rd.getFixed(4);
+  if (version != BIN_VERSION) {
+    warning(0,
+            "%s has binary parasitics version %d, expected %d\n",
+            filename,
+            version,
+            BIN_VERSION);
+    fclose(fp);
+    return 0;
+  }
+  rd._cornerCnt = rd.getFixed(4);
+  rd._float64   = rd.getFixed(4) == sizeof(double);
+  rd._graph     = (rd.getFixed(4) & BIN_GRAPH) != 0;
+
+  if (_cornerCnt && _cornerCnt != rd._cornerCnt) {
+    notice(0,
+           "Mismatch on the numbers of corners: file has %d corners vs. "
+           "Process corner table has %d corners.\n",
+           rd._cornerCnt,
+           _cornerCnt);
+    fclose(fp);
+    return 0;
+  }
+
+  // string table and index are contiguous and read at once
+  unsigned char footBuf[BIN_FOOTER_LEN];
+  uint64_t      footer[2];
+  fseeko(fp, -(off_t) BIN_FOOTER_LEN, SEEK_END);
+  uint64_t fileSize = ftello(fp) + BIN_FOOTER_LEN;
+  rd._p             = footBuf;
+  rd._end           = rd._p + fread(footBuf, 1, BIN_FOOTER_LEN, fp);
+  footer[0]         = rd.getFixed(8);
+  footer[1]         = rd.getFixed(8);
+  if (rd._bad || footer[0] > footer[1]
+      || footer[1] > fileSize - BIN_FOOTER_LEN) {
+    warning(0, "Corrupted binary parasitics file %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+  uint64_t tailSize = fileSize - BIN_FOOTER_LEN - footer[0];
+  std::vector<unsigned char> tail(tailSize + 1);
+  fseeko(fp, (off_t) footer[0], SEEK_SET);
+  tailSize = fread(&tail[0], 1, tailSize, fp);
+  rd._p    = &tail[0];
+  rd._end  = rd._p + tailSize;
+
+  uint nameCnt = rd.getVarint();
+  for (uint ii = 0; ii < nameCnt && !rd._bad; ii++) {
+    uint len = rd.getVarint();
+    if (rd._p + len > rd._end) {
+      rd._bad = true;
+      break;
+    }
+    rd._names.push_back(std::string((const char*) rd._p, len));
+    rd._p += len;
+  }
+  rd._p = &tail[0] + (footer[1] - footer[0]);
+  std::vector<uint>     nameIds;
+  std::vector<uint64_t> offsets;
+  uint                  netCnt = rd.getVarint();
+  for (uint ii = 0; ii < netCnt && !rd._bad; ii++) {
+    nameIds.push_back(rd.getVarint());
+    offsets.push_back(rd.getFixed(8));
+  }
+  offsets.push_back(footer[0]);
+  if (rd._bad || rd._names.size() == 0) {
+    warning(0, "Corrupted binary parasitics file %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+
+  if (_cornerCnt == 0) {
+    setCornerCnt(rd._cornerCnt);
+    extMain::addDummyCorners(_block, _cornerCnt);
+  }
+  _block->setCornerCount(_cornerCnt);
+  _preserveCapValues = !rd._graph;
+  rd._capIds.resize(rd._names.size());
+  _unmatchedSpefNet  = 0;
+  _unmatchedSpefInst = 0;
+
+  uint ii;
+  for (ii = 0; ii < tnets.size(); ii++)
+    tnets[ii]->setMark(true);
+
+  // the index gives random access to the selected nets
+  std::vector<dbNet*>        loaded;
+  std::vector<unsigned char> buf;
+  for (ii = 0; ii < nameIds.size(); ii++) {
+    if (nameIds[ii] >= rd._names.size())
+      continue;
+    const char* name = rd._names[nameIds[ii]].c_str();
+    dbNet*      net  = _block->findNet(name);
+    if (net == NULL) {
+      _unmatchedSpefNet++;
+      continue;
+    }
+    if (tnets.size() && !net->isMarked())
+      continue;
+
+    uint64_t size = offsets[ii + 1] - offsets[ii];
+    buf.resize(size + 1);
+    fseeko(fp, (off_t) offsets[ii], SEEK_SET);
+    rd._p   = &buf[0];
+    rd._end = rd._p + fread(&buf[0], 1, size, fp);
+    if (!readBinaryNet(net, rd)) {
+      if (rd._bad) {
+        warning(0, "Corrupted section of net %s\n", name);
+        rd._bad = false;
+      }
+      continue;
+    }
+    loaded.push_back(net);
+  }
+  fclose(fp);
+
+  uint ccCnt = 0;
+  for (ii = 0; ii < rd._ccs.size(); ii++) {
+    extSpefBinCC& cc    = rd._ccs[ii];
+    uint          tgtId = cc._tgtCapId;
+    if (tgtId == 0) {
+      std::vector<uint>& tgts = rd._capIds[cc._tgtNameIdx];
+      if (cc._tgtLocal >= tgts.size())
+        continue;  // target net not read
+      tgtId = tgts[cc._tgtLocal];
+    }
+    dbCCSeg* ccap
+        = dbCCSeg::create(dbCapNode::getCapNode(_block, cc._srcCapId),
+                          dbCapNode::getCapNode(_block, tgtId),
+                          true);
+    for (uint jj = 0; jj < rd._cornerCnt; jj++)
+      ccap->setCapacitance(rd._ccVals[cc._valIndex + jj], jj);
+    ccCnt++;
+  }
+  for (ii = 0; ii < loaded.size(); ii++)
+    loaded[ii]->reverseCCSegs();
+  for (ii = 0; ii < tnets.size(); ii++)
+    tnets[ii]->setMark(false);
+
+  if (_unmatchedSpefNet)
+    notice(0, "%d nets of %s not found in db\n", _unmatchedSpefNet, filename);
+  if (!quiet)
+    notice(0,
+           "Have read %d nets, %d coupling caps from %s\n",
+           (uint) loaded.size(),
+           ccCnt,
+           filename);
+  return loaded.size();
+}
+
+}  // namespace OpenRCX
@@ -422,6 +422,80 @@ void extSpef::addCouplingCapId(uint ccId)
   _node2nodeHashTable->addNewName(_tmpBuff1, ccId);
   _node2nodeHashTable->addNewName(_tmpBuff2, ccId);
 }
+extNodeIdTable::extNodeIdTable(uint size)
+{
+  _size = 1024;
+  while (_size < size)
+    _size <<= 1;
+  _mask   = _size - 1;
+  _cnt    = 0;
+  _keys   = new uint64_t[_size];
+  _capIds = new uint[_size];
+  memset(_capIds, 0, _size * sizeof(uint));
+}
+extNodeIdTable::~extNodeIdTable()
+{
+  delete[] _keys;
+  delete[] _capIds;
+}
+uint extNodeIdTable::hashSlot(uint64_t key)
+{
+  key *= 0x9E3779B97F4A7C15ULL;
+  return (uint) (key >> 32) & _mask;
+}
+void extNodeIdTable::reHash(uint size)
+{
+  uint64_t* keys    = _keys;
+  uint*     capIds  = _capIds;
+  uint      oldSize = _size;
+
+  _size   = size;
+  _mask   = _size - 1;
+  _keys   = new uint64_t[_size];
+  _capIds = new uint[_size];
+  memset(_capIds, 0, _size * sizeof(uint));
+  for (uint ii = 0; ii < oldSize; ii++) {
+    if (capIds[ii] == 0)
+      continue;
+    uint jj = hashSlot(keys[ii]);
+    while (_capIds[jj] != 0)
+      jj = (jj + 1) & _mask;
+    _keys[jj]   = keys[ii];
+    _capIds[jj] = capIds[ii];
+  }
+  delete[] keys;
+  delete[] capIds;
+}
+uint extNodeIdTable::get(uint netMapId, uint nodeNum)
+{
+  uint64_t key = mkKey(netMapId, nodeNum);
+  uint     ii  = hashSlot(key);
+  while (_capIds[ii] != 0) {
+    if (_keys[ii] == key)
+      return _capIds[ii];
+    ii = (ii + 1) & _mask;
+  }
+  return 0;
+}
+void extNodeIdTable::set(uint netMapId, uint nodeNum, uint capId)
+{
+  if ((_cnt + 1) * 10 > _size * 7)  // keep load under 70%
+    reHash(_size << 1);
+
+  uint64_t key = mkKey(netMapId, nodeNum);
+  uint     ii  = hashSlot(key);
+  while (_capIds[ii] != 0) {
+    if (_keys[ii] == key) {
+      _capIds[ii] = capId;
+      return;
+    }
+    ii = (ii + 1) & _mask;
+  }
+  _keys[ii]   = key;
+  _capIds[ii] = capId;
+  _cnt++;
+}
+
 uint extSpef::getCapIdFromCapTable(char* nodeWord)
 {
   if (_cc_app_print_limit) {
@@ -437,6 +511,41 @@ void extSpef::addNewCapIdOnCapTable(char* nodeWord, uint capId)
 {
   _nodeHashTable->addNewName(nodeWord, capId);
 }
+uint extSpef::getCapIdFromCapTable(uint netMapId, uint nodeNum)
+{
+  uint id = _nodeIdTable->get(netMapId, nodeNum);
+  if (id && _cc_app_print_limit)
+    _ccidmap->set(id, netMapId);
+  return id;
+}
+void extSpef::addNewCapIdOnCapTable(uint netMapId, uint nodeNum, uint capId)
+{
+  _nodeIdTable->set(netMapId, nodeNum, capId);
+}
+// Parses an internal node word "*<netMapId><delimiter><nodeNumber>" straight
+// into its ids
+bool extSpef::parseInternalNode(const char* nodeWord,
+                                uint&       netMapId,
+                                uint&       nodeNum)
+{
+  const char* p = nodeWord;
+  if (*p++ != '*' || *p < '0' || *p > '9')
+    return false;
+  uint id = 0;
+  while (*p >= '0' && *p <= '9')
+    id = id * 10 + (*p++ - '0');
+  if (*p++ != _delimiter[0] || *p < '0' || *p > '9')
+    return false;
+  uint n = 0;
+  while (*p >= '0' && *p <= '9')
+    n = n * 10 + (*p++ - '0');
+  if (*p != '\0')
+    return false;
+
+  netMapId = id;
+  nodeNum  = n;
+  return true;
+}
 void extSpef::checkCCterm()
 {
   dbNet* tnet1 = NULL;
@@ -496,14 +605,19 @@ uint extSpef::getCapNodeId(char* nodeWord, char* capWord, uint* netId)
       addNewCapIdOnCapTable(nodeWord, capId);
     }
   }
-  uint tokenCnt = _nodeParser->mkWords(nodeWord);
+  uint id1    = 0;
+  uint nodeId = 0;
+  bool internalNode
+      = !_testParsing && _maxMapId && parseInternalNode(nodeWord, id1, nodeId);
+  uint tokenCnt = internalNode ? 2 : _nodeParser->mkWords(nodeWord);
 
   dbNet* net       = NULL;
   dbNet* cornerNet = NULL;
   if (tokenCnt == 2)  // iterm or internal node
   {
-    uint id1;
-    if (_maxMapId) {
+    if (internalNode) {
+      _spefName = _nameMapTable->geti(id1);
+    } else if (_maxMapId) {
       id1       = _nodeParser->getInt(0, 1);
       _spefName = _nameMapTable->geti(id1);
     } else {
@@ -511,30 +625,42 @@ uint extSpef::getCapNodeId(char* nodeWord, char* capWord, uint* netId)
       _spefName = _nodeParser->get(0);
     }
 
-    if (_nodeParser->isDigit(1, 0))  // internal node
+    if (internalNode || _nodeParser->isDigit(1, 0))  // internal node
     {
-      net = getDbNet(netId, id1);
-      //*netId= getNameMapId(id1);
-      if (_cornerBlock != _block)
-        cornerNet = dbNet::getNet(_cornerBlock, net->getId());
-      else
-        cornerNet = net;
+      if (!internalNode)
+        nodeId = _nodeParser->getInt(1, 0);
 
-      uint nodeId = _nodeParser->getInt(1, 0);
+      if (internalNode && !_diff)
+        capId = getCapIdFromCapTable(id1, nodeId);
+
+      if (internalNode && capId > 0) {  // no need for the net name lookup
+        cap       = dbCapNode::getCapNode(_cornerBlock, capId);
+        cornerNet = cap->getNet();
+        *netId    = cornerNet->getId();
+      } else {
+        net = getDbNet(netId, id1);
+        //*netId= getNameMapId(id1);
+        if (_cornerBlock != _block)
+          cornerNet = dbNet::getNet(_cornerBlock, net->getId());
+        else
+          cornerNet = net;
 
-      if (!_testParsing && !_diff) {
-        capId = getCapIdFromCapTable(nodeWord);
+        if (!_testParsing && !_diff) {
+          uint netMapId = _maxMapId ? id1 : net->getId();
+          if (!internalNode)
+            capId = getCapIdFromCapTable(netMapId, nodeId);
 
-        if (capId > 0) {
-          cap = dbCapNode::getCapNode(_cornerBlock, capId);
-        } else {
-          // cap= dbCapNode::create(dbNet::getNet(_block, *netId), 0, true); //
-          // "foreign" mode
-          cap   = dbCapNode::create(cornerNet, 0, true);  // "foreign" mode
-          capId = cap->getId();
-          addNewCapIdOnCapTable(nodeWord, capId);
-          cap->setNode(nodeId);
-          cap->setInternalFlag();
+          if (capId > 0) {
+            cap = dbCapNode::getCapNode(_cornerBlock, capId);
+          } else {
+            cap   = dbCapNode::create(cornerNet, 0, true);  // "foreign" mode
+            capId = cap->getId();
+            addNewCapIdOnCapTable(netMapId, nodeId, capId);
+            if (_cc_app_print_limit)
+              _ccidmap->set(capId, netMapId);
+            cap->setNode(nodeId);
+            cap->setInternalFlag();
+          }
         }
       }
     } else  // iterm
@@ -2252,6 +2378,23 @@ uint extSpef::readDNet(uint debug)
   return 0;  // should not get here!!!
 }
 
+bool extSpef::sortDNetRSegs()
+{
+  bool sortingRSeg = _d_net && !_keep_loaded_corner
+                     && (_doSortRSeg || _readingNodeCoords != C_NONE);
+  if (!sortingRSeg)
+    return false;
+
+  sortRSegs();
+  dbSet<dbCapNode>           nodeSet = _d_corner_net->getCapNodes();
+  dbSet<dbCapNode>::iterator rc_itr;
+  for (rc_itr = nodeSet.begin(); rc_itr != nodeSet.end(); ++rc_itr) {
+    dbCapNode* node = *rc_itr;
+    node->setSortIndex(0);
+  }
+  return true;
+}
+
 void extSpef::setupMapping(uint itermCnt)
 {
   if (_btermTable)
@@ -2292,7 +2435,6 @@ void extSpef::createName(uint n, char* name)
 }
 void extSpef::addNetNodeHash(dbNet* net)
 {
-  char                       nodeWord[100];
   uint                       netId = net->getId();
   uint                       capId;
   uint                       nodeNum;
@@ -2314,8 +2456,7 @@ void extSpef::addNetNodeHash(dbNet* net)
       iterm->setExtId(capId);
       continue;
     }
-    sprintf(nodeWord, "*%d%s%d", netId, _delimiter, nodeNum);
-    addNewCapIdOnCapTable(nodeWord, capId);
+    addNewCapIdOnCapTable(netId, nodeNum, capId);
   }
 }
 
@@ -2336,6 +2477,9 @@ void extSpef::reinit()
   if (_nodeHashTable)
     delete _nodeHashTable;
   _nodeHashTable = NULL;
+  if (_nodeIdTable)
+    delete _nodeIdTable;
+  _nodeIdTable = NULL;
   if (_notFoundInst)
     delete _notFoundInst;
   _notFoundInst = NULL;
@@ -2642,8 +2786,10 @@ uint extSpef::readBlock(uint                debug,
     _idMapTable->reSize(_maxMapId + 1);
     resetNameTable(_maxMapId + 1);
   }
-  if (_nodeHashTable == NULL)
+  if (_testParsing && _nodeHashTable == NULL)
     _nodeHashTable = new Ath__nameTable(8000000);
+  if (_nodeIdTable == NULL)  // grows on demand, start near a few nodes/net
+    _nodeIdTable = new extNodeIdTable(4 * _block->getNets().size());
   if (_notFoundInst == NULL)
     _notFoundInst = new Ath__nameTable(800);
   if (_rRun == 1 && _extracted && _rOnlyCCcap)
@@ -2685,32 +2831,28 @@ uint extSpef::readBlock(uint                debug,
     _multipleLoop      = 0;
     _breakLoopNet      = 0;
     bool doSortingRSeg = false;
-    do {
-      cnt++;
-      readDNet(debug);
-
-      if (cnt % 100000 == 0) {
-        notice(0,
-               "Have read %d D_NET nets, %d resistors, %d gnd caps %d coupling "
-               "caps\n",
-               cnt,
-               _resCnt,
-               _gndCapCnt,
-               _ccCapCnt);
-      }
-      bool sortingRSeg = _d_net && !_keep_loaded_corner
-                         && (_doSortRSeg || _readingNodeCoords != C_NONE);
-      doSortingRSeg |= sortingRSeg;
-      if (sortingRSeg) {
-        sortRSegs();
-        dbSet<dbCapNode>           nodeSet = _d_corner_net->getCapNodes();
-        dbSet<dbCapNode>::iterator rc_itr;
-        for (rc_itr = nodeSet.begin(); rc_itr != nodeSet.end(); ++rc_itr) {
-          dbCapNode* node = *rc_itr;
-          node->setSortIndex(0);
+    bool parallelRead
+        = isParallelReadable() && readDNetsParallel(doSortingRSeg, cnt);
+    if (!parallelRead && cnt > 0)
+      skipDNetSections(cnt);
+    if (!parallelRead && isStreamDiffable())
+      cnt = diffDNetsStreaming(debug);
+    else if (!parallelRead)
+      do {
+        cnt++;
+        readDNet(debug);
+
+        if (cnt % 100000 == 0) {
+          notice(0,
+                 "Have read %d D_NET nets, %d resistors, %d gnd caps %d "
+                 "coupling caps\n",
+                 cnt,
+                 _resCnt,
+                 _gndCapCnt,
+                 _ccCapCnt);
         }
-      }
-    } while (_parser->parseNextLine() > 0);
+        doSortingRSeg |= sortDNetRSegs();
+      } while (_parser->parseNextLine() > 0);
     if (doSortingRSeg)
       _cornerBlock->preExttreeMergeRC(0.0, 0);
     if (_stampWire)
@@ -2832,7 +2974,16 @@ void extSpef::printCapNode(uint capNodeId)
   } else if (capNode->isBTerm()) {
     notice(0, "%s ", dbBTerm::getBTerm(_block, tid)->getName().c_str());
   } else {
-    notice(0, "%s ", _nodeHashTable->getName(tid));
+    if (_nodeHashTable)
+      notice(0, "%s ", _nodeHashTable->getName(tid));
+    else if (_maxMapId)
+      notice(0, "*%d%s%d ", tid, _delimiter, tnode);
+    else
+      notice(0,
+             "%s%s%d ",
+             capNode->getNet()->getConstName(),
+             _delimiter,
+             tnode);
   }
 }
 void extSpef::printAppearance(int app, int appc)
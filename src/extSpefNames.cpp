@@ -0,0 +1,287 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Interned SPEF names
+//
+// The name map, *D_NET headers and node names all print net and instance
+// names through tinkerSpefName(), which copies the name to strip the
+// backslashes when the spef is written with -no_backslash. The escaped
+// names are kept per block instead, built for all nets and instances at
+// once when the name map is written (the escaping runs in parallel; the
+// names are collected from odb on the calling thread), and reused by every
+// later write_spef on the block, including one write per corner.
+//
+// Tables are kept by block id. Objects can be renamed, and ids and blocks
+// reused after a destroy, so every lookup checks the entry against the
+// current name (the name minus its backslashes must equal the entry, or the
+// name has none when there is no entry) and re-escapes a stale one. The
+// check walks the name once and allocates nothing. Without -no_backslash
+// the names are printed as they are and no table is kept.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "extRCap.h"
+#include "extSpef.h"
+#include "extUtil.h"
+
+namespace OpenRCX {
+
+using odb::dbBlock;
+using odb::dbInst;
+using odb::dbNet;
+using odb::dbSet;
+
+// below this many names the table is escaped on the calling thread
+static const uint NAME_INTERN_PARALLEL_MIN = 20000;
+
+struct extSpefNameTable
+{
+  std::vector<const char*> _src;   // by object id; odb names to build from
+  std::vector<char*>       _name;  // by object id; NULL: printed as is
+  bool                     _built;
+
+  extSpefNameTable() { _built = false; }
+};
+
+class extSpefNameCache
+{
+ public:
+  extSpefNameCache() {}
+  ~extSpefNameCache() { clear(); }
+
+  void clear();
+  void build(extSpefNameTable* table, uint threadCnt);
+
+  const char* lookup(extSpefNameTable* table, uint id, const char* src);
+
+  extSpefNameTable* netTable(dbBlock* block)
+  {
+    return &_nets[block->getId()];
+  }
+  extSpefNameTable* instTable(dbBlock* block)
+  {
+    return &_insts[block->getId()];
+  }
+
+ private:
+  static void  clearTable(extSpefNameTable* table);
+  static char* escape(const char* src);
+  static bool  isEscapeOf(const char* name, const char* src);
+  static void  escapeRange(void* arg, uint first, uint last);
+
+  std::map<uint, extSpefNameTable> _nets;  // by block id
+  std::map<uint, extSpefNameTable> _insts;
+};
+
+char* extSpefNameCache::escape(const char* src)
+{
+  if (strchr(src, '\\') == NULL)
+    return NULL;
+
+  char* name = (char*) malloc(strlen(src) + 1);
+  uint  jj   = 0;
+  for (uint ii = 0; src[ii] != '\0'; ii++) {
+    if (src[ii] != '\\')
+      name[jj++] = src[ii];
+  }
+  name[jj] = '\0';
+  return name;
+}
+
+// name is src without its backslashes
+bool extSpefNameCache::isEscapeOf(const char* name, const char* src)
+{
+  for (; *src != '\0'; src++) {
+    if (*src != '\\' && *src != *name++)
+      return false;
+  }
+  return *name == '\0';
+}
+
+void extSpefNameCache::escapeRange(void* arg, uint first, uint last)
+{
+  extSpefNameTable* table = (extSpefNameTable*) arg;
+  for (uint ii = first; ii < last; ii++) {
+    if (table->_src[ii] != NULL)
+      table->_name[ii] = escape(table->_src[ii]);
+  }
+}
+
+void extSpefNameCache::build(extSpefNameTable* table, uint threadCnt)
+{
+  uint cnt = table->_src.size();
+  table->_name.assign(cnt, NULL);
+  table->_built = true;
+
+  extRunRanges(cnt, threadCnt, NAME_INTERN_PARALLEL_MIN, escapeRange, table);
+  std::vector<const char*>().swap(table->_src);
+}
+
+const char* extSpefNameCache::lookup(extSpefNameTable* table,
+                                     uint              id,
+                                     const char*       src)
+{
+  if (id >= table->_name.size())
+    table->_name.resize(id + 1, NULL);
+
+  char* name = table->_name[id];
+  if (name == NULL ? strchr(src, '\\') == NULL : isEscapeOf(name, src))
+    return name ? name : src;
+
+  free(name);  // renamed, or another object with the id
+  table->_name[id] = escape(src);
+  return table->_name[id] ? table->_name[id] : src;
+}
+
+void extSpefNameCache::clearTable(extSpefNameTable* table)
+{
+  for (uint ii = 0; ii < table->_name.size(); ii++)
+    free(table->_name[ii]);
+  table->_name.clear();
+  table->_src.clear();
+  table->_built = false;
+}
+
+void extSpefNameCache::clear()
+{
+  std::map<uint, extSpefNameTable>::iterator itr;
+  for (itr = _nets.begin(); itr != _nets.end(); ++itr)
+    clearTable(&itr->second);
+  for (itr = _insts.begin(); itr != _insts.end(); ++itr)
+    clearTable(&itr->second);
+  _nets.clear();
+  _insts.clear();
+}
+
+void extSpef::internSpefNames(dbBlock* block)
+{
+  if (!_noBackSlash)
+    return;
+  if (_nameCache == NULL)
+    _nameCache = _ext ? _ext->getSpefNameCache() : new extSpefNameCache();
+
+  extSpefNameTable* nets = _nameCache->netTable(block);
+  if (!nets->_built) {
+    dbSet<dbNet>           bnets = block->getNets();
+    dbSet<dbNet>::iterator nitr;
+    for (nitr = bnets.begin(); nitr != bnets.end(); ++nitr) {
+      dbNet* net = *nitr;
+      if (net->getId() >= nets->_src.size())
+        nets->_src.resize(net->getId() + 1, NULL);
+      nets->_src[net->getId()] = net->getConstName();
+    }
+  } else {
+    nets = NULL;  // already interned; lookups refresh stale entries
+  }
+  extSpefNameTable* insts = _nameCache->instTable(block);
+  if (!insts->_built) {
+    dbSet<dbInst>           binsts = block->getInsts();
+    dbSet<dbInst>::iterator iitr;
+    for (iitr = binsts.begin(); iitr != binsts.end(); ++iitr) {
+      dbInst* inst = *iitr;
+      if (inst->getId() >= insts->_src.size())
+        insts->_src.resize(inst->getId() + 1, NULL);
+      insts->_src[inst->getId()] = inst->getConstName();
+    }
+  } else {
+    insts = NULL;
+  }
+  if (nets == NULL && insts == NULL)
+    return;
+
+  uint threadCnt = extThreadCnt();
+  if (nets && insts && threadCnt > 1) {
+    // the two tables are independent; split the threads between them
+    uint        instThreads = threadCnt / 2;
+    std::thread instWorker(
+        &extSpefNameCache::build, _nameCache, insts, instThreads);
+    _nameCache->build(nets, threadCnt - instThreads);
+    instWorker.join();
+    return;
+  }
+  if (nets)
+    _nameCache->build(nets, threadCnt);
+  if (insts)
+    _nameCache->build(insts, threadCnt);
+}
+
+void extSpef::releaseSpefNames()
+{
+  if (_nameCache && _ext == NULL)
+    delete _nameCache;
+  _nameCache = NULL;
+}
+
+extSpefNameCache* extMain::getSpefNameCache()
+{
+  if (_spefNameCache == NULL)
+    _spefNameCache = new extSpefNameCache();
+  return _spefNameCache;
+}
+
+void extMain::clearSpefNameCache()
+{
+  if (_spefNameCache)
+    delete _spefNameCache;
+  _spefNameCache = NULL;
+}
+
+const char* extSpef::spefNetName(dbNet* net)
+{
+  if (!_noBackSlash)
+    return net->getConstName();
+  if (_nameCache == NULL)
+    _nameCache = _ext ? _ext->getSpefNameCache() : new extSpefNameCache();
+
+  return _nameCache->lookup(_nameCache->netTable(net->getBlock()),
+                            net->getId(),
+                            net->getConstName());
+}
+
+const char* extSpef::spefInstName(dbInst* inst)
+{
+  if (!_noBackSlash)
+    return inst->getConstName();
+  if (_nameCache == NULL)
+    _nameCache = _ext ? _ext->getSpefNameCache() : new extSpefNameCache();
+
+  return _nameCache->lookup(_nameCache->instTable(inst->getBlock()),
+                            inst->getId(),
+                            inst->getConstName());
+}
+
+}  // namespace OpenRCX
@@ -0,0 +1,877 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <dbLogger.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "extRCap.h"
+#include "extSpef.h"
+#include "extUtil.h"
+#include "parse.h"
+
+namespace OpenRCX {
+
+using odb::dbBlock;
+using odb::dbCapNode;
+using odb::dbCCSeg;
+using odb::dbNet;
+using odb::dbRSeg;
+using odb::notice;
+using odb::warning;
+
+// number of *D_NET sections parsed by the workers before the main thread
+// commits them, per thread; bounds the memory held in records
+static const uint DNET_BATCH_PER_THREAD = 4096;
+
+static bool isSpefSpace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static uint mkSpefWords(char* line, char** words, uint maxWords)
+{
+  uint  n = 0;
+  char* p = line;
+  while (n < maxWords) {
+    while (isSpefSpace(*p))
+      p++;
+    if (*p == '\0' || (p[0] == '/' && p[1] == '/'))
+      break;
+    words[n++] = p;
+    while (*p != '\0' && !isSpefSpace(*p))
+      p++;
+    if (*p == '\0')
+      break;
+    *p++ = '\0';
+  }
+  return n;
+}
+
+static void addSpefEntry(std::vector<extSpefDNetEntry>& table,
+                         std::vector<double>&           vals,
+                         const char*                    node1,
+                         const char*                    node2,
+                         char*                          valWord,
+                         char                           delimiter)
+{
+  extSpefDNetEntry e;
+  e._node1 = node1;
+  if (node2 != NULL)
+    e._node2 = node2;
+  e._valIndex = vals.size();
+  e._valCnt   = 0;
+
+  char* p = valWord;
+  while (true) {
+    char* end;
+    vals.push_back(strtod(p, &end));
+    e._valCnt++;
+    if (*end != delimiter)
+      break;
+    p = end + 1;
+  }
+  table.push_back(e);
+}
+
+// Worker: reads the byte range of sections [first, last) and fills
+// recs[first-recBase .. last-recBase); the records of a range that cannot
+// be read keep an empty _netWord
+static void parseDNetSections(const char*                     filename,
+                              const std::vector<uint64_t>*    offsets,
+                              uint                            first,
+                              uint                            last,
+                              uint                            recBase,
+                              char                            delimiter,
+                              std::vector<extSpefDNetRecord>* recs)
+{
+  if (first >= last)
+    return;
+
+  uint64_t begin = (*offsets)[first];
+  uint64_t size  = (*offsets)[last] - begin;
+
+  FILE* fp = fopen(filename, "r");
+  if (fp == NULL)
+    return;
+  char* buf = (char*) malloc(size + 1);
+  if (buf == NULL || fseeko(fp, (off_t) begin, SEEK_SET) != 0) {
+    free(buf);
+    fclose(fp);
+    return;
+  }
+  size      = fread(buf, 1, size, fp);
+  buf[size] = '\0';
+  fclose(fp);
+
+  enum
+  {
+    S_NONE,
+    S_CONN,
+    S_CAP,
+    S_RES
+  } state                = S_NONE;
+  extSpefDNetRecord* rec = NULL;
+  uint               ii  = first;
+  char*              words[8];
+
+  char* line = buf;
+  while (line < buf + size) {
+    char* eol = strchr(line, '\n');
+    if (eol != NULL)
+      *eol = '\0';
+
+    uint n = mkSpefWords(line, words, 8);
+    line   = eol != NULL ? eol + 1 : buf + size;
+    if (n == 0)
+      continue;
+
+    if (strcmp(words[0], "*D_NET") == 0) {
+      rec = &(*recs)[ii++ - recBase];
+      rec->_netWord = n > 1 ? words[1] : "";
+      state         = S_NONE;
+    } else if (rec == NULL)
+      continue;
+    else if (strcmp(words[0], "*CONN") == 0)
+      state = S_CONN;
+    else if (strcmp(words[0], "*CAP") == 0) {
+      state        = S_CAP;
+      rec->_hasCap = true;
+    } else if (strcmp(words[0], "*RES") == 0) {
+      state        = S_RES;
+      rec->_hasRes = true;
+    } else if (strcmp(words[0], "*END") == 0) {
+      state       = S_NONE;
+      rec->_ended = true;
+    } else if (state == S_CAP) {
+      if (n == 3)
+        addSpefEntry(
+            rec->_gndCaps, rec->_vals, words[1], NULL, words[2], delimiter);
+      else if (n == 4)
+        addSpefEntry(
+            rec->_ccCaps, rec->_vals, words[1], words[2], words[3], delimiter);
+      else
+        rec->_badLines++;
+    } else if (state == S_RES) {
+      if (n >= 4)
+        addSpefEntry(
+            rec->_res, rec->_vals, words[1], words[2], words[3], delimiter);
+      else
+        rec->_badLines++;
+    }
+  }
+  free(buf);
+}
+
+// A batch of sections [_base, _base + cnt) split in ranges between threads
+struct extSpefDNetBatch
+{
+  const char*                     _file;
+  const std::vector<uint64_t>*    _offsets;
+  uint                            _base;
+  char                            _delimiter;
+  std::vector<extSpefDNetRecord>* _recs;
+  std::vector<extSpefDNetTotals>* _totals;
+};
+
+static void parseDNetBatch(void* arg, uint first, uint last)
+{
+  extSpefDNetBatch* b = (extSpefDNetBatch*) arg;
+  parseDNetSections(b->_file,
+                    b->_offsets,
+                    b->_base + first,
+                    b->_base + last,
+                    b->_base,
+                    b->_delimiter,
+                    b->_recs);
+}
+
+bool extSpef::isParallelReadable()
+{
+  if (_readThreadCnt < 2)
+    return false;
+  if (_diff || _match || _calib || _testParsing || _statsOnly
+      || _keep_loaded_corner || _capNodeFile != NULL
+      || _readingNodeCoords != C_NONE || _inFile[0] == '\0')
+    return false;
+
+  uint len = strlen(_inFile);
+  if (len > 3 && strcmp(_inFile + len - 3, ".gz") == 0) {
+    notice(0,
+           "Compressed spef file %s is read with a single thread\n",
+           _inFile);
+    return false;
+  }
+  return true;
+}
+
+// Collects the byte offset of every *D_NET line; the end of file is appended
+// as the last offset. Returns the file size.
+uint64_t extSpef::indexDNetOffsets(const char*            filename,
+                                   std::vector<uint64_t>& offsets)
+{
+  offsets.clear();
+  FILE* fp = fopen(filename, "r");
+  if (fp == NULL)
+    return 0;
+
+  char*    line = NULL;
+  size_t   cap  = 0;
+  ssize_t  len;
+  uint64_t pos = 0;
+  while ((len = getline(&line, &cap, fp)) > 0) {
+    if (len > 6 && strncmp(line, "*D_NET", 6) == 0 && isSpefSpace(line[6]))
+      offsets.push_back(pos);
+    pos += len;
+  }
+  offsets.push_back(pos);
+  free(line);
+  fclose(fp);
+  return pos;
+}
+
+void extSpef::setCapNodeValues(dbCapNode* cap, double* vals, uint cnt)
+{
+  if (_readAllCorners) {
+    for (uint ii = 0; ii < cnt; ii++) {
+      if (_addRepeatedCapValue)
+        cap->addCapacitance(_cap_unit * vals[ii], ii);
+      else
+        cap->setCapacitance(_cap_unit * vals[ii], ii);
+    }
+    return;
+  }
+  double capVal = _cap_unit * vals[_in_spef_corner];
+  if (_addRepeatedCapValue)
+    cap->addCapacitance(capVal, _db_ext_corner);
+  else
+    cap->setCapacitance(capVal, _db_ext_corner);
+}
+
+void extSpef::createCCSeg(uint srcId, uint dstId, double* vals, uint cnt)
+{
+  dbCapNode* srcCapNode = dbCapNode::getCapNode(_cornerBlock, srcId);
+  if (srcId == dstId) {
+    warning(0,
+            "Source capnode %d is the same as target capnode %d. Add "
+            "the cc capactiance to ground.\n",
+            srcId,
+            dstId);
+    if (_readAllCorners) {
+      for (uint ii = 0; ii < cnt; ii++)
+        srcCapNode->addCapacitance(_cap_unit * vals[ii], ii);
+    } else {
+      srcCapNode->addCapacitance(_cap_unit * vals[_in_spef_corner],
+                                 _db_ext_corner);
+    }
+    return;
+  }
+  dbCapNode* tgtCapNode = dbCapNode::getCapNode(_cornerBlock, dstId);
+  dbCCSeg*   ccap       = dbCCSeg::create(srcCapNode, tgtCapNode, true);
+  if (_readAllCorners) {
+    for (uint ii = 0; ii < cnt; ii++)
+      ccap->setCapacitance(_cap_unit * vals[ii], ii);
+  } else {
+    ccap->setCapacitance(_cap_unit * vals[_in_spef_corner], _db_ext_corner);
+  }
+}
+
+// Creates the db objects of one parsed *D_NET section the same way readDNet
+// does for the text being parsed
+uint extSpef::commitDNet(extSpefDNetRecord& rec)
+{
+  uint netId = 0;
+  _netV1.clear();
+
+  if (_maxMapId) {
+    _tmpNetSpefId = atoi(rec._netWord.c_str() + 1);
+    _spefName     = _nameMapTable->geti(_tmpNetSpefId);
+  } else {
+    _tmpNetSpefId = 0;
+    _spefName     = (char*) rec._netWord.c_str();
+  }
+
+  _d_net = getDbNet(&netId, _tmpNetSpefId);
+  if (!_d_net)
+    return 0;
+  if (_cornerBlock == _block)
+    _d_corner_net = _d_net;
+  else
+    _d_corner_net = dbNet::getNet(_cornerBlock, _d_net->getId());
+  _tmpNetName = _nameMapTable->geti(_tmpNetSpefId);
+
+  _inputNet = (_tnetCnt == 0 || _d_net->isMarked()) ? true : false;
+
+  dbRSeg* zrseg = _d_corner_net->getZeroRSeg();
+  if (zrseg) {
+    warning(0,
+            "net %d %s has rseg before reading spef\n",
+            _d_net->getId(),
+            _d_net->getConstName());
+    return 0;
+  }
+  zrseg = dbRSeg::create(_d_corner_net, 0, 0, 0, false);  // "foreign" mode
+
+  if (!rec._hasCap && !rec._hasRes)
+    return 0;
+
+  if (rec._badLines)
+    warning(0,
+            "Unexpected number of tokens on %d lines of net %s\n",
+            rec._badLines,
+            rec._netWord.c_str());
+
+  uint ii;
+  if (_rCap) {
+    for (ii = 0; ii < rec._gndCaps.size(); ii++) {
+      extSpefDNetEntry& e = rec._gndCaps[ii];
+      _gndCapCnt++;
+
+      netId     = 0;
+      uint cnid = getCapNodeId((char*) e._node1.c_str(), NULL, &netId);
+      if (!cnid || !_inputNet)
+        continue;
+      setCapNodeValues(dbCapNode::getCapNode(_cornerBlock, cnid),
+                       &rec._vals[e._valIndex],
+                       e._valCnt);
+    }
+  }
+  for (ii = 0; ii < rec._ccCaps.size(); ii++) {
+    extSpefDNetEntry& e = rec._ccCaps[ii];
+    _ccCapCnt++;
+
+    // the capnode of a net read later is created here, as readDNet does
+    netId      = 1;
+    uint srcId = getCapNodeId((char*) e._node1.c_str(), NULL, &netId);
+    if (!srcId)
+      continue;
+    netId      = 2;
+    uint dstId = getCapNodeId((char*) e._node2.c_str(), NULL, &netId);
+    if (!dstId)
+      continue;
+
+    if (!_inputNet || (!_rCap && !_rOnlyCCcap))
+      continue;
+
+    createCCSeg(srcId, dstId, &rec._vals[e._valIndex], e._valCnt);
+  }
+  if (!rec._hasRes)
+    return endNet(_d_corner_net, 0);
+
+  if (_rRun == 1 && (!_extracted || _independentExtCorners))
+    _d_corner_net->getCapNodes().reverse();
+  if (_rRun == 1)
+    _d_corner_net->reverseCCSegs();
+
+  _d_corner_net->setSpef(true);
+
+  bool fstRSegDone = false;
+  uint resCnt      = 0;
+  for (ii = 0; ii < rec._res.size(); ii++) {
+    extSpefDNetEntry& e = rec._res[ii];
+    _resCnt++;
+
+    if (_rRes && _inputNet) {
+      netId             = 0;
+      uint srcCapNodeId = getCapNodeId((char*) e._node1.c_str(), NULL, &netId);
+      if (!srcCapNodeId)
+        return 0;
+      netId             = 0;
+      uint dstCapNodeId = getCapNodeId((char*) e._node2.c_str(), NULL, &netId);
+      if (!dstCapNodeId)
+        return 0;
+
+      if (fstRSegDone == false) {
+        fstRSegDone = true;
+        zrseg->setTargetNode(srcCapNodeId);
+        int ttx, tty;
+        dbCapNode::getCapNode(_cornerBlock, srcCapNodeId)
+            ->getTermCoords(ttx, tty);
+        zrseg->setCoords(ttx, tty);
+      }
+      dbRSeg* rseg = dbRSeg::create(_d_corner_net, 0, 0, 0, false);
+
+      double* vals = &rec._vals[e._valIndex];
+      if (_readAllCorners) {
+        for (uint jj = 0; jj < e._valCnt; jj++)
+          rseg->setResistance(_res_unit * vals[jj], jj);
+      } else {
+        rseg->setResistance(_res_unit * vals[_in_spef_corner], _db_ext_corner);
+      }
+      rseg->setSourceNode(srcCapNodeId);
+      rseg->setTargetNode(dstCapNodeId);
+    }
+    resCnt++;
+  }
+  return endNet(_d_corner_net, resCnt);
+}
+
+// Main thread indexes the *D_NET offsets, workers tokenize batches of sections
+// into extSpefDNetRecord and the main thread commits them in file order, so
+// the db ids are the same for any thread count. Returns false when a range
+// of the file could not be read; cnt sections are committed then and the
+// rest is left to readDNet.
+bool extSpef::readDNetsParallel(bool& doSortingRSeg, uint& cnt)
+{
+  cnt = 0;
+  std::vector<uint64_t> offsets;
+  indexDNetOffsets(_inFile, offsets);
+  if (offsets.size() < 2) {
+    warning(0, "Cannot index D_NET sections of %s\n", _inFile);
+    return false;
+  }
+
+  uint sectionCnt = offsets.size() - 1;
+  uint threadCnt  = _readThreadCnt;
+  notice(0,
+         "Reading %d D_NET sections with %d threads\n",
+         sectionCnt,
+         threadCnt);
+
+  uint batchSize = threadCnt * DNET_BATCH_PER_THREAD;
+  for (uint first = 0; first < sectionCnt; first += batchSize) {
+    uint last = first + batchSize < sectionCnt ? first + batchSize : sectionCnt;
+
+    std::vector<extSpefDNetRecord> recs(last - first);
+    for (uint ii = 0; ii < recs.size(); ii++) {
+      recs[ii]._badLines = 0;
+      recs[ii]._hasCap   = false;
+      recs[ii]._hasRes   = false;
+      recs[ii]._ended    = false;
+    }
+    extSpefDNetBatch batch;
+    batch._file      = _inFile;
+    batch._offsets   = &offsets;
+    batch._base      = first;
+    batch._delimiter = _delimiter[0];
+    batch._recs      = &recs;
+    batch._totals    = NULL;
+    extRunRanges(last - first, threadCnt, 0, parseDNetBatch, &batch);
+
+    for (uint ii = 0; ii < recs.size(); ii++) {
+      if (recs[ii]._netWord.empty()) {
+        warning(0,
+                "Cannot read D_NET section %d of %s with threads, reading "
+                "the rest with a single thread\n",
+                cnt + 1,
+                _inFile);
+        return false;
+      }
+      cnt++;
+      if (!recs[ii]._ended)
+        warning(0,
+                "D_NET %s has no *END\n",
+                recs[ii]._netWord.c_str());
+      commitDNet(recs[ii]);
+
+      if (cnt % 100000 == 0) {
+        notice(0,
+               "Have read %d D_NET nets, %d resistors, %d gnd caps %d "
+               "coupling caps\n",
+               cnt,
+               _resCnt,
+               _gndCapCnt,
+               _ccCapCnt);
+      }
+      doSortingRSeg |= sortDNetRSegs();
+    }
+  }
+  return true;
+}
+
+// Moves the parser from the first *D_NET line to the line of section cnt
+void extSpef::skipDNetSections(uint cnt)
+{
+  uint ii = 0;
+  while (ii < cnt && _parser->parseNextLine() > 0) {
+    if (_parser->isKeyword(0, "*D_NET"))
+      ii++;
+  }
+}
+
+// Adds the corner values of "v0:v1:..." to sums[0], sums[1], ...
+static void addSpefValues(std::vector<double>& sums,
+                          char*                valWord,
+                          char                 delimiter)
+{
+  char* p = valWord;
+  for (uint ii = 0;; ii++) {
+    char*  end;
+    double v = strtod(p, &end);
+    if (ii >= sums.size())
+      sums.push_back(0.0);
+    sums[ii] += v;
+    if (*end != delimiter)
+      break;
+    p = end + 1;
+  }
+}
+
+// Streaming diff worker: reads the byte range of sections [first, last) and
+// only keeps the per-corner sums of each section in totals[first-recBase ..]
+static void sumDNetSections(const char*                     filename,
+                            const std::vector<uint64_t>*    offsets,
+                            uint                            first,
+                            uint                            last,
+                            uint                            recBase,
+                            char                            delimiter,
+                            std::vector<extSpefDNetTotals>* totals)
+{
+  if (first >= last)
+    return;
+
+  uint64_t begin = (*offsets)[first];
+  uint64_t size  = (*offsets)[last] - begin;
+
+  FILE* fp = fopen(filename, "r");
+  if (fp == NULL)
+    return;
+  char* buf = (char*) malloc(size + 1);
+  if (buf == NULL || fseeko(fp, (off_t) begin, SEEK_SET) != 0) {
+    free(buf);
+    fclose(fp);
+    return;
+  }
+  size      = fread(buf, 1, size, fp);
+  buf[size] = '\0';
+  fclose(fp);
+
+  enum
+  {
+    S_NONE,
+    S_CAP,
+    S_RES
+  } state                = S_NONE;
+  extSpefDNetTotals* tot = NULL;
+  uint               ii  = first;
+  char*              words[8];
+
+  char* line = buf;
+  while (line < buf + size) {
+    char* eol = strchr(line, '\n');
+    if (eol != NULL)
+      *eol = '\0';
+
+    uint n = mkSpefWords(line, words, 8);
+    line   = eol != NULL ? eol + 1 : buf + size;
+    if (n == 0)
+      continue;
+
+    if (strcmp(words[0], "*D_NET") == 0) {
+      tot           = &(*totals)[ii++ - recBase];
+      tot->_netWord = n > 1 ? words[1] : "";
+      if (n > 2)
+        addSpefValues(tot->_totCap, words[2], delimiter);
+      state = S_NONE;
+    } else if (tot == NULL)
+      continue;
+    else if (strcmp(words[0], "*CAP") == 0)
+      state = S_CAP;
+    else if (strcmp(words[0], "*RES") == 0) {
+      state        = S_RES;
+      tot->_hasRes = true;
+    } else if (strcmp(words[0], "*END") == 0) {
+      state       = S_NONE;
+      tot->_ended = true;
+    } else if (words[0][0] == '*')
+      state = S_NONE;
+    else if (state == S_CAP) {
+      if (n == 3) {
+        addSpefValues(tot->_gndCap, words[2], delimiter);
+        tot->_gndCapCnt++;
+      } else if (n == 4) {
+        addSpefValues(tot->_ccCap, words[3], delimiter);
+        tot->_ccCapCnt++;
+      }
+    } else if (state == S_RES && n >= 4) {
+      addSpefValues(tot->_res, words[3], delimiter);
+      tot->_resCnt++;
+    }
+  }
+  free(buf);
+}
+
+static void sumDNetBatch(void* arg, uint first, uint last)
+{
+  extSpefDNetBatch* b = (extSpefDNetBatch*) arg;
+  sumDNetSections(b->_file,
+                  b->_offsets,
+                  b->_base + first,
+                  b->_base + last,
+                  b->_base,
+                  b->_delimiter,
+                  b->_totals);
+}
+
+// upper bounds of the |percent error| histogram bins; the last bin is open
+static const double DIFF_HIST_BOUNDS[extSpefDiffStats::HIST_BIN_CNT - 1]
+    = {0.1, 0.5, 1.0, 2.0, 5.0, 10.0, 20.0, 50.0};
+
+extSpefDiffStats::extSpefDiffStats(const char* name)
+{
+  _name = name;
+  for (uint ii = 0; ii < HIST_BIN_CNT; ii++)
+    _hist[ii] = 0;
+  _sum   = 0.0;
+  _sumSq = 0.0;
+}
+
+void extSpefDiffStats::add(double percent)
+{
+  double absPercent = fabs(percent);
+  uint   bin        = 0;
+  while (bin < HIST_BIN_CNT - 1 && absPercent >= DIFF_HIST_BOUNDS[bin])
+    bin++;
+  _hist[bin]++;
+  _sum += percent;
+  _sumSq += percent * percent;
+  _diffs.push_back((float) absPercent);
+}
+
+// p in [0,100]; _diffs has to be sorted
+double extSpefDiffStats::percentile(double p)
+{
+  if (_diffs.empty())
+    return 0.0;
+  uint n = (uint) ceil(p / 100.0 * _diffs.size());
+  if (n > 0)
+    n--;
+  return _diffs[n < _diffs.size() ? n : _diffs.size() - 1];
+}
+
+void extSpefDiffStats::print()
+{
+  uint cnt = _diffs.size();
+  if (cnt == 0)
+    return;
+  std::sort(_diffs.begin(), _diffs.end());
+
+  double mean = _sum / cnt;
+  notice(0,
+         "%-10s %8d values  mean %7.3f%%  rms %7.3f%%  |err| p50 %.3f%% p90 "
+         "%.3f%% p95 %.3f%% p99 %.3f%% max %.3f%%\n",
+         _name,
+         cnt,
+         mean,
+         sqrt(_sumSq / cnt),
+         percentile(50.0),
+         percentile(90.0),
+         percentile(95.0),
+         percentile(99.0),
+         _diffs[cnt - 1]);
+
+  char  buf[512];
+  char* p = buf;
+  for (uint ii = 0; ii < HIST_BIN_CNT - 1; ii++)
+    p += sprintf(p, "  <%g%%: %d", DIFF_HIST_BOUNDS[ii], _hist[ii]);
+  sprintf(p,
+          "  >=%g%%: %d",
+          DIFF_HIST_BOUNDS[HIST_BIN_CNT - 2],
+          _hist[HIST_BIN_CNT - 1]);
+  notice(0, "%-10s%s\n", "", buf);
+}
+
+// The streaming diff keeps no capnode, rseg or ccseg state and runs on the
+// same section index as the parallel reader
+bool extSpef::isStreamDiffable()
+{
+  if (!_streamDiff || !_diff || _calib || _match || _inFile[0] == '\0')
+    return false;
+
+  uint len = strlen(_inFile);
+  if (len > 3 && strcmp(_inFile + len - 3, ".gz") == 0) {
+    notice(0,
+           "Compressed spef file %s is diffed with the regular reader\n",
+           _inFile);
+    return false;
+  }
+  return true;
+}
+
+static double diffPercent(double dbVal, double refVal)
+{
+  if (refVal > 0.0)
+    return 100.0 * (dbVal - refVal) / refVal;
+  if (refVal == 0.0 && dbVal == 0.0)
+    return 0.0;
+  return 100.0;
+}
+
+void extSpef::diffNetTotals(dbNet*             net,
+                            extSpefDNetTotals& totals,
+                            extSpefDiffStats** stats)
+{
+  uint cornerCnt = _readAllCorners ? _cornerCnt : 1;
+  for (uint ii = 0; ii < cornerCnt; ii++) {
+    int  dbCorner   = _readAllCorners ? ii : _db_ext_corner;
+    uint spefCorner = _readAllCorners ? ii : _in_spef_corner;
+
+    double db[4];
+    double ref[4];
+    bool   valid[4];
+
+    valid[0] = _rCap && spefCorner < totals._totCap.size();
+    valid[1] = _rCap;
+    valid[2] = _rCap || _rOnlyCCcap;
+    valid[3] = _rRes && totals._hasRes;
+    if (valid[0]) {
+      db[0]  = net->getTotalCapacitance(dbCorner, true);
+      ref[0] = _cap_unit * totals._totCap[spefCorner];
+    }
+    if (valid[1]) {
+      db[1]  = net->getTotalCapacitance(dbCorner);
+      ref[1] = spefCorner < totals._gndCap.size()
+                   ? _cap_unit * totals._gndCap[spefCorner]
+                   : 0.0;
+    }
+    if (valid[2]) {
+      db[2]  = net->getTotalCouplingCap(dbCorner);
+      ref[2] = spefCorner < totals._ccCap.size()
+                   ? _cap_unit * totals._ccCap[spefCorner]
+                   : 0.0;
+    }
+    if (valid[3]) {
+      db[3]  = net->getTotalResistance(dbCorner);
+      ref[3] = spefCorner < totals._res.size()
+                   ? _res_unit * totals._res[spefCorner]
+                   : 0.0;
+    }
+    for (uint kk = 0; kk < 4; kk++) {
+      if (!valid[kk])
+        continue;
+      stats[kk]->add(diffPercent(db[kk], ref[kk]));
+      if (_diffDetail)
+        printDiff(net, db[kk], ref[kk], stats[kk]->_name, dbCorner);
+    }
+  }
+}
+
+// Workers tokenize batches of *D_NET sections into per-net corner sums and
+// the main thread resolves the nets and compares them against the db totals.
+// Only the summary statistics are reported unless the detailed per-net
+// report is requested.
+uint extSpef::diffDNetsStreaming(uint debug)
+{
+  std::vector<uint64_t> offsets;
+  indexDNetOffsets(_inFile, offsets);
+  if (offsets.size() < 2)
+    return 0;
+
+  uint sectionCnt = offsets.size() - 1;
+  uint threadCnt  = _readThreadCnt > 1 ? _readThreadCnt : 1;
+  notice(0,
+         "Diffing %d D_NET sections with %d threads\n",
+         sectionCnt,
+         threadCnt);
+
+  extSpefDiffStats  netCapStats("netCap");
+  extSpefDiffStats  gndCapStats("netGndCap");
+  extSpefDiffStats  ccCapStats("netCcap");
+  extSpefDiffStats  resStats("netRes");
+  extSpefDiffStats* stats[4]
+      = {&netCapStats, &gndCapStats, &ccCapStats, &resStats};
+
+  uint batchSize   = threadCnt * DNET_BATCH_PER_THREAD;
+  uint cnt         = 0;
+  uint excludedCnt = 0;
+  for (uint first = 0; first < sectionCnt; first += batchSize) {
+    uint last = first + batchSize < sectionCnt ? first + batchSize : sectionCnt;
+
+    std::vector<extSpefDNetTotals> totals(last - first);
+    for (uint ii = 0; ii < totals.size(); ii++) {
+      totals[ii]._gndCapCnt = 0;
+      totals[ii]._ccCapCnt  = 0;
+      totals[ii]._resCnt    = 0;
+      totals[ii]._hasRes    = false;
+      totals[ii]._ended     = false;
+    }
+    extSpefDNetBatch batch;
+    batch._file      = _inFile;
+    batch._offsets   = &offsets;
+    batch._base      = first;
+    batch._delimiter = _delimiter[0];
+    batch._recs      = NULL;
+    batch._totals    = &totals;
+    extRunRanges(last - first, threadCnt, 0, sumDNetBatch, &batch);
+
+    for (uint ii = 0; ii < totals.size(); ii++) {
+      extSpefDNetTotals& t = totals[ii];
+      if (t._netWord.empty()) {
+        warning(0, "Cannot read D_NET section %d of %s\n", cnt + 1, _inFile);
+        cnt++;
+        continue;
+      }
+      cnt++;
+      _gndCapCnt += t._gndCapCnt;
+      _ccCapCnt += t._ccCapCnt;
+      _resCnt += t._resCnt;
+      if (!t._ended)
+        warning(0, "D_NET %s has no *END\n", t._netWord.c_str());
+
+      if (_maxMapId) {
+        _tmpNetSpefId = atoi(t._netWord.c_str() + 1);
+        _spefName     = _nameMapTable->geti(_tmpNetSpefId);
+      } else {
+        _tmpNetSpefId = 0;
+        _spefName     = (char*) t._netWord.c_str();
+      }
+      uint   netId = 0;
+      dbNet* net   = getDbNet(&netId, _tmpNetSpefId);
+      if (!net)
+        continue;
+      _tmpNetName = _spefName;
+      if (isNetExcluded()) {
+        excludedCnt++;
+        continue;
+      }
+      diffNetTotals(net, t, stats);
+
+      if (cnt % 100000 == 0)
+        notice(0, "Have diffed %d D_NET nets\n", cnt);
+    }
+  }
+  if (debug > 0 && excludedCnt)
+    notice(0, "Skipped %d excluded nets\n", excludedCnt);
+  if (_unmatchedSpefNet)
+    notice(0, "%d spef nets not found in db\n", _unmatchedSpefNet);
+
+  notice(0, "diff_spef summary: db vs. spef percent error\n");
+  for (uint kk = 0; kk < 4; kk++)
+    stats[kk]->print();
+  return cnt;
+}
+
+}  // namespace OpenRCX
@@ -0,0 +1,404 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Net retirement: write the SPEF during extraction
+//
+// couplingFlow sweeps the block twice, the final pass along x. Once the
+// final pass has deallocated the search up to deallocLimit, a net whose
+// bbox ends before it can not receive any more coupling, so its *D_NET
+// section is final. Such nets are formatted on the extraction thread (odb
+// is not thread safe) into a memory buffer and the buffers are written to
+// the spef file by a background thread. With -release the parasitics of a
+// written net are destroyed as soon as all of its coupled nets are written.
+
+#include <dbLogger.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "dbShape.h"
+#include "extRCap.h"
+#include "extSpef.h"
+
+namespace OpenRCX {
+
+using odb::dbCCSeg;
+using odb::dbNet;
+using odb::dbShape;
+using odb::dbSigType;
+using odb::dbWire;
+using odb::dbWireShapeItr;
+using odb::notice;
+using odb::warning;
+
+// formatted bytes allowed to wait for the writer before extraction blocks
+static const size_t RETIRE_QUEUE_LIMIT = 64 * 1024 * 1024;
+
+class extSpefRetireWriter
+{
+ public:
+  extSpefRetireWriter(FILE* fp);
+  ~extSpefRetireWriter();
+
+  void push(char* buf, size_t len);
+
+ private:
+  void run();
+
+  FILE*                                 _fp;
+  std::mutex                            _lock;
+  std::condition_variable               _ready;
+  std::condition_variable               _drained;
+  std::deque<std::pair<char*, size_t> > _bufs;
+  size_t                                _queued;
+  bool                                  _done;
+  std::thread                           _thread;
+};
+
+extSpefRetireWriter::extSpefRetireWriter(FILE* fp)
+{
+  _fp     = fp;
+  _queued = 0;
+  _done   = false;
+  _thread = std::thread(&extSpefRetireWriter::run, this);
+}
+
+extSpefRetireWriter::~extSpefRetireWriter()
+{
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    _done = true;
+  }
+  _ready.notify_one();
+  _thread.join();
+}
+
+void extSpefRetireWriter::push(char* buf, size_t len)
+{
+  std::unique_lock<std::mutex> guard(_lock);
+  _drained.wait(guard, [this] { return _queued < RETIRE_QUEUE_LIMIT; });
+  _bufs.push_back(std::make_pair(buf, len));
+  _queued += len;
+  guard.unlock();
+  _ready.notify_one();
+}
+
+void extSpefRetireWriter::run()
+{
+  while (true) {
+    std::unique_lock<std::mutex> guard(_lock);
+    _ready.wait(guard, [this] { return _done || !_bufs.empty(); });
+    if (_bufs.empty())
+      return;
+    std::pair<char*, size_t> buf = _bufs.front();
+    _bufs.pop_front();
+    guard.unlock();
+
+    fwrite(buf.first, 1, buf.second, _fp);
+    free(buf.first);
+
+    guard.lock();
+    _queued -= buf.second;
+    guard.unlock();
+    _drained.notify_one();
+  }
+}
+
+bool extSpef::startRetireWrite()
+{
+  if (_outFP == NULL)
+    return false;
+
+  _cornerBlock     = _block;
+  _cornersPerBlock = _cornerCnt;
+  _retiredCnt      = 0;
+  setupWriteScales();
+  _retireWriter    = new extSpefRetireWriter(_outFP);
+  return true;
+}
+
+uint extSpef::retireNets(std::vector<dbNet*>& nets)
+{
+  if (_retireWriter == NULL || nets.empty())
+    return 0;
+
+  uint   cnt = 0;
+  uint   ii;
+  char*  buf = NULL;
+  size_t len = 0;
+  FILE*  fp  = open_memstream(&buf, &len);
+  if (fp == NULL) {
+    // drain the writer and format these nets straight into the file
+    delete _retireWriter;
+    for (ii = 0; ii < nets.size(); ii++)
+      cnt += writeNet(nets[ii], 0.0, 0);
+    _retireWriter = new extSpefRetireWriter(_outFP);
+    _retiredCnt += cnt;
+    return cnt;
+  }
+  FILE* outFP = _outFP;
+  _outFP      = fp;
+  for (ii = 0; ii < nets.size(); ii++)
+    cnt += writeNet(nets[ii], 0.0, 0);
+  _outFP = outFP;
+  fclose(fp);
+
+  if (len > 0)
+    _retireWriter->push(buf, len);
+  else
+    free(buf);
+
+  _retiredCnt += cnt;
+  return cnt;
+}
+
+uint extSpef::finishRetireWrite()
+{
+  if (_retireWriter == NULL)
+    return 0;
+
+  delete _retireWriter;
+  _retireWriter = NULL;
+  closeOutFile();
+  _outFP = NULL;
+
+  return _retiredCnt;
+}
+
+static uint writeRetireSpef(extMain* ext, const char* file, bool initOnly)
+{
+  return ext->writeSPEF((char*) file,
+                        NULL,
+                        false,
+                        false,
+                        NULL,
+                        false,
+                        NULL,
+                        "PF",
+                        "OHM",
+                        false,
+                        false,
+                        false,
+                        false,
+                        false,
+                        false,
+                        false,
+                        false,
+                        initOnly,
+                        false,
+                        false,
+                        -1,
+                        NULL,
+                        false,
+                        false);
+}
+
+void extMain::setNetRetirement(const char* spefFile, bool release)
+{
+  _retireSpefFile = spefFile;
+  _retireRelease  = release;
+}
+
+bool extMain::initNetRetirement()
+{
+  _retiring = false;
+  if (_retireSpefFile == NULL || _retireSpefFile[0] == '\0')
+    return false;
+
+#ifdef _WIN32
+  return false;
+#endif
+  if (!_allNet || _independentExtCorners) {
+    notice(0,
+           "Nets are written to %s after extraction: partial extraction or "
+           "independent corners\n",
+           _retireSpefFile);
+    return false;
+  }
+  // derived corners are scaled by the writer
+  if (_batchScaleExt)
+    genScaledExt();
+  notice(0, "Writing SPEF %s during extraction ...\n", _retireSpefFile);
+  writeRetireSpef(this, _retireSpefFile, true);
+  if (_spef == NULL || !_spef->startRetireWrite()) {
+    warning(0, "Can not write %s during extraction\n", _retireSpefFile);
+    return false;
+  }
+
+  odb::dbSet<dbNet>           nets = _block->getNets();
+  odb::dbSet<dbNet>::iterator net_itr;
+
+  uint maxId = 0;
+  for (net_itr = nets.begin(); net_itr != nets.end(); ++net_itr) {
+    if ((*net_itr)->getId() > maxId)
+      maxId = (*net_itr)->getId();
+  }
+  _retireMaxX.assign(maxId + 1, -MAX_INT);
+  _retireState.assign(maxId + 1, 0);
+  _retireOrder.clear();
+
+  for (net_itr = nets.begin(); net_itr != nets.end(); ++net_itr) {
+    dbNet*    net  = *net_itr;
+    dbSigType type = net->getSigType();
+    if ((type == dbSigType::POWER) || (type == dbSigType::GROUND))
+      continue;
+
+    int     xMax = -MAX_INT;
+    dbWire* wire = net->getWire();
+    if (wire != NULL) {
+      dbWireShapeItr shapes;
+      dbShape        s;
+      for (shapes.begin(wire); shapes.next(s);) {
+        if (s.xMax() > xMax)
+          xMax = s.xMax();
+      }
+    }
+    _retireMaxX[net->getId()] = xMax;
+    _retireOrder.push_back(net->getId());
+  }
+  std::vector<int>& maxX = _retireMaxX;
+  std::stable_sort(_retireOrder.begin(),
+                   _retireOrder.end(),
+                   [&maxX](uint a, uint b) { return maxX[a] < maxX[b]; });
+  _retireNext = 0;
+  _retiring   = true;
+  return true;
+}
+
+uint extMain::retireExtractedNets(int limit)
+{
+  if (!_retiring)
+    return 0;
+
+  std::vector<dbNet*> nets;
+  for (; _retireNext < _retireOrder.size(); _retireNext++) {
+    uint netId = _retireOrder[_retireNext];
+    if (_retireMaxX[netId] >= limit)
+      break;
+    nets.push_back(dbNet::getNet(_block, netId));
+  }
+  if (nets.empty())
+    return 0;
+
+  uint cnt = _spef->retireNets(nets);
+  for (uint ii = 0; ii < nets.size(); ii++)
+    _retireState[nets[ii]->getId()] = 1;
+
+  if (_retireRelease)
+    releaseRetiredNets(nets);
+
+  return cnt;
+}
+
+static bool ccNetsWritten(dbNet*                net,
+                          std::vector<char>&    state,
+                          std::vector<dbNet*>* ccNets)
+{
+  bool                  written = true;
+  std::vector<dbCCSeg*> ccs;
+  net->getSrcCCSegs(ccs);
+  uint ii;
+  for (ii = 0; ii < ccs.size(); ii++) {
+    dbNet* other = ccs[ii]->getTargetNet();
+    if (state[other->getId()] == 0)
+      written = false;
+    else if (ccNets)
+      ccNets->push_back(other);
+  }
+  ccs.clear();
+  net->getTgtCCSegs(ccs);
+  for (ii = 0; ii < ccs.size(); ii++) {
+    dbNet* other = ccs[ii]->getSourceNet();
+    if (state[other->getId()] == 0)
+      written = false;
+    else if (ccNets)
+      ccNets->push_back(other);
+  }
+  return written;
+}
+
+void extMain::releaseRetiredNets(std::vector<dbNet*>& nets)
+{
+  // a written net still shares its ccsegs with unwritten nets until all
+  // of its coupled nets are written; check the neighbors of the new nets
+  std::vector<dbNet*> cands;
+  std::vector<dbNet*> freeNets;
+  uint                ii;
+  for (ii = 0; ii < nets.size(); ii++) {
+    cands.push_back(nets[ii]);
+    ccNetsWritten(nets[ii], _retireState, &cands);
+  }
+  for (ii = 0; ii < cands.size(); ii++) {
+    dbNet* net = cands[ii];
+    if (_retireState[net->getId()] != 1)
+      continue;
+    if (!ccNetsWritten(net, _retireState, NULL))
+      continue;
+    _retireState[net->getId()] = 2;
+    freeNets.push_back(net);
+  }
+  if (freeNets.size())
+    _block->destroyParasitics(freeNets);
+}
+
+uint extMain::finishNetRetirement()
+{
+  const char* file = _retireSpefFile;
+  if (!_retiring) {
+    notice(0, "Writing SPEF ...\n");
+    return writeRetireSpef(this, file, false);
+  }
+  uint early = _retireNext;
+  retireExtractedNets(MAX_INT);
+  uint cnt = _spef->finishRetireWrite();
+  notice(0,
+         "%d nets finished, %d of them written during extraction\n",
+         cnt,
+         early);
+
+  delete _spef;
+  _spef     = NULL;
+  _retiring = false;
+  std::vector<uint>().swap(_retireOrder);
+  std::vector<int>().swap(_retireMaxX);
+  std::vector<char>().swap(_retireState);
+
+  return cnt;
+}
+
+}  // namespace OpenRCX
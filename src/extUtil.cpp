@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Nefelus Inc
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Thread helpers shared by the parallel phases of extraction, rules
+// generation and spef reading
+
+#include "extUtil.h"
+
+#include <thread>
+#include <vector>
+
+namespace OpenRCX {
+
+uint extThreadCnt()
+{
+  uint threadCnt = std::thread::hardware_concurrency();
+  return threadCnt > 0 ? threadCnt : 1;
+}
+
+void extRunRanges(uint cnt,
+                  uint threadCnt,
+                  uint minCnt,
+                  void (*fn)(void* arg, uint first, uint last),
+                  void* arg)
+{
+  if (threadCnt <= 1 || cnt < minCnt) {
+    fn(arg, 0, cnt);
+    return;
+  }
+  std::vector<std::thread> workers;
+  uint                     chunk = (cnt + threadCnt - 1) / threadCnt;
+  for (uint tt = 0; tt < threadCnt; tt++) {
+    uint f = tt * chunk;
+    uint l = f + chunk < cnt ? f + chunk : cnt;
+    if (f >= l)
+      break;
+    workers.push_back(std::thread(fn, arg, f, l));
+  }
+  for (uint tt = 0; tt < workers.size(); tt++)
+    workers[tt].join();
+}
+
+void extRunWorkers(uint threadCnt, void (*fn)(void* arg), void* arg)
+{
+  std::vector<std::thread> workers;
+  for (uint tt = 0; tt < threadCnt; tt++)
+    workers.push_back(std::thread(fn, arg));
+  for (uint tt = 0; tt < workers.size(); tt++)
+    workers[tt].join();
+}
+
+}  // namespace OpenRCX
@@ -385,6 +385,7 @@ void extMain::writeSpef(char*                filename,
 
 void extMain::adjustRC(double resFactor, double ccFactor, double gndcFactor)
 {
+  _spefReuseOk = false;
   double res_factor  = resFactor / _resFactor;
   _resFactor         = resFactor;
   _resModify         = resFactor == 1.0 ? false : true;
@@ -394,7 +395,10 @@ void extMain::adjustRC(double resFactor, double ccFactor, double gndcFactor)
   double gndc_factor = gndcFactor / _gndcFactor;
   _gndcFactor        = gndcFactor;
   _gndcModify        = gndcFactor == 1.0 ? false : true;
-  _block->adjustRC(res_factor, cc_factor, gndc_factor);
+  _pendingResFactor *= res_factor;
+  _pendingCcFactor *= cc_factor;
+  _pendingGndcFactor *= gndc_factor;
+  saveLazyRC();
 }
 
 uint extMain::getMultiples(uint cnt, uint base)
@@ -492,6 +496,25 @@ extMain::extMain(uint menuId)
   _reExtCcapSDB = NULL;
 
   _reuseMetalFill     = false;
+  _spefReuseOk        = true;
+  _spefNameCache      = NULL;
+  _searchIndexFile    = NULL;
+  _searchIndex        = NULL;
+  _searchIndexWritten = false;
+  _blockCacheTracks   = 0;
+  _netCacheFile       = NULL;
+  _netCache           = NULL;
+  _solverJobCnt       = 0;
+  _solverRetryCnt     = 0;
+  _solverMetalJobCnt  = 0;
+  _solverMaxError     = 0.0;
+  _rulesFitOrder      = 0;
+  _measureLogFile     = NULL;
+  _measureLog         = NULL;
+  _retireSpefFile     = NULL;
+  _retireRelease      = false;
+  _retiring           = false;
+  _retireNext         = 0;
   _usingMetalPlanes   = 0;
   _alwaysNewGs        = true;
   _ccUp               = 0;
@@ -512,6 +535,11 @@ extMain::extMain(uint menuId)
   _gndcFactor = 1.0;
   _gndcModify = false;
 
+  _pendingResFactor  = 1.0;
+  _pendingCcFactor   = 1.0;
+  _pendingGndcFactor = 1.0;
+  _lazyScaledCorners = false;
+
   _menuId     = menuId;
   _dbPowerId  = 1;
   _dbSignalId = 2;
@@ -725,6 +753,27 @@ extRCModel* extMain::getRCmodel(uint n)
 
   return _modelTable->get(n);
 }
+// The models read through getSharedRules are read only: bench and rules
+// generation change the model they work on, so they refuse a shared one.
+bool extMain::sharedRCmodel(extRCModel* m, const char* cmd)
+{
+  if (m == NULL || !m->isSharedRules())
+    return false;
+  warning(0,
+          "%s: the extraction rules model is shared by the blocks reading "
+          "the same rules file and cannot be changed\n",
+          cmd);
+  return true;
+}
+// the models read through getSharedRules stay with the other holders, the
+// last one deletes them
+void extMain::releaseRCmodels()
+{
+  for (uint ii = 0; ii < _modelTable->getCnt(); ii++)
+    extRCModel::releaseSharedRules(_modelTable->get(ii));
+  _modelTable->resetCnt(0);
+  _currentModel = NULL;
+}
 uint extMain::getResCapTable(bool lefRC)
 {
   calcMinMaxRC();
@@ -923,6 +972,10 @@ void extMain::setBlock(dbBlock* block)
   _origSpefFilePrefix = NULL;
   _newSpefFilePrefix  = NULL;
   _excludeCells       = NULL;
+  _ecoNetIds.clear();
+  _spefReuseOk = true;
+  clearSpefNameCache();
+  loadLazyRC();
 }
 uint extMain::makeGuiBoxes(uint extGuiBoxType)
 {
@@ -1819,7 +1819,8 @@ extDistRC* extMeasure::computeOverFringe(uint overMet,
   for (uint ii = 0; ii < _metRCTable.getCnt(); ii++) {
     extMetRCTable* rcModel = _metRCTable.get(ii);
 
-    rcUnit = rcModel->_capOver[overMet]->getRC(_met, overWidth, dist);
+    rcUnit
+        = rcModel->_capOver[overMet]->getRC(_met, overWidth, dist, &_fitRC);
 
     if (IsDebugNet())
       rcUnit->printDebugRC(_met, overMet, 0, _width, dist, len);
@@ -1845,7 +1846,8 @@ extDistRC* extMeasure::computeUnderFringe(uint underMet,
     if (rcModel->_capUnder[underMet] == NULL)
       continue;
 
-    rcUnit = rcModel->_capUnder[underMet]->getRC(n, underWidth, dist);
+    rcUnit
+        = rcModel->_capUnder[underMet]->getRC(n, underWidth, dist, &_fitRC);
     if (IsDebugNet())
       rcUnit->printDebugRC(_met, 0, underMet, _width, dist, len);
 
@@ -3288,6 +3290,10 @@ void extMeasure::calcDiagRC(int  rsegId1,
                             uint diagDist,
                             uint tgtMet)
 {
+  if (_measureLog != NULL)
+    logDiag(
+        MLG_DIAG_WIDTH, rsegId1, rsegId2, len, diagWidth, diagDist, tgtMet);
+
   double capTable[10];
   uint   modelCnt = _metRCTable.getCnt();
   for (uint ii = 0; ii < modelCnt; ii++) {
@@ -3302,7 +3308,7 @@ void extMeasure::calcDiagRC(int  rsegId1,
       if (rc)
         ccTable[ii] = len * rc->_coupling;
 
-      rc = rcModel->_capOver[_met]->getRC(0, _width, _dist);
+      rc = rcModel->_capOver[_met]->getRC(0, _width, _dist, &_fitRC);
       if (rc) {
         ccTable[ii] -= len * rc->_coupling;
         _rc[ii]->_coupling += ccTable[ii];
@@ -3463,6 +3469,9 @@ void extMeasure::calcDiagRC(int  rsegId1,
                             uint dist,
                             uint tgtMet)
 {
+  if (_measureLog != NULL)
+    logDiag(MLG_DIAG, rsegId1, rsegId2, len, 0, dist, tgtMet);
+
   int    DOUBLE_DIAG = 1;
   double capTable[10];
   uint   modelCnt = _metRCTable.getCnt();
@@ -4055,22 +4064,17 @@ void extMeasure::OverSubRC_dist(dbRSeg* rseg1,
 int extMeasure::computeAndStoreRC(dbRSeg* rseg1, dbRSeg* rseg2, int srcCovered)
 {
   // Copy from computeAndStoreRC_720
-  bool SUBTRACT_DIAG = false;
-  bool no_ou         = true;
-  bool USE_DB_UBITS  = false;
+  bool no_ou        = true;
+  bool USE_DB_UBITS = false;
   if (rseg1 == NULL && rseg2 == NULL)
     return 0;
 
-  bool traceFlag = false;
-  bool watchFlag = IsDebugNet();
-
   rcSegInfo();
 
   // if (_netId>0)
   //	traceFlag= printTraceNet("\nBEGIN", true, NULL, 0, 0);
 
-  uint modelCnt      = _metRCTable.getCnt();
-  int  totLenCovered = 0;
+  int totLenCovered = 0;
   _lenOUtable->resetCnt();
   if (_extMain->_usingMetalPlanes && (_extMain->_geoThickTable == NULL)) {
     _diagLen = 0;
@@ -4082,7 +4086,6 @@ int extMeasure::computeAndStoreRC(dbRSeg* rseg1, dbRSeg* rseg2, int srcCovered)
       }
     }
   }
-  ouCovered_debug(totLenCovered);
   // TODO totLenCovered += srcCovered;
 
   if (USE_DB_UBITS) {
@@ -4090,6 +4093,20 @@ int extMeasure::computeAndStoreRC(dbRSeg* rseg1, dbRSeg* rseg2, int srcCovered)
     _len          = _extMain->GetDBcoords2(_len);
     _diagLen      = _extMain->GetDBcoords2(_diagLen);
   }
+  if (_measureLog != NULL)
+    logEvent(totLenCovered);
+
+  return storeRC(rseg1, rseg2, totLenCovered);
+}
+
+// Adds the coverage sums in _rc and the over substrate remainder of the
+// segment to the rsegs and ccsegs; reevaluate_parasitics calls it on its own.
+int extMeasure::storeRC(dbRSeg* rseg1, dbRSeg* rseg2, int totLenCovered)
+{
+  bool SUBTRACT_DIAG = false;
+
+  ouCovered_debug(totLenCovered);
+
   int lenOverSub = _len - totLenCovered;
 
   if (_diagLen > 0 && SUBTRACT_DIAG)
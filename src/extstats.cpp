@@ -68,7 +68,7 @@ extDistRC* extRCModel::getMinRC(int met, int width)
 
   return getOverFringeRC(&m);
 }
-extDistRC* extRCModel::getMaxRC(int met, int width, int dist)
+extDistRC* extRCModel::getMaxRC(int met, int width, int dist, extDistRC* fitRC)
 {
   if (met >= _layerCnt)
     return NULL;
@@ -91,6 +91,10 @@ extDistRC* extRCModel::getMaxRC(int met, int width, int dist)
   } else {
     rc = getOverUnderRC(&m);
   }
+  if (rc == &m._fitRC) {  // compact rules: outlive m
+    *fitRC = m._fitRC;
+    rc     = fitRC;
+  }
   return rc;
 }
 void extDistRC::debugRC(const char* debugWord,
@@ -140,8 +144,9 @@ uint extMain::calcMinMaxRC()
           = _currentModel->getMetRCTable(modelIndex);  // NOT NEEDED
       resetMinMaxRC(met, jj);
 
+      extDistRC  maxFitRC;
       extDistRC* rcMin = _currentModel->getMinRC(met, width);
-      extDistRC* rcMax = _currentModel->getMaxRC(met, width, dist);
+      extDistRC* rcMax = _currentModel->getMaxRC(met, width, dist, &maxFitRC);
 
       setMinRC(met, jj, rcMin);
       setMaxRC(met, jj, rcMax);
@@ -36,8 +36,11 @@
 #include <math.h>
 
 #include <algorithm>
+#include <map>
+#include <vector>
 
 #include "extRCap.h"
+#include "extUtil.h"
 #include "parse.h"
 //#include "logger.h"
 #include <dbLogger.h>
@@ -72,6 +75,7 @@ uint extSpef::writeHierInstNameMap()
                child->getConstName(),
                inst->getConstName());
 
+    internSpefNames(child);
     uint                              mapId  = 0;
     odb::dbSet<odb::dbInst>           binsts = child->getInsts();
     odb::dbSet<odb::dbInst>::iterator bitr;
@@ -80,8 +84,7 @@ uint extSpef::writeHierInstNameMap()
 
       mapId = _baseNameMap + ii->getId();
 
-      char* nname  = (char*) ii->getConstName();
-      char* nname1 = tinkerSpefName(nname);
+      const char* nname1 = spefInstName(ii);
       ATH__fprintf(_outFP, "*%d %s/%s\n", mapId, inst->getConstName(), nname1);
       odb::debug(
           "HEXT", "S", "\t%d %s/%s\n", mapId, inst->getConstName(), nname1);
@@ -131,6 +134,7 @@ uint extSpef::writeHierNetNameMap()
                child->getConstName(),
                inst->getConstName());
 
+    internSpefNames(child);
     uint                             mapId = 0;
     odb::dbSet<odb::dbNet>           nets  = child->getNets();
     odb::dbSet<odb::dbNet>::iterator bitr;
@@ -142,8 +146,7 @@ uint extSpef::writeHierNetNameMap()
 
       mapId = _baseNameMap + ii->getId();
 
-      char* nname  = (char*) ii->getConstName();
-      char* nname1 = tinkerSpefName(nname);
+      const char* nname1 = spefNetName(ii);
       ATH__fprintf(_outFP, "*%d %s/%s\n", mapId, inst->getConstName(), nname1);
       odb::debug(
           "HEXT", "S", "\t%d %s/%s\n", mapId, inst->getConstName(), nname1);
@@ -182,6 +185,79 @@ uint extMain::markCCsegs(odb::dbBlock* blk, bool flag)
   return ccs.size();
 }
 
+// Two-phase assembly: the cap nodes, rsegs and ccsegs of every IO net of
+// the child block are first read into an extHierNetPlan in parallel (this
+// only reads the child block), then the parent objects are created
+// serially from the plans since odb is not thread safe. Parent node numbers
+// come from a running maximum per parent net instead of rescanning the
+// parent cap nodes for every child net.
+
+struct extHierCC
+{
+  odb::dbCCSeg*   _cc;
+  odb::dbCapNode* _src;
+  odb::dbCapNode* _dst;
+  bool            _dstIO;
+};
+
+struct extHierNetPlan
+{
+  odb::dbNet*                  _net;
+  odb::dbNet*                  _parentNet;
+  std::vector<odb::dbCapNode*> _nodes;
+  std::vector<odb::dbRSeg*>    _rsegs;
+  std::vector<double>          _rc;  // res and cap by corner for each rseg
+  std::vector<extHierCC>       _ccs;
+  std::vector<double>          _cc;  // cap by corner for each cc
+};
+
+struct extHierPlans
+{
+  std::vector<extHierNetPlan>* _plans;
+  uint                         _cornerCnt;
+};
+
+static void readHierNets(void* arg, uint first, uint last)
+{
+  extHierPlans* hp        = (extHierPlans*) arg;
+  uint          cornerCnt = hp->_cornerCnt;
+  for (uint ii = first; ii < last; ii++) {
+    extHierNetPlan& plan = (*hp->_plans)[ii];
+
+    odb::dbSet<odb::dbCapNode>           capNodes = plan._net->getCapNodes();
+    odb::dbSet<odb::dbCapNode>::iterator citr;
+    for (citr = capNodes.begin(); citr != capNodes.end(); ++citr) {
+      odb::dbCapNode* node = *citr;
+      plan._nodes.push_back(node);
+
+      odb::dbSet<odb::dbCCSeg>           ccsegs = node->getCCSegs();
+      odb::dbSet<odb::dbCCSeg>::iterator ccitr;
+      for (ccitr = ccsegs.begin(); ccitr != ccsegs.end(); ++ccitr) {
+        extHierCC hc;
+        hc._cc  = *ccitr;
+        hc._src = node;
+        hc._dst = hc._cc->getTargetCapNode();
+        if (hc._cc->getSourceCapNode() != node)
+          hc._dst = hc._cc->getSourceCapNode();
+        hc._dstIO = hc._dst->getNet()->isIO();
+        plan._ccs.push_back(hc);
+        for (uint corner = 0; corner < cornerCnt; corner++)
+          plan._cc.push_back(hc._cc->getCapacitance(corner));
+      }
+    }
+    odb::dbSet<odb::dbRSeg>           rsegs = plan._net->getRSegs();
+    odb::dbSet<odb::dbRSeg>::iterator ritr;
+    for (ritr = rsegs.begin(); ritr != rsegs.end(); ++ritr) {
+      odb::dbRSeg* rseg = *ritr;
+      plan._rsegs.push_back(rseg);
+      for (uint corner = 0; corner < cornerCnt; corner++) {
+        plan._rc.push_back(rseg->getResistance(corner));
+        plan._rc.push_back(rseg->getCapacitance(corner));
+      }
+    }
+  }
+}
+
 uint extMain::addRCtoTop(odb::dbBlock* blk, bool write_spef)
 {
   odb::notice(0,
@@ -220,6 +296,8 @@ uint extMain::addRCtoTop(odb::dbBlock* blk, bool write_spef)
   if (topDummyNodeNet == NULL)
     topDummyNodeNet = odb::dbNet::create(_block, "dummy_sub_block_cap_nodes");
 
+  std::vector<extHierNetPlan> plans;
+
   odb::dbSet<odb::dbNet>           nets = blk->getNets();
   odb::dbSet<odb::dbNet>::iterator bitr;
   for (bitr = nets.begin(); bitr != nets.end(); ++bitr) {
@@ -238,30 +316,39 @@ uint extMain::addRCtoTop(odb::dbBlock* blk, bool write_spef)
                    net->getConstName());
       continue;
     }
-
-    gCnt += createCapNodes(net, parentNet, capNodeMap, instBaseMapId);
-    rCnt += createRSegs(net, parentNet, capNodeMap);
+    extHierNetPlan plan;
+    plan._net       = net;
+    plan._parentNet = parentNet;
+    plans.push_back(plan);
+  }
+  extHierPlans hp;
+  hp._plans     = &plans;
+  hp._cornerCnt = _block->getCornerCount();
+  extRunRanges(
+      plans.size(), extThreadCnt(), EXT_PARALLEL_MIN, readHierNets, &hp);
+
+  // highest internal node number by parent net id
+  std::map<uint, uint> parentMaxCap;
+  for (uint ii = 0; ii < plans.size(); ii++) {
+    extHierNetPlan& plan = plans[ii];
+    createTop1stRseg(plan._net, plan._parentNet);
+
+    uint parentId = plan._parentNet->getId();
+    if (parentMaxCap.find(parentId) == parentMaxCap.end())
+      parentMaxCap[parentId] = plan._parentNet->maxInternalCapNum();
+
+    gCnt += createCapNodes(
+        plan, capNodeMap, instBaseMapId, parentMaxCap[parentId]);
+    rCnt += createRSegs(plan, capNodeMap);
     flatCnt++;
   }
   markCCsegs(blk, false);
-  for (bitr = nets.begin(); bitr != nets.end(); ++bitr) {
-    odb::dbNet* net = *bitr;
-    if (!net->isIO())
-      continue;
-
-    odb::dbBTerm* bterm     = net->get1stBTerm();
-    odb::dbITerm* iterm     = bterm->getITerm();
-    odb::dbNet*   parentNet = iterm->getNet();
-    if (parentNet == NULL) {
-      odb::warning(0,
-                   "Null parent[%d] net : %s\n",
-                   net->getBTermCount(),
-                   net->getConstName());
-      continue;
-    }
+  for (uint ii = 0; ii < plans.size(); ii++) {
+    extHierNetPlan& plan = plans[ii];
+    uint maxCap = parentMaxCap[plan._parentNet->getId()] + 1;
 
     ccCnt += createCCsegs(
-        net, parentNet, topDummyNodeNet, capNodeMap, instBaseMapId);
+        plan, topDummyNodeNet, capNodeMap, instBaseMapId, maxCap);
   }
   markCCsegs(blk, false);
 
@@ -385,33 +472,32 @@ void extMain::createTop1stRseg(odb::dbNet* net, odb::dbNet* parentNet)
   odb::dbRSeg* rc = odb::dbRSeg::create(parentNet, 0, 0, 0, true);
   rc->setTargetNode(cap->getId());
 }
-uint extMain::createCapNodes(odb::dbNet* net,
-                             odb::dbNet* parentNet,
-                             uint*       capNodeMap,
-                             uint        baseNum)
+uint extMain::createCapNodes(extHierNetPlan& plan,
+                             uint*           capNodeMap,
+                             uint            baseNum,
+                             uint&           maxInternal)
 {
-  createTop1stRseg(net, parentNet);
-
-  // have to improve for performance
-  uint maxCap = parentNet->maxInternalCapNum() + 1;
+  uint maxCap = maxInternal + 1;
   odb::debug("HEXT",
              "C",
              "\n\tCapNodes: maxCap=%d : %s %s\n",
              maxCap,
-             net->getConstName(),
-             parentNet->getConstName());
+             plan._net->getConstName(),
+             plan._parentNet->getConstName());
 
-  uint                                 gCnt    = 0;
-  bool                                 foreign = false;
-  char                                 buf[1024];
-  odb::dbSet<odb::dbCapNode>           capNodes     = net->getCapNodes();
-  odb::dbSet<odb::dbCapNode>::iterator cap_node_itr = capNodes.begin();
-  for (; cap_node_itr != capNodes.end(); ++cap_node_itr) {
-    odb::dbCapNode* node = *cap_node_itr;
+  uint gCnt = 0;
+  for (uint ii = 0; ii < plan._nodes.size(); ii++) {
+    odb::dbCapNode* node = plan._nodes[ii];
 
     uint nodeNum = maxCap++;
 
-    gCnt += createParentCapNode(node, parentNet, nodeNum, capNodeMap, baseNum);
+    gCnt += createParentCapNode(
+        node, plan._parentNet, nodeNum, capNodeMap, baseNum);
+
+    // the parent node is internal (numbered nodeNum) for an internal child
+    // node, or for a bterm node when the parent iterm node was found
+    if (node->isInternal() || (node->isBTerm() && capNodeMap[node->getId()]))
+      maxInternal = nodeNum;
   }
   return gCnt;
 }
@@ -435,30 +521,26 @@ uint extMain::printRSegs(odb::dbNet* net)
   }
   return rCnt;
 }
-uint extMain::createRSegs(odb::dbNet* net,
-                          odb::dbNet* parentNet,
-                          uint*       capNodeMap)
+uint extMain::createRSegs(extHierNetPlan& plan, uint* capNodeMap)
 {
   odb::debug("HEXT",
              "R",
              "\n\tRSegs: %s %s\n",
-             net->getConstName(),
-             parentNet->getConstName());
+             plan._net->getConstName(),
+             plan._parentNet->getConstName());
 
   // extMain::printRSegs(parentNet);
 
-  odb::dbSet<odb::dbRSeg> rsegs = net->getRSegs();
-  uint                    rsize = rsegs.size();
-
-  uint                              rCnt     = 0;
-  odb::dbSet<odb::dbRSeg>::iterator rseg_itr = rsegs.begin();
-  for (; rseg_itr != rsegs.end(); ++rseg_itr) {
-    odb::dbRSeg* rseg = *rseg_itr;
+  uint cornerCnt = _block->getCornerCount();
+  uint rCnt      = 0;
+  for (uint ii = 0; ii < plan._rsegs.size(); ii++) {
+    odb::dbRSeg* rseg = plan._rsegs[ii];
 
     int x, y;
     rseg->getCoords(x, y);
     uint         pathDir = rseg->pathLowToHigh() ? 0 : 1;
-    odb::dbRSeg* rc      = odb::dbRSeg::create(parentNet, x, y, pathDir, true);
+    odb::dbRSeg* rc
+        = odb::dbRSeg::create(plan._parentNet, x, y, pathDir, true);
 
     uint tgtId = rseg->getTargetNode();
     uint srcId = rseg->getSourceNode();
@@ -466,9 +548,10 @@ uint extMain::createRSegs(odb::dbNet* net,
     rc->setSourceNode(capNodeMap[srcId]);
     rc->setTargetNode(capNodeMap[tgtId]);
 
-    for (uint corner = 0; corner < _block->getCornerCount(); corner++) {
-      double res = rseg->getResistance(corner);
-      double cap = rseg->getCapacitance(corner);
+    double* rcv = &plan._rc[2 * ii * cornerCnt];
+    for (uint corner = 0; corner < cornerCnt; corner++) {
+      double res = rcv[2 * corner];
+      double cap = rcv[2 * corner + 1];
 
       rc->setResistance(res, corner);
       rc->setCapacitance(cap, corner);
@@ -537,77 +620,68 @@ void extMain::adjustChildNode(odb::dbCapNode* childNode,
   childNode->setNameFlag();
 }
 
-uint extMain::createCCsegs(odb::dbNet* net,
-                           odb::dbNet* parentNet,
-                           odb::dbNet* topDummyNet,
-                           uint*       capNodeMap,
-                           uint        baseNum)
+uint extMain::createCCsegs(extHierNetPlan& plan,
+                           odb::dbNet*     topDummyNet,
+                           uint*           capNodeMap,
+                           uint            baseNum,
+                           uint            maxCap)
 {
   // IO nets
 
-  // have to improve for performance
-  uint maxCap = parentNet->maxInternalCapNum() + 1;
-
+  odb::dbNet* parentNet = plan._parentNet;
   odb::debug("HEXT",
              "CC",
              "\tCCsegs: maxCap[%d] %s %s\n",
              maxCap,
-             net->getConstName(),
+             plan._net->getConstName(),
              parentNet->getConstName());
 
-  odb::dbBlock* pblock = parentNet->getBlock();
-  uint          ccCnt  = 0;
+  odb::dbBlock* pblock    = parentNet->getBlock();
+  uint          cornerCnt = _block->getCornerCount();
+  uint          ccCnt     = 0;
 
-  odb::dbSet<odb::dbCapNode>           nodeSet = net->getCapNodes();
-  odb::dbSet<odb::dbCapNode>::iterator rc_itr;
-  for (rc_itr = nodeSet.begin(); rc_itr != nodeSet.end(); ++rc_itr) {
-    odb::dbCapNode* srcCapNode = *rc_itr;
+  for (uint ii = 0; ii < plan._ccs.size(); ii++) {
+    extHierCC&    hc = plan._ccs[ii];
+    odb::dbCCSeg* cc = hc._cc;
 
-    odb::dbSet<odb::dbCCSeg>           ccsegs    = srcCapNode->getCCSegs();
-    odb::dbSet<odb::dbCCSeg>::iterator ccseg_itr = ccsegs.begin();
-    for (; ccseg_itr != ccsegs.end(); ++ccseg_itr) {
-      odb::dbCCSeg* cc = *ccseg_itr;
+    if (cc->isMarked())
+      continue;
 
-      if (cc->isMarked())
-        continue;
+    odb::dbCapNode* srcCapNode = hc._src;
+    odb::dbCapNode* dstCapNode = hc._dst;
+    if (!hc._dstIO) {
+      uint nodeNum = maxCap++;
+      createParentCapNode(
+          dstCapNode, topDummyNet, nodeNum, capNodeMap, baseNum);
+      adjustChildNode(srcCapNode, parentNet, capNodeMap);
+    }
+    uint tId   = dstCapNode->getId();
+    uint sId   = srcCapNode->getId();
+    uint tgtId = capNodeMap[tId];
+    uint srcId = capNodeMap[sId];
 
-      odb::dbCapNode* dstCapNode = cc->getTargetCapNode();
-      if (cc->getSourceCapNode() != srcCapNode) {
-        dstCapNode = cc->getSourceCapNode();
-      }
-      if (!dstCapNode->getNet()->isIO()) {
-        uint nodeNum = maxCap++;
-        createParentCapNode(
-            dstCapNode, topDummyNet, nodeNum, capNodeMap, baseNum);
-        adjustChildNode(srcCapNode, parentNet, capNodeMap);
-      }
-      uint tId   = dstCapNode->getId();
-      uint sId   = srcCapNode->getId();
-      uint tgtId = capNodeMap[tId];
-      uint srcId = capNodeMap[sId];
-
-      odb::dbCapNode* map_tgt = odb::dbCapNode::getCapNode(pblock, tgtId);
-      odb::dbCapNode* map_src = odb::dbCapNode::getCapNode(pblock, srcId);
-
-      odb::dbCCSeg* ccap = odb::dbCCSeg::create(map_src, map_tgt, false);
-
-      for (uint corner = 0; corner < _block->getCornerCount(); corner++) {
-        double cap = cc->getCapacitance(corner);
-        ccap->setCapacitance(cap, corner);
-
-        odb::debug("HEXT",
-                   "CC",
-                   "\t\tCC src:%d->%d tgt:%d->%d CC %g\n",
-                   sId,
-                   srcId,
-                   tId,
-                   tgtId,
-                   cap);
-      }
-      cc->setMark(true);
+    odb::dbCapNode* map_tgt = odb::dbCapNode::getCapNode(pblock, tgtId);
+    odb::dbCapNode* map_src = odb::dbCapNode::getCapNode(pblock, srcId);
+
+    odb::dbCCSeg* ccap = odb::dbCCSeg::create(map_src, map_tgt, false);
+
+    for (uint corner = 0; corner < cornerCnt; corner++) {
+      double cap = plan._cc[ii * cornerCnt + corner];
+      ccap->setCapacitance(cap, corner);
+
+      odb::debug("HEXT",
+                 "CC",
+                 "\t\tCC src:%d->%d tgt:%d->%d CC %g\n",
+                 sId,
+                 srcId,
+                 tId,
+                 tgtId,
+                 cap);
     }
+    cc->setMark(true);
+    ccCnt++;
   }
-  return maxCap;
+  return ccCnt;
 }
 /*
 uint extMain::adjustCCsegs(odb::dbNet *net, uint baseNum)
@@ -643,14 +717,14 @@ capNodeMap); cc->setMark(true);
         return maxCap;
 }
 */
-void extSpef::writeDnetHier(uint mapId, double* totCap)
+void extSpef::writeDnetHier(uint mapId, double* gndCap, double* ccCap)
 {
   if (_writeNameMap)
     ATH__fprintf(_outFP, "\n*D_NET *%d ", mapId);
   // else
   // ATH__fprintf(_outFP, "\n*D_NET %s ", tinkerSpefName((char
   // *)_d_net->getConstName()));
-  writeRCvalue(totCap, _cap_unit);
+  writeTotCap(gndCap, ccCap);
   ATH__fprintf(_outFP, "\n");
 }
 
@@ -681,8 +755,10 @@ bool extSpef::writeHierNet(odb::dbNet* net, double resBound, uint dbg)
 
   double totCap[5];
   resetCap(totCap);
+  double ccCap[5];
+  resetCap(ccCap);
   if (_symmetricCCcaps)
-    addCouplingCaps(net, totCap);
+    addCouplingCaps(net, ccCap);
 
   _firstCapNode = minNode - 1;
 
@@ -698,11 +774,11 @@ bool extSpef::writeHierNet(odb::dbNet* net, double resBound, uint dbg)
              "\tDNET *%d-%d %g %s\n",
              _childBlockNetBaseMap + netId,
              netId,
-             totCap[0],
+             totCap[0] + ccCap[0],
              net->getConstName());
 
   // netId= _childBlockNetBaseMap+netId;
-  writeDnetHier(_childBlockNetBaseMap + netId, totCap);
+  writeDnetHier(_childBlockNetBaseMap + netId, totCap, ccCap);
 
   if (_wConn) {
     writeKeyword("*CONN");
@@ -57,6 +57,8 @@ using odb::dbBTerm;
 using odb::dbCapNode;
 using odb::dbCCSeg;
 using odb::dbChip;
+using odb::dbDoubleProperty;
+using odb::dbIntProperty;
 using odb::dbNet;
 using odb::dbRSeg;
 using odb::dbSet;
@@ -1563,6 +1565,18 @@ void extMain::removeExt(std::vector<dbNet*>& nets)
   if (_spef)
     _spef->reinit();
 }
+// Records the nets about to be re-extracted and the nets coupled to them
+// before their ccsegs go away; write_spef -reuse formats these again.
+void extMain::recordEcoNets(std::vector<dbNet*>& nets)
+{
+  std::vector<dbNet*> ccHaloNets;
+  _block->getCcHaloNets(nets, ccHaloNets);
+  uint ii;
+  for (ii = 0; ii < nets.size(); ii++)
+    _ecoNetIds.push_back(nets[ii]->getId());
+  for (ii = 0; ii < ccHaloNets.size(); ii++)
+    _ecoNetIds.push_back(ccHaloNets[ii]->getId());
+}
 void extMain::removeExt()
 {
   std::vector<dbNet*>    rnets;
@@ -2403,9 +2417,6 @@ bool extMain::setCorners(const char* rulesFileName, const char* cmp_file)
 
     notice(0, "dbFactor= %g  dbunit= %d \n", dbFactor, dbunit);
 
-    extRCModel* m = new extRCModel("MINTYPMAX");
-    _modelTable->add(m);
-
     uint cornerTable[10];
     uint extDbCnt = 0;
 
@@ -2419,18 +2430,15 @@ bool extMain::setCorners(const char* rulesFileName, const char* cmp_file)
         _modelMap.add(ii);
       }
     }
-    if (!(m->readRules((char*) rulesFileName,
-                       false,
-                       true,
-                       true,
-                       true,
-                       true,
-                       extDbCnt,
-                       cornerTable,
-                       dbFactor))) {
-      delete m;
+    extRCModel* m = extRCModel::getSharedRules("MINTYPMAX",
+                                               rulesFileName,
+                                               extDbCnt,
+                                               cornerTable,
+                                               dbFactor,
+                                               _rulesFitOrder);
+    if (m == NULL)
       return false;
-    }
+    _modelTable->add(m);
 
     int modelCnt = getRCmodel(0)->getModelCnt();
     if (cmp_file != NULL) {  // find 0.0% variability and make it first
@@ -2569,6 +2577,7 @@ uint extMain::makeBlockRCsegs(bool        btermThresholdFlag,
                               const char* extRules,
                               ZInterface* Interface)
 {
+  applyPendingAdjust();
   uint debugNetId = 0;
   if (preserve_geom < 0) {
     debugNetId    = -preserve_geom;
@@ -2782,12 +2791,33 @@ uint extMain::makeBlockRCsegs(bool        btermThresholdFlag,
       notice(0, "no nets to eco extract.\n");
       return 1;
     }
+    recordEcoNets(inets);
     removeExt(inets);
     _reExtract    = true;
     _allNet       = false;
     preserve_geom = 1;
   } else {
     _allNet = !((dbBlock*) _block)->findSomeNet(netNames, inets);
+    if (_allNet)
+      _spefReuseOk = false;
+    else
+      recordEcoNets(inets);
+  }
+  // unchanged nets come from the net cache, the rest are extracted as a
+  // subset
+  if (_allNet
+      && openNetCache(extRules ? extRules : _prevControl->_ruleFileName,
+                      inets)) {
+    _allNet = false;
+    if (inets.size() == 0) {
+      _extracted = true;
+      updatePrevControl();
+      releaseRCmodels();
+      closeNetCache();
+      if (_batchScaleExt)
+        genScaledExt();
+      return 1;
+    }
   }
 
   // if (remove_ext)
@@ -3062,6 +3092,8 @@ uint extMain::makeBlockRCsegs(bool        btermThresholdFlag,
           sprintf(bufName, "%d", debugNetId);
           m._debugFP = fopen(bufName, "w");
         }
+        if (!windowFlow && !initTiling)
+          openMeasureLog(&m);
 
         //#ifndef NEW_GS_FLOW
         if (_cc_band_tracks == 0) {
@@ -3087,14 +3119,17 @@ uint extMain::makeBlockRCsegs(bool        btermThresholdFlag,
                                doExt,
                                &m,
                                extCompute1);
-          else
+          else {
+            initNetRetirement();
             couplingFlow(
                 rlog, maxRect, _cc_band_tracks, _couplingFlag, &m, extCompute1);
+          }
 
           if (m._debugFP != NULL)
             fclose(m._debugFP);
         }
         //#endif
+        closeMeasureLog();
       } else {
         ccCnt = _extNetSDB->couplingCaps(
             ccCapSdb, CCflag, Interface, extCompute, this);
@@ -3169,26 +3204,30 @@ uint extMain::makeBlockRCsegs(bool        btermThresholdFlag,
       dbSigType type = net->getSigType();
       if ((type == dbSigType::POWER) || (type == dbSigType::GROUND))
         continue;
-      net->setWireAltered(false);
+      clearWireAltered(net);
     }
   } else {
     for (j = 0; j < inets.size(); j++) {
       net = inets[j];
       net->setMark(false);
-      net->setWireAltered(false);
+      clearWireAltered(net);
     }
   }
+  _searchIndexWritten = false;
   if (rlog)
     AthResourceLog("before remove Model", detailRlog);
 
   if (!windowFlow) {
     // delete _currentModel;
-    _modelTable->resetCnt(0);
+    releaseRCmodels();
     if (rlog)
       AthResourceLog("After remove Model", detailRlog);
   }
+  closeNetCache();
   if (_batchScaleExt)
     genScaledExt();
+  if (_retireSpefFile != NULL && _retireSpefFile[0] != '\0')
+    finishNetRetirement();
 
   return 1;
 }
@@ -3213,11 +3252,17 @@ sc->_ccFactor, sc->_gndFactor);
         }
 }
 */
-void extMain::genScaledExt()
+void extMain::genScaledExt(bool copy)
 {
   if (_processCornerTable == NULL || _scaledCornerTable == NULL)
     return;
 
+  if (!copy && !_independentExtCorners) {
+    // the spef writer scales the values of the process corners
+    _lazyScaledCorners = true;
+    saveLazyRC();
+    return;
+  }
   uint ii = 0;
   for (; ii < _scaledCornerTable->getCnt(); ii++) {
     extCorner* sc = _scaledCornerTable->get(ii);
@@ -3236,9 +3281,100 @@ void extMain::genScaledExt()
                       sc->_gndFactor);
   }
 }
+static void setLazyProperty(dbBlock* block, const char* name, double value)
+{
+  dbDoubleProperty* p = dbDoubleProperty::find(block, name);
+  if (p != NULL)
+    p->setValue(value);
+  else if (value != 1.0)
+    dbDoubleProperty::create(block, name, value);
+}
+static double getLazyProperty(dbBlock* block, const char* name)
+{
+  dbDoubleProperty* p = dbDoubleProperty::find(block, name);
+  if (p == NULL)
+    return 1.0;
+  return p->getValue();
+}
+void extMain::loadLazyRC()
+{
+  _pendingResFactor  = getLazyProperty(_block, "_pendingResFactor");
+  _pendingCcFactor   = getLazyProperty(_block, "_pendingCcFactor");
+  _pendingGndcFactor = getLazyProperty(_block, "_pendingGndcFactor");
+  dbIntProperty* p  = dbIntProperty::find(_block, "_lazyScaledCorners");
+  _lazyScaledCorners = p != NULL && p->getValue() != 0;
+}
+void extMain::saveLazyRC()
+{
+  setLazyProperty(_block, "_pendingResFactor", _pendingResFactor);
+  setLazyProperty(_block, "_pendingCcFactor", _pendingCcFactor);
+  setLazyProperty(_block, "_pendingGndcFactor", _pendingGndcFactor);
+  dbIntProperty* p = dbIntProperty::find(_block, "_lazyScaledCorners");
+  if (p != NULL)
+    p->setValue(_lazyScaledCorners ? 1 : 0);
+  else if (_lazyScaledCorners)
+    dbIntProperty::create(_block, "_lazyScaledCorners", 1);
+}
+void extMain::applyPendingAdjust()
+{
+  if (_pendingResFactor == 1.0 && _pendingCcFactor == 1.0
+      && _pendingGndcFactor == 1.0)
+    return;
+
+  _block->adjustRC(_pendingResFactor, _pendingCcFactor, _pendingGndcFactor);
+  _pendingResFactor  = 1.0;
+  _pendingCcFactor   = 1.0;
+  _pendingGndcFactor = 1.0;
+  saveLazyRC();
+}
+void extMain::applyLazyRC()
+{
+  applyPendingAdjust();
+  if (!_lazyScaledCorners)
+    return;
+
+  if (_scaledCornerTable == NULL)
+    getExtractedCorners();
+  _lazyScaledCorners = false;
+  genScaledExt(true);
+  saveLazyRC();
+}
+void extMain::getPendingAdjust(double& res, double& cc, double& gndc)
+{
+  res  = _pendingResFactor;
+  cc   = _pendingCcFactor;
+  gndc = _pendingGndcFactor;
+}
+void extMain::getLazyScale(int     dbIndex,
+                           int&    srcDbIndex,
+                           double& res,
+                           double& cc,
+                           double& gndc)
+{
+  srcDbIndex = dbIndex;
+  getPendingAdjust(res, cc, gndc);
+  if (!_lazyScaledCorners)
+    return;
+
+  if (_scaledCornerTable == NULL)
+    getExtractedCorners();
+  if (_scaledCornerTable == NULL)
+    return;
+  for (uint ii = 0; ii < _scaledCornerTable->getCnt(); ii++) {
+    extCorner* sc = _scaledCornerTable->get(ii);
+    if (sc->_dbIndex != dbIndex || sc->_extCornerPtr == NULL)
+      continue;
+    srcDbIndex = sc->_extCornerPtr->_dbIndex;
+    res *= sc->_resFactor;
+    cc *= sc->_ccFactor;
+    gndc *= sc->_gndFactor;
+    return;
+  }
+}
 
 double extMain::getTotalNetCap(uint netId, uint cornerNum)
 {
+  applyLazyRC();
   dbNet* net = dbNet::getNet(_block, netId);
 
   dbSet<dbCapNode> nodeSet = net->getCapNodes();
@@ -3285,6 +3421,7 @@ extSpef* extMain::getSpef()
 }
 uint extMain::write_spef_nets(bool flatten, bool parallel)
 {
+  applyLazyRC();
   return _spef->write_spef_nets(flatten, parallel);
 }
 
@@ -3310,6 +3447,7 @@ uint extMain::writeSPEF(uint        netId,
     return 0;
 
   _spef->_db_ext_corner = n;
+  _spef->setupWriteScales();
 
   _spef->set_single_pi(single_pi);
   _spef->writeNet(net, 0.0, debug);
@@ -3386,7 +3524,8 @@ uint extMain::writeSPEF(char*       filename,
                         int         corner,
                         const char* corner_name,
                         bool        flatten,
-                        bool        parallel)
+                        bool        parallel,
+                        const char* reuseFile)
 {
   if (_block == NULL) {
     notice(0, "Can not write_spef. There's no block in db\n");
@@ -3399,6 +3538,8 @@ uint extMain::writeSPEF(char*       filename,
   }
   _spef->_termJxy = termJxy;
   _spef->incr_wRun();
+  if (flatten || parallel)
+    applyLazyRC();
 
   if (excludeCells && strcmp(excludeCells, "FULLINCRSPEF") == 0) {
     excludeCells  = NULL;
@@ -3444,6 +3585,18 @@ uint extMain::writeSPEF(char*       filename,
       return 0;
     _spef->_db_ext_corner         = n;
     _spef->_independentExtCorners = _independentExtCorners;
+    if (reuseFile && reuseFile[0] != '\0') {
+      if (filename && strcmp(reuseFile, filename) == 0)
+        notice(0, "Can not reuse spef file %s to overwrite it\n", filename);
+      else if (_spefReuseOk) {
+        _spef->_reuseSpefFile = reuseFile;
+        _spef->_reuseNetIds   = _ecoNetIds;
+      } else
+        notice(0,
+               "Parasitics changed beyond eco extraction since %s was "
+               "written; all nets are written\n",
+               reuseFile);
+    }
 
     std::vector<dbNet*> inets;
     ((dbBlock*) _block)->findSomeNet(netNames, inets);
@@ -3465,6 +3618,10 @@ uint extMain::writeSPEF(char*       filename,
                             parallel);
     if (initOnly)
       return cnt;
+    if (_spef->_netIndexWritten) {
+      _ecoNetIds.clear();
+      _spefReuseOk = true;
+    }
   }
   delete _spef;
   _spef = NULL;
@@ -3505,14 +3662,21 @@ uint extMain::readSPEF(char*       filename,
                        bool        moreToRead,
                        bool        diff,
                        bool        calib,
-                       int         app_print_limit)
+                       int         app_print_limit,
+                       uint        threadCnt,
+                       bool        streamDiff,
+                       bool        diffDetail)
 {
+  applyLazyRC();
   if (!_spef || _spef->getBlock() != _block) {
     if (_spef)
       delete _spef;
     _spef = new extSpef(_tech, _block, this);
   }
-  _spef->_moreToRead = moreToRead;
+  _spef->_moreToRead    = moreToRead;
+  _spef->_readThreadCnt = threadCnt;
+  _spef->_streamDiff    = streamDiff;
+  _spef->_diffDetail    = diffDetail;
   _spef->incr_rRun();
 
   _spef->setUseIdsFlag(useIds, diff, calib);
@@ -3520,8 +3684,10 @@ uint extMain::readSPEF(char*       filename,
     getPrevControl();
   _spef->_independentExtCorners = _independentExtCorners;
   _spef->setCornerCnt(_cornerCnt);
-  if (!diff && !calib)
-    _foreign = true;
+  if (!diff && !calib) {
+    _foreign     = true;
+    _spefReuseOk = false;
+  }
   if (diff) {
     if (!_extracted) {
       notice(0, "There is no extraction db !\n");
@@ -3649,9 +3815,80 @@ uint extMain::readSPEF(char*       filename,
 
   return cnt;
 }
+uint extMain::writeBinaryParasitics(const char* filename,
+                                    bool        float64,
+                                    bool        quiet)
+{
+  if (_block == NULL) {
+    notice(0, "Can not write parasitics. There's no block in db\n");
+    return 0;
+  }
+  int cntnet, cntrseg, cntcapn, cntcc;
+  _block->getExtCount(cntnet, cntrseg, cntcapn, cntcc);
+  if (cntrseg == 0 || cntcapn == 0) {
+    notice(0, "Can not write parasitics. There's no extraction data.\n");
+    return 0;
+  }
+  if (!_spef || _spef->getBlock() != _block) {
+    if (_spef)
+      delete _spef;
+    _spef = new extSpef(_tech, _block, this);
+  }
+  if (_extRun == 0) {
+    getPrevControl();
+    getExtractedCorners();
+  }
+  applyLazyRC();
+  _spef->preserveFlag(_foreign);
+  _spef->_independentExtCorners = _independentExtCorners;
+
+  uint cnt = _spef->writeBinary(filename, float64, quiet);
+
+  delete _spef;
+  _spef = NULL;
+  return cnt;
+}
+
+uint extMain::readBinaryParasitics(const char* filename,
+                                   char*       netNames,
+                                   bool        quiet)
+{
+  if (!_spef || _spef->getBlock() != _block) {
+    if (_spef)
+      delete _spef;
+    _spef = new extSpef(_tech, _block, this);
+  }
+  if (_extRun == 0)
+    getPrevControl();
+  applyLazyRC();
+  _spef->_independentExtCorners = _independentExtCorners;
+  _spef->setCornerCnt(_cornerCnt);
+  if (_extracted)
+    notice(0, "Warning: Read parasitics into extracted db !!\n");
+
+  std::vector<dbNet*> inets;
+  _block->findSomeNet(netNames, inets);
+
+  uint cnt     = _spef->readBinary(filename, inets, quiet);
+  bool foreign = _spef->getPreserveFlag();
+  delete _spef;
+  _spef = NULL;
+  if (cnt == 0)
+    return 0;
+
+  genScaledExt();
+  _foreign     = foreign;
+  _extracted   = true;
+  _spefReuseOk = false;
+  _extRun++;
+  updatePrevControl();
+  return cnt;
+}
+
 uint extMain::readSPEFincr(char* filename)
 {
   // assume header/name_map/ports same as first file
+  applyLazyRC();
 
   if (!_spef->setInSpef(filename, true))
     return 0;
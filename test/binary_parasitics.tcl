@@ -0,0 +1,26 @@
+source helpers.tcl
+
+read_lef sky130/sky130_tech.lef
+read_lef sky130/sky130_std_cell.lef
+
+read_def -order_wires gcd.def
+
+# Load via resistance info
+source set_resistance.tcl
+
+define_process_corner -ext_model_index 0 X
+extract_parasitics -ext_model_file ext_pattern.rules \
+      -max_res 0 -coupling_threshold 0.1
+
+# The extracted parasitics written out, dropped and read back in must give
+# the spef of the extraction.
+write_parasitics -binary -float64 binary_parasitics.rcxb
+rcx::remove_parasitics
+read_parasitics -binary binary_parasitics.rcxb
+
+set spef_file [make_result_file binary_parasitics.spef]
+write_spef $spef_file
+
+exec rm gcd.totCap binary_parasitics.rcxb
+
+diff_files gcd.spefok $spef_file
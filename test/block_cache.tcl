@@ -0,0 +1,32 @@
+source helpers.tcl
+
+read_lef sky130/sky130_tech.lef
+read_lef sky130/sky130_std_cell.lef
+
+read_def -order_wires gcd.def
+
+# Load via resistance info
+source set_resistance.tcl
+
+define_process_corner -ext_model_index 0 X
+
+# The first extraction misses and saves the block parasitics; after they
+# are dropped the second one reads them from the cache.
+file delete -force block_cache
+file mkdir block_cache
+extract_parasitics -ext_model_file ext_pattern.rules \
+      -max_res 0 -coupling_threshold 0.1 -block_cache block_cache
+set miss_file [make_result_file block_cache_miss.spef]
+write_spef $miss_file
+
+rcx::remove_parasitics
+extract_parasitics -ext_model_file ext_pattern.rules \
+      -max_res 0 -coupling_threshold 0.1 -block_cache block_cache
+set hit_file [make_result_file block_cache_hit.spef]
+write_spef $hit_file
+
+exec rm gcd.totCap
+file delete -force block_cache
+
+diff_files gcd.spefok $miss_file
+diff_files $miss_file $hit_file
@@ -0,0 +1,21 @@
+source helpers.tcl
+
+# Two plates across the whole window: the sides of the window have no flux,
+# so the cap is the parallel plate value 3.9 * eps0 * 20um / 1um, 6.9063e-16
+# F/um.
+set deck [make_result_file builtin_solver.deck]
+set fp [open $deck w]
+puts $fp "WINDOW X1=0; Y1=0; X2=20; Y2=2; DIEL=3.9;"
+puts $fp "POLY NAME=GND; COORD=0,0; 20,0; 20,0.1; 0,0.1; VOLT=0;"
+puts $fp "POLY NAME=M1_w1; COORD=0,1.1; 20,1.1; 20,1.2; 0,1.2; VOLT=1;"
+close $fp
+
+rcx::solve_deck $deck $deck.out builtin
+
+set fp [open $deck.out r]
+while { [gets $fp line] >= 0 } {
+  if { [regexp {Charge on (\S+) = (\S+)} $line ignore name charge] } {
+    puts "$name [format %.4e $charge]"
+  }
+}
+close $fp
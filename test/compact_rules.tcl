@@ -0,0 +1,9 @@
+source helpers.tcl
+
+# order 1 pieces interpolate between the measured spacings like the compute
+# tables do, so they give the same records
+verify_compact_rules -file ext_pattern.rules -order 1
+
+if { [catch { verify_compact_rules -file ext_pattern.rules -order 2 } msg] } {
+  puts $msg
+}
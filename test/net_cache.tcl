@@ -0,0 +1,27 @@
+source helpers.tcl
+
+read_lef sky130/sky130_tech.lef
+read_lef sky130/sky130_std_cell.lef
+
+read_def -order_wires gcd.def
+
+# Load via resistance info
+source set_resistance.tcl
+
+define_process_corner -ext_model_index 0 X
+
+# The first extraction fills the cache; after the parasitics are dropped
+# the second one restores every net from it.
+exec rm -f net_cache.ncc
+extract_parasitics -ext_model_file ext_pattern.rules \
+      -max_res 0 -coupling_threshold 0.1 -net_cache net_cache.ncc
+rcx::remove_parasitics
+extract_parasitics -ext_model_file ext_pattern.rules \
+      -max_res 0 -coupling_threshold 0.1 -net_cache net_cache.ncc
+
+set spef_file [make_result_file net_cache.spef]
+write_spef $spef_file
+
+exec rm gcd.totCap net_cache.ncc
+
+diff_files gcd.spefok $spef_file
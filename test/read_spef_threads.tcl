@@ -0,0 +1,19 @@
+source helpers.tcl
+
+read_lef sky130/sky130_tech.lef
+read_lef sky130/sky130_std_cell.lef
+
+read_def -order_wires gcd.def
+
+# The parasitics read with threads must be the ones read with a single
+# thread.
+bench_read_spef gcd.spefok
+set serial_file [make_result_file read_spef_serial.spef]
+write_spef $serial_file
+
+rcx::remove_parasitics
+bench_read_spef -threads 4 gcd.spefok
+set parallel_file [make_result_file read_spef_threads.spef]
+write_spef $parallel_file
+
+diff_files $serial_file $parallel_file
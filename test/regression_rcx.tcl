@@ -3,4 +3,12 @@ record_tests {
   generate_rules
   ext_pattern
   gcd 
+  builtin_solver
+  stub_solver
+  compact_rules
+  binary_parasitics
+  write_spef_reuse
+  net_cache
+  read_spef_threads
+  block_cache
 }
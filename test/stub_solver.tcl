@@ -0,0 +1,21 @@
+source helpers.tcl
+
+# A wire between two others 0.2um away on both sides: the stub couples it
+# to each of them by eps * 0.1 / 0.2 and to the substrate 1um below by
+# eps * 0.1 / 1, with eps = 3.9 * eps0.
+set deck [make_result_file stub_solver.deck]
+set fp [open $deck w]
+puts $fp "POLY NAME=M1_w0; COORD=0,1; 0.1,1; 0.1,1.1; 0,1.1; VOLT=0;"
+puts $fp "POLY NAME=M1_w1; COORD=0.3,1; 0.4,1; 0.4,1.1; 0.3,1.1; VOLT=1;"
+puts $fp "POLY NAME=M1_w2; COORD=0.6,1; 0.7,1; 0.7,1.1; 0.6,1.1; VOLT=0;"
+close $fp
+
+rcx::solve_deck $deck $deck.out stub
+
+set fp [open $deck.out r]
+while { [gets $fp line] >= 0 } {
+  if { [regexp {Charge on (\S+) = (\S+)} $line ignore name charge] } {
+    puts "$name [format %.4e $charge]"
+  }
+}
+close $fp
@@ -0,0 +1,23 @@
+source helpers.tcl
+
+read_lef sky130/sky130_tech.lef
+read_lef sky130/sky130_std_cell.lef
+
+read_def -order_wires gcd.def
+
+# Load via resistance info
+source set_resistance.tcl
+
+define_process_corner -ext_model_index 0 X
+extract_parasitics -ext_model_file ext_pattern.rules \
+      -max_res 0 -coupling_threshold 0.1
+
+# Nothing changed since the first spef was written, so the second one
+# copies every D_NET section of it.
+write_spef write_spef_reuse.spef
+set spef_file [make_result_file write_spef_reuse.spef]
+write_spef $spef_file -reuse write_spef_reuse.spef
+
+exec rm gcd.totCap write_spef_reuse.spef write_spef_reuse.spef.idx
+
+diff_files gcd.spefok $spef_file